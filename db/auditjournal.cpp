@@ -0,0 +1,655 @@
+#include "auditjournal.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kSegmentMagic[8] = {'H', 'I', 'S', 'J', 'R', 'N', 'L', '1'};
+constexpr quint32 kSegmentVersion = 1;
+constexpr qint64 kSegmentHeaderSize = 32;
+
+constexpr quint32 kRecordMagic = 0x52445541; // "AUDR"
+constexpr qint64 kRecordHeaderSize = 40;
+constexpr qint64 kTrailerSize = 8;
+constexpr qint64 kIndexStride = 256;
+constexpr qint64 kIndexEntrySize = 24;
+
+// 记录头各字段偏移（小端）。
+enum : int {
+    OffMagic = 0,
+    OffLength = 4,
+    OffSeq = 8,
+    OffTs = 16,
+    OffAction = 24,
+    OffEntity = 26,
+    OffUserLen = 28,
+    OffEntityIdLen = 30,
+    OffTemplateLen = 32,
+    OffDetailLen = 36,
+};
+
+quint32 crc32(const uchar* data, qint64 size)
+{
+    static const auto table = [] {
+        std::array<quint32, 256> t{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    quint32 c = 0xFFFFFFFFu;
+    for (qint64 i = 0; i < size; ++i) {
+        c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+T load(const uchar* p)
+{
+    return qFromLittleEndian<T>(p);
+}
+
+template <typename T>
+void store(uchar* p, T v)
+{
+    qToLittleEndian<T>(v, p);
+}
+
+qint64 align8(qint64 n)
+{
+    return (n + 7) & ~qint64(7);
+}
+
+QString segmentName(qint64 firstSeq)
+{
+    return QStringLiteral("%1.seg").arg(firstSeq, 20, 10, QLatin1Char('0'));
+}
+
+QString indexPath(const QString& segmentPath)
+{
+    auto p = segmentPath;
+    p.chop(4);
+    return p + QStringLiteral(".idx");
+}
+
+QStringList listSegments(const QString& dir)
+{
+    // 文件名是补零的首序号，按名字排序即按序号排序。
+    return QDir(dir).entryList({QStringLiteral("*.seg")}, QDir::Files, QDir::Name);
+}
+
+// [offset, limit) 内从 offset 开始的一条记录是否完整；完整时返回其长度，否则返回 0。
+qint64 checkRecord(const uchar* data, qint64 offset, qint64 limit, bool verifyCrc)
+{
+    if (limit - offset < kRecordHeaderSize + kTrailerSize) {
+        return 0;
+    }
+    const uchar* r = data + offset;
+    if (load<quint32>(r + OffMagic) != kRecordMagic) {
+        return 0;
+    }
+    const qint64 length = load<quint32>(r + OffLength);
+    if (length < kRecordHeaderSize + kTrailerSize || (length & 7) != 0 || offset + length > limit) {
+        return 0;
+    }
+    const uchar* trailer = r + length - kTrailerSize;
+    if (load<quint32>(trailer + 4) != length) {
+        return 0;
+    }
+    if (verifyCrc) {
+        const qint64 payload = qint64(load<quint16>(r + OffUserLen)) + load<quint16>(r + OffEntityIdLen)
+                               + load<quint16>(r + OffTemplateLen) + load<quint32>(r + OffDetailLen);
+        if (kRecordHeaderSize + payload + kTrailerSize > length
+            || crc32(r, kRecordHeaderSize + payload) != load<quint32>(trailer)) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+// 从 offset 起顺序校验，返回最后一条完整记录的终点。
+qint64 scanValidEnd(const uchar* data, qint64 offset, qint64 limit, qint64* lastSeq, qint64* records)
+{
+    while (offset < limit) {
+        const qint64 length = checkRecord(data, offset, limit, true);
+        if (length == 0) {
+            break;
+        }
+        if (lastSeq) {
+            *lastSeq = load<qint64>(data + offset + OffSeq);
+        }
+        if (records) {
+            ++*records;
+        }
+        offset += length;
+    }
+    return offset;
+}
+
+QByteArray truncatedUtf8(const QString& s, int maxBytes)
+{
+    auto bytes = s.toUtf8();
+    if (bytes.size() <= maxBytes) {
+        return bytes;
+    }
+    // 不截断在多字节字符中间。
+    int n = maxBytes;
+    while (n > 0 && (static_cast<uchar>(bytes.at(n)) & 0xC0) == 0x80) {
+        --n;
+    }
+    bytes.truncate(n);
+    return bytes;
+}
+
+}
+
+// ---------------------------------------------------------------- writer
+
+AuditJournalWriter::AuditJournalWriter(const QString& dir, qint64 maxSegmentBytes)
+    : m_dir(dir), m_maxBytes(qMax<qint64>(maxSegmentBytes, 64 * 1024))
+{
+}
+
+AuditJournalWriter::~AuditJournalWriter()
+{
+    flush();
+}
+
+bool AuditJournalWriter::open(qint64 minNextSeq, QString* error)
+{
+    if (!QDir().mkpath(m_dir)) {
+        if (error) {
+            *error = QStringLiteral("无法创建日志目录 %1").arg(m_dir);
+        }
+        return false;
+    }
+
+    const auto segments = listSegments(m_dir);
+    if (segments.isEmpty()) {
+        m_nextSeq = qMax<qint64>(1, minNextSeq);
+        return startSegment(error);
+    }
+
+    const auto path = QDir(m_dir).filePath(segments.constLast());
+    m_segment.setFileName(path);
+    m_index.setFileName(indexPath(path));
+    if (!m_segment.open(QIODevice::ReadWrite) || !m_index.open(QIODevice::ReadWrite)) {
+        if (error) {
+            *error = m_segment.isOpen() ? m_index.errorString() : m_segment.errorString();
+        }
+        return false;
+    }
+
+    const qint64 size = m_segment.size();
+    if (size < kSegmentHeaderSize) {
+        // 刚建段就中断，段头都没写完：按文件名里的首序号重建这一段。
+        m_nextSeq = qMax(QFileInfo(path).completeBaseName().toLongLong(), minNextSeq);
+        return startSegment(error);
+    }
+    uchar* data = m_segment.map(0, size);
+    if (!data || memcmp(data, kSegmentMagic, sizeof(kSegmentMagic)) != 0) {
+        if (error) {
+            *error = QStringLiteral("日志段文件损坏：%1").arg(path);
+        }
+        return false;
+    }
+
+    // 从最后一个仍在有效范围内的索引项开始校验，不必扫整段。
+    qint64 lastSeq = load<qint64>(data + 16) - 1;
+    qint64 from = kSegmentHeaderSize;
+    qint64 records = 0;
+    const QByteArray idx = m_index.readAll();
+    qint64 keep = 0;
+    for (qint64 i = 0; i + kIndexEntrySize <= idx.size(); i += kIndexEntrySize) {
+        const auto* e = reinterpret_cast<const uchar*>(idx.constData()) + i;
+        const qint64 offset = load<qint64>(e + 16);
+        if (checkRecord(data, offset, size, true) == 0) {
+            break;
+        }
+        from = offset;
+        records = (i / kIndexEntrySize) * kIndexStride;
+        keep = i + kIndexEntrySize;
+    }
+    const qint64 validEnd = scanValidEnd(data, from, size, &lastSeq, &records);
+    m_segment.unmap(data);
+
+    // 截掉崩溃时只写了一半的记录和指向它们的索引项。
+    if ((validEnd < size && !m_segment.resize(validEnd)) || (keep < idx.size() && !m_index.resize(keep))) {
+        if (error) {
+            *error = m_segment.errorString();
+        }
+        return false;
+    }
+    m_segment.seek(validEnd);
+    m_index.seek(keep);
+    m_size = validEnd;
+    m_records = records;
+    m_nextSeq = qMax(lastSeq + 1, minNextSeq);
+    return true;
+}
+
+bool AuditJournalWriter::startSegment(QString* error)
+{
+    if (m_segment.isOpen()) {
+        m_segment.close();
+        m_index.close();
+    }
+
+    const auto path = QDir(m_dir).filePath(segmentName(m_nextSeq));
+    m_segment.setFileName(path);
+    m_index.setFileName(indexPath(path));
+    if (!m_segment.open(QIODevice::ReadWrite | QIODevice::Truncate)
+        || !m_index.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        if (error) {
+            *error = m_segment.isOpen() ? m_index.errorString() : m_segment.errorString();
+        }
+        return false;
+    }
+
+    QByteArray header(kSegmentHeaderSize, '\0');
+    auto* h = reinterpret_cast<uchar*>(header.data());
+    memcpy(h, kSegmentMagic, sizeof(kSegmentMagic));
+    store<quint32>(h + 8, kSegmentVersion);
+    store<quint32>(h + 12, quint32(kSegmentHeaderSize));
+    store<qint64>(h + 16, m_nextSeq);
+    store<qint64>(h + 24, QDateTime::currentMSecsSinceEpoch());
+    if (m_segment.write(header) != header.size()) {
+        if (error) {
+            *error = m_segment.errorString();
+        }
+        return false;
+    }
+    m_size = kSegmentHeaderSize;
+    m_records = 0;
+    return true;
+}
+
+bool AuditJournalWriter::writeIndexEntry(qint64 seq, qint64 tsMs, qint64 offset, QString* error)
+{
+    uchar e[kIndexEntrySize];
+    store<qint64>(e, seq);
+    store<qint64>(e + 8, tsMs);
+    store<qint64>(e + 16, offset);
+    if (m_index.write(reinterpret_cast<const char*>(e), kIndexEntrySize) != kIndexEntrySize) {
+        if (error) {
+            *error = m_index.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+qint64 AuditJournalWriter::append(const AuditJournalRecord& record, QString* error)
+{
+    const auto user = truncatedUtf8(record.userId, 0xFFFF);
+    const auto entityId = truncatedUtf8(record.entityId, 0xFFFF);
+    const auto tmpl = truncatedUtf8(record.templateText, 0xFFFF);
+    const auto detail = record.detail.toUtf8();
+
+    const qint64 payload = user.size() + entityId.size() + tmpl.size() + detail.size();
+    const qint64 length = align8(kRecordHeaderSize + payload) + kTrailerSize;
+
+    if (m_records > 0 && m_size + length > m_maxBytes) {
+        if (!flush(error) || !startSegment(error)) {
+            return -1;
+        }
+    }
+
+    const qint64 seq = m_nextSeq;
+    QByteArray buf(length, '\0');
+    auto* r = reinterpret_cast<uchar*>(buf.data());
+    store<quint32>(r + OffMagic, kRecordMagic);
+    store<quint32>(r + OffLength, quint32(length));
+    store<qint64>(r + OffSeq, seq);
+    store<qint64>(r + OffTs, record.tsMs);
+    store<quint16>(r + OffAction, quint16(record.action));
+    store<quint16>(r + OffEntity, quint16(record.entity));
+    store<quint16>(r + OffUserLen, quint16(user.size()));
+    store<quint16>(r + OffEntityIdLen, quint16(entityId.size()));
+    store<quint16>(r + OffTemplateLen, quint16(tmpl.size()));
+    store<quint32>(r + OffDetailLen, quint32(detail.size()));
+
+    auto* p = r + kRecordHeaderSize;
+    for (const auto* field : {&user, &entityId, &tmpl, &detail}) {
+        memcpy(p, field->constData(), size_t(field->size()));
+        p += field->size();
+    }
+    uchar* trailer = r + length - kTrailerSize;
+    store<quint32>(trailer, crc32(r, kRecordHeaderSize + payload));
+    store<quint32>(trailer + 4, quint32(length));
+
+    if (m_segment.write(buf) != buf.size()) {
+        if (error) {
+            *error = m_segment.errorString();
+        }
+        return -1;
+    }
+    if (m_records % kIndexStride == 0 && !writeIndexEntry(seq, record.tsMs, m_size, error)) {
+        return -1;
+    }
+    m_size += length;
+    ++m_records;
+    ++m_nextSeq;
+    return seq;
+}
+
+bool AuditJournalWriter::flush(QString* error)
+{
+    if (!m_segment.isOpen()) {
+        return true;
+    }
+    // 先段后索引：索引项只会指向已经写出的记录。
+    if (!m_segment.flush() || !m_index.flush()) {
+        if (error) {
+            *error = m_segment.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+bool AuditJournalWriter::sync(QString* error)
+{
+    if (!flush(error)) {
+        return false;
+    }
+    if (!m_segment.isOpen()) {
+        return true;
+    }
+    // 索引只用来加速定位，缺了读端会顺扫，只需保证段文件落盘。
+#ifdef Q_OS_WIN
+    const bool ok = ::_commit(m_segment.handle()) == 0;
+#else
+    const bool ok = ::fsync(m_segment.handle()) == 0;
+#endif
+    if (!ok && error) {
+        *error = QStringLiteral("无法把日志文件写入磁盘：%1").arg(m_segment.fileName());
+    }
+    return ok;
+}
+
+// ---------------------------------------------------------------- reader
+
+bool AuditJournalReader::View::contains(const QByteArray& utf8) const
+{
+    return raw(Field::Template).contains(utf8) || raw(Field::Detail).contains(utf8) || raw(Field::EntityId).contains(utf8);
+}
+
+QByteArray AuditJournalReader::View::raw(Field field) const
+{
+    if (!m_record) {
+        return {};
+    }
+    const qint64 lens[] = {
+        load<quint16>(m_record + OffUserLen),
+        load<quint16>(m_record + OffEntityIdLen),
+        load<quint16>(m_record + OffTemplateLen),
+        load<quint32>(m_record + OffDetailLen),
+    };
+    const int i = static_cast<int>(field);
+    qint64 offset = kRecordHeaderSize;
+    for (int k = 0; k < i; ++k) {
+        offset += lens[k];
+    }
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(m_record + offset), int(lens[i]));
+}
+
+AuditJournalReader::AuditJournalReader(const QString& dir)
+    : m_dir(dir)
+{
+}
+
+AuditJournalReader::~AuditJournalReader()
+{
+    for (auto& s : m_segments) {
+        if (s->data) {
+            s->file->unmap(s->data);
+        }
+    }
+}
+
+bool AuditJournalReader::mapSegment(Segment& s, QString* error)
+{
+    const qint64 size = QFileInfo(s.path).size();
+    if (size <= s.mapped) {
+        return true;
+    }
+    if (!s.file) {
+        s.file = std::make_unique<QFile>(s.path);
+        if (!s.file->open(QIODevice::ReadOnly)) {
+            if (error) {
+                *error = s.file->errorString();
+            }
+            s.file.reset();
+            return false;
+        }
+    }
+    if (s.data) {
+        s.file->unmap(s.data);
+        s.data = nullptr;
+        s.mapped = 0;
+    }
+    s.data = s.file->map(0, size);
+    if (!s.data) {
+        if (error) {
+            *error = s.file->errorString();
+        }
+        return false;
+    }
+    s.mapped = size;
+
+    if (s.validEnd == 0) {
+        if (size < kSegmentHeaderSize || memcmp(s.data, kSegmentMagic, sizeof(kSegmentMagic)) != 0) {
+            if (error) {
+                *error = QStringLiteral("日志段文件损坏：%1").arg(s.path);
+            }
+            return false;
+        }
+        s.firstSeq = load<qint64>(s.data + 16);
+        s.validEnd = kSegmentHeaderSize;
+    }
+    // 写端可能正在追加，末尾不完整的记录留到下次刷新。
+    loadIndex(s);
+    const qint64 from = s.index.isEmpty() ? s.validEnd : qMax(s.validEnd, s.index.constLast().offset);
+    s.validEnd = scanValidEnd(s.data, from, s.mapped, nullptr, nullptr);
+    return true;
+}
+
+void AuditJournalReader::loadIndex(Segment& s)
+{
+    QFile f(indexPath(s.path));
+    if (!f.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    f.seek(s.index.size() * kIndexEntrySize);
+    const QByteArray bytes = f.readAll();
+    for (qint64 i = 0; i + kIndexEntrySize <= bytes.size(); i += kIndexEntrySize) {
+        const auto* e = reinterpret_cast<const uchar*>(bytes.constData()) + i;
+        IndexEntry entry;
+        entry.seq = load<qint64>(e);
+        entry.tsMs = load<qint64>(e + 8);
+        entry.offset = load<qint64>(e + 16);
+        if (entry.offset >= s.mapped) {
+            break;
+        }
+        s.index.append(entry);
+    }
+}
+
+bool AuditJournalReader::refresh(QString* error)
+{
+    const auto names = listSegments(m_dir);
+    for (const auto& name : names) {
+        const auto path = QDir(m_dir).filePath(name);
+        const bool known = std::any_of(m_segments.begin(), m_segments.end(), [&](const auto& s) { return s->path == path; });
+        if (!known) {
+            auto s = std::make_unique<Segment>();
+            s->path = path;
+            m_segments.push_back(std::move(s));
+        }
+    }
+    for (auto& s : m_segments) {
+        if (!mapSegment(*s, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AuditJournalReader::isEmpty() const
+{
+    return std::all_of(m_segments.begin(), m_segments.end(), [](const auto& s) { return s->validEnd <= kSegmentHeaderSize; });
+}
+
+AuditJournalReader::Position AuditJournalReader::begin() const
+{
+    return {0, kSegmentHeaderSize};
+}
+
+AuditJournalReader::Position AuditJournalReader::end() const
+{
+    if (m_segments.empty()) {
+        return {0, kSegmentHeaderSize};
+    }
+    return {int(m_segments.size()) - 1, m_segments.back()->validEnd};
+}
+
+template <typename Key>
+AuditJournalReader::Position AuditJournalReader::seekBy(Key key) const
+{
+    // 先按各段第一个索引项定位段，再在段内索引上二分，最后顺扫到第一条满足条件的记录。
+    int seg = 0;
+    for (int i = 0; i < int(m_segments.size()); ++i) {
+        const auto& idx = m_segments[size_t(i)]->index;
+        if (!idx.isEmpty() && key.before(idx.constFirst())) {
+            break;
+        }
+        seg = i;
+    }
+    if (m_segments.empty()) {
+        return begin();
+    }
+
+    const auto& s = *m_segments[size_t(seg)];
+    auto it = std::partition_point(s.index.begin(), s.index.end(), [&](const IndexEntry& e) { return !key.before(e); });
+    Position pos{seg, it == s.index.begin() ? kSegmentHeaderSize : (it - 1)->offset};
+
+    View v;
+    Position probe = pos;
+    while (next(&probe, &v)) {
+        if (key.reached(v)) {
+            return pos;
+        }
+        pos = probe;
+    }
+    return pos;
+}
+
+AuditJournalReader::Position AuditJournalReader::seekSeq(qint64 seq) const
+{
+    struct
+    {
+        qint64 seq;
+        bool before(const IndexEntry& e) const { return seq < e.seq; }
+        bool reached(const View& v) const { return v.seq >= seq; }
+    } key{seq};
+    return seekBy(key);
+}
+
+AuditJournalReader::Position AuditJournalReader::seekTime(qint64 tsMs) const
+{
+    struct
+    {
+        qint64 ts;
+        bool before(const IndexEntry& e) const { return ts < e.tsMs; }
+        bool reached(const View& v) const { return v.tsMs >= ts; }
+    } key{tsMs};
+    return seekBy(key);
+}
+
+AuditJournalReader::View AuditJournalReader::at(int segment, qint64 offset) const
+{
+    View v;
+    if (segment < 0 || segment >= int(m_segments.size())) {
+        return v;
+    }
+    const auto& s = *m_segments[size_t(segment)];
+    if (checkRecord(s.data, offset, s.validEnd, false) == 0) {
+        return v;
+    }
+    const uchar* r = s.data + offset;
+    v.m_record = r;
+    v.seq = load<qint64>(r + OffSeq);
+    v.tsMs = load<qint64>(r + OffTs);
+    v.action = load<quint16>(r + OffAction);
+    v.entity = load<quint16>(r + OffEntity);
+    v.segment = segment;
+    v.offset = offset;
+    return v;
+}
+
+bool AuditJournalReader::next(Position* pos, View* out) const
+{
+    while (pos->segment < int(m_segments.size())) {
+        const auto& s = *m_segments[size_t(pos->segment)];
+        if (pos->offset < s.validEnd) {
+            *out = at(pos->segment, pos->offset);
+            if (!out->isValid()) {
+                return false;
+            }
+            pos->offset += load<quint32>(s.data + pos->offset + OffLength);
+            return true;
+        }
+        // 只有已封存的段才跨到下一段；最后一段读到有效末尾即停。
+        if (pos->segment + 1 >= int(m_segments.size())) {
+            return false;
+        }
+        ++pos->segment;
+        pos->offset = kSegmentHeaderSize;
+    }
+    return false;
+}
+
+bool AuditJournalReader::previous(Position* pos, View* out) const
+{
+    while (pos->segment >= 0 && pos->segment < int(m_segments.size())) {
+        const auto& s = *m_segments[size_t(pos->segment)];
+        if (pos->offset > kSegmentHeaderSize && pos->offset <= s.validEnd) {
+            const qint64 length = load<quint32>(s.data + pos->offset - kTrailerSize + 4);
+            const qint64 start = pos->offset - length;
+            if (start < kSegmentHeaderSize) {
+                return false;
+            }
+            *out = at(pos->segment, start);
+            if (!out->isValid()) {
+                return false;
+            }
+            pos->offset = start;
+            return true;
+        }
+        if (pos->segment == 0) {
+            return false;
+        }
+        --pos->segment;
+        pos->offset = m_segments[size_t(pos->segment)]->validEnd;
+    }
+    return false;
+}
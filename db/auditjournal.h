@@ -0,0 +1,150 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+// 审计日志的追加式二进制段文件（HistoryLogger 的可选后端）。
+// 段文件 = 32 字节段头 + 若干记录；记录 = 40 字节定长头 + UTF-8 字段 + 对齐填充 + 8 字节尾（CRC32、总长）。
+// 尾部带总长，可以从任意记录边界向前遍历；写满 maxSegmentBytes 后换新段。
+// 每段旁有 .idx 稀疏索引：每 256 条记一项 (seq, 时间, 偏移)，按序号或时间定位时先查它再顺扫。
+// 读端用 QFile::map 映射整段，View 直接指向映射内存，不复制记录。
+
+struct AuditJournalRecord
+{
+    qint64 tsMs = 0;
+    int action = 0;
+    int entity = 0;
+    QString userId;
+    QString entityId;
+    QString templateText;
+    QString detail;
+};
+
+class AuditJournalWriter final
+{
+public:
+    static constexpr qint64 kDefaultSegmentBytes = 64 * 1024 * 1024;
+
+    explicit AuditJournalWriter(const QString& dir, qint64 maxSegmentBytes = kDefaultSegmentBytes);
+    ~AuditJournalWriter();
+
+    AuditJournalWriter(const AuditJournalWriter&) = delete;
+    AuditJournalWriter& operator=(const AuditJournalWriter&) = delete;
+
+    // 打开最后一段并截掉崩溃留下的残缺尾部；序号从 max(已有最大序号 + 1, minNextSeq) 继续。
+    bool open(qint64 minNextSeq, QString* error = nullptr);
+    // 返回分配的序号，出错返回 -1。
+    qint64 append(const AuditJournalRecord& record, QString* error = nullptr);
+    // 把缓冲写到操作系统（不强制落盘）。
+    bool flush(QString* error = nullptr);
+    // flush() 之后再让操作系统把段文件落盘，返回 true 时这之前追加的记录断电也不会丢。
+    bool sync(QString* error = nullptr);
+
+    qint64 nextSeq() const { return m_nextSeq; }
+
+private:
+    bool startSegment(QString* error);
+    bool writeIndexEntry(qint64 seq, qint64 tsMs, qint64 offset, QString* error);
+
+    QString m_dir;
+    qint64 m_maxBytes = kDefaultSegmentBytes;
+    QFile m_segment;
+    QFile m_index;
+    qint64 m_size = 0;
+    qint64 m_records = 0;
+    qint64 m_nextSeq = 1;
+};
+
+class AuditJournalReader final
+{
+public:
+    // 记录边界：向后遍历时指向下一条的起点，向前遍历时指向上一条的终点。
+    struct Position
+    {
+        int segment = 0;
+        qint64 offset = 0;
+    };
+
+    class View
+    {
+    public:
+        qint64 seq = 0;
+        qint64 tsMs = 0;
+        int action = 0;
+        int entity = 0;
+        int segment = -1;
+        qint64 offset = 0;
+
+        bool isValid() const { return m_record != nullptr; }
+
+        QString userId() const { return QString::fromUtf8(raw(Field::User)); }
+        QString entityId() const { return QString::fromUtf8(raw(Field::EntityId)); }
+        QString templateText() const { return QString::fromUtf8(raw(Field::Template)); }
+        QString detail() const { return QString::fromUtf8(raw(Field::Detail)); }
+
+        // 在模板、明细、实体 ID 的原始字节里查找子串，不解码。
+        bool contains(const QByteArray& utf8) const;
+
+    private:
+        friend class AuditJournalReader;
+        enum class Field { User, EntityId, Template, Detail };
+
+        // 引用映射内存，Reader::refresh() 之后失效。
+        QByteArray raw(Field field) const;
+
+        const uchar* m_record = nullptr;
+    };
+
+    explicit AuditJournalReader(const QString& dir);
+    ~AuditJournalReader();
+
+    AuditJournalReader(const AuditJournalReader&) = delete;
+    AuditJournalReader& operator=(const AuditJournalReader&) = delete;
+
+    // 映射新增的段并延伸最后一段的有效范围；已有的 Position 在刷新后仍然有效。
+    bool refresh(QString* error = nullptr);
+
+    bool isEmpty() const;
+    Position begin() const;
+    Position end() const;
+    // 第一条序号 >= seq 的位置。
+    Position seekSeq(qint64 seq) const;
+    // 第一条时间 >= tsMs 的大致位置（按写入顺序视时间为单调）。
+    Position seekTime(qint64 tsMs) const;
+
+    bool next(Position* pos, View* out) const;
+    bool previous(Position* pos, View* out) const;
+    View at(int segment, qint64 offset) const;
+
+private:
+    struct IndexEntry
+    {
+        qint64 seq = 0;
+        qint64 tsMs = 0;
+        qint64 offset = 0;
+    };
+
+    struct Segment
+    {
+        QString path;
+        std::unique_ptr<QFile> file;
+        uchar* data = nullptr;
+        qint64 mapped = 0;
+        qint64 validEnd = 0;
+        qint64 firstSeq = 0;
+        QVector<IndexEntry> index;
+    };
+
+    bool mapSegment(Segment& s, QString* error);
+    void loadIndex(Segment& s);
+    template <typename Key>
+    Position seekBy(Key key) const;
+
+    QString m_dir;
+    std::vector<std::unique_ptr<Segment>> m_segments;
+};
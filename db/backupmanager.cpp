@@ -0,0 +1,352 @@
+#include "backupmanager.h"
+
+#include "db/dbmanager.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <QTemporaryFile>
+#include <QThread>
+
+#include <sqlite3.h>
+#include <zlib.h>
+
+namespace {
+
+// 每步拷多少页（默认页大小 4 KiB 时约 256 KiB），步间停顿让出磁盘。
+constexpr int kPagesPerStep = 64;
+constexpr unsigned long kPauseMs = 10;
+constexpr int kDefaultIntervalHours = 24;
+constexpr int kDefaultKeep = 7;
+constexpr int kIoBytes = 1024 * 1024;
+// 进度每拷这么多步报一次。
+constexpr int kProgressSteps = 16;
+
+const QString kGroup = QStringLiteral("Backup");
+const QString kPrefix = QStringLiteral("hospital-");
+
+QString sqliteError(sqlite3* h, const QString& what)
+{
+    return QStringLiteral("%1: %2").arg(what, QString::fromUtf8(h ? sqlite3_errmsg(h) : "out of memory"));
+}
+
+// 备份源单独用 SQLite C 接口只读打开，不借用 QSQLITE 驱动的句柄：
+// Qt 自带的驱动通常静态编进了它自己的 SQLite，与这里链接的系统库不是同一份代码。
+sqlite3* openSource(const QString& path, QString* error)
+{
+    sqlite3* h = nullptr;
+    if (sqlite3_open_v2(QFile::encodeName(path).constData(), &h, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        *error = sqliteError(h, path);
+        sqlite3_close(h);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(h, 5000);
+    return h;
+}
+
+bool integrityCheck(sqlite3* h, QString* error)
+{
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(h, "PRAGMA integrity_check;", -1, &stmt, nullptr) != SQLITE_OK) {
+        *error = sqliteError(h, QStringLiteral("integrity_check"));
+        return false;
+    }
+    QStringList problems;
+    int rc = SQLITE_ROW;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const auto line = QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        if (line != QStringLiteral("ok")) {
+            problems << line;
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        *error = sqliteError(h, QStringLiteral("integrity_check"));
+        return false;
+    }
+    if (!problems.isEmpty()) {
+        *error = QStringLiteral("备份校验失败：%1").arg(problems.mid(0, 5).join(QStringLiteral("；")));
+        return false;
+    }
+    return true;
+}
+
+bool checkFile(const QString& path, QString* error)
+{
+    sqlite3* h = nullptr;
+    if (sqlite3_open_v2(QFile::encodeName(path).constData(), &h, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        *error = sqliteError(h, path);
+        sqlite3_close(h);
+        return false;
+    }
+    const bool ok = integrityCheck(h, error);
+    sqlite3_close(h);
+    return ok;
+}
+
+bool stopped(const std::atomic_bool* stop)
+{
+    return stop && stop->load();
+}
+
+// 流式压缩，返回原文件的 CRC 供回读校验。stop 置位时中途返回 false（error 不填）。
+bool gzipFile(const QString& from, const QString& to, uLong* crc, const std::atomic_bool* stop, QString* error)
+{
+    QFile in(from);
+    if (!in.open(QIODevice::ReadOnly)) {
+        *error = in.errorString();
+        return false;
+    }
+    gzFile out = gzopen(QFile::encodeName(to).constData(), "wb6");
+    if (!out) {
+        *error = QStringLiteral("无法创建 %1").arg(to);
+        return false;
+    }
+    *crc = crc32(0L, Z_NULL, 0);
+    QByteArray buf(kIoBytes, Qt::Uninitialized);
+    bool ok = true;
+    for (;;) {
+        if (stopped(stop)) {
+            ok = false;
+            break;
+        }
+        const qint64 n = in.read(buf.data(), buf.size());
+        if (n < 0) {
+            *error = in.errorString();
+            ok = false;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        *crc = crc32(*crc, reinterpret_cast<const Bytef*>(buf.constData()), uInt(n));
+        if (gzwrite(out, buf.constData(), unsigned(n)) != int(n)) {
+            *error = QStringLiteral("写入 %1 失败").arg(to);
+            ok = false;
+            break;
+        }
+    }
+    if (gzclose(out) != Z_OK && ok) {
+        *error = QStringLiteral("写入 %1 失败").arg(to);
+        ok = false;
+    }
+    return ok;
+}
+
+// 解压到 to；expectedCrc 非空时只读不写，比对内容 CRC。stop 的含义同 gzipFile。
+bool gunzipFile(const QString& from, const QString& to, const uLong* expectedCrc, const std::atomic_bool* stop, QString* error)
+{
+    gzFile in = gzopen(QFile::encodeName(from).constData(), "rb");
+    if (!in) {
+        *error = QStringLiteral("无法打开 %1").arg(from);
+        return false;
+    }
+    QFile out(to);
+    if (!to.isEmpty() && !out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = out.errorString();
+        gzclose(in);
+        return false;
+    }
+    uLong crc = crc32(0L, Z_NULL, 0);
+    QByteArray buf(kIoBytes, Qt::Uninitialized);
+    bool ok = true;
+    for (;;) {
+        if (stopped(stop)) {
+            ok = false;
+            break;
+        }
+        const int n = gzread(in, buf.data(), unsigned(buf.size()));
+        if (n < 0) {
+            *error = QStringLiteral("%1 已损坏").arg(from);
+            ok = false;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(buf.constData()), uInt(n));
+        if (out.isOpen() && out.write(buf.constData(), n) != n) {
+            *error = out.errorString();
+            ok = false;
+            break;
+        }
+    }
+    gzclose(in);
+    if (ok && expectedCrc && crc != *expectedCrc) {
+        *error = QStringLiteral("%1 回读校验不一致").arg(from);
+        ok = false;
+    }
+    return ok;
+}
+
+}
+
+BackupManager::BackupManager(QObject* parent)
+    : QObject(parent)
+{
+    m_job = new PeriodicJob([this](const std::shared_ptr<std::atomic_bool>& stop) { run(this, stop); }, this);
+}
+
+BackupManager::~BackupManager()
+{
+    stop();
+}
+
+QString BackupManager::backupDir()
+{
+    return PeriodicJob::dir(kGroup, QStringLiteral("backup"));
+}
+
+int BackupManager::intervalHours()
+{
+    return PeriodicJob::intervalHours(kGroup, kDefaultIntervalHours);
+}
+
+int BackupManager::keepCount()
+{
+    return PeriodicJob::keepCount(kGroup, kDefaultKeep);
+}
+
+bool BackupManager::compress()
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    return settings.value(QStringLiteral("Backup/Compress"), true).toBool();
+}
+
+QVector<BackupManager::Backup> BackupManager::backups()
+{
+    // 文件名形如 hospital-yyyyMMdd-HHmmss.db[.gz]。
+    return PeriodicJob::files(backupDir(), kPrefix, {QStringLiteral(".db"), QStringLiteral(".db.gz")});
+}
+
+bool BackupManager::verify(const QString& path, QString* error)
+{
+    QString err;
+    bool ok = false;
+    if (path.endsWith(QStringLiteral(".gz"))) {
+        QTemporaryFile tmp(QDir(backupDir()).filePath(QStringLiteral("verify-XXXXXX.db")));
+        if (!tmp.open()) {
+            err = tmp.errorString();
+        } else {
+            tmp.close();
+            ok = gunzipFile(path, tmp.fileName(), nullptr, nullptr, &err) && checkFile(tmp.fileName(), &err);
+        }
+    } else {
+        ok = checkFile(path, &err);
+    }
+    if (!ok && error) {
+        *error = err;
+    }
+    return ok;
+}
+
+void BackupManager::run(BackupManager* self, const std::shared_ptr<std::atomic_bool>& stop)
+{
+    QString err;
+    QString finalPath;
+    const QDir dir(backupDir());
+    const auto base = dir.filePath(PeriodicJob::fileName(kPrefix, QStringLiteral(".db")));
+    const auto partDb = base + QStringLiteral(".part");
+
+    if (!QDir().mkpath(dir.absolutePath())) {
+        err = QStringLiteral("无法创建备份目录 %1").arg(dir.absolutePath());
+    }
+
+    sqlite3* src = err.isEmpty() ? openSource(DbManager::instance().databasePath(), &err) : nullptr;
+    sqlite3* dst = nullptr;
+
+    // 读事务贯穿整个备份：快照固定，别的连接写入不会让备份重来；WAL 下也不挡写者。
+    // 代价是备份期间检查点推进不到快照之后，WAL 文件会暂时变大。
+    bool inSnapshot = false;
+    if (src) {
+        inSnapshot = sqlite3_exec(src, "BEGIN; SELECT COUNT(1) FROM sqlite_master;", nullptr, nullptr, nullptr) == SQLITE_OK;
+        if (!inSnapshot) {
+            err = sqliteError(src, QStringLiteral("begin"));
+        }
+    }
+
+    if (inSnapshot && err.isEmpty()) {
+        QFile::remove(partDb);
+        if (sqlite3_open_v2(QFile::encodeName(partDb).constData(), &dst, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr)
+            != SQLITE_OK) {
+            err = sqliteError(dst, partDb);
+        }
+    }
+
+    if (err.isEmpty() && dst) {
+        sqlite3_backup* backup = sqlite3_backup_init(dst, "main", src, "main");
+        if (!backup) {
+            err = sqliteError(dst, QStringLiteral("backup_init"));
+        } else {
+            int steps = 0;
+            int rc = SQLITE_OK;
+            while (!stop->load()) {
+                rc = sqlite3_backup_step(backup, kPagesPerStep);
+                if (rc == SQLITE_DONE) {
+                    break;
+                }
+                if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+                    break;
+                }
+                if (++steps % kProgressSteps == 0) {
+                    const int total = sqlite3_backup_pagecount(backup);
+                    const int done = total - sqlite3_backup_remaining(backup);
+                    QMetaObject::invokeMethod(self, [self, done, total] { emit self->progress(done, total); }, Qt::QueuedConnection);
+                }
+                QThread::msleep(kPauseMs);
+            }
+            sqlite3_backup_finish(backup);
+            if (!stop->load() && rc != SQLITE_DONE) {
+                err = sqliteError(dst, QStringLiteral("backup_step"));
+            }
+        }
+    }
+
+    if (inSnapshot) {
+        sqlite3_exec(src, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+    sqlite3_close(src);
+
+    // 源库是 WAL，拷出的文件头也带 WAL 标记；备份文件改回普通回滚日志模式，单文件即可打开。
+    if (err.isEmpty() && dst && !stop->load()) {
+        char* msg = nullptr;
+        if (sqlite3_exec(dst, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, &msg) != SQLITE_OK) {
+            err = QString::fromUtf8(msg);
+        }
+        sqlite3_free(msg);
+        if (err.isEmpty()) {
+            integrityCheck(dst, &err);
+        }
+    }
+    sqlite3_close(dst);
+
+    if (err.isEmpty() && !stop->load()) {
+        if (compress()) {
+            const auto partGz = base + QStringLiteral(".gz.part");
+            uLong crc = 0;
+            if (gzipFile(partDb, partGz, &crc, stop.get(), &err) && gunzipFile(partGz, {}, &crc, stop.get(), &err)) {
+                finalPath = base + QStringLiteral(".gz");
+                if (!QFile::rename(partGz, finalPath)) {
+                    err = QStringLiteral("无法写入 %1").arg(finalPath);
+                }
+            }
+            QFile::remove(partGz);
+        } else {
+            finalPath = base;
+            if (!QFile::rename(partDb, finalPath)) {
+                err = QStringLiteral("无法写入 %1").arg(finalPath);
+            }
+        }
+    }
+    QFile::remove(partDb);
+
+    if (err.isEmpty() && !finalPath.isEmpty()) {
+        PeriodicJob::prune(backups(), keepCount());
+    } else {
+        finalPath.clear();
+    }
+    if (!err.isEmpty()) {
+        qWarning("BackupManager: %s", qPrintable(err));
+    }
+    QMetaObject::invokeMethod(self, [self, finalPath, err] { emit self->finished(finalPath, err); }, Qt::QueuedConnection);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+#include "db/periodicjob.h"
+
+// 在线备份：后台连接上开一个读事务固定快照，用 SQLite 备份 API 每次拷几十页，步间停顿。
+// WAL 模式下读者不挡写者，前台写入不会被备份阻塞；快照固定后备份也不会因为有写入而从头重来。
+// 拷完后在副本上做 integrity_check，再按需压缩成 .db.gz 并回读校验，最后改名为正式文件。
+// 备份放在数据库目录下 backup/（可在 hospital.ini 的 Backup/Dir 修改），只保留最近若干份。
+// 依赖系统 SQLite（-lsqlite3）与 zlib（-lz）；源库用 SQLite C 接口另开只读连接，与 QSQLITE 驱动用的是哪份 SQLite 无关。
+class BackupManager final : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Backup = PeriodicJob::File;
+
+    explicit BackupManager(QObject* parent = nullptr);
+    ~BackupManager() override;
+
+    // 以下设置保存在 hospital.ini 的 Backup 节。
+    static QString backupDir();
+    // 自动备份间隔（小时），0 表示不自动备份。
+    static int intervalHours();
+    static int keepCount();
+    static bool compress();
+
+    // 按时间倒序。
+    static QVector<Backup> backups();
+    // 校验已有的备份（.db 或 .db.gz）：解压到临时文件后做 integrity_check。
+    static bool verify(const QString& path, QString* error = nullptr);
+
+    void schedule(int firstDelayMs, int intervalMs) { m_job->schedule(firstDelayMs, intervalMs); }
+    void start() { m_job->start(); }
+    // 请求停止并等待当前一步（拷页、压缩或回读的一块）做完；未完成的临时文件会删除。
+    void stop() { m_job->stop(); }
+    bool isRunning() const { return m_job->isRunning(); }
+
+signals:
+    void progress(int pagesDone, int pagesTotal);
+    void finished(const QString& path, const QString& error);
+
+private:
+    static void run(BackupManager* self, const std::shared_ptr<std::atomic_bool>& stop);
+
+    PeriodicJob* m_job = nullptr;
+};
@@ -1,14 +1,29 @@
 #include "dbmanager.h"
 
+#include "db/deltasync.h"
+#include "db/historysearch.h"
+
+#include <QAtomicInt>
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
 #include <QSqlError>
 #include <QSqlQuery>
-#include <QSqlQueryModel>
 #include <QStandardPaths>
 
+#include <iterator>
+
+// 文本时间另存一份 UTC 毫秒整数的列。
+const struct {
+    const char* table;
+    const char* column;
+    const char* textColumn;
+} kEpochColumns[] = {
+    {"History", "TS_MS", "TIMESTAMP"},
+    {"Patient", "CREATED_MS", "CREATEDTIMESTAMP"},
+};
+
 static QString lastSqlError(const QSqlQuery& query)
 {
     const auto err = query.lastError();
@@ -18,6 +33,30 @@ static QString lastSqlError(const QSqlQuery& query)
     return {};
 }
 
+static int scalarCount(QSqlDatabase db, const QString& sql, const QVariantList& args, QString* error)
+{
+    QSqlQuery q(db);
+    if (!q.prepare(sql)) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return -1;
+    }
+    for (const auto& v : args) {
+        q.addBindValue(v);
+    }
+    if (!q.exec()) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return -1;
+    }
+    if (!q.next()) {
+        return 0;
+    }
+    return q.value(0).toInt();
+}
+
 DbManager& DbManager::instance()
 {
     static DbManager inst;
@@ -26,19 +65,32 @@ DbManager& DbManager::instance()
 
 QString DbManager::databasePath() const
 {
+    if (!m_path.isEmpty()) {
+        return m_path;
+    }
     const auto base = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QDir().mkpath(base);
     return QDir(base).filePath(QStringLiteral("hospital.db"));
 }
 
-bool DbManager::open(QString* error)
+QString DbManager::settingsPath() const
+{
+    return QFileInfo(databasePath()).dir().filePath(QStringLiteral("hospital.ini"));
+}
+
+bool DbManager::open(QString* error, OpenMode mode)
 {
     const QString connectionName = QSqlDatabase::defaultConnection;
     if (QSqlDatabase::contains(connectionName)) {
-        m_db = QSqlDatabase::database(connectionName);
+        m_db = QSqlDatabase::database(connectionName, false);
     } else {
         m_db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connectionName);
         m_db.setDatabaseName(databasePath());
+        m_db.setConnectOptions(QStringLiteral("QSQLITE_BUSY_TIMEOUT=5000"));
+    }
+    m_path = m_db.databaseName();
+    if (mode == OpenMode::ReadOnly && !m_db.isOpen()) {
+        m_db.setConnectOptions(m_db.connectOptions() + QStringLiteral(";QSQLITE_OPEN_READONLY"));
     }
 
     if (!m_db.open()) {
@@ -50,10 +102,23 @@ bool DbManager::open(QString* error)
 
     QSqlQuery pragma(m_db);
     pragma.exec(QStringLiteral("PRAGMA foreign_keys = ON;"));
+    if (mode == OpenMode::ReadOnly) {
+        // 不建表也不升级，只看现有的库有没有全文索引。
+        HistorySearch::setAvailable(exec(QStringLiteral("SELECT rowid FROM HistoryFts LIMIT 0;")));
+        return true;
+    }
+    // WAL：后台读连接与界面写入互不阻塞。
+    pragma.exec(QStringLiteral("PRAGMA journal_mode = WAL;"));
 
     if (!ensureSchema(error)) {
         return false;
     }
+    if (!DeltaSync::install(m_db, error)) {
+        return false;
+    }
+    if (mode == OpenMode::Maintenance) {
+        return true;
+    }
     if (!seedDefaultUser(error)) {
         return false;
     }
@@ -65,6 +130,37 @@ QSqlDatabase DbManager::database() const
     return m_db;
 }
 
+QSqlDatabase DbManager::openWorkerConnection(QString* error) const
+{
+    static QAtomicInt counter;
+    const auto name = QStringLiteral("worker-%1").arg(counter.fetchAndAddRelaxed(1) + 1);
+
+    auto db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), name);
+    db.setDatabaseName(m_path);
+    db.setConnectOptions(QStringLiteral("QSQLITE_BUSY_TIMEOUT=5000"));
+    if (!db.open()) {
+        if (error) {
+            *error = db.lastError().text();
+        }
+        closeWorkerConnection(db);
+        return {};
+    }
+
+    QSqlQuery pragma(db);
+    pragma.exec(QStringLiteral("PRAGMA foreign_keys = ON;"));
+    return db;
+}
+
+void DbManager::closeWorkerConnection(QSqlDatabase& db)
+{
+    const auto name = db.connectionName();
+    db.close();
+    db = QSqlDatabase();
+    if (!name.isEmpty()) {
+        QSqlDatabase::removeDatabase(name);
+    }
+}
+
 bool DbManager::exec(const QString& sql, const QVariantList& args, QString* error) const
 {
     QSqlQuery query(m_db);
@@ -86,32 +182,47 @@ bool DbManager::exec(const QString& sql, const QVariantList& args, QString* erro
     return true;
 }
 
-QSqlQueryModel* DbManager::createQueryModel(const QString& sql,
-                                           const QVariantList& args,
-                                           QObject* parent,
-                                           QString* error) const
+bool DbManager::execBulk(const QString& sql,
+                         const QVariantList& leadingArgs,
+                         const QStringList& ids,
+                         QString* error) const
 {
-    auto* model = new QSqlQueryModel(parent);
-    QSqlQuery query(m_db);
-    if (!query.prepare(sql)) {
+    // 低版本 SQLite 绑定参数上限为 999，按块展开 IN 列表。
+    constexpr int kChunk = 500;
+
+    if (ids.isEmpty()) {
+        return true;
+    }
+    if (!m_db.transaction()) {
         if (error) {
-            *error = query.lastError().text();
+            *error = m_db.lastError().text();
         }
-        model->setQuery(QSqlQuery());
-        return model;
+        return false;
     }
-    for (const auto& v : args) {
-        query.addBindValue(v);
+
+    for (int begin = 0; begin < ids.size(); begin += kChunk) {
+        const auto chunk = ids.mid(begin, kChunk);
+        QStringList marks;
+        marks.reserve(chunk.size());
+        QVariantList args = leadingArgs;
+        for (const auto& id : chunk) {
+            marks << QStringLiteral("?");
+            args << id;
+        }
+        if (!exec(sql.arg(marks.join(QLatin1Char(','))), args, error)) {
+            m_db.rollback();
+            return false;
+        }
     }
-    if (!query.exec()) {
+
+    if (!m_db.commit()) {
         if (error) {
-            *error = lastSqlError(query);
+            *error = m_db.lastError().text();
         }
-        model->setQuery(QSqlQuery());
-        return model;
+        m_db.rollback();
+        return false;
     }
-    model->setQuery(query);
-    return model;
+    return true;
 }
 
 bool DbManager::ensureSchema(QString* error) const
@@ -135,7 +246,8 @@ bool DbManager::ensureSchema(QString* error) const
             "  WEIGHT REAL,"
             "  MOBILEPHONE TEXT,"
             "  AGE INTEGER,"
-            "  CREATEDTIMESTAMP TEXT"
+            "  CREATEDTIMESTAMP TEXT,"
+            "  CREATED_MS INTEGER"
             ");"),
         QStringLiteral(
             "CREATE TABLE IF NOT EXISTS Department ("
@@ -157,9 +269,97 @@ bool DbManager::ensureSchema(QString* error) const
             "  USER_ID TEXT,"
             "  EVENT TEXT,"
             "  TIMESTAMP TEXT,"
+            "  ACTION INTEGER,"
+            "  ENTITY_TYPE INTEGER,"
+            "  ENTITY_ID TEXT,"
+            "  TEMPLATE_ID INTEGER,"
+            "  DETAIL TEXT,"
+            "  TS_MS INTEGER,"
             "  FOREIGN KEY(USER_ID) REFERENCES User(ID)"
             "    ON UPDATE CASCADE ON DELETE SET NULL"
             ");"),
+        QStringLiteral(
+            "CREATE TABLE IF NOT EXISTS HistoryTemplate ("
+            "  ID INTEGER PRIMARY KEY AUTOINCREMENT,"
+            "  TEXT TEXT NOT NULL UNIQUE"
+            ");"),
+        // 日志文件后端已物化进 History 的最大序号。旧版本的日志序号与 History.ID 对齐、以 AUTOINCREMENT
+        // 计数为水位，首次建表时从那里接上。
+        QStringLiteral("CREATE TABLE IF NOT EXISTS HistoryJournalState (MATERIALIZED_SEQ INTEGER NOT NULL);"),
+        QStringLiteral("INSERT INTO HistoryJournalState(MATERIALIZED_SEQ)"
+                       " SELECT IFNULL((SELECT seq FROM sqlite_sequence WHERE name='History'),0)"
+                       " WHERE NOT EXISTS (SELECT 1 FROM HistoryJournalState);"),
+        // 归档前按天汇总的操作次数，明细搬走后统计仍可直接在主库完成。
+        QStringLiteral(
+            "CREATE TABLE IF NOT EXISTS HistoryDaily ("
+            "  DAY TEXT NOT NULL,"
+            "  USER_ID TEXT NOT NULL,"
+            "  ACTION INTEGER NOT NULL,"
+            "  COUNT INTEGER NOT NULL,"
+            "  PRIMARY KEY(DAY, USER_ID, ACTION)"
+            ") WITHOUT ROWID;"),
+        // 归档库目录：FILE 相对于数据库目录下的 archive/。
+        QStringLiteral(
+            "CREATE TABLE IF NOT EXISTS HistoryArchive ("
+            "  MONTH TEXT PRIMARY KEY,"
+            "  FILE TEXT NOT NULL,"
+            "  MIN_TS INTEGER NOT NULL,"
+            "  MAX_TS INTEGER NOT NULL,"
+            "  ROWS INTEGER NOT NULL DEFAULT 0"
+            ");"),
+        // 患者历史版本，编码见 PatientRevisions；患者删除后版本保留。
+        QStringLiteral(
+            "CREATE TABLE IF NOT EXISTS PatientRevision ("
+            "  PATIENT_ID TEXT NOT NULL,"
+            "  REV INTEGER NOT NULL,"
+            "  TS_MS INTEGER NOT NULL,"
+            "  USER_ID TEXT,"
+            "  MASK INTEGER NOT NULL,"
+            "  DATA BLOB NOT NULL,"
+            "  PRIMARY KEY(PATIENT_ID, REV)"
+            ") WITHOUT ROWID;"),
+        // CSV 导入断点：与导入的数据在同一事务里更新，文件大小或修改时间变了就不再续传。
+        QStringLiteral(
+            "CREATE TABLE IF NOT EXISTS ImportCheckpoint ("
+            "  FILE TEXT PRIMARY KEY,"
+            "  TARGET TEXT NOT NULL,"
+            "  SIZE INTEGER NOT NULL,"
+            "  MTIME_MS INTEGER NOT NULL,"
+            "  BYTES_DONE INTEGER NOT NULL,"
+            "  LINE_NO INTEGER NOT NULL,"
+            "  IMPORTED INTEGER NOT NULL,"
+            "  FAILED INTEGER NOT NULL,"
+            "  UPDATED_MS INTEGER NOT NULL"
+            ");"),
+        // 检验结果（LabIngestor 从 HL7 消息写入）：(发送应用, 发送机构, MESSAGE_ID, SET_ID) 去重，
+        // MSH-10 只在同一发送方内唯一；按身份证没找到患者时 PATIENT_ID 为空。
+        QStringLiteral(
+            "CREATE TABLE IF NOT EXISTS LabResult ("
+            "  ID INTEGER PRIMARY KEY,"
+            "  SENDING_APP TEXT NOT NULL DEFAULT '',"
+            "  SENDING_FACILITY TEXT NOT NULL DEFAULT '',"
+            "  MESSAGE_ID TEXT NOT NULL,"
+            "  SET_ID INTEGER NOT NULL,"
+            "  PATIENT_ID TEXT,"
+            "  ID_CARD TEXT,"
+            "  ORDER_CODE TEXT,"
+            "  CODE TEXT,"
+            "  NAME TEXT,"
+            "  VALUE TEXT,"
+            "  UNITS TEXT,"
+            "  REF_RANGE TEXT,"
+            "  FLAGS TEXT,"
+            "  STATUS TEXT,"
+            "  OBSERVED_MS INTEGER,"
+            "  RECEIVED_MS INTEGER NOT NULL,"
+            "  FOREIGN KEY(PATIENT_ID) REFERENCES Patient(ID)"
+            "    ON UPDATE CASCADE ON DELETE SET NULL"
+            ");"),
+        QStringLiteral(
+            "CREATE TABLE IF NOT EXISTS TableVersion ("
+            "  NAME TEXT PRIMARY KEY,"
+            "  VERSION INTEGER NOT NULL DEFAULT 0"
+            ");"),
     };
 
     for (const auto& sql : statements) {
@@ -167,9 +367,218 @@ bool DbManager::ensureSchema(QString* error) const
             return false;
         }
     }
+
+    // 旧库升级：History 结构化字段（旧记录只有 EVENT 文本，新记录 EVENT 为空）。
+    const struct {
+        const char* column;
+        const char* decl;
+    } historyColumns[] = {
+        {"ACTION", "INTEGER"},
+        {"ENTITY_TYPE", "INTEGER"},
+        {"ENTITY_ID", "TEXT"},
+        {"TEMPLATE_ID", "INTEGER"},
+        {"DETAIL", "TEXT"},
+    };
+    for (const auto& c : historyColumns) {
+        if (!ensureColumn(QStringLiteral("History"), QString::fromUtf8(c.column), QString::fromUtf8(c.decl), error)) {
+            return false;
+        }
+    }
+
+    // 早期的 LabResult 没有发送方列，去重键也随之换成下面的 idx_labresult_source。
+    for (const char* column : {"SENDING_APP", "SENDING_FACILITY"}) {
+        if (!ensureColumn(QStringLiteral("LabResult"), QString::fromUtf8(column), QStringLiteral("TEXT NOT NULL DEFAULT ''"), error)) {
+            return false;
+        }
+    }
+
+    // 时间另存为 UTC 毫秒整数以便走索引做范围查找。旧行的回填量可能很大，不在这里做，
+    // 由后台维护任务分批补（见 backfillEpochChunk）。
+    for (const auto& c : kEpochColumns) {
+        if (!ensureColumn(QString::fromUtf8(c.table), QString::fromUtf8(c.column), QStringLiteral("INTEGER"), error)) {
+            return false;
+        }
+    }
+
+    // 日志全文索引；新建时记下已有日志的最大 ID，由后台维护任务分批补词（见 HistorySearch::backfillChunk）。
+    // SQLite 没编译 FTS5 时建表（或读已有的表）会失败，这不影响打开数据库，关键字查找退回 LIKE。
+    const int hasFts = scalarCount(m_db, QStringLiteral("SELECT COUNT(1) FROM sqlite_master WHERE name='HistoryFts';"), {}, error);
+    if (hasFts < 0) {
+        return false;
+    }
+    // 补词进度表总是建上，数据生成等工具不必关心有没有 FTS5。
+    if (!exec(QStringLiteral("CREATE TABLE IF NOT EXISTS HistoryFtsBackfill (NEXT_ID INTEGER NOT NULL);"), {}, error)) {
+        return false;
+    }
+    QString ftsError;
+    const bool ftsUsable = hasFts == 0
+        ? exec(QStringLiteral("CREATE VIRTUAL TABLE HistoryFts USING fts5(TOKENS);"), {}, &ftsError)
+        : exec(QStringLiteral("SELECT rowid FROM HistoryFts LIMIT 0;"), {}, &ftsError);
+    HistorySearch::setAvailable(ftsUsable);
+    if (!ftsUsable) {
+        qWarning("DbManager: full-text search unavailable, falling back to LIKE: %s", qPrintable(ftsError));
+    } else if (hasFts == 0) {
+        const QStringList fts = {
+            QStringLiteral("DELETE FROM HistoryFtsBackfill;"),
+            QStringLiteral("INSERT INTO HistoryFtsBackfill(NEXT_ID) SELECT IFNULL(MAX(ID),0) FROM History;"),
+        };
+        for (const auto& sql : fts) {
+            if (!exec(sql, {}, error)) {
+                return false;
+            }
+        }
+    }
+
+    const QStringList indexes = {
+        // 某个实体的全部操作记录（ROWID 即 ID，索引内天然按 ID 有序）。
+        QStringLiteral("CREATE INDEX IF NOT EXISTS idx_history_entity ON History(ENTITY_ID, ENTITY_TYPE);"),
+        // 某用户的某类操作。
+        QStringLiteral("CREATE INDEX IF NOT EXISTS idx_history_user_action ON History(USER_ID, ACTION);"),
+        // 时间范围查找；二级索引隐含 ROWID，(TS_MS, ID) 倒序分页可直接沿索引走。
+        QStringLiteral("CREATE INDEX IF NOT EXISTS idx_history_ts ON History(TS_MS);"),
+        QStringLiteral("CREATE INDEX IF NOT EXISTS idx_patient_created ON Patient(CREATED_MS);"),
+        // 检验结果按身份证关联患者。
+        QStringLiteral("CREATE INDEX IF NOT EXISTS idx_patient_idcard ON Patient(ID_CARD);"),
+        QStringLiteral("DROP INDEX IF EXISTS idx_labresult_message;"),
+        QStringLiteral("CREATE UNIQUE INDEX IF NOT EXISTS idx_labresult_source"
+                       " ON LabResult(SENDING_APP, SENDING_FACILITY, MESSAGE_ID, SET_ID);"),
+        QStringLiteral("CREATE INDEX IF NOT EXISTS idx_labresult_patient ON LabResult(PATIENT_ID, OBSERVED_MS);"),
+        // 只收录尚未关联到患者的结果，患者建档或改身份证后由下面的触发器补关联。
+        QStringLiteral("CREATE INDEX IF NOT EXISTS idx_labresult_unmatched ON LabResult(ID_CARD) WHERE PATIENT_ID IS NULL;"),
+        QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_patient_labresult_ins AFTER INSERT ON Patient"
+                       " WHEN NEW.ID_CARD IS NOT NULL BEGIN"
+                       " UPDATE LabResult SET PATIENT_ID=NEW.ID WHERE PATIENT_ID IS NULL AND ID_CARD=NEW.ID_CARD; END;"),
+        // 改身份证时，按旧号关联上的结果先解除（旧号属于别的患者时改挂过去），再按新号补关联。
+        QStringLiteral("DROP TRIGGER IF EXISTS trg_patient_labresult_upd;"),
+        QStringLiteral("CREATE TRIGGER trg_patient_labresult_upd AFTER UPDATE OF ID_CARD ON Patient"
+                       " WHEN OLD.ID_CARD IS NOT NEW.ID_CARD BEGIN"
+                       " UPDATE LabResult SET PATIENT_ID=(SELECT ID FROM Patient WHERE ID_CARD=OLD.ID_CARD LIMIT 1)"
+                       "  WHERE PATIENT_ID=NEW.ID AND ID_CARD=OLD.ID_CARD;"
+                       " UPDATE LabResult SET PATIENT_ID=NEW.ID WHERE PATIENT_ID IS NULL AND ID_CARD=NEW.ID_CARD; END;"),
+    };
+    for (const auto& sql : indexes) {
+        if (!exec(sql, {}, error)) {
+            return false;
+        }
+    }
+
+    // 需要做缓存版本戳的表：任何增删改都让版本号 +1。Patient 的版本号用于校验患者表格的启动缓存。
+    const QStringList versionedTables = {
+        QStringLiteral("Department"),
+        QStringLiteral("Patient"),
+        QStringLiteral("User"),
+        QStringLiteral("HistoryTemplate"),
+    };
+    for (const auto& table : versionedTables) {
+        if (!exec(QStringLiteral("INSERT OR IGNORE INTO TableVersion(NAME,VERSION) VALUES(?,0);"), {table}, error)) {
+            return false;
+        }
+        const struct {
+            const char* suffix;
+            const char* event;
+        } triggers[] = {
+            {"ins", "INSERT"},
+            {"upd", "UPDATE"},
+            {"del", "DELETE"},
+        };
+        for (const auto& t : triggers) {
+            const auto sql = QStringLiteral(
+                                 "CREATE TRIGGER IF NOT EXISTS trg_%1_version_%2 AFTER %3 ON %4 "
+                                 "BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='%4'; END;")
+                                 .arg(table.toLower(), QString::fromUtf8(t.suffix), QString::fromUtf8(t.event), table);
+            if (!exec(sql, {}, error)) {
+                return false;
+            }
+        }
+    }
     return true;
 }
 
+bool DbManager::ensureColumn(const QString& table, const QString& column, const QString& decl, QString* error) const
+{
+    QSqlQuery q(m_db);
+    if (!q.exec(QStringLiteral("PRAGMA table_info(%1);").arg(table))) {
+        if (error) {
+            *error = lastSqlError(q);
+        }
+        return false;
+    }
+    while (q.next()) {
+        if (q.value(1).toString().compare(column, Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return exec(QStringLiteral("ALTER TABLE %1 ADD COLUMN %2 %3;").arg(table, column, decl), {}, error);
+}
+
+int DbManager::backfillEpochChunk(QSqlDatabase& db, EpochBackfill* progress, int limit, QString* error)
+{
+    const auto fail = [error](const QSqlQuery& q) {
+        if (error) {
+            *error = lastSqlError(q);
+        }
+        return -1;
+    };
+
+    while (progress->column < int(std::size(kEpochColumns))) {
+        const auto& c = kEpochColumns[progress->column];
+        const auto table = QString::fromUtf8(c.table);
+        const auto column = QString::fromUtf8(c.column);
+        const auto text = QString::fromUtf8(c.textColumn);
+
+        // 先定出这一段的 rowid 上界，UPDATE 只在这段里做，解析失败仍为空的行不会被反复选中。
+        QSqlQuery q(db);
+        q.prepare(QStringLiteral("SELECT COUNT(1), MAX(rowid) FROM (SELECT rowid FROM %1"
+                                 " WHERE rowid > ? AND %2 IS NULL AND %3 IS NOT NULL ORDER BY rowid LIMIT ?);")
+                      .arg(table, column, text));
+        q.addBindValue(progress->afterRowId);
+        q.addBindValue(limit);
+        if (!q.exec() || !q.next()) {
+            return fail(q);
+        }
+        const int n = q.value(0).toInt();
+        const qint64 last = q.value(1).toLongLong();
+        q.finish();
+        if (n == 0) {
+            ++progress->column;
+            progress->afterRowId = 0;
+            continue;
+        }
+
+        // 旧文本是不带时区的本地时间，strftime 的 'utc' 修饰符按本地时区换算。
+        q.prepare(QStringLiteral("UPDATE %1 SET %2=CAST(strftime('%s',%3,'utc') AS INTEGER)*1000"
+                                 " WHERE rowid > ? AND rowid <= ? AND %2 IS NULL AND %3 IS NOT NULL;")
+                      .arg(table, column, text));
+        q.addBindValue(progress->afterRowId);
+        q.addBindValue(last);
+        if (!q.exec()) {
+            return fail(q);
+        }
+        progress->afterRowId = last;
+        return n;
+    }
+    return 0;
+}
+
+qint64 DbManager::tableVersion(const QString& table, QString* error) const
+{
+    QSqlQuery q(m_db);
+    if (!q.prepare(QStringLiteral("SELECT VERSION FROM TableVersion WHERE NAME=?;"))) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return -1;
+    }
+    q.addBindValue(table);
+    if (!q.exec()) {
+        if (error) {
+            *error = lastSqlError(q);
+        }
+        return -1;
+    }
+    return q.next() ? q.value(0).toLongLong() : 0;
+}
+
 bool DbManager::seedDefaultUser(QString* error) const
 {
     QSqlQuery query(m_db);
@@ -200,30 +609,6 @@ bool DbManager::seedDefaultUser(QString* error) const
                 error);
 }
 
-static int scalarCount(QSqlDatabase db, const QString& sql, const QVariantList& args, QString* error)
-{
-    QSqlQuery q(db);
-    if (!q.prepare(sql)) {
-        if (error) {
-            *error = q.lastError().text();
-        }
-        return -1;
-    }
-    for (const auto& v : args) {
-        q.addBindValue(v);
-    }
-    if (!q.exec()) {
-        if (error) {
-            *error = q.lastError().text();
-        }
-        return -1;
-    }
-    if (!q.next()) {
-        return 0;
-    }
-    return q.value(0).toInt();
-}
-
 bool DbManager::seedDemoData(QString* error) const
 {
     // 仅在空表时插入演示数据，避免重复污染。
@@ -308,7 +693,8 @@ bool DbManager::seedDemoData(QString* error) const
     }
 
     if (patientCount == 0 || hasSimplePatientIds == 0) {
-        const auto created = QDateTime::currentDateTime().toString(Qt::ISODate);
+        const auto now = QDateTime::currentDateTime();
+        const auto created = now.toString(Qt::ISODate);
         const struct {
             const char* id;
             const char* idCard;
@@ -327,8 +713,8 @@ bool DbManager::seedDemoData(QString* error) const
         };
         for (const auto& p : patients) {
             if (!exec(QStringLiteral(
-                          "INSERT OR IGNORE INTO Patient(ID,ID_CARD,NAME,SEX,DOB,HEIGHT,WEIGHT,MOBILEPHONE,AGE,CREATEDTIMESTAMP)"
-                          " VALUES(?,?,?,?,?,?,?,?,?,?);"),
+                          "INSERT OR IGNORE INTO Patient(ID,ID_CARD,NAME,SEX,DOB,HEIGHT,WEIGHT,MOBILEPHONE,AGE,CREATEDTIMESTAMP,CREATED_MS)"
+                          " VALUES(?,?,?,?,?,?,?,?,?,?,?);"),
                       {QString::fromUtf8(p.id),
                        QString::fromUtf8(p.idCard),
                        QString::fromUtf8(p.name),
@@ -338,7 +724,8 @@ bool DbManager::seedDemoData(QString* error) const
                        p.weight,
                        QString::fromUtf8(p.mobile),
                        p.age,
-                       created},
+                       created,
+                       now.toMSecsSinceEpoch()},
                       error)) {
                 return false;
             }
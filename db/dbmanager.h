@@ -2,11 +2,10 @@
 
 #include <QSqlDatabase>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 #include <QVariantList>
 
-class QSqlQueryModel;
-
 class DbManager final
 {
 public:
@@ -15,23 +14,51 @@ public:
 
     static DbManager& instance();
 
-    bool open(QString* error = nullptr);
+    enum class OpenMode {
+        Application, // 建表升级、安装增量同步触发器，再补默认用户和演示数据
+        Maintenance, // 建表升级、安装触发器，不补任何数据（运维工具写库时用）
+        ReadOnly,    // 只读打开，不改动库文件（运维工具的查询类命令用）
+    };
+
+    bool open(QString* error = nullptr, OpenMode mode = OpenMode::Application);
     QSqlDatabase database() const;
+    QString databasePath() const;
+    // 与数据库放在同一目录的 hospital.ini（QSettings::IniFormat）。
+    QString settingsPath() const;
+
+    // 后台线程专用连接：必须在使用它的线程里打开和关闭。
+    QSqlDatabase openWorkerConnection(QString* error = nullptr) const;
+    static void closeWorkerConnection(QSqlDatabase& db);
 
     bool exec(const QString& sql, const QVariantList& args = {}, QString* error = nullptr) const;
-    QSqlQueryModel* createQueryModel(const QString& sql,
-                                    const QVariantList& args = {},
-                                    QObject* parent = nullptr,
-                                    QString* error = nullptr) const;
+    // 批量语句：sql 中的 %1 展开为 ID 占位符列表，全部在一个事务内执行，任一失败整体回滚。
+    bool execBulk(const QString& sql,
+                  const QVariantList& leadingArgs,
+                  const QStringList& ids,
+                  QString* error = nullptr) const;
+
+    // 由触发器维护的表版本号，用于判断缓存是否过期；出错返回 -1。
+    qint64 tableVersion(const QString& table, QString* error = nullptr) const;
+
+    // 旧库升级后 TS_MS / CREATED_MS 为空的行按文本时间补上，进度按 rowid 往后推进，解析不了的文本跳过。
+    struct EpochBackfill
+    {
+        int column = 0;
+        qint64 afterRowId = 0;
+    };
+    // 每次一条 UPDATE 处理至多 limit 行，在后台连接上反复调用；返回本次处理的行数，全部完成返回 0，出错返回 -1。
+    // 不依赖升级时的状态，每次启动都可以重跑。
+    static int backfillEpochChunk(QSqlDatabase& db, EpochBackfill* progress, int limit, QString* error = nullptr);
 
 private:
     DbManager() = default;
 
     bool ensureSchema(QString* error) const;
+    // 列不存在时 ALTER TABLE 补上。
+    bool ensureColumn(const QString& table, const QString& column, const QString& decl, QString* error) const;
     bool seedDefaultUser(QString* error) const;
     bool seedDemoData(QString* error) const;
 
-    QString databasePath() const;
-
     mutable QSqlDatabase m_db;
+    QString m_path;
 };
@@ -0,0 +1,923 @@
+#include "deltasync.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUuid>
+#include <QVariant>
+#include <QVector>
+#include <QtEndian>
+
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'H', 'S', 'D', 'E', 'L', 'T', 'A', '1'};
+
+enum Op : int {
+    OpUpsert = 1,
+    OpDelete = 2,
+};
+
+enum ValueTag : quint8 {
+    TagNull = 0,
+    TagInt = 1,
+    TagReal = 2,
+    TagText = 3,
+    TagBlob = 4,
+};
+
+const QString kNowMs = QStringLiteral("CAST((julianday('now') - 2440587.5) * 86400000.0 AS INTEGER)");
+const QString kSuppressKey = QStringLiteral("SUPPRESS");
+const QString kNodeKey = QStringLiteral("NODE_ID");
+
+struct Change
+{
+    int op = OpUpsert;
+    qint64 tsMs = 0;
+    QString origin;
+    QString rowId;
+    QVariantList values;
+};
+
+struct TableDelta
+{
+    QString table;
+    QStringList columns;
+    QVector<Change> changes;
+};
+
+void putVarint(QByteArray& out, quint64 v)
+{
+    while (v >= 0x80) {
+        out.append(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.append(static_cast<char>(v));
+}
+
+bool getVarint(const QByteArray& in, int* pos, quint64* v)
+{
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*pos >= in.size()) {
+            return false;
+        }
+        const auto b = static_cast<quint8>(in.at((*pos)++));
+        *v |= quint64(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+quint64 zigzag(qint64 v)
+{
+    return (quint64(v) << 1) ^ quint64(v >> 63);
+}
+
+qint64 unzigzag(quint64 v)
+{
+    return qint64(v >> 1) ^ -qint64(v & 1);
+}
+
+void putBytes(QByteArray& out, const QByteArray& bytes)
+{
+    putVarint(out, quint64(bytes.size()));
+    out.append(bytes);
+}
+
+bool getBytes(const QByteArray& in, int* pos, QByteArray* bytes)
+{
+    quint64 len = 0;
+    if (!getVarint(in, pos, &len) || len > quint64(in.size() - *pos)) {
+        return false;
+    }
+    *bytes = in.mid(*pos, int(len));
+    *pos += int(len);
+    return true;
+}
+
+void putString(QByteArray& out, const QString& s)
+{
+    putBytes(out, s.toUtf8());
+}
+
+bool getString(const QByteArray& in, int* pos, QString* s)
+{
+    QByteArray bytes;
+    if (!getBytes(in, pos, &bytes)) {
+        return false;
+    }
+    *s = QString::fromUtf8(bytes);
+    return true;
+}
+
+void putValue(QByteArray& out, const QVariant& v)
+{
+    if (v.isNull()) {
+        out.append(char(TagNull));
+        return;
+    }
+    switch (v.metaType().id()) {
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Bool:
+        out.append(char(TagInt));
+        putVarint(out, zigzag(v.toLongLong()));
+        break;
+    case QMetaType::Double: {
+        out.append(char(TagReal));
+        char b[8];
+        qToLittleEndian(v.toDouble(), b);
+        out.append(b, 8);
+        break;
+    }
+    case QMetaType::QByteArray:
+        out.append(char(TagBlob));
+        putBytes(out, v.toByteArray());
+        break;
+    default:
+        out.append(char(TagText));
+        putString(out, v.toString());
+        break;
+    }
+}
+
+bool getValue(const QByteArray& in, int* pos, QVariant* v)
+{
+    if (*pos >= in.size()) {
+        return false;
+    }
+    const auto tag = static_cast<quint8>(in.at((*pos)++));
+    switch (tag) {
+    case TagNull:
+        *v = QVariant();
+        return true;
+    case TagInt: {
+        quint64 n = 0;
+        if (!getVarint(in, pos, &n)) {
+            return false;
+        }
+        *v = unzigzag(n);
+        return true;
+    }
+    case TagReal:
+        if (in.size() - *pos < 8) {
+            return false;
+        }
+        *v = qFromLittleEndian<double>(in.constData() + *pos);
+        *pos += 8;
+        return true;
+    case TagText: {
+        QString s;
+        if (!getString(in, pos, &s)) {
+            return false;
+        }
+        *v = s;
+        return true;
+    }
+    case TagBlob: {
+        QByteArray b;
+        if (!getBytes(in, pos, &b)) {
+            return false;
+        }
+        *v = b;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool failQuery(const QSqlQuery& q, QString* error)
+{
+    if (error) {
+        *error = q.lastError().text();
+    }
+    return false;
+}
+
+bool fail(QString* error, const QString& message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+bool execOn(QSqlDatabase& db, const QString& sql, const QVariantList& args, QString* error)
+{
+    QSqlQuery q(db);
+    if (!q.prepare(sql)) {
+        return failQuery(q, error);
+    }
+    for (const auto& v : args) {
+        q.addBindValue(v);
+    }
+    return q.exec() || failQuery(q, error);
+}
+
+QStringList tableColumns(const QSqlDatabase& db, const QString& table, QString* error)
+{
+    QStringList columns;
+    QSqlQuery q(db);
+    if (!q.exec(QStringLiteral("PRAGMA table_info(%1);").arg(table))) {
+        failQuery(q, error);
+        return columns;
+    }
+    while (q.next()) {
+        columns << q.value(1).toString();
+    }
+    return columns;
+}
+
+// 外键列 -> 被引用的表（被引用列都是 ID）。
+QHash<QString, QString> foreignKeys(const QSqlDatabase& db, const QString& table)
+{
+    QHash<QString, QString> keys;
+    QSqlQuery q(db);
+    if (q.exec(QStringLiteral("PRAGMA foreign_key_list(%1);").arg(table))) {
+        while (q.next()) {
+            keys.insert(q.value(3).toString(), q.value(2).toString());
+        }
+    }
+    return keys;
+}
+
+// (TS_MS, ORIGIN) 较大者胜；相等说明是同一次改动。
+bool remoteWins(qint64 remoteTs, const QString& remoteOrigin, qint64 localTs, const QString& localOrigin)
+{
+    if (remoteTs != localTs) {
+        return remoteTs > localTs;
+    }
+    return remoteOrigin > localOrigin;
+}
+
+QByteArray encodeDelta(const QString& source, qint64 fromSeq, qint64 toSeq, const QVector<TableDelta>& tables)
+{
+    // 来源节点通常只有两三个，先写字典，每条记录只写下标。
+    QStringList origins;
+    QHash<QString, int> originIndex;
+    for (const auto& t : tables) {
+        for (const auto& c : t.changes) {
+            if (!originIndex.contains(c.origin)) {
+                originIndex.insert(c.origin, origins.size());
+                origins << c.origin;
+            }
+        }
+    }
+
+    QByteArray body;
+    putString(body, source);
+    putVarint(body, quint64(fromSeq));
+    putVarint(body, quint64(toSeq));
+    putVarint(body, quint64(origins.size()));
+    for (const auto& o : std::as_const(origins)) {
+        putString(body, o);
+    }
+    putVarint(body, quint64(tables.size()));
+    for (const auto& t : tables) {
+        putString(body, t.table);
+        putVarint(body, quint64(t.columns.size()));
+        for (const auto& c : t.columns) {
+            putString(body, c);
+        }
+        putVarint(body, quint64(t.changes.size()));
+        // 时间戳相对前一条做差，按 SEQ 顺序基本递增，差值很小。
+        qint64 prevTs = 0;
+        for (const auto& c : t.changes) {
+            body.append(char(c.op));
+            putVarint(body, zigzag(c.tsMs - prevTs));
+            prevTs = c.tsMs;
+            putVarint(body, quint64(originIndex.value(c.origin)));
+            putString(body, c.rowId);
+            if (c.op == OpUpsert) {
+                for (const auto& v : c.values) {
+                    putValue(body, v);
+                }
+            }
+        }
+    }
+    return QByteArray(kMagic, sizeof(kMagic)) + qCompress(body);
+}
+
+bool decodeDelta(const QByteArray& file, QString* source, qint64* fromSeq, qint64* toSeq, QVector<TableDelta>* tables)
+{
+    if (file.size() < int(sizeof(kMagic)) || std::memcmp(file.constData(), kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+    const auto body = qUncompress(file.mid(sizeof(kMagic)));
+    if (body.isEmpty()) {
+        return false;
+    }
+
+    int pos = 0;
+    quint64 n = 0;
+    quint64 from = 0;
+    quint64 to = 0;
+    if (!getString(body, &pos, source) || !getVarint(body, &pos, &from) || !getVarint(body, &pos, &to)
+        || !getVarint(body, &pos, &n)) {
+        return false;
+    }
+    *fromSeq = qint64(from);
+    *toSeq = qint64(to);
+    QStringList origins;
+    for (quint64 i = 0; i < n; ++i) {
+        QString o;
+        if (!getString(body, &pos, &o)) {
+            return false;
+        }
+        origins << o;
+    }
+
+    quint64 tableCount = 0;
+    if (!getVarint(body, &pos, &tableCount)) {
+        return false;
+    }
+    for (quint64 ti = 0; ti < tableCount; ++ti) {
+        TableDelta t;
+        quint64 columnCount = 0;
+        if (!getString(body, &pos, &t.table) || !getVarint(body, &pos, &columnCount) || columnCount > 1024) {
+            return false;
+        }
+        for (quint64 i = 0; i < columnCount; ++i) {
+            QString c;
+            if (!getString(body, &pos, &c)) {
+                return false;
+            }
+            t.columns << c;
+        }
+        quint64 changeCount = 0;
+        if (!getVarint(body, &pos, &changeCount)) {
+            return false;
+        }
+        qint64 prevTs = 0;
+        for (quint64 i = 0; i < changeCount; ++i) {
+            Change c;
+            quint64 ts = 0;
+            quint64 origin = 0;
+            if (pos >= body.size()) {
+                return false;
+            }
+            c.op = static_cast<quint8>(body.at(pos++));
+            if ((c.op != OpUpsert && c.op != OpDelete) || !getVarint(body, &pos, &ts) || !getVarint(body, &pos, &origin)
+                || origin >= quint64(origins.size()) || !getString(body, &pos, &c.rowId)) {
+                return false;
+            }
+            c.tsMs = prevTs + unzigzag(ts);
+            prevTs = c.tsMs;
+            c.origin = origins.at(int(origin));
+            if (c.op == OpUpsert) {
+                for (int k = 0; k < t.columns.size(); ++k) {
+                    QVariant v;
+                    if (!getValue(body, &pos, &v)) {
+                        return false;
+                    }
+                    c.values << v;
+                }
+            }
+            t.changes.append(c);
+        }
+        tables->append(t);
+    }
+    return pos == body.size();
+}
+
+}
+
+const QStringList& DeltaSync::tables()
+{
+    static const QStringList names = {QStringLiteral("Department"), QStringLiteral("Doctor"), QStringLiteral("Patient")};
+    return names;
+}
+
+bool DeltaSync::install(QSqlDatabase& db, QString* error)
+{
+    QStringList statements = {
+        QStringLiteral("CREATE TABLE IF NOT EXISTS SyncState ("
+                       "  KEY TEXT PRIMARY KEY,"
+                       "  VALUE TEXT"
+                       ") WITHOUT ROWID;"),
+        // 同一行只保留最新一条（INSERT OR REPLACE 会分配新的 SEQ），表的大小只与改过的行数有关。
+        QStringLiteral("CREATE TABLE IF NOT EXISTS ChangeLog ("
+                       "  SEQ INTEGER PRIMARY KEY AUTOINCREMENT,"
+                       "  TBL TEXT NOT NULL,"
+                       "  ROW_ID TEXT NOT NULL,"
+                       "  OP INTEGER NOT NULL,"
+                       "  TS_MS INTEGER NOT NULL,"
+                       "  ORIGIN TEXT NOT NULL,"
+                       "  UNIQUE(TBL, ROW_ID)"
+                       ");"),
+        QStringLiteral("CREATE TABLE IF NOT EXISTS SyncPeer ("
+                       "  PEER TEXT PRIMARY KEY,"
+                       "  SENT_SEQ INTEGER NOT NULL DEFAULT 0,"
+                       "  RECV_SEQ INTEGER NOT NULL DEFAULT 0,"
+                       "  SYNCED_MS INTEGER"
+                       ");"),
+        QStringLiteral("INSERT OR IGNORE INTO SyncState(KEY,VALUE) VALUES('%1','%2');")
+            .arg(kNodeKey, QUuid::createUuid().toString(QUuid::WithoutBraces)),
+    };
+
+    const auto log = [](const QString& table, const QString& rowId, int op) {
+        return QStringLiteral("INSERT OR REPLACE INTO ChangeLog(TBL,ROW_ID,OP,TS_MS,ORIGIN) SELECT '%1', %2, %3, %4,"
+                              " (SELECT VALUE FROM SyncState WHERE KEY='%5')")
+            .arg(table, rowId)
+            .arg(op)
+            .arg(kNowMs, kNodeKey);
+    };
+    const auto when = QStringLiteral("WHEN NOT EXISTS (SELECT 1 FROM SyncState WHERE KEY='%1')").arg(kSuppressKey);
+    for (const auto& table : tables()) {
+        const auto lower = table.toLower();
+        statements << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_%1_sync_ins AFTER INSERT ON %2 %3 BEGIN %4; END;")
+                          .arg(lower, table, when, log(table, QStringLiteral("NEW.ID"), OpUpsert))
+                   // 主键被改时，旧 ID 记为删除。
+                   << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_%1_sync_upd AFTER UPDATE ON %2 %3 BEGIN"
+                                     " %4 WHERE OLD.ID IS NOT NEW.ID; %5; END;")
+                          .arg(lower,
+                               table,
+                               when,
+                               log(table, QStringLiteral("OLD.ID"), OpDelete),
+                               log(table, QStringLiteral("NEW.ID"), OpUpsert))
+                   << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_%1_sync_del AFTER DELETE ON %2 %3 BEGIN %4; END;")
+                          .arg(lower, table, when, log(table, QStringLiteral("OLD.ID"), OpDelete));
+    }
+
+    for (const auto& sql : std::as_const(statements)) {
+        if (!execOn(db, sql, {}, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString DeltaSync::nodeId(const QSqlDatabase& db, QString* error)
+{
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("SELECT VALUE FROM SyncState WHERE KEY=?;"));
+    q.addBindValue(kNodeKey);
+    if (!q.exec()) {
+        failQuery(q, error);
+        return {};
+    }
+    return q.next() ? q.value(0).toString() : QString();
+}
+
+bool DeltaSync::resetNode(QSqlDatabase& db, QString* error)
+{
+    if (!db.transaction()) {
+        return fail(error, db.lastError().text());
+    }
+    const bool ok = execOn(db,
+                           QStringLiteral("INSERT OR REPLACE INTO SyncState(KEY,VALUE) VALUES(?,?);"),
+                           {kNodeKey, QUuid::createUuid().toString(QUuid::WithoutBraces)},
+                           error)
+        && execOn(db, QStringLiteral("DELETE FROM ChangeLog;"), {}, error)
+        && execOn(db, QStringLiteral("DELETE FROM SyncPeer;"), {}, error);
+    if (!ok || !db.commit()) {
+        if (ok) {
+            fail(error, db.lastError().text());
+        }
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool DeltaSync::setCaptureEnabled(QSqlDatabase& db, bool enabled, QString* error)
+{
+    if (enabled) {
+        return execOn(db, QStringLiteral("DELETE FROM SyncState WHERE KEY=?;"), {kSuppressKey}, error);
+    }
+    return execOn(db, QStringLiteral("INSERT OR REPLACE INTO SyncState(KEY,VALUE) VALUES(?,'1');"), {kSuppressKey}, error);
+}
+
+qint64 DeltaSync::receivedSeq(const QSqlDatabase& db, const QString& peerId, QString* error)
+{
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("SELECT RECV_SEQ FROM SyncPeer WHERE PEER=?;"));
+    q.addBindValue(peerId);
+    if (!q.exec()) {
+        failQuery(q, error);
+        return -1;
+    }
+    return q.next() ? q.value(0).toLongLong() : 0;
+}
+
+bool DeltaSync::exportChanges(QSqlDatabase& db, const QString& peerId, const QString& path, Stats* stats, QString* error)
+{
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("SELECT SENT_SEQ FROM SyncPeer WHERE PEER=?;"));
+    q.addBindValue(peerId);
+    if (!q.exec()) {
+        return failQuery(q, error);
+    }
+    const qint64 sent = q.next() ? q.value(0).toLongLong() : 0;
+    q.finish();
+    return exportChangesSince(db, peerId, sent, path, stats, error);
+}
+
+bool DeltaSync::exportChangesSince(QSqlDatabase& db,
+                                   const QString& peerId,
+                                   qint64 fromSeq,
+                                   const QString& path,
+                                   Stats* stats,
+                                   QString* error)
+{
+    const auto self = nodeId(db, error);
+    if (self.isEmpty()) {
+        return fail(error, QStringLiteral("本库还没有节点 ID"));
+    }
+    if (peerId.isEmpty() || peerId == self) {
+        return fail(error, QStringLiteral("对方节点 ID 无效"));
+    }
+
+    // 读事务内取改动和行值，得到一致的快照。
+    if (!db.transaction()) {
+        return fail(error, db.lastError().text());
+    }
+    const auto abort = [&db](QString* err, const QString& message) {
+        db.rollback();
+        return fail(err, message);
+    };
+
+    Stats s;
+    s.source = self;
+    {
+        QSqlQuery q(db);
+        if (!q.exec(QStringLiteral("SELECT IFNULL(MAX(SEQ), 0) FROM ChangeLog;")) || !q.next()) {
+            return abort(error, q.lastError().text());
+        }
+        s.fromSeq = qMax<qint64>(0, fromSeq);
+        s.toSeq = qMax(s.fromSeq, q.value(0).toLongLong());
+    }
+
+    QVector<TableDelta> deltas;
+    QHash<QString, int> tableIndex;
+    for (const auto& table : tables()) {
+        TableDelta t;
+        t.table = table;
+        t.columns = tableColumns(db, table, error);
+        if (t.columns.isEmpty()) {
+            return abort(error, QStringLiteral("找不到表 %1").arg(table));
+        }
+        tableIndex.insert(table, deltas.size());
+        deltas.append(t);
+    }
+
+    std::vector<QSqlQuery> rowQueries;
+    rowQueries.reserve(deltas.size());
+    for (const auto& t : std::as_const(deltas)) {
+        auto& rq = rowQueries.emplace_back(db);
+        rq.prepare(QStringLiteral("SELECT %1 FROM %2 WHERE ID=?;").arg(t.columns.join(QLatin1Char(',')), t.table));
+    }
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare(QStringLiteral("SELECT TBL, ROW_ID, OP, TS_MS, ORIGIN FROM ChangeLog"
+                             " WHERE SEQ > ? AND SEQ <= ? AND ORIGIN <> ? ORDER BY SEQ;"));
+    q.addBindValue(s.fromSeq);
+    q.addBindValue(s.toSeq);
+    q.addBindValue(peerId);
+    if (!q.exec()) {
+        return abort(error, q.lastError().text());
+    }
+    while (q.next()) {
+        const int ti = tableIndex.value(q.value(0).toString(), -1);
+        if (ti < 0) {
+            continue;
+        }
+        auto& t = deltas[ti];
+        Change c;
+        c.rowId = q.value(1).toString();
+        c.op = q.value(2).toInt();
+        c.tsMs = q.value(3).toLongLong();
+        c.origin = q.value(4).toString();
+        if (c.op == OpUpsert) {
+            auto& rq = rowQueries[ti];
+            rq.addBindValue(c.rowId);
+            if (!rq.exec()) {
+                return abort(error, rq.lastError().text());
+            }
+            if (rq.next()) {
+                for (int k = 0; k < t.columns.size(); ++k) {
+                    c.values << rq.value(k);
+                }
+            } else {
+                // 记录之后又被删掉，删除的记录会在下一次导出时带上；这里按删除处理也一样。
+                c.op = OpDelete;
+            }
+            rq.finish();
+        }
+        if (c.op == OpUpsert) {
+            ++s.upserts;
+        } else {
+            ++s.deletes;
+        }
+        t.changes.append(c);
+    }
+    q.finish();
+    rowQueries.clear();
+
+    QFile file(path + QStringLiteral(".part"));
+    const auto bytes = encodeDelta(self, s.fromSeq, s.toSeq, deltas);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(bytes) != bytes.size()) {
+        const auto message = file.errorString();
+        file.remove();
+        return abort(error, message);
+    }
+    file.close();
+    QFile::remove(path);
+    if (!file.rename(path)) {
+        const auto message = file.errorString();
+        file.remove();
+        return abort(error, message);
+    }
+
+    // 文件落盘后推进发送位置；对方没收到时由 exportChangesSince 按对方的 RECV_SEQ 重发，不必改这里。
+    if (!execOn(db,
+                QStringLiteral("INSERT INTO SyncPeer(PEER,SENT_SEQ,SYNCED_MS) VALUES(?,?,?)"
+                               " ON CONFLICT(PEER) DO UPDATE SET SENT_SEQ=excluded.SENT_SEQ, SYNCED_MS=excluded.SYNCED_MS;"),
+                {peerId, s.toSeq, QDateTime::currentMSecsSinceEpoch()},
+                error)) {
+        db.rollback();
+        return false;
+    }
+    if (!db.commit()) {
+        return abort(error, db.lastError().text());
+    }
+    if (stats) {
+        *stats = s;
+    }
+    return true;
+}
+
+bool DeltaSync::applyChanges(QSqlDatabase& db, const QString& path, Stats* stats, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(error, file.errorString());
+    }
+    Stats s;
+    QVector<TableDelta> deltas;
+    if (!decodeDelta(file.readAll(), &s.source, &s.fromSeq, &s.toSeq, &deltas)) {
+        return fail(error, QStringLiteral("%1 不是有效的增量文件").arg(path));
+    }
+    file.close();
+
+    const auto self = nodeId(db, error);
+    if (self.isEmpty() || s.source == self) {
+        return fail(error, QStringLiteral("增量文件来自本库，或本库还没有节点 ID"));
+    }
+
+    if (!db.transaction()) {
+        return fail(error, db.lastError().text());
+    }
+    const auto abort = [&db](QString* err, const QString& message) {
+        db.rollback();
+        return fail(err, message);
+    };
+
+    qint64 received = 0;
+    {
+        QSqlQuery q(db);
+        q.prepare(QStringLiteral("SELECT RECV_SEQ FROM SyncPeer WHERE PEER=?;"));
+        q.addBindValue(s.source);
+        if (!q.exec()) {
+            return abort(error, q.lastError().text());
+        }
+        if (q.next()) {
+            received = q.value(0).toLongLong();
+        }
+    }
+    if (s.toSeq <= received && s.toSeq > 0) {
+        db.rollback();
+        s.alreadyApplied = true;
+        if (stats) {
+            *stats = s;
+        }
+        return true;
+    }
+    if (s.fromSeq > received) {
+        return abort(error,
+                     QStringLiteral("缺少更早的增量：已应用到 %1，该文件从 %2 开始").arg(received).arg(s.fromSeq));
+    }
+
+    // 应用期间不让触发器记录，改用对方的时间戳和来源节点写 ChangeLog。
+    if (!execOn(db, QStringLiteral("INSERT OR REPLACE INTO SyncState(KEY,VALUE) VALUES(?,'1');"), {kSuppressKey}, error)) {
+        db.rollback();
+        return false;
+    }
+
+    QSqlQuery local(db);
+    local.prepare(QStringLiteral("SELECT TS_MS, ORIGIN FROM ChangeLog WHERE TBL=? AND ROW_ID=?;"));
+    QSqlQuery record(db);
+    record.prepare(QStringLiteral("INSERT OR REPLACE INTO ChangeLog(TBL,ROW_ID,OP,TS_MS,ORIGIN) VALUES(?,?,?,?,?);"));
+
+    const auto accept = [&](const QString& table, const Change& c, bool* wins) {
+        local.addBindValue(table);
+        local.addBindValue(c.rowId);
+        if (!local.exec()) {
+            return failQuery(local, error);
+        }
+        *wins = !local.next() || remoteWins(c.tsMs, c.origin, local.value(0).toLongLong(), local.value(1).toString());
+        local.finish();
+        return true;
+    };
+    const auto remember = [&](const QString& table, const Change& c) {
+        record.addBindValue(table);
+        record.addBindValue(c.rowId);
+        record.addBindValue(c.op);
+        record.addBindValue(c.tsMs);
+        record.addBindValue(c.origin);
+        return record.exec() || failQuery(record, error);
+    };
+
+    // 先按被引用在前的顺序写入/更新，再按相反顺序删除。
+    QHash<QString, const TableDelta*> byName;
+    for (const auto& t : std::as_const(deltas)) {
+        byName.insert(t.table, &t);
+    }
+
+    for (const auto& table : tables()) {
+        const auto* t = byName.value(table);
+        if (!t) {
+            continue;
+        }
+        const auto localColumns = tableColumns(db, table, error);
+        const QSet<QString> localSet(localColumns.cbegin(), localColumns.cend());
+        // 两边共有的列；对方多出的列忽略，本库多出的列保持原值。
+        QVector<int> use;
+        QStringList names;
+        for (int k = 0; k < t->columns.size(); ++k) {
+            if (localSet.contains(t->columns.at(k))) {
+                use << k;
+                names << t->columns.at(k);
+            }
+        }
+        if (!names.contains(QStringLiteral("ID"))) {
+            return abort(error, QStringLiteral("表 %1 缺少 ID 列").arg(table));
+        }
+        QStringList assignments;
+        for (const auto& n : std::as_const(names)) {
+            if (n != QStringLiteral("ID")) {
+                assignments << QStringLiteral("%1=excluded.%1").arg(n);
+            }
+        }
+        // 用 UPSERT 而不是 INSERT OR REPLACE：后者先删后插，会触发外键的 ON DELETE 动作。
+        auto sql = QStringLiteral("INSERT INTO %1(%2) VALUES(%3)")
+                       .arg(table, names.join(QLatin1Char(',')), QStringList(names.size(), QStringLiteral("?")).join(QLatin1Char(',')));
+        sql += assignments.isEmpty() ? QStringLiteral(" ON CONFLICT(ID) DO NOTHING;")
+                                     : QStringLiteral(" ON CONFLICT(ID) DO UPDATE SET %1;").arg(assignments.join(QLatin1Char(',')));
+        QSqlQuery upsert(db);
+        if (!upsert.prepare(sql)) {
+            return abort(error, upsert.lastError().text());
+        }
+
+        // 引用的行在本库不存在（已被删除）时置空，与 ON DELETE SET NULL 一致。
+        const auto fks = foreignKeys(db, table);
+        std::map<int, QSqlQuery> parentChecks;
+        for (int i = 0; i < names.size(); ++i) {
+            const auto parent = fks.value(names.at(i));
+            if (!parent.isEmpty()) {
+                auto& check = parentChecks.try_emplace(i, db).first->second;
+                check.prepare(QStringLiteral("SELECT 1 FROM %1 WHERE ID=?;").arg(parent));
+            }
+        }
+
+        for (const auto& c : t->changes) {
+            if (c.op != OpUpsert) {
+                continue;
+            }
+            bool wins = false;
+            if (!accept(table, c, &wins)) {
+                db.rollback();
+                return false;
+            }
+            if (!wins) {
+                ++s.skipped;
+                continue;
+            }
+            for (int i = 0; i < use.size(); ++i) {
+                QVariant v = c.values.at(use.at(i));
+                const auto check = parentChecks.find(i);
+                if (check != parentChecks.end() && !v.isNull()) {
+                    auto& cq = check->second;
+                    cq.addBindValue(v);
+                    if (!cq.exec()) {
+                        return abort(error, cq.lastError().text());
+                    }
+                    if (!cq.next()) {
+                        v = QVariant();
+                    }
+                    cq.finish();
+                }
+                upsert.addBindValue(v);
+            }
+            if (!upsert.exec()) {
+                return abort(error, QStringLiteral("%1 %2: %3").arg(table, c.rowId, upsert.lastError().text()));
+            }
+            if (!remember(table, c)) {
+                db.rollback();
+                return false;
+            }
+            ++s.upserts;
+        }
+    }
+
+    for (auto it = tables().crbegin(); it != tables().crend(); ++it) {
+        const auto* t = byName.value(*it);
+        if (!t) {
+            continue;
+        }
+        QSqlQuery del(db);
+        del.prepare(QStringLiteral("DELETE FROM %1 WHERE ID=?;").arg(*it));
+        for (const auto& c : t->changes) {
+            if (c.op != OpDelete) {
+                continue;
+            }
+            bool wins = false;
+            if (!accept(*it, c, &wins)) {
+                db.rollback();
+                return false;
+            }
+            if (!wins) {
+                ++s.skipped;
+                continue;
+            }
+            del.addBindValue(c.rowId);
+            if (!del.exec()) {
+                return abort(error, QStringLiteral("%1 %2: %3").arg(*it, c.rowId, del.lastError().text()));
+            }
+            if (!remember(*it, c)) {
+                db.rollback();
+                return false;
+            }
+            ++s.deletes;
+        }
+    }
+
+    const bool ok =
+        execOn(db, QStringLiteral("DELETE FROM SyncState WHERE KEY=?;"), {kSuppressKey}, error)
+        && execOn(db,
+                  QStringLiteral("INSERT INTO SyncPeer(PEER,RECV_SEQ,SYNCED_MS) VALUES(?,?,?)"
+                                 " ON CONFLICT(PEER) DO UPDATE SET RECV_SEQ=excluded.RECV_SEQ, SYNCED_MS=excluded.SYNCED_MS;"),
+                  {s.source, s.toSeq, QDateTime::currentMSecsSinceEpoch()},
+                  error);
+    if (!ok) {
+        db.rollback();
+        return false;
+    }
+    if (!db.commit()) {
+        return abort(error, db.lastError().text());
+    }
+    if (stats) {
+        *stats = s;
+    }
+    return true;
+}
+
+bool DeltaSync::syncLocal(QSqlDatabase& a, QSqlDatabase& b, const QString& workDir, Stats* aToB, Stats* bToA, QString* error)
+{
+    const auto idA = nodeId(a, error);
+    const auto idB = nodeId(b, error);
+    if (idA.isEmpty() || idB.isEmpty()) {
+        return fail(error, QStringLiteral("库还没有节点 ID"));
+    }
+    if (idA == idB) {
+        return fail(error, QStringLiteral("两个库的节点 ID 相同（%1），复制出来的库须先 resetNode").arg(idA));
+    }
+    const qint64 ackB = receivedSeq(b, idA, error);
+    const qint64 ackA = receivedSeq(a, idB, error);
+    if (ackA < 0 || ackB < 0) {
+        return false;
+    }
+
+    // 两个方向都先导出再应用，避免刚应用进来的改动又被原样发回去。
+    // 起点取对方已确认的位置而不是本库的发送位置：上一轮导出后应用失败，这一轮会把那部分重新带上。
+    const auto toB = QDir(workDir).filePath(QStringLiteral("a-to-b.delta"));
+    const auto toA = QDir(workDir).filePath(QStringLiteral("b-to-a.delta"));
+    Stats sa;
+    Stats sb;
+    const bool ok = exportChangesSince(a, idB, ackB, toB, &sa, error) && exportChangesSince(b, idA, ackA, toA, &sb, error)
+        && applyChanges(b, toB, &sa, error) && applyChanges(a, toA, &sb, error);
+    QFile::remove(toB);
+    QFile::remove(toA);
+    if (aToB) {
+        *aToB = sa;
+    }
+    if (bToA) {
+        *bToA = sb;
+    }
+    return ok;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+
+// 两个库之间的增量同步（如总院与分院各有一份 hospital.db）。
+// Patient、Doctor、Department 上的触发器把每次增删改记到 ChangeLog（同一行只留最新一条：
+// 表名 + 主键 + 操作 + 时间戳 + 来源节点），导出时按 SEQ 取上次发给对方之后的记录，
+// 再逐条按主键读当前值写成压缩的增量文件，开销只与改动行数有关，与库的大小无关。
+// 应用时按“最后写入者胜”解决冲突：比较 (TS_MS, 来源节点 ID)，较大者为准，两边结果一致。
+// 时间戳取各自机器的时钟，时钟偏差大时以偏快的一方为准。
+// 用备份复制出分院库后必须先 resetNode()，否则两边节点 ID 相同。
+class DeltaSync final
+{
+public:
+    struct Stats
+    {
+        QString source;
+        qint64 fromSeq = 0;
+        qint64 toSeq = 0;
+        qint64 upserts = 0;
+        qint64 deletes = 0;
+        // 应用时因本地较新而跳过的条数。
+        qint64 skipped = 0;
+        // 增量文件已经应用过。
+        bool alreadyApplied = false;
+    };
+
+    // 参与同步的表，按应用顺序（被引用的表在前）；主键列都是 ID。
+    static const QStringList& tables();
+
+    // 建 SyncState、ChangeLog、SyncPeer 表和触发器，首次调用时生成本库节点 ID。
+    static bool install(QSqlDatabase& db, QString* error = nullptr);
+    static QString nodeId(const QSqlDatabase& db, QString* error = nullptr);
+    // 换新节点 ID 并清空 ChangeLog、SyncPeer；用于复制出来的新库。
+    static bool resetNode(QSqlDatabase& db, QString* error = nullptr);
+    // 批量生成数据等场合暂停记录改动（状态存在库里，对所有连接生效）。
+    static bool setCaptureEnabled(QSqlDatabase& db, bool enabled, QString* error = nullptr);
+
+    // 导出上次发给 peerId 之后的改动（不含来自 peerId 本身的），成功后推进发送位置（SyncPeer.SENT_SEQ）。
+    // 发送位置只是乐观估计：文件丢失或对方应用失败时，应改用 exportChangesSince 从对方已确认的位置重发。
+    static bool exportChanges(QSqlDatabase& db, const QString& peerId, const QString& path, Stats* stats = nullptr, QString* error = nullptr);
+    // 同上，但从 fromSeq 之后导出；fromSeq 取对方库里的 receivedSeq(对方, 本库节点 ID)。
+    static bool exportChangesSince(QSqlDatabase& db,
+                                   const QString& peerId,
+                                   qint64 fromSeq,
+                                   const QString& path,
+                                   Stats* stats = nullptr,
+                                   QString* error = nullptr);
+    // 本库已从 peerId 应用到的位置（SyncPeer.RECV_SEQ），出错返回 -1。
+    static qint64 receivedSeq(const QSqlDatabase& db, const QString& peerId, QString* error = nullptr);
+    // 在一个事务里应用增量文件；重复应用同一文件不会有副作用，缺少更早的增量时报错。
+    static bool applyChanges(QSqlDatabase& db, const QString& path, Stats* stats = nullptr, QString* error = nullptr);
+    // 两个本地库互相同步一轮：两个方向都从对方已确认收到的位置导出到 workDir，再分别应用。
+    // 任何一步失败都不会丢改动，直接重跑即可。
+    static bool syncLocal(QSqlDatabase& a,
+                          QSqlDatabase& b,
+                          const QString& workDir,
+                          Stats* aToB = nullptr,
+                          Stats* bToA = nullptr,
+                          QString* error = nullptr);
+};
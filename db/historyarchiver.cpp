@@ -0,0 +1,363 @@
+#include "historyarchiver.h"
+
+#include "db/dbmanager.h"
+#include "db/historysearch.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QPointer>
+#include <QSettings>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+
+namespace {
+
+// 每个事务搬多少行；行数小，单次持有写锁的时间就短。
+constexpr int kChunkRows = 500;
+// 批间停顿，让前台写入和日志写线程拿到写锁。
+constexpr unsigned long kPauseMs = 20;
+constexpr int kDefaultRetentionDays = 180;
+constexpr int kBackfillRows = 1000;
+
+const QString kArchiveSchema = QStringLiteral(
+    "CREATE TABLE IF NOT EXISTS arc.History ("
+    "  ID INTEGER PRIMARY KEY,"
+    "  USER_ID TEXT,"
+    "  EVENT TEXT,"
+    "  TIMESTAMP TEXT,"
+    "  ACTION INTEGER,"
+    "  ENTITY_TYPE INTEGER,"
+    "  ENTITY_ID TEXT,"
+    "  TEMPLATE_ID INTEGER,"
+    "  DETAIL TEXT,"
+    "  TS_MS INTEGER"
+    ");");
+
+bool execOn(const QSqlDatabase& db, const QString& sql, const QVariantList& args, QString* error, int* affected = nullptr)
+{
+    QSqlQuery q(db);
+    if (!q.prepare(sql)) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return false;
+    }
+    for (const auto& v : args) {
+        q.addBindValue(v);
+    }
+    if (!q.exec()) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return false;
+    }
+    if (affected) {
+        *affected = q.numRowsAffected();
+    }
+    return true;
+}
+
+// 把 [fromMs, toMs) 中最早的一批行搬进已 ATTACH 为 arc 的归档库；返回搬走的行数，出错返回 -1。
+int moveChunk(QSqlDatabase& db, const QString& month, qint64 fromMs, qint64 toMs, QString* error)
+{
+    QVariantList ids;
+    qint64 minTs = 0;
+    qint64 maxTs = 0;
+    {
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        q.prepare(QStringLiteral("SELECT ID, TS_MS FROM main.History WHERE TS_MS >= ? AND TS_MS < ? ORDER BY TS_MS LIMIT %1;")
+                      .arg(kChunkRows));
+        q.addBindValue(fromMs);
+        q.addBindValue(toMs);
+        if (!q.exec()) {
+            if (error) {
+                *error = q.lastError().text();
+            }
+            return -1;
+        }
+        while (q.next()) {
+            ids << q.value(0);
+            const qint64 ts = q.value(1).toLongLong();
+            if (ids.size() == 1) {
+                minTs = ts;
+            }
+            maxTs = ts;
+        }
+    }
+    if (ids.isEmpty()) {
+        return 0;
+    }
+
+    QStringList marks;
+    marks.reserve(ids.size());
+    for (int i = 0; i < ids.size(); ++i) {
+        marks << QStringLiteral("?");
+    }
+    const auto in = marks.join(QLatin1Char(','));
+    const auto cols = HistoryArchiver::historyColumns();
+
+    if (!db.transaction()) {
+        if (error) {
+            *error = db.lastError().text();
+        }
+        return -1;
+    }
+
+    // 归档库与主库分别提交。中途崩溃时主库的行还在，重跑时 OR IGNORE 跳过已归档的行，
+    // 汇总与删除在主库同一事务内，不会重复累加。
+    int deleted = 0;
+    const bool ok =
+        execOn(db,
+               QStringLiteral("INSERT OR IGNORE INTO arc.History(%1) SELECT %1 FROM main.History WHERE ID IN (%2);").arg(cols, in),
+               ids,
+               error)
+        && execOn(db,
+                  QStringLiteral("INSERT INTO main.HistoryDaily(DAY,USER_ID,ACTION,COUNT)"
+                                 " SELECT date(TS_MS/1000,'unixepoch','localtime'), IFNULL(USER_ID,''), IFNULL(ACTION,0), COUNT(1)"
+                                 "   FROM main.History WHERE ID IN (%1) GROUP BY 1,2,3"
+                                 " ON CONFLICT(DAY,USER_ID,ACTION) DO UPDATE SET COUNT=COUNT+excluded.COUNT;")
+                      .arg(in),
+                  ids,
+                  error)
+        && (!HistorySearch::isAvailable()
+            || (execOn(db,
+                       QStringLiteral("INSERT OR IGNORE INTO arc.HistoryFts(rowid, TOKENS)"
+                                      " SELECT rowid, TOKENS FROM main.HistoryFts WHERE rowid IN (%1);")
+                           .arg(in),
+                       ids,
+                       error)
+                && execOn(db, QStringLiteral("DELETE FROM main.HistoryFts WHERE rowid IN (%1);").arg(in), ids, error)))
+        && execOn(db, QStringLiteral("DELETE FROM main.History WHERE ID IN (%1);").arg(in), ids, error, &deleted)
+        && execOn(db,
+                  QStringLiteral("INSERT INTO main.HistoryArchive(MONTH,FILE,MIN_TS,MAX_TS,ROWS) VALUES(?,?,?,?,?)"
+                                 " ON CONFLICT(MONTH) DO UPDATE SET MIN_TS=min(MIN_TS,excluded.MIN_TS),"
+                                 " MAX_TS=max(MAX_TS,excluded.MAX_TS), ROWS=ROWS+excluded.ROWS;"),
+                  {month, QStringLiteral("history-%1.db").arg(month), minTs, maxTs, deleted},
+                  error);
+
+    if (!ok) {
+        db.rollback();
+        return -1;
+    }
+    if (!db.commit()) {
+        if (error) {
+            *error = db.lastError().text();
+        }
+        db.rollback();
+        return -1;
+    }
+    return ids.size();
+}
+
+}
+
+HistoryArchiver::HistoryArchiver(QObject* parent)
+    : QObject(parent)
+{
+}
+
+HistoryArchiver::~HistoryArchiver()
+{
+    stop();
+}
+
+int HistoryArchiver::retentionDays()
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    return qMax(0, settings.value(QStringLiteral("History/RetentionDays"), kDefaultRetentionDays).toInt());
+}
+
+void HistoryArchiver::setRetentionDays(int days)
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    settings.setValue(QStringLiteral("History/RetentionDays"), qMax(0, days));
+}
+
+QString HistoryArchiver::archiveDir()
+{
+    return QFileInfo(DbManager::instance().databasePath()).dir().filePath(QStringLiteral("archive"));
+}
+
+QString HistoryArchiver::historyColumns()
+{
+    return QStringLiteral("ID,USER_ID,EVENT,TIMESTAMP,ACTION,ENTITY_TYPE,ENTITY_ID,TEMPLATE_ID,DETAIL,TS_MS");
+}
+
+QVector<HistoryArchiver::Archive> HistoryArchiver::archivesInRange(qint64 fromMs, qint64 toMs, QString* error)
+{
+    QVector<Archive> result;
+    QSqlQuery q(DbManager::instance().database());
+    q.prepare(QStringLiteral("SELECT MONTH, FILE, MIN_TS, MAX_TS FROM HistoryArchive"
+                             " WHERE MAX_TS >= ? AND (? = 0 OR MIN_TS < ?) ORDER BY MONTH DESC;"));
+    q.addBindValue(fromMs);
+    q.addBindValue(toMs);
+    q.addBindValue(toMs);
+    if (!q.exec()) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return result;
+    }
+
+    const QDir dir(archiveDir());
+    while (q.next()) {
+        Archive a;
+        a.month = q.value(0).toString();
+        a.path = dir.filePath(q.value(1).toString());
+        a.minTs = q.value(2).toLongLong();
+        a.maxTs = q.value(3).toLongLong();
+        if (QFileInfo::exists(a.path)) {
+            result.append(a);
+        }
+    }
+    return result;
+}
+
+void HistoryArchiver::schedule(int firstDelayMs, int intervalMs)
+{
+    if (!m_timer) {
+        m_timer = new QTimer(this);
+        connect(m_timer, &QTimer::timeout, this, [this] {
+            m_timer->setInterval(m_intervalMs);
+            start();
+        });
+    }
+    m_intervalMs = qMax(1, intervalMs);
+    m_timer->start(qMax(0, firstDelayMs));
+}
+
+void HistoryArchiver::start()
+{
+    if (m_thread) {
+        return;
+    }
+    // 不归档时也要跑全文索引补词，cutoffMs 为 0 表示跳过归档。
+    const int days = retentionDays();
+    const qint64 cutoffMs =
+        days > 0 ? QDateTime(QDate::currentDate().addDays(-days), QTime(0, 0)).toMSecsSinceEpoch() : 0;
+
+    m_stop = std::make_shared<std::atomic_bool>(false);
+    auto stopFlag = m_stop;
+    auto* thread = QThread::create([this, cutoffMs, stopFlag] { run(this, cutoffMs, stopFlag); });
+    m_thread = thread;
+    // stop() 可能已经同步删掉了线程对象。
+    connect(thread, &QThread::finished, this, [this, guard = QPointer<QThread>(thread)] {
+        if (!guard) {
+            return;
+        }
+        if (m_thread == guard) {
+            m_thread = nullptr;
+        }
+        guard->deleteLater();
+    });
+    thread->start();
+}
+
+void HistoryArchiver::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+    m_stop->store(true);
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+void HistoryArchiver::run(HistoryArchiver* self, qint64 cutoffMs, const std::shared_ptr<std::atomic_bool>& stop)
+{
+    qint64 moved = 0;
+    QString err;
+
+    auto db = DbManager::instance().openWorkerConnection(&err);
+
+    // 旧库升级留下的空 TS_MS 先补上：归档按 TS_MS 选行，没补的旧行永远不会被归档。
+    DbManager::EpochBackfill epoch;
+    while (db.isOpen() && err.isEmpty() && !stop->load()) {
+        if (DbManager::backfillEpochChunk(db, &epoch, kBackfillRows, &err) <= 0) {
+            break;
+        }
+        QThread::msleep(kPauseMs);
+    }
+
+    // 再补全文索引：归档时索引行随明细一起搬走，没补完的行搬过去就搜不到了。
+    bool backfilled = false;
+    while (db.isOpen() && err.isEmpty() && !stop->load()) {
+        const int n = HistorySearch::backfillChunk(db, kBackfillRows, &err);
+        if (n <= 0) {
+            backfilled = (n == 0);
+            break;
+        }
+        QThread::msleep(kPauseMs);
+    }
+    if (!backfilled || cutoffMs <= 0) {
+        cutoffMs = 0;
+    } else if (!QDir().mkpath(archiveDir())) {
+        err = QStringLiteral("无法创建归档目录 %1").arg(archiveDir());
+    }
+
+    while (cutoffMs > 0 && db.isOpen() && err.isEmpty() && !stop->load()) {
+        // 最早一条待归档记录所在的月份（MIN 直接取 idx_history_ts 的第一项）。
+        qint64 oldest = -1;
+        {
+            QSqlQuery q(db);
+            q.prepare(QStringLiteral("SELECT MIN(TS_MS) FROM History WHERE TS_MS < ?;"));
+            q.addBindValue(cutoffMs);
+            if (!q.exec()) {
+                err = q.lastError().text();
+                break;
+            }
+            if (q.next() && !q.value(0).isNull()) {
+                oldest = q.value(0).toLongLong();
+            }
+        }
+        if (oldest < 0) {
+            break;
+        }
+
+        const auto day = QDateTime::fromMSecsSinceEpoch(oldest).date();
+        const QDate first(day.year(), day.month(), 1);
+        const qint64 monthStart = QDateTime(first, QTime(0, 0)).toMSecsSinceEpoch();
+        const qint64 monthEnd = qMin(QDateTime(first.addMonths(1), QTime(0, 0)).toMSecsSinceEpoch(), cutoffMs);
+        const auto month = first.toString(QStringLiteral("yyyy-MM"));
+        const auto path = QDir(archiveDir()).filePath(QStringLiteral("history-%1.db").arg(month));
+
+        // ATTACH/DETACH 不能在事务内执行，按月挂一次。
+        if (!execOn(db, QStringLiteral("ATTACH DATABASE ? AS arc;"), {path}, &err)) {
+            break;
+        }
+        if (execOn(db, kArchiveSchema, {}, &err)
+            && (!HistorySearch::isAvailable()
+                || execOn(db, QStringLiteral("CREATE VIRTUAL TABLE IF NOT EXISTS arc.HistoryFts USING fts5(TOKENS);"), {}, &err))
+            && execOn(db, QStringLiteral("CREATE INDEX IF NOT EXISTS arc.idx_history_ts ON History(TS_MS);"), {}, &err)
+            && execOn(db,
+                      QStringLiteral("CREATE INDEX IF NOT EXISTS arc.idx_history_entity ON History(ENTITY_ID, ENTITY_TYPE);"),
+                      {},
+                      &err)) {
+            while (!stop->load()) {
+                const int n = moveChunk(db, month, monthStart, monthEnd, &err);
+                if (n <= 0) {
+                    break;
+                }
+                moved += n;
+                QThread::msleep(kPauseMs);
+            }
+        }
+        QString detachErr;
+        execOn(db, QStringLiteral("DETACH DATABASE arc;"), {}, &detachErr);
+    }
+
+    if (db.isOpen()) {
+        DbManager::closeWorkerConnection(db);
+    }
+    if (!err.isEmpty()) {
+        qWarning("HistoryArchiver: %s", qPrintable(err));
+    }
+    QMetaObject::invokeMethod(self, [self, moved, err] { emit self->finished(moved, err); }, Qt::QueuedConnection);
+}
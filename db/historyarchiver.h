@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+class QThread;
+class QTimer;
+
+// 日志保留：超过保留天数的 History 记录按月搬到数据库目录下 archive/history-yyyy-MM.db，
+// 搬走前按 (日期, 用户, 动作) 累加到主库的 HistoryDaily。每批几百行一个小事务，
+// 批间让出写锁，不影响前台操作。归档目录记在 HistoryArchive 表里，查询时按时间范围 ATTACH。
+// 同一个后台任务在归档前先补旧库升级留下的空 TS_MS / CREATED_MS（DbManager::backfillEpochChunk）
+// 和旧日志的全文索引（HistorySearch::backfillChunk）。
+class HistoryArchiver final : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Archive
+    {
+        QString month;
+        QString path;
+        qint64 minTs = 0;
+        qint64 maxTs = 0;
+    };
+
+    explicit HistoryArchiver(QObject* parent = nullptr);
+    ~HistoryArchiver() override;
+
+    // 保存在数据库旁的 hospital.ini 中；0 表示不归档。
+    static int retentionDays();
+    static void setRetentionDays(int days);
+    static QString archiveDir();
+    // 归档表与主表共有的列，跨库 UNION ALL 时按此列出。
+    static QString historyColumns();
+
+    // 与 [fromMs, toMs) 有交集的归档，按月份倒序；toMs 为 0 表示不限。仅在 GUI 线程调用。
+    static QVector<Archive> archivesInRange(qint64 fromMs, qint64 toMs, QString* error = nullptr);
+
+    // firstDelayMs 后跑第一遍，之后每 intervalMs 跑一遍。
+    void schedule(int firstDelayMs, int intervalMs);
+    void start();
+    // 请求停止并等待当前批次提交完。
+    void stop();
+    bool isRunning() const { return m_thread != nullptr; }
+
+signals:
+    void finished(qint64 movedRows, const QString& error);
+
+private:
+    static void run(HistoryArchiver* self, qint64 cutoffMs, const std::shared_ptr<std::atomic_bool>& stop);
+
+    QThread* m_thread = nullptr;
+    QTimer* m_timer = nullptr;
+    int m_intervalMs = 0;
+    std::shared_ptr<std::atomic_bool> m_stop;
+};
@@ -1,14 +1,676 @@
 #include "historylogger.h"
 
+#include "db/auditjournal.h"
 #include "db/dbmanager.h"
+#include "db/historysearch.h"
+#include "db/mpscqueue.h"
 
 #include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSettings>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <QtGlobal>
 
-void HistoryLogger::logEvent(const QString& userId, const QString& event)
+#include <atomic>
+#include <memory>
+
+namespace {
+
+// 写库持续失败时队列不能无限增长，超过上限直接丢弃并计数。
+constexpr qint64 kMaxQueueDepth = 100000;
+// 日志文件后端：物化线程每隔多久、每批多少条把日志文件补进 History 表。
+constexpr int kMaterializeIntervalMs = 1000;
+constexpr int kMaterializeRows = 1000;
+
+struct PendingEvent
+{
+    QString userId;
+    int action = 0;
+    int entity = 0;
+    QString entityId;
+    QString detail;
+    QString templateText;
+    QString tokens;
+    QString timestamp;
+    qint64 tsMs = 0;
+};
+
+struct LoggerState
+{
+    MpscQueue<PendingEvent> queue;
+    std::atomic<qint64> depth{0};
+    std::atomic<qint64> enqueued{0};
+    std::atomic<qint64> committed{0};
+    std::atomic<qint64> dropped{0};
+    std::atomic<bool> stopping{false};
+    // 队列满后开始丢弃时置位，写线程取空队列后复位；每段只告警开头和结尾各一次。
+    std::atomic<bool> overflowing{false};
+
+    int batchSize = 64;
+    int intervalMs = 200;
+    QThread* writer = nullptr;
+    QSemaphore wake;
+
+    std::atomic<int> backend{static_cast<int>(HistoryLogger::Backend::Database)};
+    bool materialize = true;
+    QThread* materializer = nullptr;
+    QSemaphore materializeWake;
+
+    // 已处理（提交或丢弃）的序号，flush() 在此等待。
+    QMutex doneMutex;
+    QWaitCondition doneCond;
+    qint64 processed = 0;
+};
+
+LoggerState& state()
+{
+    static LoggerState s;
+    return s;
+}
+
+const QString kInsertSql = QStringLiteral(
+    "INSERT INTO History(USER_ID,ACTION,ENTITY_TYPE,ENTITY_ID,TEMPLATE_ID,DETAIL,TIMESTAMP,TS_MS)"
+    " VALUES(?,?,?,?,?,?,?,?);");
+const QString kFtsSql = QStringLiteral("INSERT INTO HistoryFts(rowid, TOKENS) VALUES(?,?);");
+
+// 模板文本 -> ID。模板在批量事务之外以自动提交方式写入，缓存不会因事务回滚而失效。
+QMutex templateMutex;
+QHash<QString, qint64> templateIds;
+
+qint64 resolveTemplateId(const QSqlDatabase& db, const QString& text, QString* error)
+{
+    {
+        QMutexLocker locker(&templateMutex);
+        const auto it = templateIds.constFind(text);
+        if (it != templateIds.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("INSERT OR IGNORE INTO HistoryTemplate(TEXT) VALUES(?);"));
+    q.addBindValue(text);
+    if (!q.exec()) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return -1;
+    }
+    q.prepare(QStringLiteral("SELECT ID FROM HistoryTemplate WHERE TEXT=?;"));
+    q.addBindValue(text);
+    if (!q.exec() || !q.next()) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return -1;
+    }
+    const qint64 id = q.value(0).toLongLong();
+
+    QMutexLocker locker(&templateMutex);
+    templateIds.insert(text, id);
+    return id;
+}
+
+void bindEvent(QSqlQuery& q, const PendingEvent& e, qint64 templateId)
+{
+    q.addBindValue(e.userId);
+    q.addBindValue(e.action);
+    q.addBindValue(e.entity);
+    q.addBindValue(e.entityId.isEmpty() ? QVariant() : QVariant(e.entityId));
+    q.addBindValue(templateId);
+    q.addBindValue(e.detail);
+    q.addBindValue(e.timestamp);
+    q.addBindValue(e.tsMs);
+}
+
+// 日志行与全文索引行在同一事务内写入；没有全文索引时 fts 未准备，只写日志行。
+bool insertEvent(QSqlQuery& q, QSqlQuery& fts, const PendingEvent& e, qint64 templateId, QString* error)
+{
+    bindEvent(q, e, templateId);
+    if (!q.exec()) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return false;
+    }
+    if (!HistorySearch::isAvailable()) {
+        return true;
+    }
+    fts.addBindValue(q.lastInsertId());
+    fts.addBindValue(e.tokens);
+    if (!fts.exec()) {
+        if (error) {
+            *error = fts.lastError().text();
+        }
+        return false;
+    }
+    return true;
+}
+
+bool insertSync(const PendingEvent& e, QString* error)
+{
+    auto db = DbManager::instance().database();
+    const qint64 templateId = resolveTemplateId(db, e.templateText, error);
+    if (templateId < 0) {
+        return false;
+    }
+    if (!db.transaction()) {
+        if (error) {
+            *error = db.lastError().text();
+        }
+        return false;
+    }
+    QSqlQuery q(db);
+    QSqlQuery fts(db);
+    q.prepare(kInsertSql);
+    if (HistorySearch::isAvailable()) {
+        fts.prepare(kFtsSql);
+    }
+    if (!insertEvent(q, fts, e, templateId, error) || !db.commit()) {
+        if (error && error->isEmpty()) {
+            *error = db.lastError().text();
+        }
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+// journalSeq > 0 时是物化日志文件：同一事务里把物化水位推进到该序号。
+bool commitBatch(QSqlDatabase& db, const QVector<PendingEvent>& batch, QString* error, qint64 journalSeq = 0)
+{
+    QVector<qint64> templateIdsForBatch;
+    templateIdsForBatch.reserve(batch.size());
+    for (const auto& e : batch) {
+        const qint64 id = resolveTemplateId(db, e.templateText, error);
+        if (id < 0) {
+            return false;
+        }
+        templateIdsForBatch.append(id);
+    }
+
+    if (!db.transaction()) {
+        if (error) {
+            *error = db.lastError().text();
+        }
+        return false;
+    }
+
+    QSqlQuery q(db);
+    QSqlQuery fts(db);
+    if (!q.prepare(kInsertSql) || (HistorySearch::isAvailable() && !fts.prepare(kFtsSql))) {
+        if (error) {
+            *error = q.lastError().isValid() ? q.lastError().text() : fts.lastError().text();
+        }
+        db.rollback();
+        return false;
+    }
+    for (int i = 0; i < batch.size(); ++i) {
+        if (!insertEvent(q, fts, batch.at(i), templateIdsForBatch.at(i), error)) {
+            q.finish();
+            fts.finish();
+            db.rollback();
+            return false;
+        }
+    }
+    q.finish();
+    fts.finish();
+
+    if (journalSeq > 0) {
+        QSqlQuery mark(db);
+        mark.prepare(QStringLiteral("UPDATE HistoryJournalState SET MATERIALIZED_SEQ=?;"));
+        mark.addBindValue(journalSeq);
+        if (!mark.exec()) {
+            if (error) {
+                *error = mark.lastError().text();
+            }
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!db.commit()) {
+        if (error) {
+            *error = db.lastError().text();
+        }
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+void markProcessed(qint64 n)
+{
+    auto& s = state();
+    QMutexLocker locker(&s.doneMutex);
+    s.processed += n;
+    s.doneCond.wakeAll();
+}
+
+// 已物化进 History 的最大日志序号。日志序号与 History.ID 无关（同步写入、导入、增量同步都会占用 ID），
+// 水位单独记在 HistoryJournalState 里，和物化的那批行在同一事务内推进。
+qint64 materializedSequence(const QSqlDatabase& db, QString* error)
+{
+    QSqlQuery q(db);
+    if (!q.exec(QStringLiteral("SELECT MATERIALIZED_SEQ FROM HistoryJournalState;"))) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return -1;
+    }
+    return q.next() ? q.value(0).toLongLong() : 0;
+}
+
+std::unique_ptr<AuditJournalWriter> openJournal(QString* error)
+{
+    auto db = DbManager::instance().openWorkerConnection(error);
+    if (!db.isOpen()) {
+        return nullptr;
+    }
+    const qint64 seq = materializedSequence(db, error);
+    DbManager::closeWorkerConnection(db);
+    if (seq < 0) {
+        return nullptr;
+    }
+
+    // 日志目录被清空过时序号也不会回退到水位以下，否则新记录会被当成已物化而跳过。
+    auto journal = std::make_unique<AuditJournalWriter>(HistoryLogger::journalDir());
+    if (!journal->open(seq + 1, error)) {
+        return nullptr;
+    }
+    return journal;
+}
+
+bool appendJournal(AuditJournalWriter& journal, const QVector<PendingEvent>& batch, QString* error)
+{
+    for (const auto& e : batch) {
+        AuditJournalRecord r;
+        r.tsMs = e.tsMs;
+        r.action = e.action;
+        r.entity = e.entity;
+        r.userId = e.userId;
+        r.entityId = e.entityId;
+        r.templateText = e.templateText;
+        r.detail = e.detail;
+        if (journal.append(r, error) < 0) {
+            return false;
+        }
+    }
+    // 落盘后才算提交成功，flush() 等待的就是这一步。
+    return journal.sync(error);
+}
+
+// 把水位之后的一批日志文件记录写进 History（连同全文索引）；返回写入条数，出错返回 -1。
+int materializeChunk(QSqlDatabase& db, AuditJournalReader& reader, QString* error)
 {
-    const auto ts = QDateTime::currentDateTime().toString(Qt::ISODate);
-    DbManager::instance().exec(QStringLiteral("INSERT INTO History(USER_ID,EVENT,TIMESTAMP) VALUES(?,?,?);"),
-                               {userId, event, ts},
-                               nullptr);
+    const qint64 watermark = materializedSequence(db, error);
+    if (watermark < 0 || !reader.refresh(error)) {
+        return -1;
+    }
+
+    QVector<PendingEvent> batch;
+    qint64 lastSeq = watermark;
+    auto pos = reader.seekSeq(watermark + 1);
+    AuditJournalReader::View v;
+    while (batch.size() < kMaterializeRows && reader.next(&pos, &v)) {
+        lastSeq = v.seq;
+        PendingEvent e;
+        e.userId = v.userId();
+        e.action = v.action;
+        e.entity = v.entity;
+        e.entityId = v.entityId();
+        e.detail = v.detail();
+        e.templateText = v.templateText();
+        e.tsMs = v.tsMs;
+        e.timestamp = QDateTime::fromMSecsSinceEpoch(v.tsMs).toString(Qt::ISODate);
+        e.tokens = HistorySearch::tokenize(HistoryLogger::render(e.templateText, e.detail, e.entityId));
+        batch.append(e);
+    }
+    if (batch.isEmpty()) {
+        return 0;
+    }
+    return commitBatch(db, batch, error, lastSeq) ? batch.size() : -1;
 }
 
+void materializerLoop()
+{
+    auto& s = state();
+
+    QString err;
+    auto db = DbManager::instance().openWorkerConnection(&err);
+    if (!db.isOpen()) {
+        qWarning("HistoryLogger: cannot open materializer connection: %s", qPrintable(err));
+        return;
+    }
+
+    // 落后多少都不影响写日志；退出时不追平，下次启动接着补。
+    AuditJournalReader reader(HistoryLogger::journalDir());
+    while (!s.stopping.load()) {
+        s.materializeWake.tryAcquire(1, kMaterializeIntervalMs);
+        int n = kMaterializeRows;
+        while (n == kMaterializeRows && !s.stopping.load()) {
+            err.clear();
+            n = materializeChunk(db, reader, &err);
+            if (n < 0) {
+                qWarning("HistoryLogger: materialize failed: %s", qPrintable(err));
+            }
+        }
+    }
+
+    DbManager::closeWorkerConnection(db);
+}
+
+void writerLoop()
+{
+    auto& s = state();
+
+    QString err;
+    QSqlDatabase db;
+    std::unique_ptr<AuditJournalWriter> journal;
+    if (s.backend.load() == static_cast<int>(HistoryLogger::Backend::Journal)) {
+        journal = openJournal(&err);
+        if (!journal) {
+            qWarning("HistoryLogger: cannot open journal, falling back to database: %s", qPrintable(err));
+            s.backend.store(static_cast<int>(HistoryLogger::Backend::Database));
+        }
+    }
+    if (!journal) {
+        db = DbManager::instance().openWorkerConnection(&err);
+        if (!db.isOpen()) {
+            qWarning("HistoryLogger: cannot open writer connection: %s", qPrintable(err));
+        }
+    }
+
+    QVector<PendingEvent> batch;
+    for (;;) {
+        s.wake.tryAcquire(1, s.intervalMs);
+        const bool stopping = s.stopping.load();
+
+        batch.clear();
+        PendingEvent e;
+        while (s.queue.tryPop(e)) {
+            batch.append(std::move(e));
+        }
+
+        if (!batch.isEmpty()) {
+            s.depth.fetch_sub(batch.size());
+            if (s.overflowing.exchange(false)) {
+                qWarning("HistoryLogger: queue drained, %lld events dropped so far", static_cast<long long>(s.dropped.load()));
+            }
+            err.clear();
+            bool ok = journal ? appendJournal(*journal, batch, &err) : db.isOpen() && commitBatch(db, batch, &err);
+            if (!ok && !journal && db.isOpen()) {
+                // 多半是写锁竞争超时，重试一次。
+                QThread::msleep(50);
+                err.clear();
+                ok = commitBatch(db, batch, &err);
+            }
+            if (ok) {
+                s.committed.fetch_add(batch.size());
+                emit HistoryLogger::notifier()->eventsCommitted(static_cast<int>(batch.size()));
+            } else {
+                s.dropped.fetch_add(batch.size());
+                qWarning("HistoryLogger: dropped %d events: %s", static_cast<int>(batch.size()), qPrintable(err));
+            }
+            markProcessed(batch.size());
+        }
+
+        if (stopping && s.depth.load() == 0) {
+            break;
+        }
+    }
+
+    if (db.isOpen()) {
+        DbManager::closeWorkerConnection(db);
+    }
+}
+
+}
+
+void HistoryLogger::start(int batchSize, int flushIntervalMs)
+{
+    auto& s = state();
+    if (s.writer) {
+        return;
+    }
+    s.batchSize = qMax(1, batchSize);
+    s.intervalMs = qMax(1, flushIntervalMs);
+    s.stopping.store(false);
+    notifier();
+
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    const bool useJournal = settings.value(QStringLiteral("History/Backend")).toString() == QStringLiteral("journal");
+    s.backend.store(static_cast<int>(useJournal ? Backend::Journal : Backend::Database));
+    s.materialize = settings.value(QStringLiteral("History/Materialize"), true).toBool();
+
+    s.writer = QThread::create(writerLoop);
+    s.writer->start();
+    if (useJournal && s.materialize) {
+        s.materializer = QThread::create(materializerLoop);
+        s.materializer->start();
+    }
+}
+
+void HistoryLogger::shutdown()
+{
+    auto& s = state();
+    if (!s.writer) {
+        return;
+    }
+    s.stopping.store(true);
+    s.wake.release();
+    s.writer->wait();
+    delete s.writer;
+    s.writer = nullptr;
+
+    if (s.materializer) {
+        s.materializeWake.release();
+        s.materializer->wait();
+        delete s.materializer;
+        s.materializer = nullptr;
+    }
+}
+
+HistoryLogger::Backend HistoryLogger::backend()
+{
+    return static_cast<Backend>(state().backend.load());
+}
+
+QString HistoryLogger::journalDir()
+{
+    return QFileInfo(DbManager::instance().databasePath()).dir().filePath(QStringLiteral("journal"));
+}
+
+void HistoryLogger::requestFlush()
+{
+    auto& s = state();
+    if (s.writer && s.wake.available() == 0) {
+        s.wake.release();
+    }
+}
+
+bool HistoryLogger::flush(int timeoutMs)
+{
+    auto& s = state();
+    if (!s.writer) {
+        return true;
+    }
+    const qint64 target = s.enqueued.load();
+    // 每处理完一批都会唤醒一次，超时从进入时算起，不随每次唤醒重新计时。
+    const QDeadlineTimer deadline(timeoutMs);
+    s.wake.release();
+
+    QMutexLocker locker(&s.doneMutex);
+    while (s.processed < target) {
+        if (!s.doneCond.wait(&s.doneMutex, deadline)) {
+            return s.processed >= target;
+        }
+    }
+    return true;
+}
+
+QString HistoryLogger::templateText(Action action, Entity entity)
+{
+    QString noun;
+    switch (entity) {
+    case Entity::User:
+        noun = QStringLiteral("用户");
+        break;
+    case Entity::Patient:
+        noun = QStringLiteral("患者");
+        break;
+    case Entity::Doctor:
+        noun = QStringLiteral("医生");
+        break;
+    case Entity::Department:
+        noun = QStringLiteral("科室");
+        break;
+    case Entity::None:
+        break;
+    }
+
+    switch (action) {
+    case Action::Login:
+        return QStringLiteral("登录：%1");
+    case Action::Create:
+        return QStringLiteral("添加%1：").arg(noun) + QStringLiteral("%1(%2)");
+    case Action::Update:
+        return QStringLiteral("修改%1：").arg(noun) + QStringLiteral("%1(%2)");
+    case Action::Delete:
+        return QStringLiteral("删除%1：").arg(noun) + QStringLiteral("%1(%2)");
+    case Action::BulkDelete:
+        return QStringLiteral("批量删除%1：").arg(noun) + QStringLiteral("%1");
+    case Action::BulkUpdate:
+        return QStringLiteral("批量修改%1：").arg(noun) + QStringLiteral("%1");
+    case Action::Import:
+        return QStringLiteral("导入%1：").arg(noun) + QStringLiteral("%1");
+    case Action::Other:
+        break;
+    }
+    return QStringLiteral("%1");
+}
+
+QString HistoryLogger::render(const QString& templateText, const QString& detail, const QString& entityId)
+{
+    // 依次 replace() 会把 detail 里的 "%2" 也替换掉，这里逐字扫描模板本身。
+    QString s;
+    s.reserve(templateText.size() + detail.size() + entityId.size());
+    const qsizetype n = templateText.size();
+    for (qsizetype i = 0; i < n; ++i) {
+        const QChar c = templateText.at(i);
+        if (c == QLatin1Char('%') && i + 1 < n) {
+            const QChar d = templateText.at(i + 1);
+            if (d == QLatin1Char('1') || d == QLatin1Char('2')) {
+                s += d == QLatin1Char('1') ? detail : entityId;
+                ++i;
+                continue;
+            }
+        }
+        s += c;
+    }
+    return s;
+}
+
+QString HistoryLogger::renderSql(const QString& templateExpr, const QString& detailExpr, const QString& entityIdExpr)
+{
+    // 以 %1 为界把模板切成两段，%2 只在模板的两段里替换，代入的明细不再经过 REPLACE。
+    // 占位符是字面量，不能用 arg() 拼接。
+    const QString at = QStringLiteral("instr(") + templateExpr + QStringLiteral(", '%1')");
+    const auto replace2 = [&](const QString& text) {
+        return QStringLiteral("REPLACE(") + text + QStringLiteral(", '%2', ") + entityIdExpr + QLatin1Char(')');
+    };
+    return QStringLiteral("CASE WHEN ") + at + QStringLiteral(" > 0 THEN ")
+        + replace2(QStringLiteral("substr(") + templateExpr + QStringLiteral(", 1, ") + at + QStringLiteral(" - 1)"))
+        + QStringLiteral(" || ") + detailExpr + QStringLiteral(" || ")
+        + replace2(QStringLiteral("substr(") + templateExpr + QStringLiteral(", ") + at + QStringLiteral(" + 2)"))
+        + QStringLiteral(" ELSE ") + replace2(templateExpr) + QStringLiteral(" END");
+}
+
+void HistoryLogger::log(const QString& userId,
+                        Action action,
+                        Entity entity,
+                        const QString& entityId,
+                        const QString& detail)
+{
+    auto& s = state();
+    PendingEvent e;
+    e.userId = userId;
+    e.action = static_cast<int>(action);
+    e.entity = static_cast<int>(entity);
+    e.entityId = entityId;
+    e.detail = detail;
+    e.templateText = templateText(action, entity);
+    e.tokens = HistorySearch::tokenize(render(e.templateText, detail, entityId));
+    const auto now = QDateTime::currentDateTime();
+    e.timestamp = now.toString(Qt::ISODate);
+    e.tsMs = now.toMSecsSinceEpoch();
+
+    if (!s.writer) {
+        QString err;
+        if (insertSync(e, &err)) {
+            s.committed.fetch_add(1);
+            emit notifier()->eventsCommitted(1);
+        } else {
+            s.dropped.fetch_add(1);
+            qWarning("HistoryLogger: insert failed: %s", qPrintable(err));
+        }
+        return;
+    }
+
+    if (s.depth.load(std::memory_order_relaxed) >= kMaxQueueDepth) {
+        s.dropped.fetch_add(1);
+        if (!s.overflowing.exchange(true)) {
+            qWarning("HistoryLogger: queue full (%lld events), dropping new events", static_cast<long long>(kMaxQueueDepth));
+        }
+        return;
+    }
+
+    // 先加 depth 再入队：写线程取走后的减法不会先于这里的加法，depth 不会短暂为负，
+    // 队列里还有事件时写线程也不会读到 0 而提前退出。
+    const qint64 depth = s.depth.fetch_add(1) + 1;
+    s.queue.push(std::move(e));
+    s.enqueued.fetch_add(1);
+    // 多个线程同时入队时 depth 可能越过 batchSize 而没有哪次恰好等于它，所以用 >=；
+    // 写线程已被叫醒还没取走时不再重复 release，免得它空转。
+    if (depth >= s.batchSize && s.wake.available() == 0) {
+        s.wake.release();
+    }
+}
+
+HistoryNotifier* HistoryLogger::notifier()
+{
+    static HistoryNotifier inst;
+    return &inst;
+}
+
+qint64 HistoryLogger::queueDepth()
+{
+    return state().depth.load();
+}
+
+qint64 HistoryLogger::droppedCount()
+{
+    return state().dropped.load();
+}
+
+qint64 HistoryLogger::committedCount()
+{
+    return state().committed.load();
+}
+
+QString HistoryLogger::summarizeIds(const QStringList& ids, int limit)
+{
+    if (ids.size() <= limit) {
+        return ids.join(QLatin1Char(','));
+    }
+    return QStringLiteral("%1…").arg(ids.mid(0, limit).join(QLatin1Char(',')));
+}
@@ -1,10 +1,86 @@
 #pragma once
 
+#include <QObject>
 #include <QString>
+#include <QStringList>
 
-class HistoryLogger final
+// 写线程每提交一批就发一次信号（跨线程排队投递），日志页据此增量追加。
+class HistoryNotifier final : public QObject
 {
+    Q_OBJECT
+
 public:
-    static void logEvent(const QString& userId, const QString& event);
+    using QObject::QObject;
+
+signals:
+    void eventsCommitted(int count);
 };
 
+// 日志异步写入：log 只把事件压入无锁队列，后台写线程每 batchSize 条或每 flushIntervalMs
+// 毫秒在一个事务里批量提交。未 start() 时退化为同步写入。
+// 事件按结构化字段存储（动作、实体类型、实体 ID、明细），消息模板只在 HistoryTemplate 中存一份。
+// hospital.ini 中 History/Backend=journal 时改写追加式日志文件（AuditJournalWriter），完全不占数据库写锁；
+// History/Materialize（默认开）让后台线程滞后地把文件内容补进 History 表，供统计、归档等仍按表查询的功能使用。
+class HistoryLogger final
+{
+public:
+    enum class Action {
+        Other = 0,
+        Login = 1,
+        Create = 2,
+        Update = 3,
+        Delete = 4,
+        BulkDelete = 5,
+        BulkUpdate = 6,
+        Import = 7,
+    };
+
+    enum class Entity {
+        None = 0,
+        User = 1,
+        Patient = 2,
+        Doctor = 3,
+        Department = 4,
+    };
+
+    enum class Backend {
+        Database = 0,
+        Journal = 1,
+    };
+
+    static void start(int batchSize = 64, int flushIntervalMs = 200);
+    // 把队列里剩余事件全部落盘后停止写线程，程序退出前调用。
+    static void shutdown();
+    // 阻塞直到调用前入队的事件都已提交；超时返回 false。
+    static bool flush(int timeoutMs = 5000);
+    // 不等待，只叫醒写线程马上提交队列里的事件，提交后照常发 eventsCommitted。界面线程用这个。
+    static void requestFlush();
+
+    // 模板中 %1 为 detail（通常是名称），%2 为 entityId。
+    static void log(const QString& userId,
+                    Action action,
+                    Entity entity,
+                    const QString& entityId,
+                    const QString& detail);
+
+    static QString templateText(Action action, Entity entity);
+    // 一遍扫描代入，detail 里出现的 "%2" 等字样原样保留。
+    static QString render(const QString& templateText, const QString& detail, const QString& entityId);
+    // 与 render() 等价的 SQL 表达式，参数为列名或表达式（各自已处理 NULL）。要求模板里 %1 至多出现一次，
+    // templateText() 生成的模板都满足。
+    static QString renderSql(const QString& templateExpr, const QString& detailExpr, const QString& entityIdExpr);
+
+    // 日志文件打不开时会退回 Database。
+    static Backend backend();
+    static QString journalDir();
+
+    // 在 GUI 线程首次调用（start() 内）时创建。
+    static HistoryNotifier* notifier();
+
+    static qint64 queueDepth();
+    static qint64 droppedCount();
+    static qint64 committedCount();
+
+    // 批量操作汇总成一条日志时使用：超过 limit 个 ID 只列出前几个。
+    static QString summarizeIds(const QStringList& ids, int limit = 20);
+};
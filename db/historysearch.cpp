@@ -0,0 +1,227 @@
+#include "historysearch.h"
+
+#include "db/historylogger.h"
+
+#include <QRegularExpression>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+
+namespace {
+
+std::atomic_bool ftsAvailable{true};
+
+QString escapeLike(const QString& text)
+{
+    QString out = text;
+    out.replace(QLatin1Char('\\'), QStringLiteral("\\\\"));
+    out.replace(QLatin1Char('%'), QStringLiteral("\\%"));
+    out.replace(QLatin1Char('_'), QStringLiteral("\\_"));
+    return out;
+}
+
+struct Run
+{
+    bool han = false;
+    QVector<uint> points;
+};
+
+bool isHan(uint c)
+{
+    return QChar::script(c) == QChar::Script_Han;
+}
+
+void appendCodePoint(QString& s, uint c)
+{
+    if (QChar::requiresSurrogates(c)) {
+        s += QChar(QChar::highSurrogate(c));
+        s += QChar(QChar::lowSurrogate(c));
+    } else {
+        s += QChar(static_cast<ushort>(c));
+    }
+}
+
+QString fromPoints(const QVector<uint>& points, int from, int count)
+{
+    QString s;
+    for (int i = from; i < from + count; ++i) {
+        appendCodePoint(s, points.at(i));
+    }
+    return s;
+}
+
+// 按汉字 / 其他字母数字切成连续片段，标点和空白丢弃。
+QVector<Run> splitRuns(const QString& text)
+{
+    QVector<Run> runs;
+    Run current;
+    auto flush = [&] {
+        if (!current.points.isEmpty()) {
+            runs.append(current);
+            current.points.clear();
+        }
+    };
+
+    const auto points = text.toUcs4();
+    for (const uint c : points) {
+        const bool han = isHan(c);
+        if (!han && !QChar::isLetterOrNumber(c)) {
+            flush();
+            continue;
+        }
+        if (!current.points.isEmpty() && current.han != han) {
+            flush();
+        }
+        current.han = han;
+        current.points.append(c);
+    }
+    flush();
+    return runs;
+}
+
+QString quoted(const QString& token)
+{
+    auto s = token;
+    s.replace(QLatin1Char('"'), QStringLiteral("\"\""));
+    return QStringLiteral("\"%1\"").arg(s);
+}
+
+}
+
+QString HistorySearch::tokenize(const QString& text)
+{
+    QStringList tokens;
+    for (const auto& run : splitRuns(text)) {
+        const auto& p = run.points;
+        if (!run.han) {
+            tokens << fromPoints(p, 0, p.size()).toLower();
+            continue;
+        }
+        for (int i = 0; i + 1 < p.size(); ++i) {
+            tokens << fromPoints(p, i, 2);
+        }
+        // 末字单独成词，单字查询的前缀才能命中片段末尾。
+        tokens << fromPoints(p, p.size() - 1, 1);
+    }
+    return tokens.join(QLatin1Char(' '));
+}
+
+QString HistorySearch::matchExpression(const QString& query)
+{
+    QStringList phrases;
+    const auto terms = query.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
+    for (const auto& term : terms) {
+        for (const auto& run : splitRuns(term)) {
+            const auto& p = run.points;
+            if (!run.han) {
+                phrases << quoted(fromPoints(p, 0, p.size()).toLower()) + QLatin1Char('*');
+            } else if (p.size() == 1) {
+                phrases << quoted(fromPoints(p, 0, 1)) + QLatin1Char('*');
+            } else {
+                QStringList bigrams;
+                for (int i = 0; i + 1 < p.size(); ++i) {
+                    bigrams << fromPoints(p, i, 2);
+                }
+                phrases << quoted(bigrams.join(QLatin1Char(' ')));
+            }
+        }
+    }
+    return phrases.join(QLatin1Char(' '));
+}
+
+bool HistorySearch::isAvailable()
+{
+    return ftsAvailable.load();
+}
+
+void HistorySearch::setAvailable(bool available)
+{
+    ftsAvailable.store(available);
+}
+
+QString HistorySearch::likeCondition(const QString& query, QVariantList* args)
+{
+    const auto terms = query.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
+    QStringList parts;
+    for (const auto& term : terms) {
+        const auto like = QStringLiteral("%%%1%%").arg(escapeLike(term));
+        parts << QStringLiteral("(H.DETAIL LIKE ? ESCAPE '\\' OR H.ENTITY_ID LIKE ? ESCAPE '\\' OR H.EVENT LIKE ? ESCAPE '\\'"
+                                " OR H.TEMPLATE_ID IN (SELECT ID FROM HistoryTemplate WHERE TEXT LIKE ? ESCAPE '\\'))");
+        *args << like << like << like << like;
+    }
+    return parts.join(QStringLiteral(" AND "));
+}
+
+int HistorySearch::backfillChunk(QSqlDatabase& db, int limit, QString* error)
+{
+    auto fail = [error](const QSqlError& e) {
+        if (error) {
+            *error = e.text();
+        }
+        return -1;
+    };
+    if (!isAvailable()) {
+        return 0;
+    }
+
+    QSqlQuery q(db);
+    if (!q.exec(QStringLiteral("SELECT NEXT_ID FROM HistoryFtsBackfill;"))) {
+        return fail(q.lastError());
+    }
+    if (!q.next()) {
+        return 0;
+    }
+    const qint64 next = q.value(0).toLongLong();
+    if (next <= 0) {
+        return 0;
+    }
+
+    // 与 HistoryLogger::render 一致：%1 = DETAIL，%2 = ENTITY_ID。
+    q.prepare(QStringLiteral("SELECT H.ID, COALESCE(H.EVENT, ")
+              + HistoryLogger::renderSql(QStringLiteral("T.TEXT"), QStringLiteral("IFNULL(H.DETAIL,'')"),
+                                         QStringLiteral("IFNULL(H.ENTITY_ID,'')"))
+              + QStringLiteral(")"
+                               "  FROM History H LEFT JOIN HistoryTemplate T ON T.ID = H.TEMPLATE_ID"
+                               " WHERE H.ID <= ? ORDER BY H.ID DESC LIMIT ?;"));
+    q.addBindValue(next);
+    q.addBindValue(limit);
+    if (!q.exec()) {
+        return fail(q.lastError());
+    }
+    QVariantList ids;
+    QVariantList tokens;
+    while (q.next()) {
+        ids << q.value(0);
+        tokens << tokenize(q.value(1).toString());
+    }
+    q.finish();
+
+    if (!db.transaction()) {
+        return fail(db.lastError());
+    }
+    QSqlQuery ins(db);
+    ins.prepare(QStringLiteral("INSERT OR REPLACE INTO HistoryFts(rowid, TOKENS) VALUES(?,?);"));
+    for (int i = 0; i < ids.size(); ++i) {
+        ins.addBindValue(ids.at(i));
+        ins.addBindValue(tokens.at(i));
+        if (!ins.exec()) {
+            const auto err = ins.lastError();
+            db.rollback();
+            return fail(err);
+        }
+    }
+    // 最后一批不足 limit 行说明已到开头。
+    const qint64 remaining = ids.size() < limit ? 0 : ids.constLast().toLongLong() - 1;
+    QSqlQuery upd(db);
+    upd.prepare(QStringLiteral("UPDATE HistoryFtsBackfill SET NEXT_ID=?;"));
+    upd.addBindValue(remaining);
+    if (!upd.exec() || !db.commit()) {
+        const auto err = upd.lastError().isValid() ? upd.lastError() : db.lastError();
+        db.rollback();
+        return fail(err);
+    }
+    return ids.size();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVariantList>
+
+// History 全文检索（FTS5 表 HistoryFts，rowid = History.ID）。
+// unicode61 不切分汉字，所以入库前自己切词：连续汉字切成相邻二元组并补上末字，
+// 其他字母数字按词保留（小写），词之间用空格分隔后交给 FTS5。
+// 所用 SQLite 没有 FTS5 时不建 HistoryFts，日志照常写入，关键字查找退回 likeCondition()。
+class HistorySearch final
+{
+public:
+    // 由 DbManager 建表时确定；为 false 时不得读写 HistoryFts。
+    static bool isAvailable();
+    static void setAvailable(bool available);
+
+    // 事件文本 -> 空格分隔的词序列，写入 HistoryFts.TOKENS。
+    static QString tokenize(const QString& text);
+
+    // 搜索框内容 -> MATCH 表达式：空白分隔的各项取交集；多字汉字按二元组短语精确匹配，
+    // 单个汉字和字母数字词按前缀匹配。没有可检索的词时返回空串。
+    static QString matchExpression(const QString& query);
+    // 没有全文索引时的退路：空白分隔的各项取交集，每项在别名为 H 的 History 行的明细、实体 ID、
+    // 旧版事件文本和模板文本里做子串匹配，参数追加到 args。没有可查的词时返回空串。
+    static QString likeCondition(const QString& query, QVariantList* args);
+
+    // 给建立索引前已有的日志补词，每次从上次的位置往前处理 limit 行、一个事务。
+    // 返回本次处理的行数，全部完成返回 0，出错返回 -1。
+    static int backfillChunk(QSqlDatabase& db, int limit, QString* error = nullptr);
+};
@@ -0,0 +1,62 @@
+#include "lookupcache.h"
+
+#include "db/dbmanager.h"
+
+#include <QSqlError>
+#include <QSqlQuery>
+
+LookupCache::LookupCache(const QString& table, const QString& keyColumn, const QString& valueColumn)
+    : m_table(table), m_keyColumn(keyColumn), m_valueColumn(valueColumn)
+{
+}
+
+LookupCache& LookupCache::departments()
+{
+    static LookupCache inst(QStringLiteral("Department"), QStringLiteral("ID"), QStringLiteral("NAME"));
+    return inst;
+}
+
+LookupCache& LookupCache::users()
+{
+    static LookupCache inst(QStringLiteral("User"), QStringLiteral("ID"), QStringLiteral("USERNAME"));
+    return inst;
+}
+
+LookupCache& LookupCache::historyTemplates()
+{
+    static LookupCache inst(QStringLiteral("HistoryTemplate"), QStringLiteral("ID"), QStringLiteral("TEXT"));
+    return inst;
+}
+
+bool LookupCache::refresh(QString* error)
+{
+    const auto& db = DbManager::instance();
+    const qint64 current = db.tableVersion(m_table, error);
+    if (current < 0) {
+        return false;
+    }
+    if (current == m_version) {
+        return true;
+    }
+
+    QSqlQuery q(db.database());
+    q.setForwardOnly(true);
+    if (!q.exec(QStringLiteral("SELECT %1,%2 FROM %3 ORDER BY %2;").arg(m_keyColumn, m_valueColumn, m_table))) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return false;
+    }
+
+    m_byKey.clear();
+    m_entries.clear();
+    while (q.next()) {
+        Entry e;
+        e.key = q.value(0).toString();
+        e.value = q.value(1).toString();
+        m_byKey.insert(e.key, e.value);
+        m_entries.append(e);
+    }
+    m_version = current;
+    return true;
+}
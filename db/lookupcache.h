@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// 小字典表（ID -> 名称）的进程内缓存，按 TableVersion 中的版本号判断是否需要重新加载。
+// 仅在 GUI 线程（默认连接）上使用。
+class LookupCache final
+{
+public:
+    struct Entry
+    {
+        QString key;
+        QString value;
+    };
+
+    LookupCache(const LookupCache&) = delete;
+    LookupCache& operator=(const LookupCache&) = delete;
+
+    static LookupCache& departments();
+    static LookupCache& users();
+    static LookupCache& historyTemplates();
+
+    // 版本号变化时重新加载；未变化时只做一次主键查询。
+    bool refresh(QString* error = nullptr);
+    qint64 version() const { return m_version; }
+
+    QString valueOf(const QString& key) const { return m_byKey.value(key); }
+    const QVector<Entry>& entries() const { return m_entries; }
+
+private:
+    LookupCache(const QString& table, const QString& keyColumn, const QString& valueColumn);
+
+    QString m_table;
+    QString m_keyColumn;
+    QString m_valueColumn;
+
+    qint64 m_version = -1;
+    QHash<QString, QString> m_byKey;
+    QVector<Entry> m_entries;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// 多生产者 / 单消费者无锁队列（Vyukov 算法）。push 任意线程可调用且无等待；
+// tryPop 只能由唯一的消费者线程调用。
+template <typename T>
+class MpscQueue final
+{
+public:
+    MpscQueue()
+    {
+        auto* stub = new Node();
+        m_head.store(stub, std::memory_order_relaxed);
+        m_tail = stub;
+    }
+
+    ~MpscQueue()
+    {
+        T discard;
+        while (tryPop(discard)) {
+        }
+        delete m_tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value)
+    {
+        auto* node = new Node(std::move(value));
+        Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 生产者刚交换完 head 尚未链接 next 时会短暂返回 false，下一轮再取即可。
+    bool tryPop(T& out)
+    {
+        Node* tail = m_tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        out = std::move(next->value);
+        m_tail = next;
+        delete tail;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node*> m_head;
+    Node* m_tail = nullptr;
+};
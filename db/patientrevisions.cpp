@@ -0,0 +1,427 @@
+#include "patientrevisions.h"
+
+#include <QDateTime>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+
+void putVarint(QByteArray& out, quint64 v)
+{
+    while (v >= 0x80) {
+        out.append(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.append(static_cast<char>(v));
+}
+
+bool getVarint(const QByteArray& in, int* pos, quint64* v)
+{
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*pos >= in.size()) {
+            return false;
+        }
+        const auto b = static_cast<quint8>(in.at((*pos)++));
+        *v |= quint64(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+quint64 zigzag(qint64 v)
+{
+    return (quint64(v) << 1) ^ quint64(v >> 63);
+}
+
+qint64 unzigzag(quint64 v)
+{
+    return qint64(v >> 1) ^ -qint64(v & 1);
+}
+
+void putString(QByteArray& out, const QString& s)
+{
+    const auto utf8 = s.toUtf8();
+    putVarint(out, quint64(utf8.size()));
+    out.append(utf8);
+}
+
+bool getString(const QByteArray& in, int* pos, QString* s)
+{
+    quint64 len = 0;
+    if (!getVarint(in, pos, &len) || len > quint64(in.size() - *pos)) {
+        return false;
+    }
+    *s = QString::fromUtf8(in.constData() + *pos, int(len));
+    *pos += int(len);
+    return true;
+}
+
+// 身高体重界面上只有一位小数：能精确表示为十分之几时存 (值*10) 的变长整数，末位标记 0；
+// 否则存 8 字节 IEEE 双精度，标记 1。
+void putMeasure(QByteArray& out, double v)
+{
+    if (qAbs(v) < 1e15) {
+        const qint64 n = qRound64(v * 10.0);
+        if (double(n) / 10.0 == v) {
+            putVarint(out, zigzag(n) << 1);
+            return;
+        }
+    }
+    putVarint(out, 1);
+    quint64 bits = 0;
+    std::memcpy(&bits, &v, sizeof bits);
+    char buf[8];
+    qToLittleEndian(bits, buf);
+    out.append(buf, 8);
+}
+
+bool getMeasure(const QByteArray& in, int* pos, double* v)
+{
+    quint64 tag = 0;
+    if (!getVarint(in, pos, &tag)) {
+        return false;
+    }
+    if (!(tag & 1)) {
+        *v = double(unzigzag(tag >> 1)) / 10.0;
+        return true;
+    }
+    if (*pos + 8 > in.size()) {
+        return false;
+    }
+    const quint64 bits = qFromLittleEndian<quint64>(in.constData() + *pos);
+    std::memcpy(v, &bits, sizeof bits);
+    *pos += 8;
+    return true;
+}
+
+bool fail(const QSqlQuery& q, QString* error)
+{
+    if (error) {
+        *error = q.lastError().text();
+    }
+    return false;
+}
+
+bool insertRevision(const QSqlDatabase& db,
+                    const QString& patientId,
+                    qint64 rev,
+                    qint64 tsMs,
+                    const QString& userId,
+                    quint32 mask,
+                    const QByteArray& data,
+                    QString* error)
+{
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("INSERT INTO PatientRevision(PATIENT_ID,REV,TS_MS,USER_ID,MASK,DATA) VALUES(?,?,?,?,?,?);"));
+    q.addBindValue(patientId);
+    q.addBindValue(rev);
+    q.addBindValue(tsMs);
+    q.addBindValue(userId.isEmpty() ? QVariant() : QVariant(userId));
+    q.addBindValue(mask);
+    q.addBindValue(data);
+    return q.exec() || fail(q, error);
+}
+
+qint64 latestRevision(const QSqlDatabase& db, const QString& patientId, QString* error)
+{
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("SELECT IFNULL(MAX(REV),0) FROM PatientRevision WHERE PATIENT_ID=?;"));
+    q.addBindValue(patientId);
+    if (!q.exec() || !q.next()) {
+        fail(q, error);
+        return -1;
+    }
+    return q.value(0).toLongLong();
+}
+
+}
+
+quint32 PatientRevisions::diff(const Patient& a, const Patient& b)
+{
+    quint32 mask = 0;
+    if (a.idCard != b.idCard) {
+        mask |= IdCard;
+    }
+    if (a.name != b.name) {
+        mask |= Name;
+    }
+    if (a.sex != b.sex) {
+        mask |= Sex;
+    }
+    if (a.dob != b.dob) {
+        mask |= Dob;
+    }
+    if (a.height != b.height) {
+        mask |= Height;
+    }
+    if (a.weight != b.weight) {
+        mask |= Weight;
+    }
+    if (a.mobilePhone != b.mobilePhone) {
+        mask |= MobilePhone;
+    }
+    if (a.age != b.age) {
+        mask |= Age;
+    }
+    return mask;
+}
+
+QByteArray PatientRevisions::encode(const Patient& p, quint32 mask)
+{
+    QByteArray out;
+    if (mask & IdCard) {
+        putString(out, p.idCard);
+    }
+    if (mask & Name) {
+        putString(out, p.name);
+    }
+    if (mask & Sex) {
+        putVarint(out, zigzag(p.sex));
+    }
+    if (mask & Dob) {
+        // 儒略日；0 表示无效日期。
+        putVarint(out, p.dob.isValid() ? quint64(p.dob.toJulianDay()) : 0);
+    }
+    if (mask & Height) {
+        putMeasure(out, p.height);
+    }
+    if (mask & Weight) {
+        putMeasure(out, p.weight);
+    }
+    if (mask & MobilePhone) {
+        putString(out, p.mobilePhone);
+    }
+    if (mask & Age) {
+        putVarint(out, zigzag(p.age));
+    }
+    return out;
+}
+
+bool PatientRevisions::decode(const QByteArray& data, quint32 mask, Patient* p)
+{
+    int pos = 0;
+    quint64 v = 0;
+    if ((mask & IdCard) && !getString(data, &pos, &p->idCard)) {
+        return false;
+    }
+    if ((mask & Name) && !getString(data, &pos, &p->name)) {
+        return false;
+    }
+    if (mask & Sex) {
+        if (!getVarint(data, &pos, &v)) {
+            return false;
+        }
+        p->sex = int(unzigzag(v));
+    }
+    if (mask & Dob) {
+        if (!getVarint(data, &pos, &v)) {
+            return false;
+        }
+        p->dob = v == 0 ? QDate() : QDate::fromJulianDay(qint64(v));
+    }
+    if ((mask & Height) && !getMeasure(data, &pos, &p->height)) {
+        return false;
+    }
+    if ((mask & Weight) && !getMeasure(data, &pos, &p->weight)) {
+        return false;
+    }
+    if ((mask & MobilePhone) && !getString(data, &pos, &p->mobilePhone)) {
+        return false;
+    }
+    if (mask & Age) {
+        if (!getVarint(data, &pos, &v)) {
+            return false;
+        }
+        p->age = int(unzigzag(v));
+    }
+    return pos == data.size();
+}
+
+QString PatientRevisions::fieldNames(quint32 mask)
+{
+    static const struct {
+        Field field;
+        const char* name;
+    } names[] = {
+        {IdCard, "身份证"},
+        {Name, "姓名"},
+        {Sex, "性别"},
+        {Dob, "出生日期"},
+        {Height, "身高"},
+        {Weight, "体重"},
+        {MobilePhone, "手机号"},
+        {Age, "年龄"},
+    };
+    QStringList parts;
+    for (const auto& n : names) {
+        if (mask & n.field) {
+            parts << QString::fromUtf8(n.name);
+        }
+    }
+    return parts.join(QStringLiteral("、"));
+}
+
+bool PatientRevisions::current(const QSqlDatabase& db, const QString& patientId, Patient* out, QString* error)
+{
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("SELECT ID_CARD,NAME,SEX,DOB,HEIGHT,WEIGHT,MOBILEPHONE,AGE FROM Patient WHERE ID=?;"));
+    q.addBindValue(patientId);
+    if (!q.exec()) {
+        return fail(q, error);
+    }
+    if (!q.next()) {
+        if (error) {
+            *error = QStringLiteral("患者 %1 不存在").arg(patientId);
+        }
+        return false;
+    }
+    out->id = patientId;
+    out->idCard = q.value(0).toString();
+    out->name = q.value(1).toString();
+    out->sex = q.value(2).toInt();
+    out->dob = QDate::fromString(q.value(3).toString(), Qt::ISODate);
+    out->height = q.value(4).toDouble();
+    out->weight = q.value(5).toDouble();
+    out->mobilePhone = q.value(6).toString();
+    out->age = q.value(7).toInt();
+    return true;
+}
+
+bool PatientRevisions::recordCreated(const QSqlDatabase& db, const Patient& p, const QString& userId, QString* error)
+{
+    const qint64 last = latestRevision(db, p.id, error);
+    if (last < 0) {
+        return false;
+    }
+    // 沿用了已删除患者的 ID 时接着编号，旧版本仍可查。
+    return insertRevision(db, p.id, last + 1, QDateTime::currentMSecsSinceEpoch(), userId, AllFields, encode(p, AllFields), error);
+}
+
+bool PatientRevisions::recordUpdated(const QSqlDatabase& db,
+                                     const Patient& before,
+                                     const Patient& after,
+                                     const QString& userId,
+                                     QString* error)
+{
+    qint64 last = latestRevision(db, after.id, error);
+    if (last < 0) {
+        return false;
+    }
+
+    Patient previous = before;
+    if (last == 0) {
+        if (!insertRevision(db, after.id, 1, 0, {}, AllFields, encode(before, AllFields), error)) {
+            return false;
+        }
+        last = 1;
+    } else if (!load(db, after.id, last, &previous, error)) {
+        return false;
+    }
+
+    quint32 mask = diff(previous, after);
+    if (mask == 0) {
+        return true;
+    }
+    const qint64 rev = last + 1;
+    if ((rev - 1) % kSnapshotInterval == 0) {
+        mask = AllFields;
+    }
+    return insertRevision(db, after.id, rev, QDateTime::currentMSecsSinceEpoch(), userId, mask, encode(after, mask), error);
+}
+
+QVector<PatientRevisions::Revision> PatientRevisions::list(const QSqlDatabase& db, const QString& patientId, QString* error)
+{
+    QVector<Revision> revisions;
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral(
+        "SELECT REV,TS_MS,USER_ID,MASK,LENGTH(DATA) FROM PatientRevision WHERE PATIENT_ID=? ORDER BY REV DESC;"));
+    q.addBindValue(patientId);
+    if (!q.exec()) {
+        fail(q, error);
+        return revisions;
+    }
+    while (q.next()) {
+        Revision r;
+        r.rev = q.value(0).toLongLong();
+        r.tsMs = q.value(1).toLongLong();
+        r.userId = q.value(2).toString();
+        r.mask = q.value(3).toUInt();
+        r.bytes = q.value(4).toInt();
+        revisions.append(r);
+    }
+    return revisions;
+}
+
+bool PatientRevisions::load(const QSqlDatabase& db, const QString& patientId, qint64 rev, Patient* out, QString* error)
+{
+    // 从不晚于 rev 的最近一次快照开始顺序回放。每 kSnapshotInterval 版必有一次快照，
+    // 只在最近这么多版里找，子查询按主键最多扫这么多行。
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral(
+        "SELECT REV,MASK,DATA FROM PatientRevision"
+        " WHERE PATIENT_ID=? AND REV<=?"
+        "   AND REV>=(SELECT MAX(REV) FROM PatientRevision"
+        "             WHERE PATIENT_ID=? AND REV<=? AND REV>? AND MASK=?)"
+        " ORDER BY REV;"));
+    q.addBindValue(patientId);
+    q.addBindValue(rev);
+    q.addBindValue(patientId);
+    q.addBindValue(rev);
+    q.addBindValue(rev - kSnapshotInterval);
+    q.addBindValue(quint32(AllFields));
+    if (!q.exec()) {
+        return fail(q, error);
+    }
+
+    Patient p;
+    p.id = patientId;
+    bool any = false;
+    while (q.next()) {
+        if (!decode(q.value(2).toByteArray(), q.value(1).toUInt(), &p)) {
+            if (error) {
+                *error = QStringLiteral("患者 %1 的第 %2 版数据损坏").arg(patientId).arg(q.value(0).toLongLong());
+            }
+            return false;
+        }
+        any = true;
+    }
+    if (!any) {
+        if (error) {
+            *error = QStringLiteral("患者 %1 没有第 %2 版").arg(patientId).arg(rev);
+        }
+        return false;
+    }
+    *out = p;
+    return true;
+}
+
+bool PatientRevisions::report(const QSqlDatabase& db, Report* out, QString* error)
+{
+    QSqlQuery q(db);
+    if (!q.exec(QStringLiteral(
+            "SELECT COUNT(DISTINCT PATIENT_ID), COUNT(1),"
+            "       IFNULL(SUM(MASK=%1),0),"
+            "       IFNULL(SUM(CASE WHEN MASK=%1 THEN 0 ELSE LENGTH(DATA) END),0),"
+            "       IFNULL(SUM(CASE WHEN MASK=%1 THEN LENGTH(DATA) ELSE 0 END),0)"
+            "  FROM PatientRevision;")
+                    .arg(quint32(AllFields)))
+        || !q.next()) {
+        return fail(q, error);
+    }
+    Report r;
+    r.patients = q.value(0).toLongLong();
+    r.revisions = q.value(1).toLongLong();
+    r.snapshots = q.value(2).toLongLong();
+    r.deltaBytes = q.value(3).toLongLong();
+    r.snapshotBytes = q.value(4).toLongLong();
+    r.fullCopyBytes = r.snapshots > 0 ? r.snapshotBytes * r.revisions / r.snapshots : 0;
+    *out = r;
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QByteArray>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+
+#include "entities/patient.h"
+
+// 患者记录的历史版本（PatientRevision 表）。
+// 每次修改只存改动过的字段：MASK 位图标出字段，DATA 按字段顺序紧凑编码（变长整数、UTF-8 前缀长度）。
+// 每 kSnapshotInterval 版存一次全字段快照（MASK 为 AllFields），还原任意版本最多回放这么多条。
+// 首次修改已有患者时先补一条 REV 1、TS_MS 0 的基线快照，即开始记录前的样子。
+class PatientRevisions final
+{
+public:
+    enum Field : quint32 {
+        IdCard = 1u << 0,
+        Name = 1u << 1,
+        Sex = 1u << 2,
+        Dob = 1u << 3,
+        Height = 1u << 4,
+        Weight = 1u << 5,
+        MobilePhone = 1u << 6,
+        Age = 1u << 7,
+        AllFields = 0xFFu,
+    };
+
+    static constexpr int kSnapshotInterval = 16;
+
+    struct Revision
+    {
+        qint64 rev = 0;
+        qint64 tsMs = 0;
+        QString userId;
+        quint32 mask = 0;
+        int bytes = 0;
+    };
+
+    struct Report
+    {
+        qint64 patients = 0;
+        qint64 revisions = 0;
+        qint64 snapshots = 0;
+        qint64 deltaBytes = 0;
+        qint64 snapshotBytes = 0;
+        // 假如每版都存整条记录大约要多少字节（按快照的平均大小估算）。
+        qint64 fullCopyBytes = 0;
+    };
+
+    static quint32 diff(const Patient& a, const Patient& b);
+    static QByteArray encode(const Patient& p, quint32 mask);
+    static bool decode(const QByteArray& data, quint32 mask, Patient* p);
+    // 用顿号连接的字段名，如“姓名、手机号”。
+    static QString fieldNames(quint32 mask);
+
+    // 从 Patient 表读当前值。
+    static bool current(const QSqlDatabase& db, const QString& patientId, Patient* out, QString* error = nullptr);
+
+    // 以下写操作不开事务，由调用方与 Patient 表的改动放在同一事务里。
+    static bool recordCreated(const QSqlDatabase& db, const Patient& p, const QString& userId, QString* error = nullptr);
+    // before 只在该患者还没有任何版本时用作基线；改动字段与最新版本比较得出，没有改动时不写。
+    static bool recordUpdated(const QSqlDatabase& db,
+                              const Patient& before,
+                              const Patient& after,
+                              const QString& userId,
+                              QString* error = nullptr);
+
+    // 按版本号倒序。
+    static QVector<Revision> list(const QSqlDatabase& db, const QString& patientId, QString* error = nullptr);
+    static bool load(const QSqlDatabase& db, const QString& patientId, qint64 rev, Patient* out, QString* error = nullptr);
+    static bool report(const QSqlDatabase& db, Report* out, QString* error = nullptr);
+};
@@ -0,0 +1,127 @@
+#include "periodicjob.h"
+
+#include "db/dbmanager.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QPointer>
+#include <QSettings>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+const QString kTimeFormat = QStringLiteral("yyyyMMdd-HHmmss");
+
+}
+
+PeriodicJob::PeriodicJob(Body body, QObject* parent)
+    : QObject(parent), m_body(std::move(body))
+{
+}
+
+PeriodicJob::~PeriodicJob()
+{
+    stop();
+}
+
+QString PeriodicJob::dir(const QString& group, const QString& defaultName)
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    const auto dir = settings.value(group + QStringLiteral("/Dir")).toString();
+    if (!dir.isEmpty()) {
+        return dir;
+    }
+    return QFileInfo(DbManager::instance().databasePath()).dir().filePath(defaultName);
+}
+
+int PeriodicJob::intervalHours(const QString& group, int defaultHours)
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    return qMax(0, settings.value(group + QStringLiteral("/IntervalHours"), defaultHours).toInt());
+}
+
+int PeriodicJob::keepCount(const QString& group, int defaultKeep)
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    return qMax(1, settings.value(group + QStringLiteral("/Keep"), defaultKeep).toInt());
+}
+
+QVector<PeriodicJob::File> PeriodicJob::files(const QString& dir, const QString& prefix, const QStringList& suffixes)
+{
+    QStringList filters;
+    for (const auto& suffix : suffixes) {
+        filters << prefix + QStringLiteral("*") + suffix;
+    }
+    QVector<File> result;
+    const auto entries = QDir(dir).entryInfoList(filters, QDir::Files);
+    for (const auto& fi : entries) {
+        const auto time = QDateTime::fromString(fi.fileName().mid(prefix.size(), kTimeFormat.size()), kTimeFormat);
+        if (time.isValid()) {
+            result.append({fi.absoluteFilePath(), time, fi.size()});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const File& a, const File& b) { return a.time > b.time; });
+    return result;
+}
+
+QString PeriodicJob::fileName(const QString& prefix, const QString& suffix)
+{
+    return prefix + QDateTime::currentDateTime().toString(kTimeFormat) + suffix;
+}
+
+void PeriodicJob::prune(const QVector<File>& newestFirst, int keep)
+{
+    for (int i = keep; i < newestFirst.size(); ++i) {
+        QFile::remove(newestFirst.at(i).path);
+    }
+}
+
+void PeriodicJob::schedule(int firstDelayMs, int intervalMs)
+{
+    if (!m_timer) {
+        m_timer = new QTimer(this);
+        connect(m_timer, &QTimer::timeout, this, [this] {
+            m_timer->setInterval(m_intervalMs);
+            start();
+        });
+    }
+    m_intervalMs = qMax(1, intervalMs);
+    m_timer->start(qMax(0, firstDelayMs));
+}
+
+void PeriodicJob::start()
+{
+    if (m_thread) {
+        return;
+    }
+    m_stop = std::make_shared<std::atomic_bool>(false);
+    auto* thread = QThread::create([body = m_body, stopFlag = m_stop] { body(stopFlag); });
+    m_thread = thread;
+    // stop() 可能已经同步删掉了线程对象。
+    connect(thread, &QThread::finished, this, [this, guard = QPointer<QThread>(thread)] {
+        if (!guard) {
+            return;
+        }
+        if (m_thread == guard) {
+            m_thread = nullptr;
+        }
+        guard->deleteLater();
+    });
+    thread->start();
+}
+
+void PeriodicJob::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+    m_stop->store(true);
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
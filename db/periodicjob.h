@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class QThread;
+class QTimer;
+
+// 定时在后台线程跑一次的任务（备份、分析快照）共用的部分：定时器、线程的启动与停止，
+// 以及输出文件 <前缀>yyyyMMdd-HHmmss<后缀> 的列举和只保留最近几份。
+// 设置在 hospital.ini 里各自的节（group）下：Dir、IntervalHours、Keep。
+class PeriodicJob final : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct File
+    {
+        QString path;
+        QDateTime time;
+        qint64 bytes = 0;
+    };
+
+    // 在后台线程里调用；stop 置位时应尽快返回。
+    using Body = std::function<void(const std::shared_ptr<std::atomic_bool>& stop)>;
+
+    explicit PeriodicJob(Body body, QObject* parent = nullptr);
+    ~PeriodicJob() override;
+
+    // Dir 为空时取数据库目录下的 defaultName/。
+    static QString dir(const QString& group, const QString& defaultName);
+    static int intervalHours(const QString& group, int defaultHours);
+    static int keepCount(const QString& group, int defaultKeep);
+
+    // dir 下文件名匹配 prefix + 时间 + suffixes 之一的文件，按时间倒序。
+    static QVector<File> files(const QString& dir, const QString& prefix, const QStringList& suffixes);
+    // 本次输出的文件名（不含目录）。
+    static QString fileName(const QString& prefix, const QString& suffix);
+    // newestFirst 按时间倒序，删掉第 keep 份之后的。
+    static void prune(const QVector<File>& newestFirst, int keep);
+
+    void schedule(int firstDelayMs, int intervalMs);
+    // 已在运行时什么也不做。
+    void start();
+    // 置位停止标志并等后台线程返回。
+    void stop();
+    bool isRunning() const { return m_thread != nullptr; }
+
+private:
+    Body m_body;
+    QThread* m_thread = nullptr;
+    QTimer* m_timer = nullptr;
+    int m_intervalMs = 0;
+    std::shared_ptr<std::atomic_bool> m_stop;
+};
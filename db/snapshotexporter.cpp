@@ -0,0 +1,219 @@
+#include "snapshotexporter.h"
+
+#include "db/dbmanager.h"
+#include "io/snapshotwriter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSqlError>
+#include <QSqlQuery>
+
+namespace {
+
+constexpr int kDefaultKeep = 3;
+
+const QString kGroup = QStringLiteral("Snapshot");
+const QString kPrefix = QStringLiteral("hospital-");
+const QString kSuffix = QStringLiteral(".hcol");
+
+// 与 TS_MS、CREATED_MS 重复的文本时间不导出。
+bool skipped(const QString& table, const QString& column)
+{
+    return (table == QStringLiteral("History") && column == QStringLiteral("TIMESTAMP"))
+        || (table == QStringLiteral("Patient") && column == QStringLiteral("CREATEDTIMESTAMP"));
+}
+
+// 按 SQLite 的类型亲和规则由声明类型推断列类型。
+SnapshotFormat::Type columnType(const QString& declared)
+{
+    const auto upper = declared.toUpper();
+    if (upper.contains(QStringLiteral("INT"))) {
+        return SnapshotFormat::Type::Int64;
+    }
+    if (upper.contains(QStringLiteral("REAL")) || upper.contains(QStringLiteral("FLOA")) || upper.contains(QStringLiteral("DOUB"))) {
+        return SnapshotFormat::Type::Double;
+    }
+    return SnapshotFormat::Type::String;
+}
+
+bool writeTable(QSqlDatabase& db,
+                SnapshotWriter& writer,
+                const QString& table,
+                const std::atomic_bool* stop,
+                const std::function<void(const QString&, qint64)>& progress,
+                QString* error)
+{
+    QVector<SnapshotWriter::Column> columns;
+    QStringList names;
+    QSqlQuery info(db);
+    if (!info.exec(QStringLiteral("PRAGMA table_info(%1);").arg(table))) {
+        *error = info.lastError().text();
+        return false;
+    }
+    while (info.next()) {
+        const auto name = info.value(1).toString();
+        if (!skipped(table, name)) {
+            columns.append({name, columnType(info.value(2).toString())});
+            names << name;
+        }
+    }
+    info.finish();
+    if (!writer.beginTable(table, columns, error)) {
+        return false;
+    }
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    if (!q.exec(QStringLiteral("SELECT %1 FROM %2;").arg(names.join(QLatin1Char(',')), table))) {
+        *error = q.lastError().text();
+        return false;
+    }
+    qint64 rows = 0;
+    QVariantList values;
+    values.reserve(names.size());
+    while (q.next()) {
+        values.clear();
+        for (int i = 0; i < names.size(); ++i) {
+            values << q.value(i);
+        }
+        if (!writer.addRow(values, error)) {
+            return false;
+        }
+        if (++rows % SnapshotFormat::kRowsPerGroup == 0) {
+            if (stop && stop->load()) {
+                *error = QStringLiteral("已取消");
+                return false;
+            }
+            if (progress) {
+                progress(table, rows);
+            }
+        }
+    }
+    if (q.lastError().isValid()) {
+        *error = q.lastError().text();
+        return false;
+    }
+    if (progress) {
+        progress(table, rows);
+    }
+    return writer.endTable(error);
+}
+
+}
+
+SnapshotExporter::SnapshotExporter(QObject* parent)
+    : QObject(parent)
+{
+    m_job = new PeriodicJob([this](const std::shared_ptr<std::atomic_bool>& stop) { run(this, stop); }, this);
+}
+
+SnapshotExporter::~SnapshotExporter()
+{
+    stop();
+}
+
+QString SnapshotExporter::snapshotDir()
+{
+    return PeriodicJob::dir(kGroup, QStringLiteral("snapshot"));
+}
+
+int SnapshotExporter::intervalHours()
+{
+    return PeriodicJob::intervalHours(kGroup, 0);
+}
+
+int SnapshotExporter::keepCount()
+{
+    return PeriodicJob::keepCount(kGroup, kDefaultKeep);
+}
+
+QVector<SnapshotExporter::Snapshot> SnapshotExporter::snapshots()
+{
+    // 文件名形如 hospital-yyyyMMdd-HHmmss.hcol。
+    return PeriodicJob::files(snapshotDir(), kPrefix, {kSuffix});
+}
+
+QStringList SnapshotExporter::tables()
+{
+    return {QStringLiteral("Patient"), QStringLiteral("Doctor"), QStringLiteral("History")};
+}
+
+bool SnapshotExporter::write(const QString& path,
+                             const std::atomic_bool* stop,
+                             const std::function<void(const QString&, qint64)>& progress,
+                             QString* error)
+{
+    QString err;
+    const auto part = path + QStringLiteral(".part");
+    auto db = DbManager::instance().openWorkerConnection(&err);
+    bool ok = db.isOpen() && err.isEmpty();
+
+    // 三张表在同一个读事务里读，读到的是同一时刻的数据。
+    bool inSnapshot = false;
+    if (ok) {
+        QSqlQuery q(db);
+        inSnapshot = db.transaction() && q.exec(QStringLiteral("SELECT COUNT(1) FROM sqlite_master;"));
+        q.finish();
+        if (!inSnapshot) {
+            err = db.lastError().isValid() ? db.lastError().text() : q.lastError().text();
+            ok = false;
+        }
+    }
+
+    SnapshotWriter writer(part);
+    if (ok) {
+        ok = writer.open(QDateTime::currentMSecsSinceEpoch(), &err);
+        for (const auto& table : tables()) {
+            ok = ok && writeTable(db, writer, table, stop, progress, &err);
+        }
+        ok = ok && writer.close(&err);
+    }
+
+    if (inSnapshot) {
+        db.rollback();
+    }
+    if (db.isOpen()) {
+        DbManager::closeWorkerConnection(db);
+    }
+
+    if (ok) {
+        QFile::remove(path);
+        if (!QFile::rename(part, path)) {
+            err = QStringLiteral("无法写入 %1").arg(path);
+            ok = false;
+        }
+    }
+    if (!ok) {
+        QFile::remove(part);
+        if (error) {
+            *error = err;
+        }
+    }
+    return ok;
+}
+
+void SnapshotExporter::run(SnapshotExporter* self, const std::shared_ptr<std::atomic_bool>& stop)
+{
+    QString err;
+    QString path;
+    const QDir dir(snapshotDir());
+    if (!QDir().mkpath(dir.absolutePath())) {
+        err = QStringLiteral("无法创建快照目录 %1").arg(dir.absolutePath());
+    } else {
+        path = dir.filePath(PeriodicJob::fileName(kPrefix, kSuffix));
+        const auto report = [self](const QString& table, qint64 rows) {
+            QMetaObject::invokeMethod(self, [self, table, rows] { emit self->progress(table, rows); }, Qt::QueuedConnection);
+        };
+        if (write(path, stop.get(), report, &err)) {
+            PeriodicJob::prune(snapshots(), keepCount());
+        }
+    }
+    if (!err.isEmpty()) {
+        path.clear();
+        if (!stop->load()) {
+            qWarning("SnapshotExporter: %s", qPrintable(err));
+        }
+    }
+    QMetaObject::invokeMethod(self, [self, path, err] { emit self->finished(path, err); }, Qt::QueuedConnection);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "db/periodicjob.h"
+
+// 给离线分析用的列式快照：把 Patient、Doctor、History 写成 .hcol 文件（格式见 io/snapshotformat.h），
+// 分析程序用 tools/snapshot 下只依赖标准库和 zlib 的 SnapshotReader 读取，不碰生产库。
+// 三张表在后台连接的同一个读事务里读出，是同一时刻的一致快照。
+// 定时与保留份数同 BackupManager（PeriodicJob）：文件写到数据库目录下 snapshot/（hospital.ini 的 Snapshot/Dir）。
+// 已归档到 archive/ 的日志不在快照里。
+class SnapshotExporter final : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Snapshot = PeriodicJob::File;
+
+    explicit SnapshotExporter(QObject* parent = nullptr);
+    ~SnapshotExporter() override;
+
+    // 以下设置保存在 hospital.ini 的 Snapshot 节。
+    static QString snapshotDir();
+    // 自动导出间隔（小时），默认 0 即不自动导出。
+    static int intervalHours();
+    static int keepCount();
+
+    // 按时间倒序。
+    static QVector<Snapshot> snapshots();
+    static QStringList tables();
+
+    // 在当前线程用新开的后台连接把快照写到 path（先写 .part，成功后改名）；
+    // progress 每写完一个行组回调一次。stop 置位时尽快返回 false。
+    static bool write(const QString& path,
+                      const std::atomic_bool* stop = nullptr,
+                      const std::function<void(const QString& table, qint64 rows)>& progress = {},
+                      QString* error = nullptr);
+
+    void schedule(int firstDelayMs, int intervalMs) { m_job->schedule(firstDelayMs, intervalMs); }
+    void start() { m_job->start(); }
+    void stop() { m_job->stop(); }
+    bool isRunning() const { return m_job->isRunning(); }
+
+signals:
+    void progress(const QString& table, qint64 rows);
+    void finished(const QString& path, const QString& error);
+
+private:
+    static void run(SnapshotExporter* self, const std::shared_ptr<std::atomic_bool>& stop);
+
+    PeriodicJob* m_job = nullptr;
+};
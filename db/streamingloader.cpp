@@ -0,0 +1,174 @@
+#include "streamingloader.h"
+
+#include "db/dbmanager.h"
+
+#include <QElapsedTimer>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QThread>
+
+// 首批尽量小，让第一屏在几毫秒内出现；之后按行数或时间攒批，减少跨线程投递次数。
+static constexpr int kFirstBatchRows = 100;
+static constexpr int kBatchRows = 2000;
+static constexpr qint64 kBatchIntervalMs = 50;
+
+struct StreamingLoader::Job
+{
+    quint64 generation = 0;
+    QString sql;
+    QVariantList args;
+    QStringList attachments;
+    std::shared_ptr<std::atomic_bool> cancel;
+};
+
+StreamingLoader::StreamingLoader(QObject* parent)
+    : QObject(parent)
+{
+}
+
+StreamingLoader::~StreamingLoader()
+{
+    cancel();
+    for (auto* t : m_threads) {
+        t->wait();
+        delete t;
+    }
+}
+
+void StreamingLoader::start(const QString& sql, const QVariantList& args)
+{
+    cancel();
+
+    auto job = std::make_shared<Job>();
+    job->generation = ++m_generation;
+    job->sql = sql;
+    job->args = args;
+    job->attachments = m_attachments;
+    m_cancel = std::make_shared<std::atomic_bool>(false);
+    job->cancel = m_cancel;
+    m_running = true;
+
+    auto* thread = QThread::create([this, job] { run(this, job); });
+    m_threads.append(thread);
+    connect(thread, &QThread::finished, this, [this, thread] {
+        m_threads.removeOne(thread);
+        thread->deleteLater();
+    });
+    thread->start();
+}
+
+void StreamingLoader::cancel()
+{
+    if (m_cancel) {
+        m_cancel->store(true);
+    }
+}
+
+void StreamingLoader::onColumns(quint64 generation, const QStringList& names)
+{
+    if (generation == m_generation) {
+        emit columnsReady(names);
+    }
+}
+
+void StreamingLoader::onRows(quint64 generation, const QVector<QVariantList>& rows)
+{
+    if (generation == m_generation) {
+        emit rowsReady(rows);
+    }
+}
+
+void StreamingLoader::onFinished(quint64 generation, qint64 rows, bool cancelled, const QString& error)
+{
+    if (generation != m_generation) {
+        return;
+    }
+    m_running = false;
+    emit finished(rows, cancelled, error);
+}
+
+void StreamingLoader::run(StreamingLoader* self, const std::shared_ptr<Job>& job)
+{
+    const auto gen = job->generation;
+    qint64 loaded = 0;
+    bool cancelled = false;
+    QString err;
+
+    auto db = DbManager::instance().openWorkerConnection(&err);
+    if (db.isOpen()) {
+        for (int i = 0; i < job->attachments.size() && err.isEmpty(); ++i) {
+            QSqlQuery attach(db);
+            attach.prepare(QStringLiteral("ATTACH DATABASE ? AS arc%1;").arg(i));
+            attach.addBindValue(job->attachments.at(i));
+            if (!attach.exec()) {
+                err = attach.lastError().text();
+            }
+        }
+
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        if (err.isEmpty()) {
+            if (!q.prepare(job->sql)) {
+                err = q.lastError().text();
+            } else {
+                for (const auto& v : job->args) {
+                    q.addBindValue(v);
+                }
+                if (!q.exec()) {
+                    err = q.lastError().text();
+                }
+            }
+        }
+
+        if (err.isEmpty()) {
+            const auto rec = q.record();
+            const int cols = rec.count();
+            QStringList names;
+            for (int c = 0; c < cols; ++c) {
+                names << rec.fieldName(c);
+            }
+            QMetaObject::invokeMethod(self, [self, gen, names] { self->onColumns(gen, names); }, Qt::QueuedConnection);
+
+            QVector<QVariantList> batch;
+            int limit = kFirstBatchRows;
+            QElapsedTimer timer;
+            timer.start();
+
+            while (q.next()) {
+                if (job->cancel->load()) {
+                    cancelled = true;
+                    break;
+                }
+                QVariantList row;
+                row.reserve(cols);
+                for (int c = 0; c < cols; ++c) {
+                    row.append(q.value(c));
+                }
+                batch.append(row);
+                ++loaded;
+
+                if (batch.size() >= limit || timer.elapsed() >= kBatchIntervalMs) {
+                    QMetaObject::invokeMethod(self, [self, gen, batch] { self->onRows(gen, batch); }, Qt::QueuedConnection);
+                    batch.clear();
+                    limit = kBatchRows;
+                    timer.restart();
+                }
+            }
+
+            if (!cancelled && q.lastError().isValid()) {
+                err = q.lastError().text();
+            }
+            if (!cancelled && !batch.isEmpty()) {
+                QMetaObject::invokeMethod(self, [self, gen, batch] { self->onRows(gen, batch); }, Qt::QueuedConnection);
+            }
+        }
+        q.finish();
+        q = QSqlQuery();
+        DbManager::closeWorkerConnection(db);
+    }
+
+    QMetaObject::invokeMethod(self,
+                              [self, gen, loaded, cancelled, err] { self->onFinished(gen, loaded, cancelled, err); },
+                              Qt::QueuedConnection);
+}
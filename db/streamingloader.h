@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+class QThread;
+
+// 在后台连接上逐行读取结果集，按批次回投到 GUI 线程。
+// 首批很小以便尽快出数据，之后按行数或时间间隔攒批；可随时取消，新的 start() 会取消旧任务。
+class StreamingLoader final : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StreamingLoader(QObject* parent = nullptr);
+    ~StreamingLoader() override;
+
+    // 不另外统计总数：在同一个后台连接上 COUNT 会让后面的批次一直等着，总行数以 finished 为准。
+    void start(const QString& sql, const QVariantList& args = {});
+    void cancel();
+    bool isRunning() const { return m_running; }
+    // 之后的 start() 在查询前把这些库依次 ATTACH 为 arc0、arc1…（连接关闭时自动分离）。
+    void setAttachments(const QStringList& paths) { m_attachments = paths; }
+
+signals:
+    void columnsReady(const QStringList& names);
+    void rowsReady(const QVector<QVariantList>& rows);
+    void finished(qint64 rows, bool cancelled, const QString& error);
+
+private:
+    struct Job;
+
+    void onColumns(quint64 generation, const QStringList& names);
+    void onRows(quint64 generation, const QVector<QVariantList>& rows);
+    void onFinished(quint64 generation, qint64 rows, bool cancelled, const QString& error);
+
+    static void run(StreamingLoader* self, const std::shared_ptr<Job>& job);
+
+    QStringList m_attachments;
+    quint64 m_generation = 0;
+    bool m_running = false;
+    std::shared_ptr<std::atomic_bool> m_cancel;
+    QVector<QThread*> m_threads;
+};
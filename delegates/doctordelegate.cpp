@@ -0,0 +1,50 @@
+#include "doctordelegate.h"
+
+#include "db/lookupcache.h"
+#include "models/doctormodel.h"
+
+#include <QComboBox>
+
+DoctorDelegate::DoctorDelegate(const DoctorModel* model, QObject* parent)
+    : QStyledItemDelegate(parent), m_doctorModel(model)
+{
+}
+
+QWidget* DoctorDelegate::createEditor(QWidget* parent,
+                                      const QStyleOptionViewItem& option,
+                                      const QModelIndex& index) const
+{
+    if (!m_doctorModel || index.column() != m_doctorModel->departmentColumn()) {
+        return QStyledItemDelegate::createEditor(parent, option, index);
+    }
+
+    auto& cache = LookupCache::departments();
+    cache.refresh();
+
+    auto* cb = new QComboBox(parent);
+    cb->addItem(QStringLiteral("（无）"), QString());
+    for (const auto& e : cache.entries()) {
+        cb->addItem(e.value, e.key);
+    }
+    return cb;
+}
+
+void DoctorDelegate::setEditorData(QWidget* editor, const QModelIndex& index) const
+{
+    if (!m_doctorModel || index.column() != m_doctorModel->departmentColumn()) {
+        return QStyledItemDelegate::setEditorData(editor, index);
+    }
+    auto* cb = qobject_cast<QComboBox*>(editor);
+    const int idx = cb->findData(index.data(Qt::EditRole).toString());
+    cb->setCurrentIndex(idx >= 0 ? idx : 0);
+}
+
+void DoctorDelegate::setModelData(QWidget* editor, QAbstractItemModel* model, const QModelIndex& index) const
+{
+    if (!m_doctorModel || index.column() != m_doctorModel->departmentColumn()) {
+        return QStyledItemDelegate::setModelData(editor, model, index);
+    }
+    auto* cb = qobject_cast<QComboBox*>(editor);
+    const auto id = cb->currentData().toString();
+    model->setData(index, id.isEmpty() ? QVariant() : QVariant(id), Qt::EditRole);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QStyledItemDelegate>
+
+class DoctorModel;
+
+class DoctorDelegate final : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit DoctorDelegate(const DoctorModel* model, QObject* parent = nullptr);
+
+    QWidget* createEditor(QWidget* parent,
+                          const QStyleOptionViewItem& option,
+                          const QModelIndex& index) const override;
+    void setEditorData(QWidget* editor, const QModelIndex& index) const override;
+    void setModelData(QWidget* editor, QAbstractItemModel* model, const QModelIndex& index) const override;
+
+private:
+    const DoctorModel* m_doctorModel = nullptr;
+};
@@ -23,33 +23,34 @@ QWidget* PatientDelegate::createEditor(QWidget* parent,
         return QStyledItemDelegate::createEditor(parent, option, index);
     }
 
+    const auto& cols = m_patientModel->columns();
     const auto col = index.column();
-    if (col == m_patientModel->sexColumn()) {
+    if (col == cols.sex) {
         auto* cb = new QComboBox(parent);
         cb->addItem(QStringLiteral("女"), 0);
         cb->addItem(QStringLiteral("男"), 1);
         return cb;
     }
-    if (col == m_patientModel->dobColumn()) {
+    if (col == cols.dob) {
         auto* de = new QDateEdit(parent);
         de->setCalendarPopup(true);
         de->setDisplayFormat(QStringLiteral("yyyy/M/d"));
         de->setDate(QDate::currentDate());
         return de;
     }
-    if (col == m_patientModel->heightColumn()) {
+    if (col == cols.height) {
         auto* sb = new QDoubleSpinBox(parent);
         sb->setRange(0.0, 250.0);
         sb->setDecimals(1);
         return sb;
     }
-    if (col == m_patientModel->weightColumn()) {
+    if (col == cols.weight) {
         auto* sb = new QDoubleSpinBox(parent);
         sb->setRange(0.0, 300.0);
         sb->setDecimals(1);
         return sb;
     }
-    if (col == m_patientModel->ageColumn()) {
+    if (col == cols.age) {
         auto* sb = new QSpinBox(parent);
         sb->setRange(0, 150);
         return sb;
@@ -62,27 +63,28 @@ void PatientDelegate::setEditorData(QWidget* editor, const QModelIndex& index) c
     if (!m_patientModel) {
         return QStyledItemDelegate::setEditorData(editor, index);
     }
+    const auto& cols = m_patientModel->columns();
     const auto col = index.column();
 
-    if (col == m_patientModel->sexColumn()) {
+    if (col == cols.sex) {
         auto* cb = qobject_cast<QComboBox*>(editor);
         const int value = index.data(Qt::EditRole).toInt();
         cb->setCurrentIndex(value == 1 ? 1 : 0);
         return;
     }
-    if (col == m_patientModel->dobColumn()) {
+    if (col == cols.dob) {
         auto* de = qobject_cast<QDateEdit*>(editor);
         const auto s = index.data(Qt::EditRole).toString();
         const auto d = QDate::fromString(s, Qt::ISODate);
         de->setDate(d.isValid() ? d : QDate::currentDate());
         return;
     }
-    if (col == m_patientModel->heightColumn() || col == m_patientModel->weightColumn()) {
+    if (col == cols.height || col == cols.weight) {
         auto* sb = qobject_cast<QDoubleSpinBox*>(editor);
         sb->setValue(index.data(Qt::EditRole).toDouble());
         return;
     }
-    if (col == m_patientModel->ageColumn()) {
+    if (col == cols.age) {
         auto* sb = qobject_cast<QSpinBox*>(editor);
         sb->setValue(index.data(Qt::EditRole).toInt());
         return;
@@ -96,24 +98,25 @@ void PatientDelegate::setModelData(QWidget* editor, QAbstractItemModel* model, c
     if (!m_patientModel) {
         return QStyledItemDelegate::setModelData(editor, model, index);
     }
+    const auto& cols = m_patientModel->columns();
     const auto col = index.column();
 
-    if (col == m_patientModel->sexColumn()) {
+    if (col == cols.sex) {
         auto* cb = qobject_cast<QComboBox*>(editor);
         model->setData(index, cb->currentData().toInt(), Qt::EditRole);
         return;
     }
-    if (col == m_patientModel->dobColumn()) {
+    if (col == cols.dob) {
         auto* de = qobject_cast<QDateEdit*>(editor);
         model->setData(index, de->date().toString(Qt::ISODate), Qt::EditRole);
         return;
     }
-    if (col == m_patientModel->heightColumn() || col == m_patientModel->weightColumn()) {
+    if (col == cols.height || col == cols.weight) {
         auto* sb = qobject_cast<QDoubleSpinBox*>(editor);
         model->setData(index, sb->value(), Qt::EditRole);
         return;
     }
-    if (col == m_patientModel->ageColumn()) {
+    if (col == cols.age) {
         auto* sb = qobject_cast<QSpinBox*>(editor);
         model->setData(index, sb->value(), Qt::EditRole);
         return;
@@ -128,8 +131,8 @@ void PatientDelegate::initStyleOption(QStyleOptionViewItem* option, const QModel
     if (!m_patientModel || !option) {
         return;
     }
-    if (index.column() == m_patientModel->sexColumn()) {
-        const int v = index.data(Qt::DisplayRole).toInt();
-        option->text = (v == 1) ? QStringLiteral("男") : QStringLiteral("女");
+    const auto text = index.data(PatientModel::DisplayTextRole);
+    if (text.isValid()) {
+        option->text = text.toString();
     }
 }
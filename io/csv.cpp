@@ -0,0 +1,222 @@
+#include "csv.h"
+
+#include <cstring>
+
+namespace Csv {
+
+namespace {
+
+// 末尾的 \r 属于 CRLF 换行，不算字段内容。
+QString decodeField(const char* begin, const char* end)
+{
+    if (end > begin && end[-1] == '\r') {
+        --end;
+    }
+    return QString::fromUtf8(begin, int(end - begin));
+}
+
+// 引号外最后一个换行之后的位置；没有则返回 0。
+qsizetype lastRecordBoundary(const QByteArray& data, qsizetype* firstBoundary = nullptr)
+{
+    bool quoted = false;
+    qsizetype last = 0;
+    const char* p = data.constData();
+    for (qsizetype i = 0, n = data.size(); i < n; ++i) {
+        const char c = p[i];
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c == '\n' && !quoted) {
+            last = i + 1;
+            if (firstBoundary) {
+                *firstBoundary = last;
+                return last;
+            }
+        }
+    }
+    return last;
+}
+
+}
+
+QVector<Record> parse(const QByteArray& data, qint64 firstLine)
+{
+    QVector<Record> records;
+    const char* p = data.constData();
+    const char* const end = p + data.size();
+    qint64 line = firstLine;
+
+    while (p < end) {
+        Record rec;
+        rec.line = line;
+        QByteArray quotedBuf;
+        bool done = false;
+        while (!done) {
+            if (p < end && *p == '"') {
+                // 引号字段：读到单独的引号为止，"" 还原成一个引号。
+                ++p;
+                quotedBuf.clear();
+                while (p < end) {
+                    if (*p == '"') {
+                        if (p + 1 < end && p[1] == '"') {
+                            quotedBuf.append('"');
+                            p += 2;
+                            continue;
+                        }
+                        ++p;
+                        break;
+                    }
+                    if (*p == '\n') {
+                        ++line;
+                    }
+                    quotedBuf.append(*p++);
+                }
+                // 引号后到分隔符之前的内容（不规范）照原样接上。
+                const char* tail = p;
+                while (p < end && *p != ',' && *p != '\n') {
+                    ++p;
+                }
+                rec.fields << QString::fromUtf8(quotedBuf) + decodeField(tail, p);
+            } else {
+                const char* start = p;
+                while (p < end && *p != ',' && *p != '\n') {
+                    ++p;
+                }
+                rec.fields << decodeField(start, p);
+            }
+
+            if (p >= end) {
+                done = true;
+            } else if (*p == ',') {
+                ++p;
+            } else {
+                ++p;
+                ++line;
+                done = true;
+            }
+        }
+        if (rec.fields.size() == 1 && rec.fields.constFirst().isEmpty()) {
+            continue;
+        }
+        records.append(rec);
+    }
+    return records;
+}
+
+QByteArray escape(const QString& field)
+{
+    auto utf8 = field.toUtf8();
+    if (utf8.contains(',') || utf8.contains('"') || utf8.contains('\n') || utf8.contains('\r')) {
+        utf8.replace("\"", "\"\"");
+        return '"' + utf8 + '"';
+    }
+    return utf8;
+}
+
+QByteArray formatRecord(const QStringList& fields)
+{
+    QByteArray out;
+    for (int i = 0; i < fields.size(); ++i) {
+        if (i > 0) {
+            out.append(',');
+        }
+        out.append(escape(fields.at(i)));
+    }
+    out.append("\r\n");
+    return out;
+}
+
+ChunkReader::ChunkReader(const QString& path, int chunkBytes)
+    : m_file(path), m_chunkBytes(qMax(4096, chunkBytes))
+{
+}
+
+bool ChunkReader::open(QStringList* header, QString* error)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = m_file.errorString();
+        }
+        return false;
+    }
+
+    // 表头一般很短，逐块读到第一个记录边界为止。
+    qsizetype boundary = 0;
+    while (lastRecordBoundary(m_carry, &boundary) == 0 && !m_file.atEnd()) {
+        m_carry += m_file.read(64 * 1024);
+    }
+    if (boundary == 0) {
+        boundary = m_carry.size();
+    }
+    auto head = m_carry.left(boundary);
+    qsizetype skip = 0;
+    if (head.startsWith("\xEF\xBB\xBF")) {
+        skip = 3;
+    }
+    const auto records = parse(head.mid(skip), 1);
+    if (records.isEmpty()) {
+        if (error) {
+            *error = QStringLiteral("文件为空或没有表头");
+        }
+        return false;
+    }
+    *header = records.constFirst().fields;
+
+    m_line = 1 + head.count('\n');
+    m_offset = boundary;
+    m_carry.remove(0, boundary);
+    m_dataOffset = m_offset;
+    m_dataLine = m_line;
+    return true;
+}
+
+bool ChunkReader::seek(qint64 offset, qint64 line, QString* error)
+{
+    if (offset < m_dataOffset || offset > m_file.size() || !m_file.seek(offset)) {
+        if (error) {
+            *error = QStringLiteral("断点位置 %1 无效").arg(offset);
+        }
+        return false;
+    }
+    m_carry.clear();
+    m_offset = offset;
+    m_line = line;
+    return true;
+}
+
+bool ChunkReader::next(Chunk* out, QString* error)
+{
+    for (;;) {
+        if (m_carry.size() < m_chunkBytes && !m_file.atEnd()) {
+            const auto block = m_file.read(m_chunkBytes);
+            if (block.isEmpty() && m_file.error() != QFileDevice::NoError) {
+                if (error) {
+                    *error = m_file.errorString();
+                }
+                return false;
+            }
+            m_carry += block;
+        }
+        if (m_carry.isEmpty()) {
+            return false;
+        }
+
+        qsizetype boundary = m_file.atEnd() ? m_carry.size() : lastRecordBoundary(m_carry);
+        if (boundary == 0) {
+            // 一条记录比一块还长，继续读。
+            m_carry += m_file.read(m_chunkBytes);
+            continue;
+        }
+
+        out->offset = m_offset;
+        out->firstLine = m_line;
+        out->data = m_carry.left(boundary);
+        out->lines = out->data.count('\n');
+        m_carry.remove(0, boundary);
+        m_offset += boundary;
+        m_line += out->lines;
+        out->endOffset = m_offset;
+        return true;
+    }
+}
+
+}
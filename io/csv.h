@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QStringList>
+#include <QVector>
+
+// CSV（RFC 4180）：逗号分隔，字段可加双引号，引号内可含逗号和换行，"" 表示一个引号。
+// 文件按 UTF-8 处理，开头的 BOM 忽略。
+namespace Csv {
+
+struct Record
+{
+    // 记录第一行在文件中的行号（从 1 开始）。
+    qint64 line = 0;
+    QStringList fields;
+};
+
+// 解析若干完整记录；空行跳过。firstLine 为 data 第一行的行号。
+QVector<Record> parse(const QByteArray& data, qint64 firstLine);
+
+// 需要时加引号。
+QByteArray escape(const QString& field);
+QByteArray formatRecord(const QStringList& fields);
+
+// 按块顺序读取：每块在引号外的换行处截断，各块可以交给不同线程独立解析。
+class ChunkReader final
+{
+public:
+    struct Chunk
+    {
+        qint64 offset = 0;
+        qint64 endOffset = 0;
+        qint64 firstLine = 0;
+        qint64 lines = 0;
+        QByteArray data;
+    };
+
+    explicit ChunkReader(const QString& path, int chunkBytes = 4 * 1024 * 1024);
+
+    // 读第一行作为表头，之后从表头之后开始读。
+    bool open(QStringList* header, QString* error = nullptr);
+    // 断点续传：跳到 offset（必须是之前某块的 endOffset），line 为该处的行号。
+    bool seek(qint64 offset, qint64 line, QString* error = nullptr);
+    // 读到文件尾返回 false 且 error 为空。
+    bool next(Chunk* out, QString* error = nullptr);
+
+    qint64 size() const { return m_file.size(); }
+    qint64 dataOffset() const { return m_dataOffset; }
+    qint64 dataLine() const { return m_dataLine; }
+
+private:
+    QFile m_file;
+    int m_chunkBytes = 0;
+    QByteArray m_carry;
+    qint64 m_offset = 0;
+    qint64 m_line = 1;
+    qint64 m_dataOffset = 0;
+    qint64 m_dataLine = 2;
+};
+
+}
@@ -0,0 +1,610 @@
+#include "csvimporter.h"
+
+#include "db/dbmanager.h"
+#include "io/csv.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+enum class Kind {
+    Text,
+    // 空串存 NULL（外键列）。
+    NullableText,
+    Int,
+    Real,
+    Date,
+    Sex,
+};
+
+struct ColumnSpec
+{
+    const char* name;
+    const char* label;
+    Kind kind;
+    bool required;
+};
+
+struct TargetSpec
+{
+    const char* table;
+    QVector<ColumnSpec> columns;
+    // 患者表另外写入导入时间。
+    bool stampCreated;
+};
+
+const TargetSpec& specFor(CsvImporter::Target target)
+{
+    static const TargetSpec patients{
+        "Patient",
+        {
+            {"ID", "ID", Kind::Text, true},
+            {"ID_CARD", "身份证", Kind::Text, false},
+            {"NAME", "姓名", Kind::Text, true},
+            {"SEX", "性别", Kind::Sex, false},
+            {"DOB", "出生日期", Kind::Date, false},
+            {"HEIGHT", "身高", Kind::Real, false},
+            {"WEIGHT", "体重", Kind::Real, false},
+            {"MOBILEPHONE", "手机号", Kind::Text, false},
+            {"AGE", "年龄", Kind::Int, false},
+        },
+        true,
+    };
+    static const TargetSpec doctors{
+        "Doctor",
+        {
+            {"ID", "ID", Kind::Text, true},
+            {"EMPLOYEENO", "工号", Kind::Text, false},
+            {"NAME", "姓名", Kind::Text, true},
+            {"DEPARTMENT_ID", "科室ID", Kind::NullableText, false},
+        },
+        false,
+    };
+    static const TargetSpec departments{
+        "Department",
+        {
+            {"ID", "ID", Kind::Text, true},
+            {"NAME", "名称", Kind::Text, true},
+        },
+        false,
+    };
+    switch (target) {
+    case CsvImporter::Target::Patients:
+        return patients;
+    case CsvImporter::Target::Doctors:
+        return doctors;
+    case CsvImporter::Target::Departments:
+        break;
+    }
+    return departments;
+}
+
+QString targetName(CsvImporter::Target target)
+{
+    return QString::fromUtf8(specFor(target).table);
+}
+
+struct ParsedRow
+{
+    qint64 line = 0;
+    QVariantList values;
+    QStringList raw;
+};
+
+struct RowError
+{
+    qint64 line = 0;
+    QString message;
+    QStringList raw;
+};
+
+struct ParsedChunk
+{
+    qint64 endOffset = 0;
+    qint64 endLine = 0;
+    QVector<ParsedRow> rows;
+    QVector<RowError> errors;
+};
+
+bool convert(const ColumnSpec& c, const QString& text, QVariant* out, QString* message)
+{
+    const auto s = text.trimmed();
+    if (s.isEmpty()) {
+        if (c.required) {
+            *message = QStringLiteral("%1不能为空").arg(QString::fromUtf8(c.label));
+            return false;
+        }
+        *out = c.kind == Kind::Text ? QVariant(QString()) : QVariant();
+        return true;
+    }
+
+    bool ok = true;
+    switch (c.kind) {
+    case Kind::Text:
+    case Kind::NullableText:
+        *out = s;
+        break;
+    case Kind::Int:
+        *out = s.toInt(&ok);
+        break;
+    case Kind::Real:
+        *out = s.toDouble(&ok);
+        break;
+    case Kind::Date: {
+        auto d = QDate::fromString(s, Qt::ISODate);
+        if (!d.isValid()) {
+            d = QDate::fromString(s, QStringLiteral("yyyy/M/d"));
+        }
+        if (!d.isValid()) {
+            d = QDate::fromString(s, QStringLiteral("yyyyMMdd"));
+        }
+        ok = d.isValid();
+        *out = d.toString(Qt::ISODate);
+        break;
+    }
+    case Kind::Sex:
+        if (s == QStringLiteral("男") || s == QStringLiteral("1") || s.compare(QStringLiteral("M"), Qt::CaseInsensitive) == 0) {
+            *out = 1;
+        } else if (s == QStringLiteral("女") || s == QStringLiteral("0") || s.compare(QStringLiteral("F"), Qt::CaseInsensitive) == 0) {
+            *out = 0;
+        } else {
+            ok = false;
+        }
+        break;
+    }
+    if (!ok) {
+        *message = QStringLiteral("%1格式不正确：%2").arg(QString::fromUtf8(c.label), s);
+    }
+    return ok;
+}
+
+ParsedChunk parseChunk(CsvImporter::Target target,
+                       const QVector<int>& mapping,
+                       int headerColumns,
+                       const Csv::ChunkReader::Chunk& chunk)
+{
+    const auto& spec = specFor(target);
+    ParsedChunk out;
+    out.endOffset = chunk.endOffset;
+    out.endLine = chunk.firstLine + chunk.lines;
+
+    const auto records = Csv::parse(chunk.data, chunk.firstLine);
+    out.rows.reserve(records.size());
+    for (const auto& r : records) {
+        if (r.fields.size() > headerColumns) {
+            out.errors.append({r.line, QStringLiteral("列数 %1 多于表头的 %2 列").arg(r.fields.size()).arg(headerColumns), r.fields});
+            continue;
+        }
+        ParsedRow row;
+        row.line = r.line;
+        row.values.reserve(spec.columns.size());
+        QString message;
+        bool ok = true;
+        for (int i = 0; i < spec.columns.size() && ok; ++i) {
+            const int col = mapping.at(i);
+            QVariant v;
+            ok = convert(spec.columns.at(i), col >= 0 ? r.fields.value(col) : QString(), &v, &message);
+            row.values.append(v);
+        }
+        if (!ok) {
+            out.errors.append({r.line, message, r.fields});
+            continue;
+        }
+        row.raw = r.fields;
+        out.rows.append(row);
+    }
+    return out;
+}
+
+bool failQuery(const QSqlQuery& q, QString* error)
+{
+    if (error) {
+        *error = q.lastError().text();
+    }
+    return false;
+}
+
+}
+
+struct CsvImporter::Job
+{
+    Target target = Target::Patients;
+    QString path;
+    QString fileKey;
+    qint64 size = 0;
+    qint64 mtimeMs = 0;
+    // 表字段 -> CSV 列号，-1 表示文件里没有这一列。
+    QVector<int> mapping;
+    int headerColumns = 0;
+    std::unique_ptr<Csv::ChunkReader> reader;
+
+    bool resumed = false;
+    qint64 startOffset = 0;
+    qint64 startLine = 0;
+    qint64 baseImported = 0;
+    qint64 baseFailed = 0;
+    QString createdText;
+    qint64 createdMs = 0;
+
+    QThreadPool* pool = nullptr;
+    std::atomic_bool cancel{false};
+    // 在途（已读未提交）的块数上限。
+    QSemaphore inFlight;
+
+    QMutex mutex;
+    QWaitCondition ready;
+    QMap<qint64, ParsedChunk> parsed;
+    qint64 totalChunks = -1;
+    QString readError;
+};
+
+CsvImporter::CsvImporter(QObject* parent)
+    : QObject(parent)
+{
+    setParserThreads(QThread::idealThreadCount() - 1);
+}
+
+CsvImporter::~CsvImporter()
+{
+    cancel();
+    for (auto* t : m_threads) {
+        t->wait();
+        delete t;
+    }
+    m_pool.waitForDone();
+}
+
+void CsvImporter::setParserThreads(int threads)
+{
+    m_pool.setMaxThreadCount(qMax(1, threads));
+}
+
+QStringList CsvImporter::columnHints(Target target)
+{
+    QStringList hints;
+    for (const auto& c : specFor(target).columns) {
+        auto hint = QStringLiteral("%1/%2").arg(QString::fromUtf8(c.name), QString::fromUtf8(c.label));
+        if (c.required) {
+            hint += QLatin1Char('*');
+        }
+        hints << hint;
+    }
+    return hints;
+}
+
+QString CsvImporter::errorReportPath(const QString& csvPath)
+{
+    const QFileInfo fi(csvPath);
+    return fi.dir().filePath(fi.completeBaseName() + QStringLiteral(".errors.csv"));
+}
+
+qint64 CsvImporter::checkpointOffset(Target target, const QString& csvPath)
+{
+    // 条件与 start() 判断能否续传的一致，同一文件上次导入到别的表时不算。
+    const QFileInfo fi(csvPath);
+    QSqlQuery q(DbManager::instance().database());
+    q.prepare(QStringLiteral("SELECT BYTES_DONE FROM ImportCheckpoint WHERE FILE=? AND TARGET=? AND SIZE=? AND MTIME_MS=?;"));
+    q.addBindValue(fi.absoluteFilePath());
+    q.addBindValue(targetName(target));
+    q.addBindValue(fi.size());
+    q.addBindValue(fi.lastModified().toMSecsSinceEpoch());
+    if (!q.exec() || !q.next()) {
+        return 0;
+    }
+    return q.value(0).toLongLong();
+}
+
+bool CsvImporter::clearCheckpoint(const QString& csvPath, QString* error)
+{
+    return DbManager::instance().exec(QStringLiteral("DELETE FROM ImportCheckpoint WHERE FILE=?;"),
+                                      {QFileInfo(csvPath).absoluteFilePath()},
+                                      error);
+}
+
+bool CsvImporter::start(Target target, const QString& path, QString* error)
+{
+    if (m_running) {
+        if (error) {
+            *error = QStringLiteral("已有导入任务在进行");
+        }
+        return false;
+    }
+
+    auto job = std::make_shared<Job>();
+    const QFileInfo fi(path);
+    job->target = target;
+    job->path = path;
+    job->fileKey = fi.absoluteFilePath();
+    job->size = fi.size();
+    job->mtimeMs = fi.lastModified().toMSecsSinceEpoch();
+    job->reader = std::make_unique<Csv::ChunkReader>(path, m_chunkBytes);
+
+    QStringList header;
+    if (!job->reader->open(&header, error)) {
+        return false;
+    }
+    job->headerColumns = header.size();
+
+    const auto& spec = specFor(target);
+    for (const auto& c : spec.columns) {
+        int found = -1;
+        for (int i = 0; i < header.size(); ++i) {
+            const auto h = header.at(i).trimmed();
+            if (h.compare(QString::fromUtf8(c.name), Qt::CaseInsensitive) == 0 || h == QString::fromUtf8(c.label)) {
+                found = i;
+                break;
+            }
+        }
+        if (found < 0 && c.required) {
+            if (error) {
+                *error = QStringLiteral("表头缺少必填列：%1（%2）").arg(QString::fromUtf8(c.name), QString::fromUtf8(c.label));
+            }
+            return false;
+        }
+        job->mapping.append(found);
+    }
+
+    // 同一文件（大小、修改时间都没变）且上次没导完时从断点继续。
+    QSqlQuery q(DbManager::instance().database());
+    q.prepare(QStringLiteral(
+        "SELECT BYTES_DONE, LINE_NO, IMPORTED, FAILED FROM ImportCheckpoint WHERE FILE=? AND TARGET=? AND SIZE=? AND MTIME_MS=?;"));
+    q.addBindValue(job->fileKey);
+    q.addBindValue(targetName(target));
+    q.addBindValue(job->size);
+    q.addBindValue(job->mtimeMs);
+    if (!q.exec()) {
+        return failQuery(q, error);
+    }
+    if (q.next()) {
+        job->resumed = true;
+        job->startOffset = q.value(0).toLongLong();
+        job->startLine = q.value(1).toLongLong();
+        job->baseImported = q.value(2).toLongLong();
+        job->baseFailed = q.value(3).toLongLong();
+        if (!job->reader->seek(job->startOffset, job->startLine, error)) {
+            return false;
+        }
+    } else {
+        job->startOffset = job->reader->dataOffset();
+        job->startLine = job->reader->dataLine();
+    }
+
+    const auto now = QDateTime::currentDateTime();
+    job->createdText = now.toString(Qt::ISODate);
+    job->createdMs = now.toMSecsSinceEpoch();
+    job->pool = &m_pool;
+    job->inFlight.release(m_pool.maxThreadCount() * 2);
+
+    m_job = job;
+    m_resumedImported = job->baseImported;
+    m_running = true;
+
+    const auto addThread = [this](QThread* thread) {
+        m_threads.append(thread);
+        connect(thread, &QThread::finished, this, [this, thread] {
+            m_threads.removeOne(thread);
+            thread->deleteLater();
+        });
+        thread->start();
+    };
+    addThread(QThread::create([job] { readLoop(job); }));
+    addThread(QThread::create([this, job] { writeLoop(this, job); }));
+    return true;
+}
+
+void CsvImporter::cancel()
+{
+    if (m_job) {
+        m_job->cancel.store(true);
+        m_job->ready.wakeAll();
+    }
+}
+
+void CsvImporter::onFinished(qint64 imported, qint64 failed, bool cancelled, const QString& error)
+{
+    m_running = false;
+    m_job.reset();
+    emit finished(imported, failed, cancelled, error);
+}
+
+void CsvImporter::readLoop(const std::shared_ptr<Job>& job)
+{
+    qint64 index = 0;
+    QString err;
+    Csv::ChunkReader::Chunk chunk;
+    while (!job->cancel.load()) {
+        // 在途块数到上限时等写线程消化，内存占用因此有界。
+        if (!job->inFlight.tryAcquire(1, 100)) {
+            continue;
+        }
+        if (!job->reader->next(&chunk, &err)) {
+            break;
+        }
+        const qint64 i = index++;
+        job->pool->start([job, chunk, i] {
+            auto parsed = parseChunk(job->target, job->mapping, job->headerColumns, chunk);
+            QMutexLocker locker(&job->mutex);
+            job->parsed.insert(i, std::move(parsed));
+            job->ready.wakeAll();
+        });
+    }
+
+    QMutexLocker locker(&job->mutex);
+    job->totalChunks = index;
+    job->readError = err;
+    job->ready.wakeAll();
+}
+
+void CsvImporter::writeLoop(CsvImporter* self, const std::shared_ptr<Job>& job)
+{
+    const auto& spec = specFor(job->target);
+    qint64 imported = job->baseImported;
+    qint64 failed = job->baseFailed;
+    QString err;
+
+    const auto finish = [&](bool cancelled) {
+        QMetaObject::invokeMethod(self,
+                                  [self, imported, failed, cancelled, err] { self->onFinished(imported, failed, cancelled, err); },
+                                  Qt::QueuedConnection);
+    };
+
+    QFile report(errorReportPath(job->path));
+    const bool append = job->resumed && report.exists();
+    if (!report.open(append ? QIODevice::Append : QIODevice::WriteOnly | QIODevice::Truncate)) {
+        err = report.errorString();
+        job->cancel.store(true);
+        finish(true);
+        return;
+    }
+    if (!append) {
+        report.write(Csv::formatRecord({QStringLiteral("行号"), QStringLiteral("原因"), QStringLiteral("原始内容")}));
+    }
+    const auto writeError = [&report](const RowError& e) {
+        QStringList fields{QString::number(e.line), e.message};
+        fields += e.raw;
+        report.write(Csv::formatRecord(fields));
+    };
+
+    auto db = DbManager::instance().openWorkerConnection(&err);
+    if (!db.isOpen()) {
+        job->cancel.store(true);
+        finish(true);
+        return;
+    }
+
+    QStringList columns;
+    for (const auto& c : spec.columns) {
+        columns << QString::fromUtf8(c.name);
+    }
+    if (spec.stampCreated) {
+        columns << QStringLiteral("CREATEDTIMESTAMP") << QStringLiteral("CREATED_MS");
+    }
+    QStringList marks;
+    for (int i = 0; i < columns.size(); ++i) {
+        marks << QStringLiteral("?");
+    }
+
+    bool cancelled = false;
+    {
+        QSqlQuery ins(db);
+        QSqlQuery checkpoint(db);
+        if (!ins.prepare(QStringLiteral("INSERT INTO %1(%2) VALUES(%3);")
+                             .arg(QString::fromUtf8(spec.table), columns.join(QLatin1Char(',')), marks.join(QLatin1Char(','))))
+            || !checkpoint.prepare(QStringLiteral(
+                "INSERT OR REPLACE INTO ImportCheckpoint(FILE,TARGET,SIZE,MTIME_MS,BYTES_DONE,LINE_NO,IMPORTED,FAILED,UPDATED_MS)"
+                " VALUES(?,?,?,?,?,?,?,?,?);"))) {
+            err = ins.lastError().isValid() ? ins.lastError().text() : checkpoint.lastError().text();
+            cancelled = true;
+        }
+
+        for (qint64 next = 0; !cancelled; ++next) {
+            ParsedChunk chunk;
+            {
+                QMutexLocker locker(&job->mutex);
+                while (!job->parsed.contains(next) && job->totalChunks != next && !job->cancel.load()) {
+                    job->ready.wait(&job->mutex);
+                }
+                if (job->cancel.load()) {
+                    cancelled = true;
+                    break;
+                }
+                if (!job->parsed.contains(next)) {
+                    err = job->readError;
+                    break;
+                }
+                chunk = job->parsed.take(next);
+            }
+
+            if (!db.transaction()) {
+                err = db.lastError().text();
+                cancelled = true;
+                break;
+            }
+            qint64 ok = 0;
+            for (const auto& row : std::as_const(chunk.rows)) {
+                int i = 0;
+                for (const auto& v : row.values) {
+                    ins.bindValue(i++, v);
+                }
+                if (spec.stampCreated) {
+                    ins.bindValue(i++, job->createdText);
+                    ins.bindValue(i++, job->createdMs);
+                }
+                // 单条失败（主键重复、外键不存在）只回滚这一条语句，事务继续。
+                if (ins.exec()) {
+                    ++ok;
+                } else {
+                    chunk.errors.append({row.line, ins.lastError().databaseText(), row.raw});
+                }
+            }
+            checkpoint.addBindValue(job->fileKey);
+            checkpoint.addBindValue(targetName(job->target));
+            checkpoint.addBindValue(job->size);
+            checkpoint.addBindValue(job->mtimeMs);
+            checkpoint.addBindValue(chunk.endOffset);
+            checkpoint.addBindValue(chunk.endLine);
+            checkpoint.addBindValue(imported + ok);
+            checkpoint.addBindValue(failed + chunk.errors.size());
+            checkpoint.addBindValue(QDateTime::currentMSecsSinceEpoch());
+            if (!checkpoint.exec() || !db.commit()) {
+                err = checkpoint.lastError().isValid() ? checkpoint.lastError().text() : db.lastError().text();
+                db.rollback();
+                cancelled = true;
+                break;
+            }
+
+            imported += ok;
+            failed += chunk.errors.size();
+            std::sort(chunk.errors.begin(), chunk.errors.end(), [](const RowError& a, const RowError& b) {
+                return a.line < b.line;
+            });
+            for (const auto& e : std::as_const(chunk.errors)) {
+                writeError(e);
+            }
+            report.flush();
+            job->inFlight.release();
+
+            const qint64 done = chunk.endOffset;
+            const qint64 total = job->size;
+            const qint64 importedNow = imported;
+            const qint64 failedNow = failed;
+            QMetaObject::invokeMethod(self,
+                                      [self, done, total, importedNow, failedNow] {
+                                          emit self->progress(done, total, importedNow, failedNow);
+                                      },
+                                      Qt::QueuedConnection);
+        }
+
+        // 整个文件导完后清掉断点，下次导入同一文件从头开始。
+        if (!cancelled && err.isEmpty()) {
+            QSqlQuery done(db);
+            done.prepare(QStringLiteral("DELETE FROM ImportCheckpoint WHERE FILE=?;"));
+            done.addBindValue(job->fileKey);
+            if (!done.exec()) {
+                err = done.lastError().text();
+            }
+        }
+    }
+    DbManager::closeWorkerConnection(db);
+
+    // 出错时让读线程也停下来。
+    if (cancelled || !err.isEmpty()) {
+        job->cancel.store(true);
+    }
+    job->inFlight.release(job->pool->maxThreadCount() * 2);
+    finish(cancelled);
+}
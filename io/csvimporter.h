@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+class QThread;
+
+// 从 CSV 批量导入患者、医生或科室。
+// 读线程按块（默认 4 MiB，在记录边界截断）读文件，线程池并行解析和校验，
+// 单个写线程按块的顺序各用一个事务提交；同一事务里更新 ImportCheckpoint，
+// 中途取消或崩溃后再导入同一文件（大小和修改时间不变）会从上次提交的位置继续。
+// 同时在途的块数有上限，内存占用与文件大小无关。
+// 校验或写库失败的行写到 <文件名>.errors.csv（行号、原因、原始字段），其余行照常导入。
+class CsvImporter final : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Target {
+        Patients,
+        Doctors,
+        Departments,
+    };
+
+    explicit CsvImporter(QObject* parent = nullptr);
+    ~CsvImporter() override;
+
+    void setChunkBytes(int bytes) { m_chunkBytes = qMax(64 * 1024, bytes); }
+    void setParserThreads(int threads);
+
+    bool start(Target target, const QString& path, QString* error = nullptr);
+    void cancel();
+    bool isRunning() const { return m_running; }
+    // start() 从断点继续时之前几次已导入的行数；progress、finished 里的 imported 包含这部分。
+    qint64 resumedImported() const { return m_resumedImported; }
+
+    // 表头可用的列名（表字段名或中文名），导入对话框里提示用。
+    static QStringList columnHints(Target target);
+    static QString errorReportPath(const QString& csvPath);
+    // 该文件上次导入到 target 未完成留下的进度（已提交的字节数）；没有返回 0。仅在 GUI 线程调用。
+    static qint64 checkpointOffset(Target target, const QString& csvPath);
+    static bool clearCheckpoint(const QString& csvPath, QString* error = nullptr);
+
+signals:
+    void progress(qint64 bytesDone, qint64 bytesTotal, qint64 imported, qint64 failed);
+    void finished(qint64 imported, qint64 failed, bool cancelled, const QString& error);
+
+private:
+    struct Job;
+
+    static void readLoop(const std::shared_ptr<Job>& job);
+    static void writeLoop(CsvImporter* self, const std::shared_ptr<Job>& job);
+    void onFinished(qint64 imported, qint64 failed, bool cancelled, const QString& error);
+
+    int m_chunkBytes = 4 * 1024 * 1024;
+    QThreadPool m_pool;
+    std::shared_ptr<Job> m_job;
+    QVector<QThread*> m_threads;
+    qint64 m_resumedImported = 0;
+    bool m_running = false;
+};
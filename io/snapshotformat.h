@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+// 列式快照文件（.hcol）的格式常量，写入端（SnapshotWriter）和只依赖标准库的读取端（SnapshotReader）共用。
+//
+// 文件布局（整数均为小端）：
+//   头部    magic(8) version(u32) createdMs(i64)
+//   数据    按表、按行组依次写的列块
+//   目录    表、列、行组、列块位置和统计信息（变长整数编码）
+//   尾部    footerOffset(u64) footerSize(u32) footerCrc32(u32) magic(8)
+// 读取端只需读尾部和目录，列块按需读取。
+//
+// 列块解压后的内容：若有空值，先是按行的存在位图（ceil(rows/8) 字节，1 为非空），
+// 之后只编码非空值：
+//   Int64  Plain  每个值 zigzag 变长整数
+//          Delta  首值 zigzag 变长整数，之后是与前值之差
+//          Rle    (值, 重复次数) 对
+//   Double Plain  每个值 8 字节
+//   String Plain  每个值 长度 + UTF-8 字节
+//          Dict   字典大小、字典项（长度 + 字节），之后是 (字典下标, 重复次数) 对
+// 目录里每个列块带非空值的 min/max（字符串过长时不记），查询可据此跳过整个行组。
+namespace SnapshotFormat {
+
+constexpr char kMagic[8] = {'H', 'C', 'O', 'L', 'S', 'N', 'P', '1'};
+constexpr std::uint32_t kVersion = 1;
+constexpr int kHeaderSize = 8 + 4 + 8;
+constexpr int kTrailerSize = 8 + 4 + 4 + 8;
+constexpr int kRowsPerGroup = 65536;
+// 超过这个长度的字符串不进 min/max。
+constexpr int kMaxStatBytes = 256;
+
+enum class Type : std::uint8_t {
+    Int64 = 1,
+    Double = 2,
+    String = 3,
+};
+
+enum class Encoding : std::uint8_t {
+    Plain = 0,
+    Delta = 1,
+    Rle = 2,
+    Dict = 3,
+};
+
+enum class Compression : std::uint8_t {
+    None = 0,
+    Zlib = 1,
+};
+
+}
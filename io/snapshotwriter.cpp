@@ -0,0 +1,458 @@
+#include "snapshotwriter.h"
+
+#include <QHash>
+#include <QtEndian>
+
+#include <zlib.h>
+
+using namespace SnapshotFormat;
+
+namespace {
+
+// 列内已经做过字典、差分或游程编码，压缩只求快。
+constexpr int kZlibLevel = 1;
+
+void putVarint(QByteArray& out, quint64 v)
+{
+    while (v >= 0x80) {
+        out.append(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.append(static_cast<char>(v));
+}
+
+quint64 zigzag(qint64 v)
+{
+    return (quint64(v) << 1) ^ quint64(v >> 63);
+}
+
+void putBytes(QByteArray& out, const QByteArray& bytes)
+{
+    putVarint(out, quint64(bytes.size()));
+    out.append(bytes);
+}
+
+template <typename T>
+void putFixed(QByteArray& out, T v)
+{
+    char b[sizeof(T)];
+    qToLittleEndian(v, b);
+    out.append(b, sizeof(T));
+}
+
+// 按补码回绕相减，极端值也不会溢出。
+qint64 difference(qint64 a, qint64 b)
+{
+    return qint64(quint64(a) - quint64(b));
+}
+
+int varintSize(quint64 v)
+{
+    int n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+}
+
+void SnapshotWriter::Stats::merge(const Stats& other)
+{
+    if (other.values > 0) {
+        if (values == 0) {
+            minInt = other.minInt;
+            maxInt = other.maxInt;
+            minReal = other.minReal;
+            maxReal = other.maxReal;
+            minText = other.minText;
+            maxText = other.maxText;
+        } else {
+            minInt = qMin(minInt, other.minInt);
+            maxInt = qMax(maxInt, other.maxInt);
+            minReal = qMin(minReal, other.minReal);
+            maxReal = qMax(maxReal, other.maxReal);
+            minText = qMin(minText, other.minText);
+            maxText = qMax(maxText, other.maxText);
+        }
+    }
+    nulls += other.nulls;
+    values += other.values;
+    tooLong = tooLong || other.tooLong;
+}
+
+SnapshotWriter::SnapshotWriter(const QString& path)
+    : m_file(path)
+{
+}
+
+bool SnapshotWriter::open(qint64 createdMs, QString* error)
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) {
+            *error = m_file.errorString();
+        }
+        return false;
+    }
+    QByteArray header(kMagic, sizeof(kMagic));
+    putFixed<quint32>(header, kVersion);
+    putFixed<qint64>(header, createdMs);
+    return write(header, error);
+}
+
+bool SnapshotWriter::beginTable(const QString& name, const QVector<Column>& columns, QString* error)
+{
+    if (m_inTable && !endTable(error)) {
+        return false;
+    }
+    Table t;
+    t.name = name;
+    t.columns = columns;
+    t.stats.resize(columns.size());
+    m_tables.append(t);
+    m_buffers = QVector<Buffer>(columns.size());
+    m_groupRows = 0;
+    m_inTable = true;
+    return true;
+}
+
+bool SnapshotWriter::addRow(const QVariantList& values, QString* error)
+{
+    const auto& table = m_tables.last();
+    const auto& columns = table.columns;
+    // 先整行转换，有一列转换失败就整行不写，行组里各列的行数保持一致。
+    QVector<qint64> ints(columns.size());
+    QVector<double> reals(columns.size());
+    for (int i = 0; i < columns.size(); ++i) {
+        const auto& v = values.value(i);
+        if (v.isNull() || columns.at(i).type == Type::String) {
+            continue;
+        }
+        bool ok = false;
+        if (columns.at(i).type == Type::Int64) {
+            ints[i] = v.toLongLong(&ok);
+        } else {
+            reals[i] = v.toDouble(&ok);
+        }
+        if (!ok) {
+            if (error) {
+                *error = QStringLiteral("%1 表第 %2 行 %3 列的值“%4”不是%5")
+                             .arg(table.name)
+                             .arg(table.rows + quint64(m_groupRows) + 1)
+                             .arg(columns.at(i).name, v.toString(),
+                                  columns.at(i).type == Type::Int64 ? QStringLiteral("整数") : QStringLiteral("数值"));
+            }
+            return false;
+        }
+    }
+
+    for (int i = 0; i < columns.size(); ++i) {
+        const auto& v = values.value(i);
+        auto& b = m_buffers[i];
+        const bool present = !v.isNull();
+        if (present) {
+            switch (columns.at(i).type) {
+            case Type::Int64:
+                b.ints.append(ints.at(i));
+                break;
+            case Type::Double:
+                b.reals.append(reals.at(i));
+                break;
+            case Type::String:
+                b.texts.append(v.toString().toUtf8());
+                break;
+            }
+        }
+        b.present.append(present);
+    }
+    if (++m_groupRows >= kRowsPerGroup) {
+        return flushGroup(error);
+    }
+    return true;
+}
+
+bool SnapshotWriter::endTable(QString* error)
+{
+    if (!m_inTable) {
+        return true;
+    }
+    m_inTable = false;
+    return m_groupRows == 0 || flushGroup(error);
+}
+
+bool SnapshotWriter::flushGroup(QString* error)
+{
+    auto& t = m_tables.last();
+    Group g;
+    g.rows = quint64(m_groupRows);
+    QByteArray raw;
+    for (int i = 0; i < t.columns.size(); ++i) {
+        raw.clear();
+        Chunk c;
+        encode(t.columns.at(i).type, m_buffers.at(i), &raw, &c);
+        c.raw = quint64(raw.size());
+        c.offset = m_offset;
+
+        QByteArray stored;
+        uLongf size = compressBound(uLong(raw.size()));
+        stored.resize(int(size));
+        if (compress2(reinterpret_cast<Bytef*>(stored.data()), &size, reinterpret_cast<const Bytef*>(raw.constData()), uLong(raw.size()), kZlibLevel) == Z_OK
+            && size < uLongf(raw.size())) {
+            stored.resize(int(size));
+            c.compression = Compression::Zlib;
+        } else {
+            stored = raw;
+            c.compression = Compression::None;
+        }
+        c.stored = quint64(stored.size());
+        if (!write(stored, error)) {
+            return false;
+        }
+        t.stats[i].merge(c.stats);
+        g.chunks.append(c);
+        m_buffers[i] = Buffer();
+    }
+    t.rows += g.rows;
+    t.groups.append(g);
+    m_groupRows = 0;
+    return true;
+}
+
+void SnapshotWriter::encode(Type type, const Buffer& buffer, QByteArray* out, Chunk* chunk) const
+{
+    auto& s = chunk->stats;
+    const int rows = buffer.present.size();
+    for (bool p : buffer.present) {
+        if (!p) {
+            ++s.nulls;
+        }
+    }
+    if (s.nulls > 0) {
+        QByteArray bitmap((rows + 7) / 8, '\0');
+        for (int r = 0; r < rows; ++r) {
+            if (buffer.present.at(r)) {
+                bitmap[r / 8] = char(bitmap.at(r / 8) | (1 << (r % 8)));
+            }
+        }
+        out->append(bitmap);
+    }
+
+    switch (type) {
+    case Type::Int64: {
+        const auto& v = buffer.ints;
+        s.values = quint64(v.size());
+        qint64 plain = 0;
+        qint64 delta = 0;
+        qint64 rle = 0;
+        for (int k = 0; k < v.size(); ++k) {
+            if (k == 0) {
+                s.minInt = s.maxInt = v.at(k);
+            } else {
+                s.minInt = qMin(s.minInt, v.at(k));
+                s.maxInt = qMax(s.maxInt, v.at(k));
+            }
+            plain += varintSize(zigzag(v.at(k)));
+            delta += varintSize(zigzag(k == 0 ? v.at(k) : difference(v.at(k), v.at(k - 1))));
+        }
+        for (int k = 0; k < v.size();) {
+            int run = 1;
+            while (k + run < v.size() && v.at(k + run) == v.at(k)) {
+                ++run;
+            }
+            rle += varintSize(zigzag(v.at(k))) + varintSize(quint64(run));
+            k += run;
+        }
+        if (rle < plain && rle <= delta) {
+            chunk->encoding = Encoding::Rle;
+            for (int k = 0; k < v.size();) {
+                int run = 1;
+                while (k + run < v.size() && v.at(k + run) == v.at(k)) {
+                    ++run;
+                }
+                putVarint(*out, zigzag(v.at(k)));
+                putVarint(*out, quint64(run));
+                k += run;
+            }
+        } else if (delta < plain) {
+            chunk->encoding = Encoding::Delta;
+            for (int k = 0; k < v.size(); ++k) {
+                putVarint(*out, zigzag(k == 0 ? v.at(k) : difference(v.at(k), v.at(k - 1))));
+            }
+        } else {
+            chunk->encoding = Encoding::Plain;
+            for (qint64 n : v) {
+                putVarint(*out, zigzag(n));
+            }
+        }
+        break;
+    }
+    case Type::Double: {
+        const auto& v = buffer.reals;
+        s.values = quint64(v.size());
+        chunk->encoding = Encoding::Plain;
+        for (int k = 0; k < v.size(); ++k) {
+            if (k == 0) {
+                s.minReal = s.maxReal = v.at(k);
+            } else {
+                s.minReal = qMin(s.minReal, v.at(k));
+                s.maxReal = qMax(s.maxReal, v.at(k));
+            }
+            putFixed<double>(*out, v.at(k));
+        }
+        break;
+    }
+    case Type::String: {
+        const auto& v = buffer.texts;
+        s.values = quint64(v.size());
+        // 重复多的列（性别、科室、操作明细）用字典；字典项数超过一半行数就不划算。
+        QHash<QByteArray, int> index;
+        QVector<QByteArray> dict;
+        QVector<int> ids;
+        ids.reserve(v.size());
+        qint64 plain = 0;
+        for (int k = 0; k < v.size(); ++k) {
+            const auto& text = v.at(k);
+            if (k == 0) {
+                s.minText = s.maxText = text;
+            } else {
+                s.minText = qMin(s.minText, text);
+                s.maxText = qMax(s.maxText, text);
+            }
+            s.tooLong = s.tooLong || text.size() > kMaxStatBytes;
+            plain += varintSize(quint64(text.size())) + text.size();
+            if (dict.size() <= v.size() / 2) {
+                auto it = index.find(text);
+                if (it == index.end()) {
+                    it = index.insert(text, dict.size());
+                    dict.append(text);
+                }
+                ids.append(it.value());
+            }
+        }
+        qint64 dictSize = -1;
+        if (!v.isEmpty() && ids.size() == v.size()) {
+            dictSize = varintSize(quint64(dict.size()));
+            for (const auto& d : std::as_const(dict)) {
+                dictSize += varintSize(quint64(d.size())) + d.size();
+            }
+            for (int k = 0; k < ids.size();) {
+                int run = 1;
+                while (k + run < ids.size() && ids.at(k + run) == ids.at(k)) {
+                    ++run;
+                }
+                dictSize += varintSize(quint64(ids.at(k))) + varintSize(quint64(run));
+                k += run;
+            }
+        }
+        if (dictSize >= 0 && dictSize < plain) {
+            chunk->encoding = Encoding::Dict;
+            putVarint(*out, quint64(dict.size()));
+            for (const auto& d : std::as_const(dict)) {
+                putBytes(*out, d);
+            }
+            for (int k = 0; k < ids.size();) {
+                int run = 1;
+                while (k + run < ids.size() && ids.at(k + run) == ids.at(k)) {
+                    ++run;
+                }
+                putVarint(*out, quint64(ids.at(k)));
+                putVarint(*out, quint64(run));
+                k += run;
+            }
+        } else {
+            chunk->encoding = Encoding::Plain;
+            for (const auto& text : v) {
+                putBytes(*out, text);
+            }
+        }
+        break;
+    }
+    }
+}
+
+void SnapshotWriter::appendStats(QByteArray& out, Type type, const Stats& stats) const
+{
+    putVarint(out, stats.nulls);
+    const bool hasMinMax = stats.values > 0 && !(type == Type::String && stats.tooLong);
+    out.append(char(hasMinMax ? 1 : 0));
+    if (!hasMinMax) {
+        return;
+    }
+    switch (type) {
+    case Type::Int64:
+        putVarint(out, zigzag(stats.minInt));
+        putVarint(out, zigzag(stats.maxInt));
+        break;
+    case Type::Double:
+        putFixed<double>(out, stats.minReal);
+        putFixed<double>(out, stats.maxReal);
+        break;
+    case Type::String:
+        putBytes(out, stats.minText);
+        putBytes(out, stats.maxText);
+        break;
+    }
+}
+
+bool SnapshotWriter::close(QString* error)
+{
+    if (!endTable(error)) {
+        return false;
+    }
+    QByteArray footer;
+    putVarint(footer, quint64(m_tables.size()));
+    for (const auto& t : std::as_const(m_tables)) {
+        putBytes(footer, t.name.toUtf8());
+        putVarint(footer, t.rows);
+        putVarint(footer, quint64(t.columns.size()));
+        for (int i = 0; i < t.columns.size(); ++i) {
+            putBytes(footer, t.columns.at(i).name.toUtf8());
+            footer.append(char(t.columns.at(i).type));
+            appendStats(footer, t.columns.at(i).type, t.stats.at(i));
+        }
+        putVarint(footer, quint64(t.groups.size()));
+        for (const auto& g : t.groups) {
+            putVarint(footer, g.rows);
+            for (int i = 0; i < g.chunks.size(); ++i) {
+                const auto& c = g.chunks.at(i);
+                putVarint(footer, c.offset);
+                putVarint(footer, c.stored);
+                putVarint(footer, c.raw);
+                footer.append(char(c.encoding));
+                footer.append(char(c.compression));
+                appendStats(footer, t.columns.at(i).type, c.stats);
+            }
+        }
+    }
+
+    const quint64 footerOffset = m_offset;
+    QByteArray trailer;
+    putFixed<quint64>(trailer, footerOffset);
+    putFixed<quint32>(trailer, quint32(footer.size()));
+    putFixed<quint32>(trailer, quint32(crc32(0, reinterpret_cast<const Bytef*>(footer.constData()), uInt(footer.size()))));
+    trailer.append(kMagic, sizeof(kMagic));
+    if (!write(footer, error) || !write(trailer, error)) {
+        return false;
+    }
+    if (!m_file.flush()) {
+        if (error) {
+            *error = m_file.errorString();
+        }
+        return false;
+    }
+    m_file.close();
+    return true;
+}
+
+bool SnapshotWriter::write(const QByteArray& data, QString* error)
+{
+    if (m_file.write(data) != data.size()) {
+        if (error) {
+            *error = m_file.errorString();
+        }
+        return false;
+    }
+    m_offset += quint64(data.size());
+    return true;
+}
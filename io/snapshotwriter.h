@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+
+#include "io/snapshotformat.h"
+
+// 写列式快照文件（格式见 snapshotformat.h）。按表逐行 addRow，每满一个行组
+// （kRowsPerGroup 行）就把各列分别编码、压缩后写出，内存只占一个行组。
+// 值按列类型转换；转换不了的（如 INTEGER 列里的空字符串）addRow 返回 false 并说明是哪一行哪一列。
+class SnapshotWriter final
+{
+public:
+    struct Column
+    {
+        QString name;
+        SnapshotFormat::Type type = SnapshotFormat::Type::String;
+    };
+
+    explicit SnapshotWriter(const QString& path);
+
+    bool open(qint64 createdMs, QString* error = nullptr);
+    bool beginTable(const QString& name, const QVector<Column>& columns, QString* error = nullptr);
+    bool addRow(const QVariantList& values, QString* error = nullptr);
+    bool endTable(QString* error = nullptr);
+    // 写目录和尾部并关闭文件。
+    bool close(QString* error = nullptr);
+
+    qint64 bytesWritten() const { return m_offset; }
+
+private:
+    struct Stats
+    {
+        quint64 nulls = 0;
+        quint64 values = 0;
+        // 有字符串超过 kMaxStatBytes 时不记 min/max。
+        bool tooLong = false;
+        qint64 minInt = 0;
+        qint64 maxInt = 0;
+        double minReal = 0;
+        double maxReal = 0;
+        QByteArray minText;
+        QByteArray maxText;
+
+        void merge(const Stats& other);
+    };
+
+    struct Chunk
+    {
+        quint64 offset = 0;
+        quint64 stored = 0;
+        quint64 raw = 0;
+        SnapshotFormat::Encoding encoding = SnapshotFormat::Encoding::Plain;
+        SnapshotFormat::Compression compression = SnapshotFormat::Compression::None;
+        Stats stats;
+    };
+
+    struct Group
+    {
+        quint64 rows = 0;
+        QVector<Chunk> chunks;
+    };
+
+    struct Table
+    {
+        QString name;
+        QVector<Column> columns;
+        QVector<Stats> stats;
+        QVector<Group> groups;
+        quint64 rows = 0;
+    };
+
+    struct Buffer
+    {
+        QVector<bool> present;
+        QVector<qint64> ints;
+        QVector<double> reals;
+        QVector<QByteArray> texts;
+    };
+
+    bool flushGroup(QString* error);
+    void encode(SnapshotFormat::Type type, const Buffer& buffer, QByteArray* out, Chunk* chunk) const;
+    bool write(const QByteArray& data, QString* error);
+    void appendStats(QByteArray& out, SnapshotFormat::Type type, const Stats& stats) const;
+
+    QFile m_file;
+    quint64 m_offset = 0;
+    QVector<Table> m_tables;
+    bool m_inTable = false;
+    QVector<Buffer> m_buffers;
+    int m_groupRows = 0;
+};
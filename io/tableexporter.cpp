@@ -0,0 +1,338 @@
+#include "tableexporter.h"
+
+#include "db/dbmanager.h"
+#include "io/csv.h"
+#include "io/xlsxwriter.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QThread>
+
+static constexpr int kFlushBytes = 1024 * 1024;
+static constexpr int kProgressIntervalMs = 200;
+
+struct TableExporter::Job
+{
+    Source source;
+    QString path;
+    Format format = Format::Csv;
+    std::shared_ptr<std::atomic_bool> cancel;
+};
+
+namespace {
+
+QString whereClause(const QString& filter)
+{
+    return filter.trimmed().isEmpty() ? QString() : QStringLiteral(" WHERE ") + filter;
+}
+
+// CSV 与 XLSX 的统一写入接口。
+class RowSink
+{
+public:
+    virtual ~RowSink() = default;
+    virtual bool open(const QStringList& headers, QString* error) = 0;
+    virtual bool addRow(const QVariantList& values, QString* error) = 0;
+    virtual bool close(QString* error) = 0;
+};
+
+class CsvSink final : public RowSink
+{
+public:
+    explicit CsvSink(const QString& path)
+        : m_file(path)
+    {
+    }
+
+    bool open(const QStringList& headers, QString* error) override
+    {
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return fail(error);
+        }
+        // 带 BOM，Excel 直接打开时才能识别为 UTF-8。
+        m_buffer = "\xEF\xBB\xBF" + Csv::formatRecord(headers);
+        return true;
+    }
+
+    bool addRow(const QVariantList& values, QString* error) override
+    {
+        for (int i = 0; i < values.size(); ++i) {
+            if (i > 0) {
+                m_buffer.append(',');
+            }
+            m_buffer.append(Csv::escape(values.at(i).toString()));
+        }
+        m_buffer.append("\r\n");
+        return m_buffer.size() < kFlushBytes || flush(error);
+    }
+
+    bool close(QString* error) override
+    {
+        if (!flush(error)) {
+            return false;
+        }
+        m_file.close();
+        return m_file.error() == QFileDevice::NoError || fail(error);
+    }
+
+private:
+    bool flush(QString* error)
+    {
+        if (m_file.write(m_buffer) != m_buffer.size()) {
+            return fail(error);
+        }
+        m_buffer.clear();
+        return true;
+    }
+
+    bool fail(QString* error)
+    {
+        if (error) {
+            *error = m_file.errorString();
+        }
+        return false;
+    }
+
+    QFile m_file;
+    QByteArray m_buffer;
+};
+
+class XlsxSink final : public RowSink
+{
+public:
+    explicit XlsxSink(const QString& path)
+        : m_writer(path)
+    {
+    }
+
+    bool open(const QStringList& headers, QString* error) override { return m_writer.open(headers, error); }
+    bool addRow(const QVariantList& values, QString* error) override { return m_writer.addRow(values, error); }
+    bool close(QString* error) override { return m_writer.close(error); }
+
+private:
+    XlsxWriter m_writer;
+};
+
+}
+
+TableExporter::Source TableExporter::patients(const QString& filter)
+{
+    Source s;
+    s.sql = QStringLiteral("SELECT ID, ID_CARD, NAME, CASE SEX WHEN 1 THEN '男' WHEN 0 THEN '女' END,"
+                           " DOB, HEIGHT, WEIGHT, MOBILEPHONE, AGE, CREATEDTIMESTAMP FROM Patient%1 ORDER BY ID")
+                .arg(whereClause(filter));
+    s.headers = {QStringLiteral("ID"),
+                 QStringLiteral("身份证"),
+                 QStringLiteral("姓名"),
+                 QStringLiteral("性别"),
+                 QStringLiteral("出生日期"),
+                 QStringLiteral("身高(cm)"),
+                 QStringLiteral("体重(kg)"),
+                 QStringLiteral("手机号"),
+                 QStringLiteral("年龄"),
+                 QStringLiteral("创建时间")};
+    return s;
+}
+
+TableExporter::Source TableExporter::doctors(const QString& filter)
+{
+    // filter 里的列名不带表前缀，科室名用相关子查询取，避免连接后列名歧义。
+    Source s;
+    s.sql = QStringLiteral("SELECT ID, EMPLOYEENO, NAME,"
+                           " (SELECT D.NAME FROM Department D WHERE D.ID = Doctor.DEPARTMENT_ID)"
+                           " FROM Doctor%1 ORDER BY ID")
+                .arg(whereClause(filter));
+    s.headers = {QStringLiteral("ID"), QStringLiteral("工号"), QStringLiteral("姓名"), QStringLiteral("科室")};
+    return s;
+}
+
+TableExporter::Source TableExporter::departments(const QString& filter)
+{
+    Source s;
+    s.sql = QStringLiteral("SELECT ID, NAME FROM Department%1 ORDER BY ID").arg(whereClause(filter));
+    s.headers = {QStringLiteral("ID"), QStringLiteral("科室名称")};
+    return s;
+}
+
+TableExporter::Format TableExporter::formatFor(const QString& path)
+{
+    return path.endsWith(QStringLiteral(".xlsx"), Qt::CaseInsensitive) ? Format::Xlsx : Format::Csv;
+}
+
+TableExporter::TableExporter(QObject* parent)
+    : QObject(parent)
+{
+}
+
+TableExporter::~TableExporter()
+{
+    cancel();
+    for (auto* t : m_threads) {
+        t->wait();
+        delete t;
+    }
+}
+
+bool TableExporter::start(const Source& source, const QString& path, Format format, QString* error)
+{
+    if (m_running) {
+        if (error) {
+            *error = QStringLiteral("已有导出任务在进行");
+        }
+        return false;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->source = source;
+    job->path = path;
+    job->format = format;
+    m_cancel = std::make_shared<std::atomic_bool>(false);
+    job->cancel = m_cancel;
+    m_running = true;
+
+    auto* thread = QThread::create([this, job] { run(this, job); });
+    m_threads.append(thread);
+    connect(thread, &QThread::finished, this, [this, thread] {
+        m_threads.removeOne(thread);
+        thread->deleteLater();
+    });
+    thread->start();
+    return true;
+}
+
+void TableExporter::cancel()
+{
+    if (m_cancel) {
+        m_cancel->store(true);
+    }
+}
+
+void TableExporter::onFinished(qint64 rows, bool cancelled, const QString& error)
+{
+    m_running = false;
+    m_cancel.reset();
+    emit finished(rows, cancelled, error);
+}
+
+void TableExporter::run(TableExporter* self, const std::shared_ptr<Job>& job)
+{
+    qint64 rows = 0;
+    QString err;
+    const auto partPath = job->path + QStringLiteral(".part");
+
+    auto db = DbManager::instance().openWorkerConnection(&err);
+    if (db.isOpen()) {
+        for (int i = 0; i < job->source.attachments.size() && err.isEmpty(); ++i) {
+            QSqlQuery attach(db);
+            attach.prepare(QStringLiteral("ATTACH DATABASE ? AS arc%1;").arg(i));
+            attach.addBindValue(job->source.attachments.at(i));
+            if (!attach.exec()) {
+                err = attach.lastError().text();
+            }
+        }
+
+        auto sql = job->source.sql.trimmed();
+        if (sql.endsWith(QLatin1Char(';'))) {
+            sql.chop(1);
+        }
+        const auto bindAll = [&job](QSqlQuery& q) {
+            for (const auto& v : job->source.args) {
+                q.addBindValue(v);
+            }
+        };
+
+        // 统计和导出在同一个读事务里，总数与实际导出的行对得上，不受中途写入影响。
+        bool inTransaction = false;
+        if (err.isEmpty()) {
+            inTransaction = db.transaction();
+            if (!inTransaction) {
+                err = db.lastError().text();
+            }
+        }
+
+        // 先统计总数供进度条使用；统计失败不影响导出。
+        if (err.isEmpty() && !job->cancel->load()) {
+            QSqlQuery count(db);
+            count.setForwardOnly(true);
+            if (count.prepare(QStringLiteral("SELECT COUNT(1) FROM (%1);").arg(sql))) {
+                bindAll(count);
+                if (count.exec() && count.next()) {
+                    const qint64 total = count.value(0).toLongLong();
+                    QMetaObject::invokeMethod(self, [self, total] { emit self->progress(0, total); }, Qt::QueuedConnection);
+                }
+            }
+        }
+
+        std::unique_ptr<RowSink> sink;
+        if (job->format == Format::Xlsx) {
+            sink = std::make_unique<XlsxSink>(partPath);
+        } else {
+            sink = std::make_unique<CsvSink>(partPath);
+        }
+
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        if (err.isEmpty() && !job->cancel->load()) {
+            if (!q.prepare(sql)) {
+                err = q.lastError().text();
+            } else {
+                bindAll(q);
+                if (!q.exec()) {
+                    err = q.lastError().text();
+                }
+            }
+        }
+
+        if (err.isEmpty() && !job->cancel->load() && sink->open(job->source.headers, &err)) {
+            const int columns = q.record().count();
+            QVariantList values;
+            QElapsedTimer sinceProgress;
+            sinceProgress.start();
+            while (!job->cancel->load() && q.next()) {
+                values.clear();
+                for (int c = 0; c < columns; ++c) {
+                    values << q.value(c);
+                }
+                if (!sink->addRow(values, &err)) {
+                    break;
+                }
+                ++rows;
+                if (sinceProgress.elapsed() >= kProgressIntervalMs) {
+                    sinceProgress.restart();
+                    const qint64 done = rows;
+                    QMetaObject::invokeMethod(self, [self, done] { emit self->progress(done, -1); }, Qt::QueuedConnection);
+                }
+            }
+            if (err.isEmpty() && q.lastError().isValid()) {
+                err = q.lastError().text();
+            }
+            if (err.isEmpty() && !job->cancel->load()) {
+                sink->close(&err);
+            }
+        }
+        sink.reset();
+        q.finish();
+        if (inTransaction) {
+            db.rollback();
+        }
+    }
+    DbManager::closeWorkerConnection(db);
+
+    const bool cancelled = job->cancel->load();
+    if (cancelled || !err.isEmpty()) {
+        QFile::remove(partPath);
+    } else {
+        QFile::remove(job->path);
+        if (!QFile::rename(partPath, job->path)) {
+            err = QStringLiteral("无法写入 %1").arg(job->path);
+            QFile::remove(partPath);
+        }
+    }
+
+    QMetaObject::invokeMethod(self,
+                              [self, rows, cancelled, err] { self->onFinished(rows, cancelled, err); },
+                              Qt::QueuedConnection);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+class QThread;
+
+// 把表导出为 CSV 或 XLSX：在后台连接上用只进游标逐行读取，边读边写文件，
+// 不经过 QSqlTableModel，内存占用与行数无关。
+// 先写到 <目标>.part，完成后再改名；取消或出错时删除临时文件，不会留下半个文件。
+class TableExporter final : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Format {
+        Csv,
+        Xlsx,
+    };
+
+    struct Source
+    {
+        QString sql;
+        QVariantList args;
+        QStringList headers;
+        // 查询前依次 ATTACH 为 arc0、arc1…，与 StreamingLoader 相同。
+        QStringList attachments;
+    };
+
+    // filter 为模型 filter() 的原始 SQL 条件，为空表示全部导出。
+    static Source patients(const QString& filter);
+    static Source doctors(const QString& filter);
+    static Source departments(const QString& filter);
+
+    // 按扩展名判断，.xlsx 以外都按 CSV。
+    static Format formatFor(const QString& path);
+
+    explicit TableExporter(QObject* parent = nullptr);
+    ~TableExporter() override;
+
+    bool start(const Source& source, const QString& path, Format format, QString* error = nullptr);
+    void cancel();
+    bool isRunning() const { return m_running; }
+
+signals:
+    // total 为 -1 表示沿用之前报告的总数（或还没统计出来）。
+    void progress(qint64 rows, qint64 total);
+    void finished(qint64 rows, bool cancelled, const QString& error);
+
+private:
+    struct Job;
+
+    static void run(TableExporter* self, const std::shared_ptr<Job>& job);
+    void onFinished(qint64 rows, bool cancelled, const QString& error);
+
+    std::shared_ptr<std::atomic_bool> m_cancel;
+    QVector<QThread*> m_threads;
+    bool m_running = false;
+};
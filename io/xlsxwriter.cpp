@@ -0,0 +1,174 @@
+#include "xlsxwriter.h"
+
+#include <QMetaType>
+
+#include <utility>
+
+static constexpr int kFlushBytes = 256 * 1024;
+
+static QByteArray xmlEscape(const QString& text)
+{
+    QByteArray out;
+    const auto utf8 = text.toUtf8();
+    out.reserve(utf8.size());
+    for (const char c : utf8) {
+        switch (c) {
+        case '&':
+            out.append("&amp;");
+            break;
+        case '<':
+            out.append("&lt;");
+            break;
+        case '>':
+            out.append("&gt;");
+            break;
+        case '"':
+            out.append("&quot;");
+            break;
+        default:
+            // XML 1.0 不允许除制表、换行、回车以外的控制字符。
+            if (static_cast<uchar>(c) >= 0x20 || c == '\t' || c == '\n' || c == '\r') {
+                out.append(c);
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+XlsxWriter::XlsxWriter(const QString& path)
+    : m_zip(path)
+{
+}
+
+bool XlsxWriter::open(const QStringList& headers, QString* error)
+{
+    m_headers = headers;
+    return m_zip.open(error) && beginSheet(error);
+}
+
+void XlsxWriter::appendRow(const QVariantList& values)
+{
+    m_buffer.append("<row>");
+    for (const auto& v : values) {
+        switch (v.metaType().id()) {
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Double:
+            m_buffer.append("<c><v>").append(v.toString().toUtf8()).append("</v></c>");
+            break;
+        default:
+            if (v.isNull()) {
+                m_buffer.append("<c/>");
+            } else {
+                m_buffer.append("<c t=\"inlineStr\"><is><t xml:space=\"preserve\">")
+                    .append(xmlEscape(v.toString()))
+                    .append("</t></is></c>");
+            }
+            break;
+        }
+    }
+    m_buffer.append("</row>");
+    ++m_sheetRows;
+}
+
+bool XlsxWriter::flush(QString* error)
+{
+    if (m_buffer.isEmpty()) {
+        return true;
+    }
+    const bool ok = m_zip.write(m_buffer, error);
+    m_buffer.clear();
+    return ok;
+}
+
+bool XlsxWriter::beginSheet(QString* error)
+{
+    ++m_sheets;
+    m_sheetRows = 0;
+    if (!m_zip.beginEntry(QStringLiteral("xl/worksheets/sheet%1.xml").arg(m_sheets), error)) {
+        return false;
+    }
+    m_buffer.append("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                    "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+                    "<sheetViews><sheetView workbookViewId=\"0\"><pane ySplit=\"1\" topLeftCell=\"A2\" activePane=\"bottomLeft\" state=\"frozen\"/></sheetView></sheetViews>"
+                    "<sheetData>");
+    QVariantList header;
+    for (const auto& h : std::as_const(m_headers)) {
+        header << h;
+    }
+    appendRow(header);
+    return true;
+}
+
+bool XlsxWriter::endSheet(QString* error)
+{
+    m_buffer.append("</sheetData></worksheet>");
+    return flush(error) && m_zip.endEntry(error);
+}
+
+bool XlsxWriter::addRow(const QVariantList& values, QString* error)
+{
+    if (m_sheetRows >= kMaxRowsPerSheet && !(endSheet(error) && beginSheet(error))) {
+        return false;
+    }
+    appendRow(values);
+    return m_buffer.size() < kFlushBytes || flush(error);
+}
+
+bool XlsxWriter::close(QString* error)
+{
+    if (!endSheet(error)) {
+        return false;
+    }
+
+    QByteArray types = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                       "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+                       "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+                       "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+                       "<Override PartName=\"/xl/workbook.xml\" "
+                       "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>";
+    QByteArray sheets;
+    QByteArray rels = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                      "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">";
+    for (int i = 1; i <= m_sheets; ++i) {
+        const auto n = QByteArray::number(i);
+        types += "<Override PartName=\"/xl/worksheets/sheet" + n
+            + ".xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>";
+        sheets += "<sheet name=\"Sheet" + n + "\" sheetId=\"" + n + "\" r:id=\"rId" + n + "\"/>";
+        rels += "<Relationship Id=\"rId" + n
+            + "\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet\" Target=\"worksheets/sheet"
+            + n + ".xml\"/>";
+    }
+    types += "</Types>";
+    rels += "</Relationships>";
+
+    const QByteArray workbook = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                                "<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" "
+                                "xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\">"
+                                "<sheets>"
+        + sheets + "</sheets></workbook>";
+    const QByteArray rootRels = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                                "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+                                "<Relationship Id=\"rId1\" "
+                                "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" "
+                                "Target=\"xl/workbook.xml\"/></Relationships>";
+
+    const struct {
+        const char* name;
+        const QByteArray& data;
+    } parts[] = {
+        {"[Content_Types].xml", types},
+        {"_rels/.rels", rootRels},
+        {"xl/workbook.xml", workbook},
+        {"xl/_rels/workbook.xml.rels", rels},
+    };
+    for (const auto& p : parts) {
+        if (!m_zip.beginEntry(QString::fromUtf8(p.name), error) || !m_zip.write(p.data, error) || !m_zip.endEntry(error)) {
+            return false;
+        }
+    }
+    return m_zip.close(error);
+}
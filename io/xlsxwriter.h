@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QByteArray>
+#include <QStringList>
+#include <QVariantList>
+
+#include "io/zipwriter.h"
+
+// 流式写 XLSX：字符串用 inlineStr 直接写进单元格（不建共享字符串表），
+// 工作表 XML 边生成边写入 ZIP，内存占用与行数无关。
+// 一个工作表最多 1048576 行，超出时自动新开工作表并重复表头。
+class XlsxWriter final
+{
+public:
+    static constexpr int kMaxRowsPerSheet = 1048576;
+
+    explicit XlsxWriter(const QString& path);
+
+    bool open(const QStringList& headers, QString* error = nullptr);
+    bool addRow(const QVariantList& values, QString* error = nullptr);
+    bool close(QString* error = nullptr);
+
+private:
+    bool beginSheet(QString* error);
+    bool endSheet(QString* error);
+    bool flush(QString* error);
+    void appendRow(const QVariantList& values);
+
+    ZipWriter m_zip;
+    QStringList m_headers;
+    QByteArray m_buffer;
+    int m_sheets = 0;
+    int m_sheetRows = 0;
+};
@@ -0,0 +1,295 @@
+#include "zipwriter.h"
+
+#include <QtEndian>
+
+#include <utility>
+
+#include <zlib.h>
+
+namespace {
+
+constexpr quint32 kLocalHeaderSig = 0x04034b50;
+constexpr quint32 kDescriptorSig = 0x08074b50;
+constexpr quint32 kCentralHeaderSig = 0x02014b50;
+constexpr quint32 kZip64EndOfCentralSig = 0x06064b50;
+constexpr quint32 kZip64LocatorSig = 0x07064b50;
+constexpr quint32 kEndOfCentralSig = 0x06054b50;
+constexpr quint16 kVersion = 20;
+constexpr quint16 kVersionZip64 = 45;
+constexpr quint16 kDeflated = 8;
+constexpr quint16 kZip64ExtraId = 0x0001;
+// 位 3：大小和 CRC 在数据描述符里；位 11：文件名是 UTF-8。
+constexpr quint16 kFlags = 0x0808;
+// 超过这些值的字段写成全 1，真实值放进 ZIP64 扩展字段或记录。
+constexpr qint64 kMax32 = 0xFFFFFFFFll;
+constexpr int kMax16 = 0xFFFF;
+constexpr int kOutChunk = 64 * 1024;
+
+void put16(QByteArray& out, quint16 v)
+{
+    char b[2];
+    qToLittleEndian(v, b);
+    out.append(b, 2);
+}
+
+void put32(QByteArray& out, quint32 v)
+{
+    char b[4];
+    qToLittleEndian(v, b);
+    out.append(b, 4);
+}
+
+void put64(QByteArray& out, quint64 v)
+{
+    char b[8];
+    qToLittleEndian(v, b);
+    out.append(b, 8);
+}
+
+quint32 clamp32(qint64 v)
+{
+    return v >= kMax32 ? quint32(kMax32) : quint32(v);
+}
+
+bool fail(QString* error, const QString& message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+}
+
+ZipWriter::ZipWriter(const QString& path)
+    : m_file(path)
+{
+}
+
+ZipWriter::~ZipWriter()
+{
+    if (m_stream) {
+        deflateEnd(m_stream.get());
+    }
+}
+
+bool ZipWriter::open(QString* error)
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return fail(error, m_file.errorString());
+    }
+    // 所有条目统一用打开时的时间（DOS 格式，精度 2 秒）。
+    const auto now = QDateTime::currentDateTime();
+    const auto d = now.date();
+    const auto t = now.time();
+    m_dosDate = quint16(((qMax(1980, d.year()) - 1980) << 9) | (d.month() << 5) | d.day());
+    m_dosTime = quint16((t.hour() << 11) | (t.minute() << 5) | (t.second() / 2));
+    return true;
+}
+
+bool ZipWriter::writeRaw(const QByteArray& data, QString* error)
+{
+    if (m_file.write(data) != data.size()) {
+        return fail(error, m_file.errorString());
+    }
+    return true;
+}
+
+bool ZipWriter::beginEntry(const QString& name, QString* error)
+{
+    if (m_inEntry && !endEntry(error)) {
+        return false;
+    }
+
+    Entry e;
+    e.name = name.toUtf8();
+    e.offset = m_file.pos();
+
+    // 大小事先不知道，本地头里填 0，读取方以中央目录为准。
+    QByteArray h;
+    put32(h, kLocalHeaderSig);
+    put16(h, kVersion);
+    put16(h, kFlags);
+    put16(h, kDeflated);
+    put16(h, m_dosTime);
+    put16(h, m_dosDate);
+    put32(h, 0);
+    put32(h, 0);
+    put32(h, 0);
+    put16(h, quint16(e.name.size()));
+    put16(h, 0);
+    h.append(e.name);
+    if (!writeRaw(h, error)) {
+        return false;
+    }
+
+    if (!m_stream) {
+        m_stream = std::make_unique<z_stream_s>();
+        // 负的窗口位数表示不带 zlib 头尾的原始 DEFLATE 流，ZIP 要求如此。
+        if (deflateInit2(m_stream.get(), Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            m_stream.reset();
+            return fail(error, QStringLiteral("初始化压缩失败"));
+        }
+    } else if (deflateReset(m_stream.get()) != Z_OK) {
+        return fail(error, QStringLiteral("初始化压缩失败"));
+    }
+
+    m_entries.append(e);
+    m_inEntry = true;
+    m_entrySize = 0;
+    m_compressedSize = 0;
+    m_crc = quint32(crc32(0, nullptr, 0));
+    return true;
+}
+
+bool ZipWriter::deflateTo(bool finish, QString* error)
+{
+    if (m_out.size() != kOutChunk) {
+        m_out.resize(kOutChunk);
+    }
+    for (;;) {
+        m_stream->next_out = reinterpret_cast<Bytef*>(m_out.data());
+        m_stream->avail_out = uInt(m_out.size());
+        const int rc = deflate(m_stream.get(), finish ? Z_FINISH : Z_NO_FLUSH);
+        if (rc == Z_STREAM_ERROR) {
+            return fail(error, QStringLiteral("压缩失败"));
+        }
+        const qint64 n = m_out.size() - m_stream->avail_out;
+        if (n > 0) {
+            if (m_file.write(m_out.constData(), n) != n) {
+                return fail(error, m_file.errorString());
+            }
+            m_compressedSize += n;
+        }
+        if (finish ? rc == Z_STREAM_END : m_stream->avail_out != 0) {
+            return true;
+        }
+    }
+}
+
+bool ZipWriter::write(const QByteArray& data, QString* error)
+{
+    if (!m_inEntry) {
+        return fail(error, QStringLiteral("没有打开的 ZIP 条目"));
+    }
+    m_entrySize += data.size();
+    m_crc = quint32(crc32(m_crc, reinterpret_cast<const Bytef*>(data.constData()), uInt(data.size())));
+    m_stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    m_stream->avail_in = uInt(data.size());
+    return deflateTo(false, error);
+}
+
+bool ZipWriter::endEntry(QString* error)
+{
+    if (!m_inEntry) {
+        return true;
+    }
+    m_inEntry = false;
+    m_stream->next_in = nullptr;
+    m_stream->avail_in = 0;
+    if (!deflateTo(true, error)) {
+        return false;
+    }
+    auto& e = m_entries.last();
+    e.crc = m_crc;
+    e.size = m_entrySize;
+    e.compressedSize = m_compressedSize;
+
+    // 超过 4 GiB 的条目用 8 字节长度的描述符（同 Go、Java 的做法），中央目录里另有 ZIP64 扩展字段。
+    QByteArray d;
+    put32(d, kDescriptorSig);
+    put32(d, e.crc);
+    if (e.size >= kMax32 || e.compressedSize >= kMax32) {
+        put64(d, quint64(e.compressedSize));
+        put64(d, quint64(e.size));
+    } else {
+        put32(d, quint32(e.compressedSize));
+        put32(d, quint32(e.size));
+    }
+    return writeRaw(d, error);
+}
+
+bool ZipWriter::close(QString* error)
+{
+    if (!endEntry(error)) {
+        return false;
+    }
+    const qint64 cdOffset = m_file.pos();
+
+    QByteArray cd;
+    for (const auto& e : std::as_const(m_entries)) {
+        // ZIP64 扩展字段只放溢出的那几项，顺序固定为原始大小、压缩后大小、本地头偏移。
+        QByteArray extra;
+        if (e.size >= kMax32) {
+            put64(extra, quint64(e.size));
+        }
+        if (e.compressedSize >= kMax32) {
+            put64(extra, quint64(e.compressedSize));
+        }
+        if (e.offset >= kMax32) {
+            put64(extra, quint64(e.offset));
+        }
+        if (!extra.isEmpty()) {
+            QByteArray head;
+            put16(head, kZip64ExtraId);
+            put16(head, quint16(extra.size()));
+            extra.prepend(head);
+        }
+        const quint16 version = extra.isEmpty() ? kVersion : kVersionZip64;
+
+        put32(cd, kCentralHeaderSig);
+        put16(cd, version);
+        put16(cd, version);
+        put16(cd, kFlags);
+        put16(cd, kDeflated);
+        put16(cd, m_dosTime);
+        put16(cd, m_dosDate);
+        put32(cd, e.crc);
+        put32(cd, clamp32(e.compressedSize));
+        put32(cd, clamp32(e.size));
+        put16(cd, quint16(e.name.size()));
+        put16(cd, quint16(extra.size()));
+        put16(cd, 0);
+        put16(cd, 0);
+        put16(cd, 0);
+        put32(cd, 0);
+        put32(cd, clamp32(e.offset));
+        cd.append(e.name);
+        cd.append(extra);
+    }
+
+    QByteArray end;
+    const qint64 count = m_entries.size();
+    if (count >= kMax16 || cd.size() >= kMax32 || cdOffset >= kMax32) {
+        const qint64 zip64Offset = cdOffset + cd.size();
+        put32(end, kZip64EndOfCentralSig);
+        put64(end, 44); // 本记录此后的长度
+        put16(end, kVersionZip64);
+        put16(end, kVersionZip64);
+        put32(end, 0);
+        put32(end, 0);
+        put64(end, quint64(count));
+        put64(end, quint64(count));
+        put64(end, quint64(cd.size()));
+        put64(end, quint64(cdOffset));
+
+        put32(end, kZip64LocatorSig);
+        put32(end, 0);
+        put64(end, quint64(zip64Offset));
+        put32(end, 1);
+    }
+    put32(end, kEndOfCentralSig);
+    put16(end, 0);
+    put16(end, 0);
+    put16(end, quint16(qMin<qint64>(count, kMax16)));
+    put16(end, quint16(qMin<qint64>(count, kMax16)));
+    put32(end, clamp32(cd.size()));
+    put32(end, clamp32(cdOffset));
+    put16(end, 0);
+
+    if (!writeRaw(cd + end, error)) {
+        return false;
+    }
+    m_file.close();
+    return true;
+}
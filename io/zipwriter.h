@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+struct z_stream_s;
+
+// 只写的 ZIP 打包，条目用 zlib 边写边 DEFLATE 压缩、边算 CRC，长度和 CRC 写在条目后的数据描述符里，
+// 所以条目内容不必先放进内存。条目或整个文件超过 4 GiB、条目超过 65535 个时按需写 ZIP64 记录。
+class ZipWriter final
+{
+public:
+    explicit ZipWriter(const QString& path);
+    ~ZipWriter();
+
+    bool open(QString* error = nullptr);
+    bool beginEntry(const QString& name, QString* error = nullptr);
+    bool write(const QByteArray& data, QString* error = nullptr);
+    bool endEntry(QString* error = nullptr);
+    // 写中央目录并关闭文件。
+    bool close(QString* error = nullptr);
+
+private:
+    struct Entry
+    {
+        QByteArray name;
+        quint32 crc = 0;
+        qint64 compressedSize = 0;
+        qint64 size = 0;
+        qint64 offset = 0;
+    };
+
+    bool writeRaw(const QByteArray& data, QString* error);
+    // 把 zlib 的输出写进文件；finish 为 true 时一直写到压缩流结束。
+    bool deflateTo(bool finish, QString* error);
+
+    QFile m_file;
+    QVector<Entry> m_entries;
+    std::unique_ptr<z_stream_s> m_stream;
+    QByteArray m_out;
+    bool m_inEntry = false;
+    qint64 m_entrySize = 0;
+    qint64 m_compressedSize = 0;
+    quint32 m_crc = 0;
+    quint16 m_dosTime = 0;
+    quint16 m_dosDate = 0;
+};
@@ -0,0 +1,269 @@
+#include "hl7.h"
+
+#include <cstring>
+
+namespace {
+
+// MLLP 帧起止字节。
+constexpr char kStartBlock = 0x0B;
+constexpr char kEndBlock = 0x1C;
+
+bool isLineBreak(char c)
+{
+    return c == '\r' || c == '\n';
+}
+
+bool sameBytes(QByteArrayView a, QByteArrayView b)
+{
+    return a.size() == b.size() && (a.isEmpty() || std::memcmp(a.data(), b.data(), static_cast<size_t>(a.size())) == 0);
+}
+
+qsizetype indexOf(QByteArrayView data, char c, qsizetype from = 0)
+{
+    if (from >= data.size()) {
+        return -1;
+    }
+    const auto* hit = static_cast<const char*>(std::memchr(data.data() + from, c, static_cast<size_t>(data.size() - from)));
+    return hit ? hit - data.data() : -1;
+}
+
+// 按 sep 切分后的第 k 段（从 0 数），不存在时为空视图。
+QByteArrayView nth(QByteArrayView data, char sep, int k)
+{
+    qsizetype start = 0;
+    for (; k > 0; --k) {
+        const qsizetype i = indexOf(data, sep, start);
+        if (i < 0) {
+            return {};
+        }
+        start = i + 1;
+    }
+    const qsizetype end = indexOf(data, sep, start);
+    return data.sliced(start, (end < 0 ? data.size() : end) - start);
+}
+
+QByteArrayView trimmed(QByteArrayView v)
+{
+    while (!v.isEmpty() && (isLineBreak(v.back()) || v.back() == kEndBlock)) {
+        v.chop(1);
+    }
+    return v;
+}
+
+}
+
+bool Hl7Stream::split(QByteArrayView data, qsizetype* pos, QByteArrayView* message, bool atEnd)
+{
+    const char* p = data.data();
+    const qsizetype n = data.size();
+
+    qsizetype start = *pos;
+    for (;;) {
+        while (start < n && (isLineBreak(p[start]) || p[start] == kEndBlock)) {
+            ++start;
+        }
+        if (start >= n) {
+            *pos = n;
+            return false;
+        }
+
+        const qsizetype messageStart = start;
+        qsizetype end = -1;
+        qsizetype next = -1;
+        if (p[start] == kStartBlock) {
+            ++start;
+            end = indexOf(data, kEndBlock, start);
+            if (end >= 0) {
+                next = end + 1;
+            }
+        } else {
+            // 裸文本：下一行以 MSH 开头（或遇到 MLLP 起始字节）时本条结束。
+            for (qsizetype i = start + 1; i < n && end < 0; ++i) {
+                if (p[i] == kStartBlock) {
+                    end = i;
+                    break;
+                }
+                if (!isLineBreak(p[i])) {
+                    continue;
+                }
+                qsizetype q = i + 1;
+                while (q < n && isLineBreak(p[q])) {
+                    ++q;
+                }
+                if (n - q < 3) {
+                    break;
+                }
+                if (std::memcmp(p + q, "MSH", 3) == 0) {
+                    end = i;
+                }
+                i = q - 1;
+            }
+            next = end;
+        }
+
+        if (end < 0) {
+            if (!atEnd) {
+                *pos = messageStart;
+                return false;
+            }
+            end = n;
+            next = n;
+        }
+
+        *pos = next;
+        *message = trimmed(data.sliced(start, end - start));
+        if (!message->isEmpty()) {
+            return true;
+        }
+        start = next;
+    }
+}
+
+void Hl7Stream::feed(QByteArrayView bytes)
+{
+    if (m_pos > 0) {
+        m_buffer.remove(0, m_pos);
+        m_pos = 0;
+    }
+    m_buffer.append(bytes.data(), bytes.size());
+}
+
+bool Hl7Stream::next(QByteArrayView* message, bool atEnd)
+{
+    if (split(m_buffer, &m_pos, message, atEnd)) {
+        return true;
+    }
+    if (m_buffer.size() - m_pos > kMaxMessageBytes) {
+        m_discarded += m_buffer.size() - m_pos;
+        m_pos = m_buffer.size();
+    }
+    return false;
+}
+
+Hl7Message::Hl7Message(QByteArrayView raw)
+    : m_raw(trimmed(raw))
+{
+    if (m_raw.size() < 8 || std::memcmp(m_raw.data(), "MSH", 3) != 0) {
+        return;
+    }
+    m_field = m_raw[3];
+    const QByteArrayView enc = nth(m_raw.sliced(4), m_field, 0);
+    if (enc.size() < 4) {
+        return;
+    }
+    m_component = enc[0];
+    m_repetition = enc[1];
+    m_escape = enc[2];
+    m_subcomponent = enc[3];
+    m_valid = true;
+}
+
+bool Hl7Message::nextSegment(qsizetype* pos, QByteArrayView* segment) const
+{
+    const char* p = m_raw.data();
+    const qsizetype n = m_raw.size();
+    qsizetype start = *pos;
+    while (start < n && isLineBreak(p[start])) {
+        ++start;
+    }
+    if (start >= n) {
+        *pos = n;
+        return false;
+    }
+    qsizetype end = indexOf(m_raw, '\r', start);
+    const qsizetype lf = indexOf(m_raw.first(end < 0 ? n : end), '\n', start);
+    if (lf >= 0) {
+        end = lf;
+    }
+    if (end < 0) {
+        end = n;
+    }
+    *segment = m_raw.sliced(start, end - start);
+    *pos = end;
+    return true;
+}
+
+QByteArrayView Hl7Message::segment(QByteArrayView id, int occurrence) const
+{
+    qsizetype pos = 0;
+    QByteArrayView seg;
+    while (nextSegment(&pos, &seg)) {
+        if (sameBytes(segmentId(seg), id) && occurrence-- == 0) {
+            return seg;
+        }
+    }
+    return {};
+}
+
+QByteArrayView Hl7Message::segmentId(QByteArrayView segment)
+{
+    return segment.first(qMin<qsizetype>(3, segment.size()));
+}
+
+QByteArrayView Hl7Message::field(QByteArrayView segment, int n) const
+{
+    if (n <= 0 || segment.size() < 3) {
+        return {};
+    }
+    if (std::memcmp(segment.data(), "MSH", 3) == 0) {
+        // MSH-1 是字段分隔符本身，其后的字段序号整体错开一位。
+        if (n == 1) {
+            return segment.size() > 3 ? segment.sliced(3, 1) : QByteArrayView();
+        }
+        --n;
+    }
+    return nth(segment, m_field, n);
+}
+
+QByteArrayView Hl7Message::component(QByteArrayView field, int n) const
+{
+    if (n <= 0) {
+        return {};
+    }
+    return nth(nth(field, m_repetition, 0), m_component, n - 1);
+}
+
+QString Hl7Message::text(QByteArrayView value) const
+{
+    if (indexOf(value, m_escape) < 0) {
+        return QString::fromUtf8(value.data(), value.size());
+    }
+
+    QByteArray out;
+    out.reserve(value.size());
+    qsizetype i = 0;
+    while (i < value.size()) {
+        const qsizetype esc = indexOf(value, m_escape, i);
+        if (esc < 0) {
+            out.append(value.data() + i, value.size() - i);
+            break;
+        }
+        out.append(value.data() + i, esc - i);
+        const qsizetype close = indexOf(value, m_escape, esc + 1);
+        if (close < 0) {
+            out.append(value.data() + esc, value.size() - esc);
+            break;
+        }
+        const QByteArrayView seq = value.sliced(esc + 1, close - esc - 1);
+        if (seq.size() == 1) {
+            switch (seq[0]) {
+            case 'F': out.append(m_field); break;
+            case 'S': out.append(m_component); break;
+            case 'T': out.append(m_subcomponent); break;
+            case 'R': out.append(m_repetition); break;
+            case 'E': out.append(m_escape); break;
+            default: break;
+            }
+        } else if (sameBytes(seq, ".br")) {
+            out.append('\n');
+        }
+        i = close + 1;
+    }
+    return QString::fromUtf8(out);
+}
+
+QByteArray Hl7Message::encodingCharacters() const
+{
+    const char chars[] = {m_component, m_repetition, m_escape, m_subcomponent};
+    return QByteArray(chars, sizeof(chars));
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+// HL7 v2 管道分隔消息的流式切分与按需取字段。全部返回指向原缓冲区的视图，不拷贝、不建树；
+// 只有需要成为 QString 的字段才经 Hl7Message::text() 转义并解码（按 UTF-8）。
+//
+// 消息边界：MLLP 帧（0x0B ... 0x1C 0x0D），或裸文本中新一行以 "MSH" 开头处。
+// 段分隔符为 CR，也接受 LF / CRLF（文件常被编辑器改过行尾）。
+
+// 从字节流中切出完整消息。socket 每收到一块就 feed()，再循环 next() 取完。
+class Hl7Stream final
+{
+public:
+    // 单条消息的上限，超过仍未见到结尾时整段丢弃，防止缓冲区被无分隔符的数据撑大。
+    static constexpr qsizetype kMaxMessageBytes = 4 * 1024 * 1024;
+
+    // 在 data 的 *pos 处切下一条消息：找到结尾（或 atEnd 时到数据末尾）返回 true 并把 *pos 移过它；
+    // 剩余部分不完整时返回 false，*pos 停在这条消息开头。已经映射进内存的整个文件可直接用它遍历。
+    static bool split(QByteArrayView data, qsizetype* pos, QByteArrayView* message, bool atEnd);
+
+    void feed(QByteArrayView bytes);
+    // 取出的视图在下一次 feed() 之前有效。
+    bool next(QByteArrayView* message, bool atEnd = false);
+    qsizetype discarded() const { return m_discarded; }
+
+private:
+    QByteArray m_buffer;
+    qsizetype m_pos = 0;
+    qsizetype m_discarded = 0;
+};
+
+// 一条消息的只读视图：分隔符取自 MSH-1/MSH-2，字段序号与标准一致（从 1 开始，MSH-1 即字段分隔符本身）。
+class Hl7Message final
+{
+public:
+    explicit Hl7Message(QByteArrayView raw);
+
+    bool isValid() const { return m_valid; }
+    QByteArrayView raw() const { return m_raw; }
+
+    // 逐段遍历：*pos 从 0 开始，返回 false 表示没有更多段。
+    bool nextSegment(qsizetype* pos, QByteArrayView* segment) const;
+    // 第 occurrence 个（从 0 数）名为 id 的段，没有则为空视图。
+    QByteArrayView segment(QByteArrayView id, int occurrence = 0) const;
+
+    static QByteArrayView segmentId(QByteArrayView segment);
+    QByteArrayView field(QByteArrayView segment, int n) const;
+    // 字段的第 n 个组分（从 1 数），只看第一个重复。
+    QByteArrayView component(QByteArrayView field, int n) const;
+    // 处理 \F\ \S\ \T\ \R\ \E\ 转义后按 UTF-8 解码；其他转义（\H\、\Xhh\ 等）原样去掉反斜杠对。
+    QString text(QByteArrayView value) const;
+
+    char fieldSeparator() const { return m_field; }
+    QByteArray encodingCharacters() const;
+
+private:
+    QByteArrayView m_raw;
+    bool m_valid = false;
+    char m_field = '|';
+    char m_component = '^';
+    char m_repetition = '~';
+    char m_escape = '\\';
+    char m_subcomponent = '&';
+};
@@ -0,0 +1,602 @@
+#include "labingestor.h"
+
+#include "db/dbmanager.h"
+#include "db/mpscqueue.h"
+#include "lab/hl7.h"
+#include "lab/labmessage.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPair>
+#include <QPointer>
+#include <QSemaphore>
+#include <QSettings>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+
+#include <atomic>
+
+namespace {
+
+// 每批最多多少条消息（一条通常十几项结果），以及凑不满一批时最长等多久。
+constexpr int kBatchMessages = 1000;
+constexpr int kFlushMs = 100;
+// 套接字来的消息排队超过这个数就回 AR 让对方稍后重发，写库跟不上时内存不会无限增长。
+constexpr qint64 kMaxQueued = 50000;
+// 文件修改时间静止这么久才认为对方已写完。
+constexpr qint64 kSettleMs = 1000;
+
+const QString kFindPatientSql = QStringLiteral("SELECT ID FROM Patient WHERE ID_CARD=? LIMIT 1;");
+const QString kInsertSql = QStringLiteral(
+    "INSERT OR IGNORE INTO LabResult(SENDING_APP,SENDING_FACILITY,MESSAGE_ID,SET_ID,PATIENT_ID,ID_CARD,ORDER_CODE,"
+    "CODE,NAME,VALUE,UNITS,REF_RANGE,FLAGS,STATUS,OBSERVED_MS,RECEIVED_MS) VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?);");
+
+struct PendingMessage
+{
+    qint64 receivedMs = 0;
+    LabMessage message;
+    // 来自套接字时：连接编号和原消息的 MSH 段，写库有了结果再据此回 ACK。文件来的为 0。
+    quint64 connection = 0;
+    QByteArray header;
+};
+
+QVariant orNull(const QString& s)
+{
+    return s.isEmpty() ? QVariant() : QVariant(s);
+}
+
+}
+
+struct LabIngestor::Shared
+{
+    MpscQueue<PendingMessage> queue;
+    MpscQueue<QString> files;
+    QSemaphore wake;
+    std::atomic<bool> stopping{false};
+    std::atomic<qint64> depth{0};
+    std::atomic<qint64> messages{0};
+    std::atomic<qint64> rejected{0};
+    std::atomic<qint64> results{0};
+    std::atomic<qint64> unmatched{0};
+    std::atomic<qint64> dropped{0};
+};
+
+namespace {
+
+class ResultWriter final
+{
+public:
+    explicit ResultWriter(QSqlDatabase db)
+        : m_db(db)
+        , m_find(db)
+        , m_insert(db)
+    {
+    }
+
+    bool prepare(QString* error)
+    {
+        if (!m_find.prepare(kFindPatientSql) || !m_insert.prepare(kInsertSql)) {
+            if (error) {
+                *error = (m_find.lastError().isValid() ? m_find.lastError() : m_insert.lastError()).text();
+            }
+            return false;
+        }
+        return true;
+    }
+
+    // 一批消息一个事务；多半是写锁竞争超时，失败时重试一次。
+    bool commit(const QVector<PendingMessage>& batch, qint64* results, qint64* unmatched, QString* error)
+    {
+        if (commitOnce(batch, results, unmatched, error)) {
+            return true;
+        }
+        QThread::msleep(50);
+        return commitOnce(batch, results, unmatched, error);
+    }
+
+private:
+    bool fail(const QSqlError& e, QString* error)
+    {
+        if (error) {
+            *error = e.text();
+        }
+        m_db.rollback();
+        return false;
+    }
+
+    bool commitOnce(const QVector<PendingMessage>& batch, qint64* results, qint64* unmatched, QString* error)
+    {
+        *results = 0;
+        *unmatched = 0;
+        if (!m_db.transaction()) {
+            if (error) {
+                *error = m_db.lastError().text();
+            }
+            return false;
+        }
+
+        // 同一批里同一个人的多条消息很常见（一台仪器连续出一个标本的各项），只查一次。
+        QHash<QString, QVariant> patients;
+        for (const auto& m : batch) {
+            QVariant patientId;
+            const QString& idCard = m.message.idCard;
+            if (!idCard.isEmpty()) {
+                const auto it = patients.constFind(idCard);
+                if (it != patients.constEnd()) {
+                    patientId = it.value();
+                } else {
+                    m_find.addBindValue(idCard);
+                    if (!m_find.exec()) {
+                        return fail(m_find.lastError(), error);
+                    }
+                    if (m_find.next()) {
+                        patientId = m_find.value(0);
+                    }
+                    m_find.finish();
+                    patients.insert(idCard, patientId);
+                }
+            }
+
+            for (const auto& o : m.message.observations) {
+                m_insert.addBindValue(m.message.sendingApplication);
+                m_insert.addBindValue(m.message.sendingFacility);
+                m_insert.addBindValue(m.message.controlId);
+                m_insert.addBindValue(o.setId);
+                m_insert.addBindValue(patientId);
+                m_insert.addBindValue(orNull(idCard));
+                m_insert.addBindValue(orNull(o.orderCode));
+                m_insert.addBindValue(orNull(o.code));
+                m_insert.addBindValue(orNull(o.name));
+                m_insert.addBindValue(orNull(o.value));
+                m_insert.addBindValue(orNull(o.units));
+                m_insert.addBindValue(orNull(o.range));
+                m_insert.addBindValue(orNull(o.flags));
+                m_insert.addBindValue(orNull(o.status));
+                m_insert.addBindValue(o.observedMs > 0 ? QVariant(o.observedMs) : QVariant());
+                m_insert.addBindValue(m.receivedMs);
+                if (!m_insert.exec()) {
+                    return fail(m_insert.lastError(), error);
+                }
+                if (m_insert.numRowsAffected() > 0) {
+                    ++*results;
+                    if (patientId.isNull()) {
+                        ++*unmatched;
+                    }
+                }
+            }
+        }
+
+        if (!m_db.commit()) {
+            return fail(m_db.lastError(), error);
+        }
+        return true;
+    }
+
+    QSqlDatabase m_db;
+    QSqlQuery m_find;
+    QSqlQuery m_insert;
+};
+
+// 移到收件目录下的 sub/；重名时加时间前缀。
+bool moveInto(const QString& path, const QString& sub)
+{
+    const QFileInfo fi(path);
+    const QDir dir(fi.dir().filePath(sub));
+    if (!QDir().mkpath(dir.absolutePath())) {
+        return false;
+    }
+    QString target = dir.filePath(fi.fileName());
+    if (QFileInfo::exists(target)) {
+        target = dir.filePath(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss-zzz-")) + fi.fileName());
+    }
+    return QFile::rename(path, target);
+}
+
+}
+
+LabIngestor::LabIngestor(QObject* parent)
+    : QObject(parent)
+{
+}
+
+LabIngestor::~LabIngestor()
+{
+    stop();
+}
+
+bool LabIngestor::enabled()
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    return settings.value(QStringLiteral("Lab/Enabled"), false).toBool();
+}
+
+QString LabIngestor::inboxDir()
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    const auto dir = settings.value(QStringLiteral("Lab/InboxDir")).toString();
+    if (!dir.isEmpty()) {
+        return dir;
+    }
+    return QFileInfo(DbManager::instance().databasePath()).dir().filePath(QStringLiteral("lab-inbox"));
+}
+
+QString LabIngestor::socketName()
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    return settings.value(QStringLiteral("Lab/Socket"), QStringLiteral("hospital-lab")).toString();
+}
+
+bool LabIngestor::start(QString* error)
+{
+    if (m_writer) {
+        return true;
+    }
+
+    m_inbox = inboxDir();
+    if (!QDir().mkpath(m_inbox)) {
+        if (error) {
+            *error = QStringLiteral("无法创建检验结果收件目录 %1").arg(m_inbox);
+        }
+        return false;
+    }
+
+    const QString name = socketName();
+    if (!name.isEmpty()) {
+        m_server = new QLocalServer(this);
+        // 上次异常退出可能留下套接字文件。
+        QLocalServer::removeServer(name);
+        if (!m_server->listen(name)) {
+            if (error) {
+                *error = QStringLiteral("无法监听本地套接字 %1：%2").arg(name, m_server->errorString());
+            }
+            delete m_server;
+            m_server = nullptr;
+            return false;
+        }
+        connect(m_server, &QLocalServer::newConnection, this, &LabIngestor::onNewConnection);
+    }
+
+    m_shared = std::make_shared<Shared>();
+    auto shared = m_shared;
+    m_writer = QThread::create([this, shared] { run(this, shared); });
+    m_writer->start();
+
+    m_watcher = new QFileSystemWatcher({m_inbox}, this);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &LabIngestor::scanInbox);
+    // 监视只报目录变化；对方还在写的文件和漏报的变化由定时器补扫。
+    m_timer = new QTimer(this);
+    connect(m_timer, &QTimer::timeout, this, &LabIngestor::tick);
+    m_timer->start(1000);
+    m_clock.start();
+    m_last = Stats();
+
+    scanInbox();
+    qInfo("LabIngestor: watching %s%s", qPrintable(QDir::toNativeSeparators(m_inbox)),
+          m_server ? qPrintable(QStringLiteral(", listening on ") + m_server->fullServerName()) : "");
+    return true;
+}
+
+void LabIngestor::stop()
+{
+    if (!m_writer) {
+        return;
+    }
+
+    delete m_timer;
+    m_timer = nullptr;
+    delete m_watcher;
+    m_watcher = nullptr;
+    for (auto it = m_streams.cbegin(); it != m_streams.cend(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->abort();
+    }
+    m_streams.clear();
+    m_sockets.clear();
+    delete m_server;
+    m_server = nullptr;
+
+    m_shared->stopping.store(true);
+    m_shared->wake.release();
+    m_writer->wait();
+    delete m_writer;
+    m_writer = nullptr;
+    m_inFlight.clear();
+}
+
+bool LabIngestor::submit(QByteArrayView message, QString* error)
+{
+    return enqueue(message, 0, error);
+}
+
+bool LabIngestor::enqueue(QByteArrayView message, quint64 connection, QString* error)
+{
+    const auto reject = [this, error](const QString& text) {
+        m_shared->rejected.fetch_add(1);
+        if (error) {
+            *error = text;
+        }
+        return false;
+    };
+    if (!m_writer) {
+        return reject(QStringLiteral("检验结果接收未启动"));
+    }
+    if (m_shared->depth.load() >= kMaxQueued) {
+        return reject(QStringLiteral("入库队列已满，请稍后重发"));
+    }
+
+    PendingMessage m;
+    QString err;
+    const Hl7Message hl7(message);
+    if (!LabMessage::parse(hl7, &m.message, &err)) {
+        return reject(err);
+    }
+    m.receivedMs = QDateTime::currentMSecsSinceEpoch();
+    m.connection = connection;
+    if (connection) {
+        m.header = hl7.segment("MSH").toByteArray();
+    }
+    m_shared->queue.push(std::move(m));
+    m_shared->messages.fetch_add(1);
+    if (m_shared->depth.fetch_add(1) + 1 >= kBatchMessages) {
+        m_shared->wake.release();
+    }
+    return true;
+}
+
+LabIngestor::Stats LabIngestor::stats() const
+{
+    Stats s = m_last;
+    if (m_shared) {
+        s.messages = m_shared->messages.load();
+        s.rejected = m_shared->rejected.load();
+        s.results = m_shared->results.load();
+        s.unmatched = m_shared->unmatched.load();
+        s.dropped = m_shared->dropped.load();
+        s.queued = m_shared->depth.load();
+    }
+    return s;
+}
+
+void LabIngestor::scanInbox()
+{
+    if (!m_writer) {
+        return;
+    }
+    const qint64 settled = QDateTime::currentMSecsSinceEpoch() - kSettleMs;
+    const auto entries = QDir(m_inbox).entryInfoList({QStringLiteral("*.hl7")}, QDir::Files, QDir::Name);
+    bool queued = false;
+    for (const auto& fi : entries) {
+        const QString path = fi.absoluteFilePath();
+        if (m_inFlight.contains(path) || fi.lastModified().toMSecsSinceEpoch() > settled) {
+            continue;
+        }
+        m_inFlight.insert(path);
+        m_shared->files.push(path);
+        queued = true;
+    }
+    if (queued) {
+        m_shared->wake.release();
+    }
+}
+
+void LabIngestor::onNewConnection()
+{
+    while (auto* socket = m_server->nextPendingConnection()) {
+        const quint64 id = ++m_nextConnection;
+        m_streams.insert(socket, {id, std::make_shared<Hl7Stream>()});
+        m_sockets.insert(id, socket);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket] { onReadyRead(socket, false); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket, id] {
+            // 没有 MLLP 帧的发送方以断开表示最后一条结束；这条已无处回 ACK。
+            onReadyRead(socket, true);
+            m_streams.remove(socket);
+            m_sockets.remove(id);
+            socket->deleteLater();
+        });
+    }
+}
+
+void LabIngestor::onReadyRead(QLocalSocket* socket, bool atEnd)
+{
+    const auto it = m_streams.constFind(socket);
+    if (it == m_streams.constEnd()) {
+        return;
+    }
+    const auto connection = it.value();
+    connection.stream->feed(socket->readAll());
+    QByteArrayView raw;
+    while (connection.stream->next(&raw, atEnd)) {
+        QString err;
+        // 入队成功的由写线程在提交后回 AA（写库失败回 AR）；这里只对当场拒收的回 AR。
+        if (!enqueue(raw, atEnd ? 0 : connection.id, &err)) {
+            qWarning("LabIngestor: rejected message: %s", qPrintable(err));
+            if (!atEnd) {
+                socket->write(LabMessage::acknowledgement(Hl7Message(raw), false, err));
+            }
+        }
+    }
+}
+
+void LabIngestor::sendAcks(const QVector<QPair<quint64, QByteArray>>& acks)
+{
+    for (const auto& ack : acks) {
+        // 连接已断开的不再回；对方没收到 ACK 会重发，唯一键保证不重复入库。
+        if (auto* socket = m_sockets.value(ack.first)) {
+            socket->write(ack.second);
+        }
+    }
+}
+
+void LabIngestor::tick()
+{
+    scanInbox();
+
+    const double seconds = qMax<qint64>(1, m_clock.restart()) / 1000.0;
+    Stats s = stats();
+    s.messagesPerSecond = (s.messages - m_last.messages) / seconds;
+    s.resultsPerSecond = (s.results - m_last.results) / seconds;
+    const bool active = s.messages != m_last.messages || s.results != m_last.results || s.rejected != m_last.rejected;
+    m_last = s;
+    if (!active) {
+        return;
+    }
+    qInfo("LabIngestor: %.0f msg/s, %.0f results/s, queued %lld; total %lld messages, %lld results"
+          " (%lld unmatched), %lld rejected, %lld dropped",
+          s.messagesPerSecond, s.resultsPerSecond, static_cast<long long>(s.queued),
+          static_cast<long long>(s.messages), static_cast<long long>(s.results),
+          static_cast<long long>(s.unmatched), static_cast<long long>(s.rejected),
+          static_cast<long long>(s.dropped));
+    emit statsUpdated(s);
+}
+
+void LabIngestor::run(LabIngestor* self, const std::shared_ptr<Shared>& shared)
+{
+    auto& s = *shared;
+
+    QString err;
+    auto db = DbManager::instance().openWorkerConnection(&err);
+    if (!db.isOpen()) {
+        qWarning("LabIngestor: cannot open writer connection: %s", qPrintable(err));
+    }
+    // 连接关闭前查询对象必须先析构。
+    {
+        ResultWriter writer(db);
+        const bool ready = db.isOpen() && writer.prepare(&err);
+        if (db.isOpen() && !ready) {
+            qWarning("LabIngestor: cannot prepare statements: %s", qPrintable(err));
+        }
+
+        // 套接字来的消息在这里才回 ACK：AA 表示已经提交，写库失败的回 AR 让对方重发。
+        const auto acknowledge = [self](const QVector<PendingMessage>& batch, bool committed, const QString& reason) {
+            QVector<QPair<quint64, QByteArray>> acks;
+            for (const auto& m : batch) {
+                if (m.connection) {
+                    acks.append({m.connection, LabMessage::acknowledgement(Hl7Message(m.header), committed, reason)});
+                }
+            }
+            if (!acks.isEmpty()) {
+                QMetaObject::invokeMethod(self, [self, acks] { self->sendAcks(acks); }, Qt::QueuedConnection);
+            }
+        };
+
+        const auto write = [&](const QVector<PendingMessage>& batch) {
+            qint64 results = 0;
+            qint64 unmatched = 0;
+            err.clear();
+            if (ready && writer.commit(batch, &results, &unmatched, &err)) {
+                s.results.fetch_add(results);
+                s.unmatched.fetch_add(unmatched);
+                acknowledge(batch, true, {});
+                return true;
+            }
+            s.dropped.fetch_add(batch.size());
+            qWarning("LabIngestor: dropped %d messages: %s", static_cast<int>(batch.size()), qPrintable(err));
+            acknowledge(batch, false, QStringLiteral("写库失败，请重发：%1").arg(err));
+            return false;
+        };
+
+        QVector<PendingMessage> batch;
+        batch.reserve(kBatchMessages);
+        const auto drainQueue = [&] {
+            bool more = true;
+            while (more) {
+                batch.clear();
+                PendingMessage m;
+                while (batch.size() < kBatchMessages && s.queue.tryPop(m)) {
+                    batch.append(std::move(m));
+                }
+                more = batch.size() == kBatchMessages;
+                if (!batch.isEmpty()) {
+                    write(batch);
+                    s.depth.fetch_sub(batch.size());
+                }
+            }
+        };
+
+        // 整个文件映射进来，消息和字段都是指向映射区的视图；每凑满一批写一次，其间顺带清空套接字队列。
+        const auto ingestFile = [&](const QString& path) {
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly)) {
+                qWarning("LabIngestor: cannot open %s: %s", qPrintable(path), qPrintable(file.errorString()));
+                return;
+            }
+            const qint64 size = file.size();
+            uchar* base = size > 0 ? file.map(0, size) : nullptr;
+            const QByteArray copy = (!base && size > 0) ? file.readAll() : QByteArray();
+            const QByteArrayView data = base ? QByteArrayView(reinterpret_cast<const char*>(base), size) : QByteArrayView(copy);
+
+            const qint64 receivedMs = QDateTime::currentMSecsSinceEpoch();
+            QVector<PendingMessage> fileBatch;
+            fileBatch.reserve(kBatchMessages);
+            int rejected = 0;
+            bool failed = false;
+            qsizetype pos = 0;
+            QByteArrayView raw;
+            while (!s.stopping.load() && Hl7Stream::split(data, &pos, &raw, true)) {
+                PendingMessage m;
+                m.receivedMs = receivedMs;
+                QString parseErr;
+                if (!LabMessage::parse(Hl7Message(raw), &m.message, &parseErr)) {
+                    ++rejected;
+                    s.rejected.fetch_add(1);
+                    qWarning("LabIngestor: %s: %s", qPrintable(QFileInfo(path).fileName()), qPrintable(parseErr));
+                    continue;
+                }
+                fileBatch.append(std::move(m));
+                s.messages.fetch_add(1);
+                if (fileBatch.size() == kBatchMessages) {
+                    failed = !write(fileBatch) || failed;
+                    fileBatch.clear();
+                    drainQueue();
+                }
+            }
+            if (!fileBatch.isEmpty()) {
+                failed = !write(fileBatch) || failed;
+            }
+            const bool complete = pos >= data.size();
+            if (base) {
+                file.unmap(base);
+            }
+            file.close();
+
+            // 没读完（正在退出）或写库失败的留在收件目录，下次重读；已写入的行靠唯一键去重。
+            if (complete && !failed && !moveInto(path, rejected > 0 ? QStringLiteral("error") : QStringLiteral("done"))) {
+                qWarning("LabIngestor: cannot move %s out of the inbox", qPrintable(path));
+            }
+            QMetaObject::invokeMethod(self, [self, path] { self->m_inFlight.remove(path); }, Qt::QueuedConnection);
+        };
+
+        bool busy = false;
+        for (;;) {
+            if (!busy) {
+                s.wake.tryAcquire(1, kFlushMs);
+            }
+            const bool stopping = s.stopping.load();
+            drainQueue();
+
+            QString path;
+            busy = !stopping && s.files.tryPop(path);
+            if (busy) {
+                ingestFile(path);
+            }
+
+            if (stopping && s.depth.load() == 0) {
+                break;
+            }
+        }
+    }
+
+    if (db.isOpen()) {
+        DbManager::closeWorkerConnection(db);
+    }
+}
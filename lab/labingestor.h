@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QByteArrayView>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+class Hl7Stream;
+class QFileSystemWatcher;
+class QLocalServer;
+class QLocalSocket;
+class QThread;
+class QTimer;
+
+// 检验仪器 / LIS 推送的 HL7 v2 结果消息（ORU^R01）接收入库。两个来源：
+//   收件目录  *.hl7 文件写完（修改时间静止一秒）后由写线程整个映射进来，原地切分解析、按批入库，
+//             完成后移到 done/，有解析失败的消息则移到 error/ 留待人工查看；写库失败的留在原处下次再读；
+//   本地套接字 MLLP 帧，在界面线程解析；写线程提交所在的批次后才回 AA，写库失败回 AR，
+//             解析失败或队列已满当场回 AR。进程崩溃时只会丢还没回 ACK 的消息，发送方会重发。
+// 解析只取入库需要的字段，不拷贝整条消息；写线程按批在一个事务里写 LabResult，
+// 按 Patient.ID_CARD 索引关联患者，找不到的先只记身份证号，患者建档时由触发器补上。
+// (发送应用, 发送机构, MSH-10, 序号) 唯一，重复推送不会重复入库。
+// 设置保存在 hospital.ini 的 Lab 节，默认关闭。
+class LabIngestor final : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats
+    {
+        qint64 messages = 0;  // 已接受（解析成功并入队）的消息
+        qint64 rejected = 0;  // 解析失败或不是结果消息
+        qint64 results = 0;   // 已写入的结果行（重复推送的不计）
+        qint64 unmatched = 0; // 其中没找到患者的
+        qint64 dropped = 0;   // 写库失败丢弃的消息
+        qint64 queued = 0;    // 已入队尚未写库的消息
+        double messagesPerSecond = 0;
+        double resultsPerSecond = 0;
+    };
+
+    explicit LabIngestor(QObject* parent = nullptr);
+    ~LabIngestor() override;
+
+    static bool enabled();
+    // 默认为数据库目录下的 lab-inbox/。
+    static QString inboxDir();
+    // 本地套接字名，默认 hospital-lab；设为空则不监听。
+    static QString socketName();
+
+    bool start(QString* error = nullptr);
+    // 停止接收并等写线程把已入队的消息写完。
+    void stop();
+    bool isRunning() const { return m_writer != nullptr; }
+
+    // 解析一条消息并入队；返回 false 时 error 说明原因（队列已满也算拒绝）。返回 true 不代表已经写库。
+    bool submit(QByteArrayView message, QString* error = nullptr);
+    Stats stats() const;
+
+signals:
+    // 每秒一次，有新消息时才发。
+    void statsUpdated(const LabIngestor::Stats& stats);
+
+private:
+    struct Shared;
+    struct Connection
+    {
+        quint64 id = 0;
+        std::shared_ptr<Hl7Stream> stream;
+    };
+
+    // connection 非 0 时，写线程提交后向该连接回 ACK。
+    bool enqueue(QByteArrayView message, quint64 connection, QString* error);
+    void sendAcks(const QVector<QPair<quint64, QByteArray>>& acks);
+    void scanInbox();
+    void onNewConnection();
+    void onReadyRead(QLocalSocket* socket, bool atEnd);
+    void tick();
+    // 写线程：批量写入队的消息，空闲时逐个处理收件目录里的文件。
+    static void run(LabIngestor* self, const std::shared_ptr<Shared>& shared);
+
+    std::shared_ptr<Shared> m_shared;
+    QThread* m_writer = nullptr;
+    QFileSystemWatcher* m_watcher = nullptr;
+    QLocalServer* m_server = nullptr;
+    QTimer* m_timer = nullptr;
+    QHash<QLocalSocket*, Connection> m_streams;
+    QHash<quint64, QLocalSocket*> m_sockets;
+    quint64 m_nextConnection = 0;
+    // 已交给写线程、尚未移走的文件。
+    QSet<QString> m_inFlight;
+    QString m_inbox;
+    Stats m_last;
+    QElapsedTimer m_clock;
+};
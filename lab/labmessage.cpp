@@ -0,0 +1,213 @@
+#include "labmessage.h"
+
+#include "lab/hl7.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QTime>
+
+#include <cstring>
+
+namespace {
+
+bool isType(QByteArrayView value, const char* type)
+{
+    const auto n = static_cast<qsizetype>(std::strlen(type));
+    return value.size() == n && std::memcmp(value.data(), type, static_cast<size_t>(n)) == 0;
+}
+
+// 应答里回填的文本要把分隔符转义掉。
+QByteArray escaped(const Hl7Message& message, const QString& text)
+{
+    const QByteArray enc = message.encodingCharacters();
+    const char esc = enc[2];
+    const QByteArray in = text.toUtf8();
+    QByteArray out;
+    out.reserve(in.size());
+    for (const char c : in) {
+        char code = 0;
+        if (c == message.fieldSeparator()) {
+            code = 'F';
+        } else if (c == enc[0]) {
+            code = 'S';
+        } else if (c == enc[1]) {
+            code = 'R';
+        } else if (c == esc) {
+            code = 'E';
+        } else if (c == enc[3]) {
+            code = 'T';
+        }
+        if (code) {
+            out.append(esc).append(code).append(esc);
+        } else if (c != '\r' && c != '\n') {
+            out.append(c);
+        }
+    }
+    return out;
+}
+
+}
+
+bool LabMessage::parse(const Hl7Message& message, LabMessage* out, QString* error)
+{
+    const auto fail = [error](const QString& text) {
+        if (error) {
+            *error = text;
+        }
+        return false;
+    };
+    if (!message.isValid()) {
+        return fail(QStringLiteral("不是 HL7 消息（缺少 MSH 段）"));
+    }
+
+    const QByteArrayView msh = message.segment("MSH");
+    const QByteArrayView type = message.component(message.field(msh, 9), 1);
+    if (!isType(type, "ORU")) {
+        return fail(QStringLiteral("不是检验结果消息（MSH-9=%1）").arg(message.text(message.field(msh, 9))));
+    }
+    out->sendingApplication = message.text(message.component(message.field(msh, 3), 1));
+    out->sendingFacility = message.text(message.component(message.field(msh, 4), 1));
+    out->controlId = message.text(message.field(msh, 10));
+    if (out->controlId.isEmpty()) {
+        return fail(QStringLiteral("缺少消息控制 ID（MSH-10）"));
+    }
+    out->idCard.clear();
+    out->observations.clear();
+
+    QString orderCode;
+    qint64 orderMs = 0;
+    qsizetype pos = 0;
+    QByteArrayView seg;
+    while (message.nextSegment(&pos, &seg)) {
+        const QByteArrayView id = Hl7Message::segmentId(seg);
+        if (isType(id, "PID") && out->idCard.isEmpty()) {
+            out->idCard = message.text(message.component(message.field(seg, 3), 1)).trimmed();
+            if (out->idCard.isEmpty()) {
+                out->idCard = message.text(message.field(seg, 19)).trimmed();
+            }
+        } else if (isType(id, "OBR")) {
+            orderCode = message.text(message.component(message.field(seg, 4), 1));
+            orderMs = parseTimestamp(message.component(message.field(seg, 7), 1));
+        } else if (isType(id, "OBX")) {
+            LabObservation o;
+            o.setId = out->observations.size() + 1;
+            o.orderCode = orderCode;
+            const QByteArrayView code = message.field(seg, 3);
+            o.code = message.text(message.component(code, 1));
+            o.name = message.text(message.component(code, 2));
+            o.value = message.text(message.field(seg, 5));
+            o.units = message.text(message.component(message.field(seg, 6), 1));
+            o.range = message.text(message.field(seg, 7));
+            o.flags = message.text(message.field(seg, 8));
+            o.status = message.text(message.field(seg, 11));
+            o.observedMs = parseTimestamp(message.component(message.field(seg, 14), 1));
+            if (o.observedMs == 0) {
+                o.observedMs = orderMs;
+            }
+            out->observations.append(std::move(o));
+        }
+    }
+    if (out->observations.isEmpty()) {
+        return fail(QStringLiteral("消息 %1 没有结果（OBX 段）").arg(out->controlId));
+    }
+    return true;
+}
+
+qint64 LabMessage::parseTimestamp(QByteArrayView ts)
+{
+    const char* p = ts.data();
+    const qsizetype n = ts.size();
+    qsizetype i = 0;
+    const auto digits = [&](int count, int* value) {
+        if (i + count > n) {
+            return false;
+        }
+        int v = 0;
+        for (int k = 0; k < count; ++k) {
+            const char c = p[i + k];
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            v = v * 10 + (c - '0');
+        }
+        *value = v;
+        i += count;
+        return true;
+    };
+
+    int year = 0;
+    int month = 1;
+    int day = 1;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    int msec = 0;
+    if (!digits(4, &year)) {
+        return 0;
+    }
+    if (digits(2, &month) && digits(2, &day) && digits(2, &hour) && digits(2, &minute) && digits(2, &second)
+        && i < n && p[i] == '.') {
+        ++i;
+        for (int scale = 100; i < n && p[i] >= '0' && p[i] <= '9'; ++i, scale /= 10) {
+            msec += (p[i] - '0') * scale;
+        }
+    }
+
+    bool hasOffset = false;
+    int offsetMinutes = 0;
+    if (i < n && (p[i] == '+' || p[i] == '-')) {
+        const int sign = p[i] == '-' ? -1 : 1;
+        ++i;
+        int hh = 0;
+        int mm = 0;
+        if (digits(2, &hh) && digits(2, &mm)) {
+            hasOffset = true;
+            offsetMinutes = sign * (hh * 60 + mm);
+        }
+    }
+
+    const QDate date(year, month, day);
+    const QTime time(hour, minute, second, msec);
+    if (!date.isValid() || !time.isValid()) {
+        return 0;
+    }
+    if (!hasOffset) {
+        return QDateTime(date, time).toMSecsSinceEpoch();
+    }
+    const qint64 days = date.toJulianDay() - QDate(1970, 1, 1).toJulianDay();
+    return days * 86400000 + time.msecsSinceStartOfDay() - qint64(offsetMinutes) * 60000;
+}
+
+QByteArray LabMessage::acknowledgement(const Hl7Message& message, bool accepted, const QString& text)
+{
+    const QByteArrayView msh = message.segment("MSH");
+    const char sep = message.fieldSeparator();
+    const auto field = [&](int n) { return message.field(msh, n).toByteArray(); };
+
+    // 收发双方对调；MSH-9 的触发事件照抄。
+    QByteArray out;
+    out.append('\x0B');
+    out.append("MSH").append(sep).append(message.encodingCharacters());
+    out.append(sep).append(field(5)).append(sep).append(field(6));
+    out.append(sep).append(field(3)).append(sep).append(field(4));
+    out.append(sep).append(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMddHHmmss")).toLatin1());
+    out.append(sep);
+    out.append(sep).append("ACK");
+    const QByteArrayView trigger = message.component(message.field(msh, 9), 2);
+    if (!trigger.isEmpty()) {
+        out.append(message.encodingCharacters()[0]).append(trigger.data(), trigger.size());
+    }
+    out.append(sep).append('A').append(field(10));
+    out.append(sep).append(msh.isEmpty() ? QByteArray("P") : field(11));
+    out.append(sep).append(msh.isEmpty() ? QByteArray("2.5") : field(12));
+    out.append('\r');
+
+    out.append("MSA").append(sep).append(accepted ? "AA" : "AR");
+    out.append(sep).append(field(10));
+    if (!text.isEmpty()) {
+        out.append(sep).append(escaped(message, text));
+    }
+    out.append('\r');
+    out.append('\x1C').append('\r');
+    return out;
+}
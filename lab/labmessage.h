@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QVector>
+
+class Hl7Message;
+
+// 一条检验结果消息（ORU^R01）里入库需要的字段。一条消息可含多个申请单（OBR），每个下面若干项结果（OBX）。
+struct LabObservation
+{
+    int setId = 0;         // 消息内第几个 OBX（从 1 数）；OBX-1 在每个 OBR 下重新编号，不能做键
+    QString orderCode;     // 所属 OBR 的 OBR-4.1
+    QString code;          // OBX-3.1
+    QString name;          // OBX-3.2
+    QString value;         // OBX-5
+    QString units;         // OBX-6.1
+    QString range;         // OBX-7
+    QString flags;         // OBX-8，H/L/A 等异常标志
+    QString status;        // OBX-11，F 终审、C 更正等
+    qint64 observedMs = 0; // OBX-14，缺省取 OBR-7；0 表示消息里没有
+};
+
+struct LabMessage
+{
+    // 去重键为 (发送应用, 发送机构, MSH-10, setId)：MSH-10 只在同一发送方内唯一，各台仪器的计数器互不相干。
+    QString sendingApplication; // MSH-3.1
+    QString sendingFacility;    // MSH-4.1
+    QString controlId;          // MSH-10
+    QString idCard;             // PID-3 第一个组分，没有时取 PID-19
+    QVector<LabObservation> observations;
+
+    // 取出 ORU 消息里的结果；不是 ORU、缺少 MSH-10 或没有 OBX 时返回 false。
+    static bool parse(const Hl7Message& message, LabMessage* out, QString* error = nullptr);
+    // HL7 时间 YYYY[MM[DD[HH[MM[SS[.S...]]]]]][+/-ZZZZ] 转为 UTC 毫秒；不带时区按本地时间。无效返回 0。
+    static qint64 parseTimestamp(QByteArrayView ts);
+    // 对 message 的 ACK 应答（MSA-1 为 AA 或 AR），已带 MLLP 帧。
+    static QByteArray acknowledgement(const Hl7Message& message, bool accepted, const QString& text = QString());
+};
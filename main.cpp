@@ -1,12 +1,21 @@
 #include "mainwindow.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QMessageBox>
+#include <QTimer>
 
+#include "db/backupmanager.h"
 #include "db/dbmanager.h"
+#include "db/historyarchiver.h"
+#include "db/historylogger.h"
+#include "db/snapshotexporter.h"
+#include "lab/labingestor.h"
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startup;
+    startup.start();
     QApplication a(argc, argv);
 
     QString err;
@@ -15,7 +24,45 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    HistoryLogger::start();
+
+    // 启动一分钟后跑第一遍归档，之后每 6 小时一次。
+    HistoryArchiver archiver;
+    archiver.schedule(60 * 1000, 6 * 60 * 60 * 1000);
+
+    // 自动备份：启动十分钟后第一次，之后按 hospital.ini 中的间隔。
+    BackupManager backup;
+    if (const int hours = BackupManager::intervalHours(); hours > 0) {
+        backup.schedule(10 * 60 * 1000, qMin(hours, 24 * 7) * 60 * 60 * 1000);
+    }
+
+    // 分析用列式快照：默认不导出，hospital.ini 的 Snapshot/IntervalHours 打开；首次在启动半小时后。
+    SnapshotExporter snapshot;
+    if (const int hours = SnapshotExporter::intervalHours(); hours > 0) {
+        snapshot.schedule(30 * 60 * 1000, qMin(hours, 24 * 7) * 60 * 60 * 1000);
+    }
+
+    // 检验结果接收：hospital.ini 的 Lab/Enabled 打开后监视收件目录和本地套接字。
+    LabIngestor lab;
+    if (LabIngestor::enabled()) {
+        QString labErr;
+        if (!lab.start(&labErr)) {
+            qWarning("LabIngestor: %s", qPrintable(labErr));
+        }
+    }
+
     MainWindow w;
     w.show();
-    return a.exec();
+    // 事件循环处理完首次显示后登录界面即可操作。
+    QTimer::singleShot(0, &w, [&startup] {
+        qInfo("Startup: login page interactive in %lld ms", static_cast<long long>(startup.elapsed()));
+    });
+    const int rc = a.exec();
+
+    lab.stop();
+    snapshot.stop();
+    backup.stop();
+    archiver.stop();
+    HistoryLogger::shutdown();
+    return rc;
 }
@@ -1,6 +1,7 @@
 #include "mainwindow.h"
 
 #include "appinfo.h"
+#include "db/dbmanager.h"
 #include "ui/homepage.h"
 #include "ui/loginpage.h"
 #include "ui/doctorpage.h"
@@ -9,6 +10,7 @@
 #include "ui/patientpage.h"
 
 #include <QAction>
+#include <QElapsedTimer>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QMessageBox>
@@ -21,6 +23,23 @@
 #include <QSizePolicy>
 #include <QWidget>
 #include <QMenu>
+#include <QSettings>
+#include <QTimer>
+
+// 登录后等界面稳定再开始预热，之后每隔一小段时间建一个页面，避免连续占用界面线程。
+static constexpr int kPrewarmDelayMs = 500;
+static constexpr int kPrewarmStepMs = 50;
+
+template <typename PageT>
+static PageT* createPage(QStackedWidget* stack, const char* name)
+{
+    QElapsedTimer timer;
+    timer.start();
+    auto* page = new PageT(stack);
+    stack->addWidget(page);
+    qInfo("MainWindow: %s page built in %lld ms", name, static_cast<long long>(timer.elapsed()));
+    return page;
+}
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
@@ -38,17 +57,9 @@ void MainWindow::buildUi()
 
     m_login = new LoginPage(this);
     m_home = new HomePage(this);
-    m_patients = new PatientPage(this);
-    m_doctors = new DoctorPage(this);
-    m_departments = new DepartmentPage(this);
-    m_history = new HistoryPage(this);
 
     m_stack->addWidget(m_login);
     m_stack->addWidget(m_home);
-    m_stack->addWidget(m_patients);
-    m_stack->addWidget(m_doctors);
-    m_stack->addWidget(m_departments);
-    m_stack->addWidget(m_history);
 
     auto* tb = addToolBar(QStringLiteral("Main"));
     tb->setMovable(false);
@@ -110,11 +121,26 @@ void MainWindow::buildUi()
     statusBar()->addPermanentWidget(m_statusLabel);
 
     connect(m_login, &LoginPage::loginSucceeded, this, [this](const UserInfo& u) {
+        QElapsedTimer timer;
+        timer.start();
         m_user = u;
-        m_patients->setCurrentUserId(u.id);
-        m_doctors->setCurrentUserId(u.id);
-        m_departments->setCurrentUserId(u.id);
+        if (m_patients) {
+            m_patients->setCurrentUserId(u.id);
+        }
+        if (m_doctors) {
+            m_doctors->setCurrentUserId(u.id);
+        }
+        if (m_departments) {
+            m_departments->setCurrentUserId(u.id);
+        }
         setPage(Page::Home);
+        qInfo("MainWindow: home interactive %lld ms after login", static_cast<long long>(timer.elapsed()));
+
+        QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+        if (settings.value(QStringLiteral("Startup/Prewarm"), true).toBool()) {
+            m_prewarm = {Page::Patients, Page::Doctors, Page::Departments, Page::History};
+            QTimer::singleShot(kPrewarmDelayMs, this, &MainWindow::prewarmNext);
+        }
     });
     connect(m_home, &HomePage::openPatients, this, [this] { setPage(Page::Patients); });
     connect(m_home, &HomePage::openDoctors, this, [this] { setPage(Page::Doctors); });
@@ -132,22 +158,95 @@ void MainWindow::setPage(Page p)
         m_stack->setCurrentWidget(m_home);
         break;
     case Page::Patients:
-        m_stack->setCurrentWidget(m_patients);
+        m_stack->setCurrentWidget(patientPage());
         break;
     case Page::Doctors:
-        m_stack->setCurrentWidget(m_doctors);
+        m_stack->setCurrentWidget(doctorPage());
         break;
     case Page::Departments:
-        m_stack->setCurrentWidget(m_departments);
+        m_stack->setCurrentWidget(departmentPage());
         break;
     case Page::History:
-        m_history->refresh();
+        historyPage()->catchUp();
         m_stack->setCurrentWidget(m_history);
         break;
     }
     updateChrome();
 }
 
+PatientPage* MainWindow::patientPage()
+{
+    if (!m_patients) {
+        m_patients = createPage<PatientPage>(m_stack, "patient");
+        m_patients->setCurrentUserId(m_user.id);
+    }
+    return m_patients;
+}
+
+DoctorPage* MainWindow::doctorPage()
+{
+    if (!m_doctors) {
+        m_doctors = createPage<DoctorPage>(m_stack, "doctor");
+        m_doctors->setCurrentUserId(m_user.id);
+    }
+    return m_doctors;
+}
+
+DepartmentPage* MainWindow::departmentPage()
+{
+    if (!m_departments) {
+        m_departments = createPage<DepartmentPage>(m_stack, "department");
+        m_departments->setCurrentUserId(m_user.id);
+    }
+    return m_departments;
+}
+
+HistoryPage* MainWindow::historyPage()
+{
+    if (!m_history) {
+        m_history = createPage<HistoryPage>(m_stack, "history");
+    }
+    return m_history;
+}
+
+void MainWindow::prewarmNext()
+{
+    // 退出登录后不再继续；已经进入过的页面直接跳过。
+    while (!m_prewarm.isEmpty() && m_page != Page::Login) {
+        switch (m_prewarm.takeFirst()) {
+        case Page::Patients:
+            if (m_patients) {
+                continue;
+            }
+            patientPage();
+            break;
+        case Page::Doctors:
+            if (m_doctors) {
+                continue;
+            }
+            doctorPage();
+            break;
+        case Page::Departments:
+            if (m_departments) {
+                continue;
+            }
+            departmentPage();
+            break;
+        case Page::History:
+            if (m_history) {
+                continue;
+            }
+            historyPage();
+            break;
+        default:
+            continue;
+        }
+        QTimer::singleShot(kPrewarmStepMs, this, &MainWindow::prewarmNext);
+        return;
+    }
+    m_prewarm.clear();
+}
+
 void MainWindow::updateChrome()
 {
     const bool loggedIn = (m_page != Page::Login);
@@ -27,12 +27,19 @@ private:
 
     void buildUi();
     void setPage(Page p);
+    // 业务页面在第一次进入时才创建（构造时各自加载数据）；登录后可在空闲时依次预热。
+    PatientPage* patientPage();
+    DoctorPage* doctorPage();
+    DepartmentPage* departmentPage();
+    HistoryPage* historyPage();
+    void prewarmNext();
     void updateChrome();
 
     void onLogout();
 
     Page m_page = Page::Login;
     UserInfo m_user;
+    QList<Page> m_prewarm;
 
     QStackedWidget* m_stack = nullptr;
     LoginPage* m_login = nullptr;
@@ -0,0 +1,389 @@
+#include "compactrowstore.h"
+
+#include "models/stringpool.h"
+
+#include <QDate>
+#include <QSqlQuery>
+#include <QTime>
+
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr qint16 kNull16 = std::numeric_limits<qint16>::min();
+constexpr qint32 kNull32 = std::numeric_limits<qint32>::min();
+constexpr qint64 kNull64 = std::numeric_limits<qint64>::min();
+constexpr qint64 kMsPerDay = 24 * 60 * 60 * 1000;
+
+using ColumnType = CompactRowStore::ColumnType;
+
+bool isInteger(const QVariant& v)
+{
+    switch (v.typeId()) {
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        return true;
+    default:
+        return false;
+    }
+}
+
+QString dateText(qint64 julianDay)
+{
+    return QDate::fromJulianDay(julianDay).toString(Qt::ISODate);
+}
+
+QString dateTimeText(qint64 v)
+{
+    return dateText(v / kMsPerDay) + QLatin1Char('T')
+        + QTime::fromMSecsSinceStartOfDay(static_cast<int>(v % kMsPerDay)).toString(Qt::ISODate);
+}
+
+// 各类型落在哪个定宽数组里。
+enum class Width { W16, W32, W64 };
+
+Width widthOf(ColumnType type)
+{
+    switch (type) {
+    case ColumnType::Int16:
+        return Width::W16;
+    case ColumnType::Int64:
+    case ColumnType::DateTime:
+        return Width::W64;
+    default:
+        return Width::W32;
+    }
+}
+
+}
+
+CompactRowStore::CompactRowStore(const QVector<Column>& columns, StringPool* pool)
+    : m_columns(columns), m_pool(pool ? pool : &StringPool::shared())
+{
+    clear();
+}
+
+int CompactRowStore::columnIndex(const QString& name) const
+{
+    for (int i = 0; i < m_columns.size(); ++i) {
+        if (m_columns.at(i).name.compare(name, Qt::CaseInsensitive) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void CompactRowStore::clear()
+{
+    m_rows = 0;
+    m_data = QVector<ColumnData>(m_columns.size());
+    for (int c = 0; c < m_columns.size(); ++c) {
+        if (m_columns.at(c).type == ColumnType::Text) {
+            m_data[c].offsets.append(0);
+        }
+    }
+}
+
+void CompactRowStore::reserve(int rows)
+{
+    for (int c = 0; c < m_columns.size(); ++c) {
+        auto& d = m_data[c];
+        const auto type = m_columns.at(c).type;
+        if (type == ColumnType::Text) {
+            d.offsets.reserve(rows + 1);
+            d.nulls.reserve(rows / 8 + 1);
+            continue;
+        }
+        switch (widthOf(type)) {
+        case Width::W16:
+            d.i16.reserve(rows);
+            break;
+        case Width::W32:
+            d.i32.reserve(rows);
+            break;
+        case Width::W64:
+            d.i64.reserve(rows);
+            break;
+        }
+    }
+}
+
+void CompactRowStore::squeeze()
+{
+    for (auto& d : m_data) {
+        d.i16.squeeze();
+        d.i32.squeeze();
+        d.i64.squeeze();
+        d.text.squeeze();
+        d.offsets.squeeze();
+        d.nulls.squeeze();
+    }
+}
+
+bool CompactRowStore::encode(ColumnType type, const QVariant& v, qint64* out) const
+{
+    switch (type) {
+    case ColumnType::Int16:
+    case ColumnType::Int32:
+    case ColumnType::Int64: {
+        if (!isInteger(v)
+            || (v.typeId() == QMetaType::ULongLong && v.toULongLong() > quint64(std::numeric_limits<qint64>::max()))) {
+            return false;
+        }
+        const qint64 n = v.toLongLong();
+        const qint64 lo = type == ColumnType::Int16 ? kNull16 : type == ColumnType::Int32 ? kNull32 : kNull64;
+        const qint64 hi = type == ColumnType::Int16 ? std::numeric_limits<qint16>::max()
+            : type == ColumnType::Int32           ? std::numeric_limits<qint32>::max()
+                                                   : std::numeric_limits<qint64>::max();
+        if (n <= lo || n > hi) {
+            return false;
+        }
+        *out = n;
+        return true;
+    }
+    case ColumnType::Decimal1: {
+        if (v.typeId() != QMetaType::Double) {
+            return false;
+        }
+        const double d = v.toDouble();
+        if (!std::isfinite(d) || std::fabs(d) >= 2.0e8) {
+            return false;
+        }
+        const qint64 tenths = qRound64(d * 10.0);
+        if (static_cast<double>(tenths) / 10.0 != d) {
+            return false;
+        }
+        *out = tenths;
+        return true;
+    }
+    case ColumnType::Date: {
+        if (v.typeId() != QMetaType::QString) {
+            return false;
+        }
+        const auto s = v.toString();
+        const auto date = QDate::fromString(s, Qt::ISODate);
+        if (!date.isValid() || date.toJulianDay() <= kNull32 || date.toJulianDay() > std::numeric_limits<qint32>::max()) {
+            return false;
+        }
+        *out = date.toJulianDay();
+        return dateText(*out) == s;
+    }
+    case ColumnType::DateTime: {
+        if (v.typeId() != QMetaType::QString) {
+            return false;
+        }
+        const auto s = v.toString();
+        if (s.size() != 19 || s.at(10) != QLatin1Char('T')) {
+            return false;
+        }
+        const auto date = QDate::fromString(s.left(10), Qt::ISODate);
+        const auto time = QTime::fromString(s.mid(11), Qt::ISODate);
+        if (!date.isValid() || !time.isValid() || date.toJulianDay() < 0) {
+            return false;
+        }
+        *out = date.toJulianDay() * kMsPerDay + time.msecsSinceStartOfDay();
+        return dateTimeText(*out) == s;
+    }
+    case ColumnType::Interned:
+    case ColumnType::Text:
+        break;
+    }
+    return false;
+}
+
+void CompactRowStore::appendRow(const QSqlQuery& query)
+{
+    for (int c = 0; c < m_columns.size(); ++c) {
+        appendValue(c, query.value(c));
+    }
+    ++m_rows;
+}
+
+void CompactRowStore::appendRow(const QVariantList& values)
+{
+    for (int c = 0; c < m_columns.size(); ++c) {
+        appendValue(c, c < values.size() ? values.at(c) : QVariant());
+    }
+    ++m_rows;
+}
+
+void CompactRowStore::appendValue(int column, const QVariant& v)
+{
+    auto& d = m_data[column];
+    const auto type = m_columns.at(column).type;
+    const int row = m_rows;
+
+    if (type == ColumnType::Text) {
+        if (row % 8 == 0) {
+            d.nulls.append('\0');
+        }
+        if (v.isNull()) {
+            d.nulls[row / 8] = static_cast<char>(d.nulls.at(row / 8) | (1 << (row % 8)));
+        } else if (v.typeId() == QMetaType::QString) {
+            const auto utf8 = v.toString().toUtf8();
+            if (d.text.size() + utf8.size() <= std::numeric_limits<quint32>::max()) {
+                d.text.append(utf8);
+            } else {
+                d.spill.insert(row, v);
+            }
+        } else {
+            d.spill.insert(row, v);
+        }
+        d.offsets.append(static_cast<quint32>(d.text.size()));
+        return;
+    }
+
+    if (type == ColumnType::Interned) {
+        quint32 id = StringPool::kNullId;
+        if (!v.isNull() && v.typeId() == QMetaType::QString) {
+            id = m_pool->intern(v.toString());
+        } else if (!v.isNull()) {
+            d.spill.insert(row, v);
+        }
+        d.i32.append(static_cast<qint32>(id));
+        return;
+    }
+
+    qint64 n = 0;
+    const bool encoded = !v.isNull() && encode(type, v, &n);
+    if (!v.isNull() && !encoded) {
+        d.spill.insert(row, v);
+    }
+    switch (widthOf(type)) {
+    case Width::W16:
+        d.i16.append(encoded ? static_cast<qint16>(n) : kNull16);
+        break;
+    case Width::W32:
+        d.i32.append(encoded ? static_cast<qint32>(n) : kNull32);
+        break;
+    case Width::W64:
+        d.i64.append(encoded ? n : kNull64);
+        break;
+    }
+}
+
+void CompactRowStore::setValue(int row, int column, const QVariant& v)
+{
+    if (row < 0 || row >= m_rows || column < 0 || column >= m_columns.size()) {
+        return;
+    }
+    auto& d = m_data[column];
+    const auto type = m_columns.at(column).type;
+    d.spill.remove(row);
+
+    // 文本缓冲是连续的，改过的值不回写缓冲。
+    if (type == ColumnType::Text) {
+        d.spill.insert(row, v);
+        return;
+    }
+
+    if (type == ColumnType::Interned) {
+        quint32 id = StringPool::kNullId;
+        if (!v.isNull() && v.typeId() == QMetaType::QString) {
+            id = m_pool->intern(v.toString());
+        } else if (!v.isNull()) {
+            d.spill.insert(row, v);
+        }
+        d.i32[row] = static_cast<qint32>(id);
+        return;
+    }
+
+    qint64 n = 0;
+    const bool encoded = !v.isNull() && encode(type, v, &n);
+    if (!v.isNull() && !encoded) {
+        d.spill.insert(row, v);
+    }
+    switch (widthOf(type)) {
+    case Width::W16:
+        d.i16[row] = encoded ? static_cast<qint16>(n) : kNull16;
+        break;
+    case Width::W32:
+        d.i32[row] = encoded ? static_cast<qint32>(n) : kNull32;
+        break;
+    case Width::W64:
+        d.i64[row] = encoded ? n : kNull64;
+        break;
+    }
+}
+
+QVariant CompactRowStore::value(int row, int column) const
+{
+    if (row < 0 || row >= m_rows || column < 0 || column >= m_columns.size()) {
+        return {};
+    }
+    const auto& d = m_data.at(column);
+    if (!d.spill.isEmpty()) {
+        const auto it = d.spill.constFind(row);
+        if (it != d.spill.constEnd()) {
+            return it.value();
+        }
+    }
+
+    switch (m_columns.at(column).type) {
+    case ColumnType::Int16: {
+        const auto v = d.i16.at(row);
+        return v == kNull16 ? QVariant() : QVariant(static_cast<qlonglong>(v));
+    }
+    case ColumnType::Int32: {
+        const auto v = d.i32.at(row);
+        return v == kNull32 ? QVariant() : QVariant(static_cast<qlonglong>(v));
+    }
+    case ColumnType::Int64: {
+        const auto v = d.i64.at(row);
+        return v == kNull64 ? QVariant() : QVariant(static_cast<qlonglong>(v));
+    }
+    case ColumnType::Decimal1: {
+        const auto v = d.i32.at(row);
+        return v == kNull32 ? QVariant() : QVariant(static_cast<double>(v) / 10.0);
+    }
+    case ColumnType::Date: {
+        const auto v = d.i32.at(row);
+        return v == kNull32 ? QVariant() : QVariant(dateText(v));
+    }
+    case ColumnType::DateTime: {
+        const auto v = d.i64.at(row);
+        return v == kNull64 ? QVariant() : QVariant(dateTimeText(v));
+    }
+    case ColumnType::Interned: {
+        const auto id = static_cast<quint32>(d.i32.at(row));
+        return id == StringPool::kNullId ? QVariant() : QVariant(m_pool->at(id));
+    }
+    case ColumnType::Text: {
+        if (d.nulls.at(row / 8) & (1 << (row % 8))) {
+            return {};
+        }
+        const auto begin = d.offsets.at(row);
+        const auto end = d.offsets.at(row + 1);
+        return QString::fromUtf8(d.text.constData() + begin, static_cast<qsizetype>(end - begin));
+    }
+    }
+    return {};
+}
+
+qint64 CompactRowStore::byteSize() const
+{
+    qint64 bytes = 0;
+    for (const auto& d : m_data) {
+        bytes += static_cast<qint64>(d.i16.capacity()) * static_cast<qint64>(sizeof(qint16));
+        bytes += static_cast<qint64>(d.i32.capacity()) * static_cast<qint64>(sizeof(qint32));
+        bytes += static_cast<qint64>(d.i64.capacity()) * static_cast<qint64>(sizeof(qint64));
+        bytes += static_cast<qint64>(d.text.capacity());
+        bytes += static_cast<qint64>(d.offsets.capacity()) * static_cast<qint64>(sizeof(quint32));
+        bytes += static_cast<qint64>(d.nulls.capacity());
+        // 另存的值按 QHash 节点的大致大小计。
+        bytes += static_cast<qint64>(d.spill.size()) * static_cast<qint64>(sizeof(int) + sizeof(QVariant) + 2 * sizeof(void*));
+    }
+    return bytes;
+}
+
+double CompactRowStore::bytesPerRow() const
+{
+    if (m_rows == 0) {
+        return 0.0;
+    }
+    // 共享字典按整池计入，多个表共用时会偏保守。
+    return static_cast<double>(byteSize() + m_pool->byteSize()) / static_cast<double>(m_rows);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+class QSqlQuery;
+class StringPool;
+
+// 面向整表常驻的紧凑列存：数值定宽、日期存整数、低基数文本走 StringPool 字典编码，
+// 高基数文本放进每列一块 UTF-8 缓冲。取代 QSqlQueryModel 按行缓存的 QVariant。
+// 编码后不能原样还原的值（类型不符、超出范围、非规范格式）以及编辑过的文本按行号另存，
+// 所以 value() 读回的总是写入时的值。
+class CompactRowStore final
+{
+public:
+    enum class ColumnType {
+        Int16,    // 性别、年龄等小整数
+        Int32,
+        Int64,    // 毫秒时间戳等
+        Decimal1, // 一位小数的实数（身高体重），存十分之一的整数
+        Date,     // ISO 日期 yyyy-MM-dd -> Julian Day
+        DateTime, // ISO 时间 yyyy-MM-ddTHH:mm:ss -> Julian Day * 86400000 + 当天毫秒，不涉及时区
+        Interned, // 低基数文本 -> StringPool 编号
+        Text,     // 高基数文本 -> UTF-8 连续缓冲 + 偏移
+    };
+
+    struct Column
+    {
+        QString name;
+        ColumnType type = ColumnType::Text;
+    };
+
+    explicit CompactRowStore(const QVector<Column>& columns = {}, StringPool* pool = nullptr);
+
+    const QVector<Column>& columns() const { return m_columns; }
+    int columnIndex(const QString& name) const;
+
+    int rowCount() const { return m_rows; }
+    int columnCount() const { return m_columns.size(); }
+
+    void clear();
+    void reserve(int rows);
+    // 读完后释放各列数组多余的容量。
+    void squeeze();
+
+    // 读 query 的当前行，列顺序与 columns() 一致。
+    void appendRow(const QSqlQuery& query);
+    void appendRow(const QVariantList& values);
+    void setValue(int row, int column, const QVariant& v);
+
+    QVariant value(int row, int column) const;
+
+    qint64 byteSize() const;
+    // 共享字典按整池计入。
+    double bytesPerRow() const;
+
+private:
+    struct ColumnData
+    {
+        QVector<qint16> i16;
+        QVector<qint32> i32;
+        QVector<qint64> i64;
+        QByteArray text;
+        QVector<quint32> offsets;
+        QByteArray nulls; // Text 列的 NULL 位图
+        QHash<int, QVariant> spill;
+    };
+
+    void appendValue(int column, const QVariant& v);
+    // 定宽列：能原样还原时写入 *out 并返回 true。
+    bool encode(ColumnType type, const QVariant& v, qint64* out) const;
+
+    QVector<Column> m_columns;
+    QVector<ColumnData> m_data;
+    StringPool* m_pool = nullptr;
+    int m_rows = 0;
+};
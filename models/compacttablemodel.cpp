@@ -0,0 +1,207 @@
+#include "compacttablemodel.h"
+
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlIndex>
+
+CompactTableModel::CompactTableModel(const QString& table,
+                                     const QHash<QString, CompactRowStore::ColumnType>& types,
+                                     QObject* parent)
+    : QSqlTableModel(parent)
+{
+    setTable(table);
+    setEditStrategy(QSqlTableModel::OnFieldChange);
+
+    QVector<CompactRowStore::Column> columns;
+    const auto rec = record();
+    for (int i = 0; i < rec.count(); ++i) {
+        columns.append({rec.fieldName(i), types.value(rec.fieldName(i).toUpper(), CompactRowStore::ColumnType::Text)});
+    }
+    m_store = CompactRowStore(columns);
+}
+
+bool CompactTableModel::select()
+{
+    const auto sql = selectStatement();
+    if (sql.isEmpty()) {
+        return false;
+    }
+
+    beginResetModel();
+    m_store.clear();
+    m_query = QSqlQuery(database());
+    m_query.setForwardOnly(true);
+    const bool ok = m_query.exec(sql);
+    setLastError(ok ? QSqlError() : m_query.lastError());
+    m_atEnd = !ok;
+    if (ok) {
+        fetchRows(kFetchBatch);
+    }
+    m_rowCount = m_store.rowCount();
+    endResetModel();
+    return ok;
+}
+
+void CompactTableModel::fetchRows(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        if (!m_query.next()) {
+            if (m_query.lastError().isValid()) {
+                setLastError(m_query.lastError());
+            }
+            m_query.finish();
+            m_atEnd = true;
+            m_store.squeeze();
+            qInfo("%s: %d rows resident, %.1f bytes/row", qPrintable(tableName()), m_store.rowCount(),
+                  m_store.bytesPerRow());
+            return;
+        }
+        m_store.appendRow(m_query);
+    }
+}
+
+bool CompactTableModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && !m_atEnd;
+}
+
+void CompactTableModel::fetchMore(const QModelIndex& parent)
+{
+    if (parent.isValid() || m_atEnd) {
+        return;
+    }
+    // 读多少行事先不知道，先读进列存，rowCount() 在通知视图后才放出新行。
+    fetchRows(kFetchBatch);
+    if (m_store.rowCount() > m_rowCount) {
+        beginInsertRows({}, m_rowCount, m_store.rowCount() - 1);
+        m_rowCount = m_store.rowCount();
+        endInsertRows();
+    }
+}
+
+int CompactTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_rowCount;
+}
+
+QVariant CompactTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rowCount || (role != Qt::DisplayRole && role != Qt::EditRole)) {
+        return {};
+    }
+    return m_store.value(index.row(), index.column());
+}
+
+QSqlRecord CompactTableModel::record(int row) const
+{
+    auto rec = record();
+    if (row < 0 || row >= m_rowCount) {
+        return rec;
+    }
+    for (int c = 0; c < rec.count(); ++c) {
+        rec.setValue(c, m_store.value(row, c));
+    }
+    return rec;
+}
+
+QSqlRecord CompactTableModel::keyValues(int row) const
+{
+    QSqlRecord key = primaryKey().isEmpty() ? record() : QSqlRecord(primaryKey());
+    for (int i = 0; i < key.count(); ++i) {
+        key.setValue(i, m_store.value(row, fieldIndex(key.fieldName(i))));
+    }
+    return key;
+}
+
+bool CompactTableModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (role != Qt::EditRole || !index.isValid() || index.row() >= m_rowCount || !(flags(index) & Qt::ItemIsEditable)) {
+        return false;
+    }
+
+    auto values = record();
+    for (int c = 0; c < values.count(); ++c) {
+        values.setGenerated(c, false);
+    }
+    values.setValue(index.column(), value);
+    values.setGenerated(index.column(), true);
+    if (!updateRowInTable(index.row(), values)) {
+        return false;
+    }
+
+    // 库里按列亲和性转换后的值以重读为准；改的是主键时按旧键找不到，直接用写入的值。
+    if (!selectRow(index.row())) {
+        m_store.setValue(index.row(), index.column(), value);
+        emit dataChanged(index, index);
+    }
+    return true;
+}
+
+bool CompactTableModel::selectRow(int row)
+{
+    if (row < 0 || row >= m_rowCount) {
+        return false;
+    }
+
+    const auto key = keyValues(row);
+    auto* driver = database().driver();
+    const auto sql = driver->sqlStatement(QSqlDriver::SelectStatement, tableName(), record(), false)
+        + QLatin1Char(' ') + driver->sqlStatement(QSqlDriver::WhereStatement, tableName(), key, true);
+
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    if (!q.prepare(sql)) {
+        setLastError(q.lastError());
+        return false;
+    }
+    for (int i = 0; i < key.count(); ++i) {
+        if (!key.isNull(i)) {
+            q.addBindValue(key.value(i));
+        }
+    }
+    if (!q.exec()) {
+        setLastError(q.lastError());
+        return false;
+    }
+    if (!q.next()) {
+        return false;
+    }
+    for (int c = 0; c < m_store.columnCount(); ++c) {
+        m_store.setValue(row, c, q.value(c));
+    }
+    emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+    return true;
+}
+
+bool CompactTableModel::updateRowInTable(int row, const QSqlRecord& values)
+{
+    const auto key = keyValues(row);
+    auto* driver = database().driver();
+    const auto set = driver->sqlStatement(QSqlDriver::UpdateStatement, tableName(), values, true);
+    const auto where = driver->sqlStatement(QSqlDriver::WhereStatement, tableName(), key, true);
+    if (set.isEmpty() || where.isEmpty()) {
+        setLastError(QSqlError(QStringLiteral("没有要更新的字段或主键"), {}, QSqlError::StatementError));
+        return false;
+    }
+
+    QSqlQuery q(database());
+    if (!q.prepare(set + QLatin1Char(' ') + where)) {
+        setLastError(q.lastError());
+        return false;
+    }
+    for (int i = 0; i < values.count(); ++i) {
+        if (values.isGenerated(i)) {
+            q.addBindValue(values.value(i));
+        }
+    }
+    for (int i = 0; i < key.count(); ++i) {
+        if (!key.isNull(i)) {
+            q.addBindValue(key.value(i));
+        }
+    }
+    if (!q.exec()) {
+        setLastError(q.lastError());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "models/compactrowstore.h"
+
+#include <QHash>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlTableModel>
+
+// 行数据放在 CompactRowStore 里的 QSqlTableModel：select 用只进查询分批读入紧凑列存，
+// 基类只负责表结构、过滤、排序和表头，不再持有查询结果。
+// 只支持 OnFieldChange 下的单元格编辑（写库后重读该行）；增删行由页面直接写库后 select()。
+class CompactTableModel : public QSqlTableModel
+{
+    Q_OBJECT
+
+public:
+    using QSqlTableModel::record;
+
+    bool select() override;
+    bool selectRow(int row) override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    bool canFetchMore(const QModelIndex& parent = QModelIndex()) const override;
+    void fetchMore(const QModelIndex& parent = QModelIndex()) override;
+
+    // 带取值的整行；基类的同名函数读的是这里不用的查询。
+    QSqlRecord record(int row) const;
+
+    double bytesPerRow() const { return m_store.bytesPerRow(); }
+
+protected:
+    // types 按大写列名给出编码方式，没列出的列按高基数文本存。
+    CompactTableModel(const QString& table, const QHash<QString, CompactRowStore::ColumnType>& types, QObject* parent);
+
+    const CompactRowStore& store() const { return m_store; }
+    // 按主键更新一行，只写 values 里 generated 的字段。
+    bool updateRowInTable(int row, const QSqlRecord& values) override;
+
+private:
+    static constexpr int kFetchBatch = 256;
+
+    void fetchRows(int count);
+    QSqlRecord keyValues(int row) const;
+
+    CompactRowStore m_store;
+    QSqlQuery m_query;
+    int m_rowCount = 0;
+    bool m_atEnd = true;
+};
@@ -1,17 +1,13 @@
 #include "doctormodel.h"
 
-#include <QSqlRelation>
+#include "db/lookupcache.h"
 
 DoctorModel::DoctorModel(QObject* parent)
-    : QSqlRelationalTableModel(parent)
+    : CompactTableModel(QStringLiteral("Doctor"),
+                        {{QStringLiteral("DEPARTMENT_ID"), CompactRowStore::ColumnType::Interned}},
+                        parent)
 {
-    setTable(QStringLiteral("Doctor"));
-    setEditStrategy(QSqlTableModel::OnFieldChange);
-
-    const int deptCol = fieldIndex(QStringLiteral("DEPARTMENT_ID"));
-    if (deptCol >= 0) {
-        setRelation(deptCol, QSqlRelation(QStringLiteral("Department"), QStringLiteral("ID"), QStringLiteral("NAME")));
-    }
+    m_departmentColumn = fieldIndex(QStringLiteral("DEPARTMENT_ID"));
 
     select();
 
@@ -21,6 +17,25 @@ DoctorModel::DoctorModel(QObject* parent)
     setHeaderData(fieldIndex(QStringLiteral("DEPARTMENT_ID")), Qt::Horizontal, QStringLiteral("科室"));
 }
 
+bool DoctorModel::select()
+{
+    LookupCache::departments().refresh();
+    return CompactTableModel::select();
+}
+
+QVariant DoctorModel::data(const QModelIndex& index, int role) const
+{
+    if (role == Qt::DisplayRole && index.isValid() && index.column() == m_departmentColumn) {
+        const auto id = CompactTableModel::data(index, Qt::EditRole).toString();
+        if (id.isEmpty()) {
+            return {};
+        }
+        const auto name = LookupCache::departments().valueOf(id);
+        return name.isEmpty() ? id : name;
+    }
+    return CompactTableModel::data(index, role);
+}
+
 QString DoctorModel::escapeLike(const QString& text)
 {
     QString s = text;
@@ -43,4 +58,3 @@ void DoctorModel::setKeywordFilter(const QString& keyword)
     setFilter(QStringLiteral("(EMPLOYEENO LIKE '%1' ESCAPE '\\' OR NAME LIKE '%1' ESCAPE '\\')").arg(like));
     select();
 }
-
@@ -1,17 +1,25 @@
 #pragma once
 
-#include <QSqlRelationalTableModel>
+#include "models/compacttablemodel.h"
 
-class DoctorModel final : public QSqlRelationalTableModel
+// 科室列存 DEPARTMENT_ID，显示时通过 LookupCache 把 ID 换成名称，select 只扫 Doctor 单表。
+// 行数据在 CompactRowStore 里，DEPARTMENT_ID 走共享字符串池。
+class DoctorModel final : public CompactTableModel
 {
     Q_OBJECT
 
 public:
     explicit DoctorModel(QObject* parent = nullptr);
 
+    bool select() override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
     void setKeywordFilter(const QString& keyword);
 
+    int departmentColumn() const { return m_departmentColumn; }
+
 private:
     static QString escapeLike(const QString& text);
-};
 
+    int m_departmentColumn = -1;
+};
@@ -0,0 +1,584 @@
+#include "historymodel.h"
+
+#include "db/historyarchiver.h"
+#include "db/historylogger.h"
+#include "db/historysearch.h"
+#include "db/lookupcache.h"
+#include "db/streamingloader.h"
+
+#include <QDateTime>
+#include <QStringList>
+#include <QTimer>
+
+#include <utility>
+
+enum Column { ColId, ColUser, ColEvent, ColTime, ColCount };
+
+// 长时间未刷新时新记录可能很多，超过上限就整页重载，避免一次插入过多行。
+static constexpr int kTailLimit = 5000;
+
+// SQLite 默认最多同时挂 10 个库，留出余量。
+static constexpr int kMaxArchives = 8;
+// 按相关度排序时参与打分的最新命中数。
+static constexpr int kRankCandidates = 5000;
+// 日志文件模式下每次同步扫描的记录上限，过滤条件很严时分多次在事件循环里扫完，不卡界面。
+static constexpr int kJournalScanBudget = 50000;
+
+// 日志文件模式的关键字：空格分隔的各项都要出现在原始 UTF-8 字节里。
+static QList<QByteArray> journalTerms(const QString& keyword)
+{
+    QList<QByteArray> terms;
+    for (const auto& term : keyword.split(QLatin1Char(' '), Qt::SkipEmptyParts)) {
+        terms << term.toUtf8();
+    }
+    return terms;
+}
+
+HistoryModel::HistoryModel(QObject* parent)
+    : QAbstractTableModel(parent), m_loader(new StreamingLoader(this)), m_tailLoader(new StreamingLoader(this))
+{
+    connect(m_loader, &StreamingLoader::rowsReady, this, &HistoryModel::onRows);
+    connect(m_loader, &StreamingLoader::finished, this, &HistoryModel::onFinished);
+    connect(m_tailLoader, &StreamingLoader::rowsReady, this, [this](const QVector<QVariantList>& rows) {
+        m_pendingTail += convertRows(rows);
+    });
+    connect(m_tailLoader, &StreamingLoader::finished, this, &HistoryModel::onTailFinished);
+}
+
+void HistoryModel::setFilter(const Filter& filter)
+{
+    m_filter = filter;
+    reload();
+}
+
+void HistoryModel::reload()
+{
+    m_loader->cancel();
+    m_tailLoader->cancel();
+    ++m_generation;
+
+    beginResetModel();
+    m_rows.clear();
+    m_pendingTail.clear();
+    m_lastId = 0;
+    m_lastTs = 0;
+    m_maxId = 0;
+    m_atEnd = false;
+    m_loaded = true;
+    m_tailPending = false;
+    endResetModel();
+
+    LookupCache::users().refresh();
+    LookupCache::historyTemplates().refresh();
+
+    if (HistoryLogger::backend() == HistoryLogger::Backend::Journal) {
+        if (!m_journal) {
+            m_journal = std::make_unique<AuditJournalReader>(HistoryLogger::journalDir());
+        }
+        QString err;
+        if (!m_journal->refresh(&err)) {
+            emit loadFailed(err);
+        }
+        if (m_filter.byRelevance && !m_filter.keyword.trimmed().isEmpty()) {
+            emit notice(QStringLiteral("日志文件模式不支持按相关度排序，按时间倒序显示"));
+        }
+        m_attachments.clear();
+        m_tailPos = m_journal->end();
+        m_scanPos = m_filter.toMs > 0 ? m_journal->seekTime(m_filter.toMs) : m_tailPos;
+        startPage();
+        return;
+    }
+    m_journal.reset();
+
+    // 不指定时间范围时只看主库里的近期记录。
+    QStringList attachments;
+    if (m_filter.hasRange()) {
+        QString err;
+        const auto archives = HistoryArchiver::archivesInRange(m_filter.fromMs, m_filter.toMs, &err);
+        if (!err.isEmpty()) {
+            emit loadFailed(err);
+        }
+        for (const auto& a : archives) {
+            if (attachments.size() == kMaxArchives) {
+                emit notice(QStringLiteral("时间范围跨越 %1 个归档月份，只查询最近的 %2 个").arg(archives.size()).arg(kMaxArchives));
+                break;
+            }
+            attachments << a.path;
+        }
+    }
+    m_attachments = attachments;
+    m_loader->setAttachments(attachments);
+
+    startPage();
+}
+
+void HistoryModel::cancel()
+{
+    m_loader->cancel();
+}
+
+void HistoryModel::refreshTail()
+{
+    if (!m_loaded) {
+        reload();
+        return;
+    }
+    // 新记录可能来自刚注册的用户、刚用上的模板；表版本没变时 refresh 只查一次版本号。
+    LookupCache::users().refresh();
+    LookupCache::historyTemplates().refresh();
+    if (m_journal) {
+        refreshJournalTail();
+        return;
+    }
+    // 按相关度排序时新记录没有固定位置，不做增量。
+    if (m_filter.byRelevance && HistorySearch::isAvailable() && !HistorySearch::matchExpression(m_filter.keyword).isEmpty()) {
+        return;
+    }
+    // 首页还在读时它本身就会带上新记录。
+    if (m_loading && m_rows.isEmpty()) {
+        return;
+    }
+    // 上一次增量还没回来时只记一笔，回来后再补取一次。
+    if (m_tailLoader->isRunning()) {
+        m_tailPending = true;
+        return;
+    }
+
+    QString sql;
+    QVariantList args;
+    buildQuery(&sql, &args, QueryMode::Tail, kTailLimit);
+    m_pendingTail.clear();
+    m_tailLoader->start(sql, args);
+}
+
+void HistoryModel::onTailFinished(qint64 rows, bool cancelled, const QString& error)
+{
+    if (!error.isEmpty()) {
+        emit loadFailed(error);
+    }
+    if (cancelled || !error.isEmpty()) {
+        m_pendingTail.clear();
+        return;
+    }
+    if (rows >= kTailLimit) {
+        reload();
+        return;
+    }
+
+    if (!m_pendingTail.isEmpty()) {
+        // 新记录按 ID 倒序到达，整体插到最前面；视图的选择和滚动位置由持久索引保持。
+        beginInsertRows(QModelIndex(), 0, m_pendingTail.size() - 1);
+        m_rows = m_pendingTail + m_rows;
+        endInsertRows();
+        for (const auto& row : std::as_const(m_pendingTail)) {
+            m_maxId = qMax(m_maxId, row.id);
+        }
+        if (m_lastId == 0) {
+            m_lastId = m_rows.constLast().id;
+            m_lastTs = m_rows.constLast().tsMs;
+        }
+        emit tailInserted(m_pendingTail.size());
+        m_pendingTail.clear();
+    }
+
+    if (m_tailPending) {
+        m_tailPending = false;
+        refreshTail();
+    }
+}
+
+bool HistoryModel::journalMatches(const AuditJournalReader::View& v, const QList<QByteArray>& terms) const
+{
+    if (m_filter.action != 0 && v.action != m_filter.action) {
+        return false;
+    }
+    if (m_filter.entityType != 0) {
+        if (v.entity != m_filter.entityType) {
+            return false;
+        }
+        if (!m_filter.entityId.isEmpty() && v.entityId() != m_filter.entityId) {
+            return false;
+        }
+    }
+    if ((m_filter.fromMs > 0 && v.tsMs < m_filter.fromMs) || (m_filter.toMs > 0 && v.tsMs >= m_filter.toMs)) {
+        return false;
+    }
+    for (const auto& term : terms) {
+        if (!v.contains(term)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void HistoryModel::startJournalPage(quint64 generation)
+{
+    if (generation != m_generation) {
+        return;
+    }
+    const auto terms = journalTerms(m_filter.keyword);
+    const int wanted = m_pageSize;
+
+    QVector<Row> rows;
+    AuditJournalReader::View v;
+    int scanned = 0;
+    bool end = false;
+    while (rows.size() < wanted && scanned < kJournalScanBudget) {
+        if (!m_journal->previous(&m_scanPos, &v)) {
+            end = true;
+            break;
+        }
+        ++scanned;
+        // 写入顺序即时间顺序，早于范围起点就不必再往前翻。
+        if (m_filter.fromMs > 0 && v.tsMs < m_filter.fromMs) {
+            end = true;
+            break;
+        }
+        if (journalMatches(v, terms)) {
+            Row row;
+            row.id = v.seq;
+            row.tsMs = v.tsMs;
+            row.segment = v.segment;
+            row.offset = v.offset;
+            rows.append(row);
+        }
+    }
+
+    if (!rows.isEmpty()) {
+        const int first = m_rows.size();
+        beginInsertRows(QModelIndex(), first, first + rows.size() - 1);
+        m_rows += rows;
+        endInsertRows();
+    }
+    if (!end && rows.size() < wanted) {
+        // 扫描额度用完但本页还没凑满，让出事件循环后接着扫。
+        QTimer::singleShot(0, this, [this, generation] { startJournalPage(generation); });
+        return;
+    }
+
+    m_atEnd = end;
+    m_loading = false;
+    emit loadingChanged(false);
+}
+
+void HistoryModel::refreshJournalTail()
+{
+    QString err;
+    if (!m_journal->refresh(&err)) {
+        emit loadFailed(err);
+        return;
+    }
+
+    const auto terms = journalTerms(m_filter.keyword);
+    QVector<Row> rows;
+    AuditJournalReader::View v;
+    while (m_journal->next(&m_tailPos, &v)) {
+        if (!journalMatches(v, terms)) {
+            continue;
+        }
+        if (rows.size() == kTailLimit) {
+            reload();
+            return;
+        }
+        Row row;
+        row.id = v.seq;
+        row.tsMs = v.tsMs;
+        row.segment = v.segment;
+        row.offset = v.offset;
+        rows.prepend(row);
+    }
+    if (rows.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), 0, rows.size() - 1);
+    m_rows = rows + m_rows;
+    endInsertRows();
+    emit tailInserted(rows.size());
+}
+
+void HistoryModel::exportQuery(QString* sql, QVariantList* args, QStringList* attachments) const
+{
+    buildQuery(sql, args, QueryMode::Export, -1);
+    *attachments = m_attachments;
+}
+
+void HistoryModel::buildQuery(QString* sql, QVariantList* args, QueryMode mode, int limit) const
+{
+    const bool tail = mode == QueryMode::Tail;
+    const bool exporting = mode == QueryMode::Export;
+    QStringList where;
+    QVariantList sourceArgs;
+    args->clear();
+
+    // 关键字走全文索引；切不出可检索的词（只有标点等）时不按关键字过滤。没有 FTS5 时逐行 LIKE。
+    const bool ftsAvailable = HistorySearch::isAvailable();
+    const auto match = ftsAvailable ? HistorySearch::matchExpression(m_filter.keyword) : QString();
+    const bool fts = !match.isEmpty();
+    // 增量只会是新写入的行，不需要查归档。
+    const int archiveCount = m_attachments.size();
+    const bool withArchives = !tail && archiveCount > 0;
+    const bool byRank = fts && m_filter.byRelevance && !withArchives && !tail && !exporting;
+    const bool byTime = m_filter.hasRange() && !byRank;
+
+    QString source;
+    QString keyId = QStringLiteral("H.ID");
+    if (withArchives) {
+        const auto cols = HistoryArchiver::historyColumns();
+        QStringList parts;
+        for (int i = -1; i < archiveCount; ++i) {
+            const auto schema = i < 0 ? QStringLiteral("main") : QStringLiteral("arc%1").arg(i);
+            auto part = QStringLiteral("SELECT %1 FROM %2.History").arg(cols, schema);
+            if (fts) {
+                part += QStringLiteral(" WHERE ID IN (SELECT rowid FROM %1.HistoryFts WHERE HistoryFts MATCH ?)").arg(schema);
+                sourceArgs << match;
+            }
+            parts << part;
+        }
+        source = QStringLiteral("(%1) H").arg(parts.join(QStringLiteral(" UNION ALL ")));
+    } else if (byRank) {
+        // 按相关度排序要给全部命中打分，常见词会很慢；只在最新的若干条命中里排序。
+        source = QStringLiteral(
+                     "(SELECT rowid AS FID, bm25(HistoryFts) AS SCORE FROM HistoryFts"
+                     "  WHERE HistoryFts MATCH ? ORDER BY rowid DESC LIMIT %1) F"
+                     " JOIN History H ON H.ID = F.FID")
+                     .arg(kRankCandidates);
+        sourceArgs << match;
+    } else if (fts) {
+        // 由全文索引驱动，按 rowid 倒序取前 n 条命中，不必读完整个命中集。
+        source = QStringLiteral("HistoryFts F JOIN History H ON H.ID = F.rowid");
+        where << QStringLiteral("F.HistoryFts MATCH ?");
+        *args << match;
+        keyId = QStringLiteral("F.rowid");
+    } else {
+        source = QStringLiteral("History H");
+    }
+    if (!ftsAvailable) {
+        const auto like = HistorySearch::likeCondition(m_filter.keyword, args);
+        if (!like.isEmpty()) {
+            where << like;
+        }
+    }
+
+    if (m_filter.action != 0) {
+        where << QStringLiteral("H.ACTION = ?");
+        *args << m_filter.action;
+    }
+    if (m_filter.entityType != 0) {
+        if (m_filter.entityId.isEmpty()) {
+            where << QStringLiteral("H.ENTITY_TYPE = ?");
+            *args << m_filter.entityType;
+        } else {
+            // 走 idx_history_entity 索引查找。
+            where << QStringLiteral("H.ENTITY_ID = ? AND H.ENTITY_TYPE = ?");
+            *args << m_filter.entityId << m_filter.entityType;
+        }
+    }
+    if (m_filter.fromMs > 0) {
+        where << QStringLiteral("H.TS_MS >= ?");
+        *args << m_filter.fromMs;
+    }
+    if (m_filter.toMs > 0) {
+        where << QStringLiteral("H.TS_MS < ?");
+        *args << m_filter.toMs;
+    }
+
+    if (tail) {
+        if (m_maxId > 0) {
+            where << QStringLiteral("%1 > ?").arg(keyId);
+            *args << m_maxId;
+        }
+    } else if (m_lastId > 0 && !byRank && !exporting) {
+        if (byTime) {
+            where << QStringLiteral("(H.TS_MS, H.ID) < (?, ?)");
+            *args << m_lastTs << m_lastId;
+        } else {
+            where << QStringLiteral("%1 < ?").arg(keyId);
+            *args << m_lastId;
+        }
+    }
+
+    if (exporting) {
+        // 导出时行数可能很多，不经 LookupCache 逐行换算，直接连接字典表。
+        // 模板里的 %1、%2 是占位符，这里不能用 arg() 拼接。
+        *sql = QStringLiteral("SELECT H.ID, U.USERNAME, COALESCE(H.EVENT, ")
+            + HistoryLogger::renderSql(QStringLiteral("T.TEXT"), QStringLiteral("IFNULL(H.DETAIL, '')"),
+                                       QStringLiteral("IFNULL(H.ENTITY_ID, '')"))
+            + QStringLiteral("), H.TIMESTAMP  FROM ")
+            + source
+            + QStringLiteral(" LEFT JOIN User U ON U.ID = H.USER_ID LEFT JOIN HistoryTemplate T ON T.ID = H.TEMPLATE_ID");
+    } else {
+        *sql = QStringLiteral(
+                   "SELECT H.ID, H.USER_ID, H.EVENT, H.TEMPLATE_ID, H.DETAIL, H.ENTITY_ID, H.TIMESTAMP, H.TS_MS"
+                   "  FROM %1")
+                   .arg(source);
+    }
+    if (!where.isEmpty()) {
+        *sql += QStringLiteral(" WHERE ") + where.join(QStringLiteral(" AND "));
+    }
+    if (byRank) {
+        *sql += QStringLiteral(" ORDER BY F.SCORE, H.ID DESC LIMIT %1 OFFSET %2;").arg(limit).arg(m_rows.size());
+    } else if (byTime) {
+        *sql += QStringLiteral(" ORDER BY H.TS_MS DESC, H.ID DESC LIMIT %1;").arg(limit);
+    } else {
+        *sql += QStringLiteral(" ORDER BY %1 DESC LIMIT %2;").arg(keyId).arg(limit);
+    }
+    *args = sourceArgs + *args;
+}
+
+void HistoryModel::startPage()
+{
+    if (m_journal) {
+        m_loading = true;
+        emit loadingChanged(true);
+        startJournalPage(m_generation);
+        return;
+    }
+
+    QString sql;
+    QVariantList args;
+    buildQuery(&sql, &args, QueryMode::Page, m_pageSize);
+
+    m_loading = true;
+    emit loadingChanged(true);
+    m_loader->start(sql, args);
+}
+
+QVector<HistoryModel::Row> HistoryModel::convertRows(const QVector<QVariantList>& rows) const
+{
+    auto& users = LookupCache::users();
+    auto& templates = LookupCache::historyTemplates();
+
+    QVector<Row> converted;
+    converted.reserve(rows.size());
+    for (const auto& r : rows) {
+        Row row;
+        row.id = r.value(0).toLongLong();
+        row.userName = users.valueOf(r.value(1).toString());
+        if (!r.value(2).isNull()) {
+            row.event = r.value(2).toString();
+        } else {
+            const auto templateId = r.value(3).toString();
+            auto text = templates.valueOf(templateId);
+            if (text.isEmpty() && templates.refresh()) {
+                text = templates.valueOf(templateId);
+            }
+            row.event = HistoryLogger::render(text, r.value(4).toString(), r.value(5).toString());
+        }
+        row.timestamp = r.value(6).toString();
+        row.tsMs = r.value(7).toLongLong();
+        converted.append(row);
+    }
+    return converted;
+}
+
+void HistoryModel::onRows(const QVector<QVariantList>& rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+
+    const auto converted = convertRows(rows);
+    const int first = m_rows.size();
+    beginInsertRows(QModelIndex(), first, first + converted.size() - 1);
+    m_rows += converted;
+    endInsertRows();
+    m_lastId = m_rows.constLast().id;
+    m_lastTs = m_rows.constLast().tsMs;
+    for (const auto& row : converted) {
+        m_maxId = qMax(m_maxId, row.id);
+    }
+}
+
+void HistoryModel::onFinished(qint64 rows, bool cancelled, const QString& error)
+{
+    m_loading = false;
+    if (!error.isEmpty()) {
+        emit loadFailed(error);
+    }
+    // 取消的页下次滚动时重新取；不足一页说明到底了。
+    if (!cancelled && error.isEmpty() && rows < m_pageSize) {
+        m_atEnd = true;
+    }
+    emit loadingChanged(false);
+}
+
+int HistoryModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+int HistoryModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColCount;
+}
+
+QVariant HistoryModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole) {
+        return {};
+    }
+    const auto& row = m_rows.at(index.row());
+    if (row.segment >= 0 && index.column() != ColId) {
+        const auto v = m_journal->at(row.segment, row.offset);
+        if (!v.isValid()) {
+            return {};
+        }
+        switch (index.column()) {
+        case ColUser:
+            return LookupCache::users().valueOf(v.userId());
+        case ColEvent:
+            return HistoryLogger::render(v.templateText(), v.detail(), v.entityId());
+        case ColTime:
+            return QDateTime::fromMSecsSinceEpoch(v.tsMs).toString(Qt::ISODate);
+        default:
+            return {};
+        }
+    }
+    switch (index.column()) {
+    case ColId:
+        return row.id;
+    case ColUser:
+        return row.userName;
+    case ColEvent:
+        return row.event;
+    case ColTime:
+        return row.timestamp;
+    default:
+        return {};
+    }
+}
+
+QVariant HistoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return {};
+    }
+    if (orientation == Qt::Vertical) {
+        return section + 1;
+    }
+    switch (section) {
+    case ColId:
+        return QStringLiteral("ID");
+    case ColUser:
+        return QStringLiteral("用户名");
+    case ColEvent:
+        return QStringLiteral("事件");
+    case ColTime:
+        return QStringLiteral("时间");
+    default:
+        return {};
+    }
+}
+
+bool HistoryModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && !m_atEnd && !m_loading;
+}
+
+void HistoryModel::fetchMore(const QModelIndex& parent)
+{
+    if (canFetchMore(parent)) {
+        startPage();
+    }
+}
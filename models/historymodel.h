@@ -0,0 +1,121 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+#include "db/auditjournal.h"
+
+#include <memory>
+
+class StreamingLoader;
+
+// 日志按 ID 倒序做键集分页：每页 WHERE ID < 已加载的最小 ID LIMIT n，
+// 视图滚动到底部时通过 canFetchMore/fetchMore 在后台连接上取下一页。
+// 用户名、消息模板走 LookupCache，不再与 User 表连接。
+// refreshTail() 只取比已加载最大 ID 更新的记录插到顶部，不重置模型。
+// 指定时间范围时改按 (TS_MS, ID) 倒序分页，沿 idx_history_ts 做范围查找；
+// 范围落到已归档的月份时，把对应归档库 ATTACH 到读连接上与主表 UNION ALL 一起查。
+// HistoryLogger 使用日志文件后端时直接从映射的段文件向前扫描，行里只记位置，显示时再解码；
+// 这种模式下关键字按子串匹配原始字节，不支持按相关度排序。
+class HistoryModel final : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    struct Filter
+    {
+        int action = 0;
+        int entityType = 0;
+        QString entityId;
+        // 全文检索（HistoryFts），见 HistorySearch::matchExpression。
+        QString keyword;
+        bool byRelevance = false;
+        // UTC 毫秒，[fromMs, toMs)；0 表示不限。
+        qint64 fromMs = 0;
+        qint64 toMs = 0;
+
+        bool hasRange() const { return fromMs > 0 || toMs > 0; }
+    };
+
+    explicit HistoryModel(QObject* parent = nullptr);
+
+    void setFilter(const Filter& filter);
+    void reload();
+    void refreshTail();
+    void cancel();
+
+    bool hasLoaded() const { return m_loaded; }
+    // 按当前过滤条件导出全部记录的查询（不分页，用户名、事件文本在 SQL 里拼好），
+    // 列为 ID、用户名、事件、时间；attachments 需按顺序 ATTACH 为 arc0、arc1…。
+    // 日志文件模式下查的是物化到 History 表的记录。
+    void exportQuery(QString* sql, QVariantList* args, QStringList* attachments) const;
+
+    bool isLoading() const { return m_loading; }
+    bool atEnd() const { return m_atEnd; }
+    int pageSize() const { return m_pageSize; }
+    void setPageSize(int rows) { m_pageSize = qMax(1, rows); }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+signals:
+    void loadingChanged(bool loading);
+    void tailInserted(int rows);
+    void notice(const QString& text);
+    void loadFailed(const QString& error);
+
+private:
+    struct Row
+    {
+        qint64 id = 0;
+        QString userName;
+        QString event;
+        QString timestamp;
+        qint64 tsMs = 0;
+        // 来自日志文件的行：记录所在段和偏移，其余字段在 data() 中解码。
+        int segment = -1;
+        qint64 offset = 0;
+    };
+
+    enum class QueryMode {
+        Page,
+        Tail,
+        Export,
+    };
+
+    bool journalMatches(const AuditJournalReader::View& v, const QList<QByteArray>& terms) const;
+    void startJournalPage(quint64 generation);
+    void refreshJournalTail();
+    void buildQuery(QString* sql, QVariantList* args, QueryMode mode, int limit) const;
+    QVector<Row> convertRows(const QVector<QVariantList>& rows) const;
+    void startPage();
+    void onRows(const QVector<QVariantList>& rows);
+    void onFinished(qint64 rows, bool cancelled, const QString& error);
+    void onTailFinished(qint64 rows, bool cancelled, const QString& error);
+
+    StreamingLoader* m_loader = nullptr;
+    StreamingLoader* m_tailLoader = nullptr;
+    std::unique_ptr<AuditJournalReader> m_journal;
+    AuditJournalReader::Position m_scanPos;
+    AuditJournalReader::Position m_tailPos;
+    quint64 m_generation = 0;
+    Filter m_filter;
+    QStringList m_attachments;
+    QVector<Row> m_rows;
+    QVector<Row> m_pendingTail;
+    qint64 m_lastId = 0;
+    qint64 m_lastTs = 0;
+    qint64 m_maxId = 0;
+    bool m_loaded = false;
+    bool m_tailPending = false;
+    int m_pageSize = 200;
+    bool m_loading = false;
+    bool m_atEnd = false;
+};
@@ -0,0 +1,401 @@
+#include "patientgridcache.h"
+
+#include "db/dbmanager.h"
+#include "db/deltasync.h"
+#include "models/patientmodel.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QtEndian>
+
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr char kMagic[8] = {'H', 'P', 'G', 'R', 'I', 'D', 'C', '1'};
+constexpr quint32 kFormatVersion = 1;
+constexpr int kHeaderSize = 8 + 4 + 4 + 8 + 8 + 8 + 8;
+constexpr int kMaxRowBytes = std::numeric_limits<quint16>::max();
+constexpr int kFlushBytes = 1 << 20;
+constexpr int kStopCheckRows = 4096;
+
+struct Header
+{
+    quint32 columns = 0;
+    quint64 rows = 0;
+    qint64 version = 0;
+    quint64 textOffset = 0;
+    quint64 indexOffset = 0;
+};
+
+template <typename T>
+T load(const uchar* p)
+{
+    return qFromLittleEndian<T>(p);
+}
+
+template <typename T>
+void append(QByteArray& out, T v)
+{
+    uchar b[sizeof(T)];
+    qToLittleEndian<T>(v, b);
+    out.append(reinterpret_cast<const char*>(b), sizeof(T));
+}
+
+QByteArray encodeHeader(const Header& h)
+{
+    QByteArray out(kMagic, sizeof(kMagic));
+    append<quint32>(out, kFormatVersion);
+    append<quint32>(out, h.columns);
+    append<quint64>(out, h.rows);
+    append<qint64>(out, h.version);
+    append<quint64>(out, h.textOffset);
+    append<quint64>(out, h.indexOffset);
+    return out;
+}
+
+bool decodeHeader(const uchar* p, qint64 size, Header* h)
+{
+    if (size < kHeaderSize || std::memcmp(p, kMagic, sizeof(kMagic)) != 0 || load<quint32>(p + 8) != kFormatVersion) {
+        return false;
+    }
+    h->columns = load<quint32>(p + 12);
+    h->rows = load<quint64>(p + 16);
+    h->version = load<qint64>(p + 24);
+    h->textOffset = load<quint64>(p + 32);
+    h->indexOffset = load<quint64>(p + 40);
+    return true;
+}
+
+QByteArray encodeMeta(const QString& nodeId, const QStringList& fields)
+{
+    return (QStringList{nodeId} + fields).join(QLatin1Char('\n')).toUtf8();
+}
+
+// 库里 Patient 当前的版本戳；db 上应已开始读事务，保证与随后读到的行一致。
+bool currentStamp(const QSqlDatabase& db, qint64* version, QByteArray* meta, QStringList* fields, QString* error)
+{
+    QSqlQuery q(db);
+    if (!q.exec(QStringLiteral("SELECT VERSION FROM TableVersion WHERE NAME='Patient';"))) {
+        *error = q.lastError().text();
+        return false;
+    }
+    *version = q.next() ? q.value(0).toLongLong() : 0;
+    q.finish();
+
+    const auto node = DeltaSync::nodeId(db, error);
+    if (node.isEmpty()) {
+        return false;
+    }
+    const auto rec = db.record(QStringLiteral("Patient"));
+    fields->clear();
+    for (int i = 0; i < rec.count(); ++i) {
+        *fields << rec.fieldName(i);
+    }
+    *meta = encodeMeta(node, *fields);
+    return true;
+}
+
+// 只读已有文件的头部和元数据，判断要不要重写。
+bool storedStamp(const QString& path, qint64* version, QByteArray* meta)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const auto head = f.read(kHeaderSize + 4);
+    Header h;
+    if (head.size() < kHeaderSize + 4 || !decodeHeader(reinterpret_cast<const uchar*>(head.constData()), head.size(), &h)) {
+        return false;
+    }
+    const auto metaSize = load<quint32>(reinterpret_cast<const uchar*>(head.constData()) + kHeaderSize);
+    if (h.textOffset != quint64(kHeaderSize) + 4 + metaSize) {
+        return false;
+    }
+    *version = h.version;
+    *meta = f.read(metaSize);
+    return meta->size() == qint64(metaSize);
+}
+
+}
+
+PatientGridCache::PatientGridCache(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+PatientGridCache::~PatientGridCache()
+{
+    if (m_file && m_base) {
+        m_file->unmap(m_base);
+    }
+}
+
+QString PatientGridCache::cachePath()
+{
+    return QFileInfo(DbManager::instance().databasePath()).dir().filePath(QStringLiteral("patientgrid.cache"));
+}
+
+bool PatientGridCache::enabled()
+{
+    QSettings settings(DbManager::instance().settingsPath(), QSettings::IniFormat);
+    return settings.value(QStringLiteral("Startup/PatientGridCache"), true).toBool();
+}
+
+PatientGridCache* PatientGridCache::open(QObject* parent, QString* error)
+{
+    const auto fail = [error](const QString& message) -> PatientGridCache* {
+        if (error) {
+            *error = message;
+        }
+        return nullptr;
+    };
+
+    const auto path = cachePath();
+    auto file = std::make_unique<QFile>(path);
+    if (!file->exists()) {
+        return fail(QStringLiteral("没有启动缓存"));
+    }
+    if (!file->open(QIODevice::ReadOnly)) {
+        return fail(file->errorString());
+    }
+    const qint64 size = file->size();
+    uchar* base = size >= kHeaderSize + 4 ? file->map(0, size) : nullptr;
+    if (!base) {
+        return fail(QStringLiteral("启动缓存损坏：%1").arg(path));
+    }
+
+    // 先核对结构，再核对版本戳；任何一项不符都放弃映射。
+    Header h;
+    bool ok = decodeHeader(base, size, &h);
+    const quint32 metaSize = ok ? load<quint32>(base + kHeaderSize) : 0;
+    ok = ok && h.textOffset == quint64(kHeaderSize) + 4 + metaSize && h.indexOffset >= h.textOffset
+        && h.columns > 0 && h.rows <= quint64(std::numeric_limits<int>::max())
+        && h.indexOffset <= quint64(size)
+        && (quint64(size) - h.indexOffset) / (8 + 2 * quint64(h.columns)) == h.rows
+        && (quint64(size) - h.indexOffset) % (8 + 2 * quint64(h.columns)) == 0;
+    if (!ok) {
+        file->unmap(base);
+        return fail(QStringLiteral("启动缓存损坏：%1").arg(path));
+    }
+
+    auto& dbm = DbManager::instance();
+    QString err;
+    const qint64 version = dbm.tableVersion(QStringLiteral("Patient"), &err);
+    QByteArray meta;
+    QStringList fields;
+    if (version >= 0) {
+        const auto node = DeltaSync::nodeId(dbm.database(), &err);
+        const auto rec = dbm.database().record(QStringLiteral("Patient"));
+        for (int i = 0; i < rec.count(); ++i) {
+            fields << rec.fieldName(i);
+        }
+        meta = encodeMeta(node, fields);
+    }
+    const QByteArray stored(reinterpret_cast<const char*>(base + kHeaderSize + 4), metaSize);
+    if (version < 0 || version != h.version || stored != meta || fields.size() != int(h.columns)) {
+        file->unmap(base);
+        return fail(err.isEmpty() ? QStringLiteral("启动缓存已过期") : err);
+    }
+
+    auto* cache = new PatientGridCache(parent);
+    cache->m_base = base;
+    cache->m_text = base + h.textOffset;
+    cache->m_textSize = h.indexOffset - h.textOffset;
+    cache->m_rowStarts = base + h.indexOffset;
+    cache->m_cellEnds = base + h.indexOffset + 8 * h.rows;
+    cache->m_rows = int(h.rows);
+    cache->m_columns = int(h.columns);
+    cache->m_version = h.version;
+    cache->m_fields = fields;
+    cache->m_file = std::move(file);
+    return cache;
+}
+
+bool PatientGridCache::write(const QString& path, const std::atomic_bool* stop, QString* error)
+{
+    QString err;
+    auto db = DbManager::instance().openWorkerConnection(&err);
+    bool ok = db.isOpen() && err.isEmpty();
+    bool inSnapshot = false;
+    bool upToDate = false;
+
+    // 版本号和行在同一个读事务里读，写出来的版本戳与内容一致。
+    qint64 version = 0;
+    QByteArray meta;
+    QStringList fields;
+    if (ok) {
+        inSnapshot = db.transaction();
+        ok = inSnapshot && currentStamp(db, &version, &meta, &fields, &err);
+        if (!ok && err.isEmpty()) {
+            err = db.lastError().text();
+        }
+    }
+    if (ok) {
+        qint64 storedVersion = 0;
+        QByteArray storedMeta;
+        upToDate = storedStamp(path, &storedVersion, &storedMeta) && storedVersion == version && storedMeta == meta;
+    }
+
+    const auto part = path + QStringLiteral(".part");
+    QFile out(part);
+    if (ok && !upToDate) {
+        Header h;
+        h.columns = quint32(fields.size());
+        h.version = version;
+        h.textOffset = quint64(kHeaderSize) + 4 + quint64(meta.size());
+
+        QByteArray buffer = encodeHeader(h);
+        append<quint32>(buffer, quint32(meta.size()));
+        buffer += meta;
+        ok = out.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        if (!ok) {
+            err = out.errorString();
+        }
+
+        // 与 PatientModel 的 QSqlTableModel 一样不带 ORDER BY 全表扫描，行序相同。
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        if (ok && !q.exec(QStringLiteral("SELECT %1 FROM Patient;").arg(fields.join(QLatin1Char(','))))) {
+            err = q.lastError().text();
+            ok = false;
+        }
+
+        QVector<quint64> rowStarts;
+        QVector<quint16> cellEnds;
+        quint64 textSize = 0;
+        QByteArray row;
+        while (ok && q.next()) {
+            row.clear();
+            for (int c = 0; c < fields.size(); ++c) {
+                auto cell = PatientModel::displayText(fields.at(c), q.value(c)).toUtf8();
+                if (row.size() + cell.size() > kMaxRowBytes) {
+                    // 截断时退到 UTF-8 字符边界。
+                    int n = kMaxRowBytes - row.size();
+                    while (n > 0 && (uchar(cell.at(n)) & 0xC0) == 0x80) {
+                        --n;
+                    }
+                    cell.truncate(n);
+                }
+                row += cell;
+                cellEnds.append(quint16(row.size()));
+            }
+            rowStarts.append(textSize);
+            textSize += quint64(row.size());
+            buffer += row;
+            if (buffer.size() >= kFlushBytes) {
+                ok = out.write(buffer) == buffer.size();
+                buffer.clear();
+            }
+            if (rowStarts.size() % kStopCheckRows == 0 && stop && stop->load()) {
+                err = QStringLiteral("已取消");
+                ok = false;
+            }
+        }
+        if (ok && q.lastError().isValid()) {
+            err = q.lastError().text();
+            ok = false;
+        }
+        q.finish();
+
+        if (ok) {
+            h.rows = quint64(rowStarts.size());
+            h.indexOffset = h.textOffset + textSize;
+            buffer.reserve(buffer.size() + rowStarts.size() * 8 + cellEnds.size() * 2);
+            for (const auto start : rowStarts) {
+                append<quint64>(buffer, start);
+            }
+            for (const auto end : cellEnds) {
+                append<quint16>(buffer, end);
+            }
+            const auto header = encodeHeader(h);
+            ok = out.write(buffer) == buffer.size() && out.seek(0) && out.write(header) == header.size() && out.flush();
+        }
+        if (!ok && err.isEmpty()) {
+            err = out.errorString();
+        }
+        out.close();
+    }
+
+    if (inSnapshot) {
+        db.rollback();
+    }
+    if (db.isOpen()) {
+        DbManager::closeWorkerConnection(db);
+    }
+
+    if (ok && !upToDate) {
+        QFile::remove(path);
+        if (!QFile::rename(part, path)) {
+            err = QStringLiteral("无法写入 %1").arg(path);
+            ok = false;
+        }
+    }
+    if (!ok) {
+        QFile::remove(part);
+        if (error) {
+            *error = err;
+        }
+    }
+    return ok;
+}
+
+int PatientGridCache::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_rows;
+}
+
+int PatientGridCache::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_columns;
+}
+
+QVariant PatientGridCache::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || (role != Qt::DisplayRole && role != PatientModel::DisplayTextRole)) {
+        return {};
+    }
+    const int row = index.row();
+    const int col = index.column();
+    if (row < 0 || row >= m_rows || col < 0 || col >= m_columns) {
+        return {};
+    }
+
+    const quint64 start = load<quint64>(m_rowStarts + 8 * quint64(row));
+    const uchar* ends = m_cellEnds + 2 * (quint64(row) * m_columns);
+    const quint16 begin = col == 0 ? 0 : load<quint16>(ends + 2 * (col - 1));
+    const quint16 end = load<quint16>(ends + 2 * col);
+    if (end < begin || start > m_textSize || end > m_textSize - start) {
+        return QString();
+    }
+    return QString::fromUtf8(reinterpret_cast<const char*>(m_text + start + begin), end - begin);
+}
+
+QVariant PatientGridCache::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < m_fields.size()) {
+        return PatientModel::headerText(m_fields.at(section));
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+Qt::ItemFlags PatientGridCache::flags(const QModelIndex& index) const
+{
+    return index.isValid() ? Qt::ItemIsSelectable | Qt::ItemIsEnabled : Qt::NoItemFlags;
+}
+
+int PatientGridCache::fieldIndex(const QString& fieldName) const
+{
+    for (int i = 0; i < m_fields.size(); ++i) {
+        if (m_fields.at(i).compare(fieldName, Qt::CaseInsensitive) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
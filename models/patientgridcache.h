@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QStringList>
+
+#include <atomic>
+#include <memory>
+
+class QFile;
+
+// 患者表格的启动缓存：整张 Patient 表每个单元格的显示文本，写在数据库目录下的 patientgrid.cache。
+// 重启后页面直接把文件映射进来当只读模型显示，不经过 SQLite；PatientModel 在后面分片追上后再换过去。
+// 文件记着写入时 Patient 的 TableVersion 版本号、本库节点 ID 和列名，与当前库对不上就不用。
+//
+// 文件布局（整数均为小端）：
+//   头部    magic(8) version(u32) columns(u32) rows(u64) tableVersion(i64) textOffset(u64) indexOffset(u64)
+//   元数据  长度(u32) + UTF-8：节点 ID 和各列名，以 '\n' 分隔
+//   文本    各行的单元格文本依次相连
+//   索引    每行文本的起点(u64)，之后是每个单元格在行内的结束位置(u16)
+// 单行文本超过 64KB 的部分截掉。
+class PatientGridCache final : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    ~PatientGridCache() override;
+
+    static QString cachePath();
+    // hospital.ini 的 Startup/PatientGridCache，默认打开。
+    static bool enabled();
+
+    // 映射缓存文件并与当前库（默认连接）核对；文件不存在、损坏或已过期时返回 nullptr。
+    static PatientGridCache* open(QObject* parent = nullptr, QString* error = nullptr);
+    // 在当前线程用新开的后台连接把缓存写到 path（先写 .part，成功后改名）；
+    // 已有文件的版本戳与库一致时不重写。stop 置位时尽快返回 false。
+    static bool write(const QString& path, const std::atomic_bool* stop = nullptr, QString* error = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+    int fieldIndex(const QString& fieldName) const;
+    qint64 version() const { return m_version; }
+
+private:
+    explicit PatientGridCache(QObject* parent);
+
+    std::unique_ptr<QFile> m_file;
+    uchar* m_base = nullptr;
+    const uchar* m_text = nullptr;
+    const uchar* m_rowStarts = nullptr;
+    const uchar* m_cellEnds = nullptr;
+    quint64 m_textSize = 0;
+    int m_rows = 0;
+    int m_columns = 0;
+    qint64 m_version = 0;
+    QStringList m_fields;
+};
@@ -0,0 +1,82 @@
+#include "patientgridcachewriter.h"
+
+#include "models/patientgridcache.h"
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+
+PatientGridCacheWriter::PatientGridCacheWriter(QObject* parent)
+    : QObject(parent)
+{
+}
+
+PatientGridCacheWriter::~PatientGridCacheWriter()
+{
+    stop();
+}
+
+void PatientGridCacheWriter::schedule(int delayMs)
+{
+    if (!m_timer) {
+        m_timer = new QTimer(this);
+        m_timer->setSingleShot(true);
+        connect(m_timer, &QTimer::timeout, this, &PatientGridCacheWriter::start);
+    }
+    m_timer->start(qMax(0, delayMs));
+}
+
+void PatientGridCacheWriter::start()
+{
+    if (m_thread) {
+        m_pending = true;
+        return;
+    }
+    m_pending = false;
+    m_stop = std::make_shared<std::atomic_bool>(false);
+    auto stopFlag = m_stop;
+    auto* thread = QThread::create([this, stopFlag] { run(this, stopFlag); });
+    m_thread = thread;
+    connect(thread, &QThread::finished, this, [this, guard = QPointer<QThread>(thread)] {
+        if (!guard) {
+            return;
+        }
+        if (m_thread == guard) {
+            m_thread = nullptr;
+        }
+        guard->deleteLater();
+        if (m_pending) {
+            schedule();
+        }
+    });
+    thread->start(QThread::LowPriority);
+}
+
+void PatientGridCacheWriter::stop()
+{
+    if (m_timer) {
+        m_timer->stop();
+    }
+    m_pending = false;
+    if (!m_thread) {
+        return;
+    }
+    m_stop->store(true);
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+void PatientGridCacheWriter::run(PatientGridCacheWriter* self, const std::shared_ptr<std::atomic_bool>& stop)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QString err;
+    if (PatientGridCache::write(PatientGridCache::cachePath(), stop.get(), &err)) {
+        qInfo("PatientGridCache: refreshed in %lld ms", static_cast<long long>(timer.elapsed()));
+    } else if (!stop->load()) {
+        qWarning("PatientGridCache: %s", qPrintable(err));
+    }
+    QMetaObject::invokeMethod(self, [self, err] { emit self->finished(err); }, Qt::QueuedConnection);
+}
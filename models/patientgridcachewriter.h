@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+
+class QThread;
+class QTimer;
+
+// 在后台线程重写患者表格的启动缓存（PatientGridCache::write）。
+// schedule() 把短时间内的多次改动合并成一次；正在写时又有改动，写完后再补一次。
+class PatientGridCacheWriter final : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PatientGridCacheWriter(QObject* parent = nullptr);
+    ~PatientGridCacheWriter() override;
+
+    void schedule(int delayMs = 3000);
+    void start();
+    // 请求停止并等待；写了一半的临时文件会删除。
+    void stop();
+    bool isRunning() const { return m_thread != nullptr; }
+
+signals:
+    void finished(const QString& error);
+
+private:
+    static void run(PatientGridCacheWriter* self, const std::shared_ptr<std::atomic_bool>& stop);
+
+    QThread* m_thread = nullptr;
+    QTimer* m_timer = nullptr;
+    bool m_pending = false;
+    std::shared_ptr<std::atomic_bool> m_stop;
+};
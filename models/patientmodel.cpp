@@ -1,24 +1,87 @@
 #include "patientmodel.h"
 
+#include "db/patientrevisions.h"
+
+#include <QDate>
+#include <QHash>
+#include <QSqlError>
 #include <QSqlRecord>
 
+static QHash<QString, CompactRowStore::ColumnType> compactTypes()
+{
+    using T = CompactRowStore::ColumnType;
+    return {
+        {QStringLiteral("SEX"), T::Int16},
+        {QStringLiteral("DOB"), T::Date},
+        {QStringLiteral("HEIGHT"), T::Decimal1},
+        {QStringLiteral("WEIGHT"), T::Decimal1},
+        {QStringLiteral("AGE"), T::Int16},
+        {QStringLiteral("CREATEDTIMESTAMP"), T::DateTime},
+        {QStringLiteral("CREATED_MS"), T::Int64},
+    };
+}
+
 PatientModel::PatientModel(QObject* parent)
-    : QSqlTableModel(parent)
+    : CompactTableModel(QStringLiteral("Patient"), compactTypes(), parent)
 {
-    setTable(QStringLiteral("Patient"));
-    setEditStrategy(QSqlTableModel::OnFieldChange);
+    connect(this, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex& tl, const QModelIndex& br) {
+        invalidateDisplayRows(tl.row(), br.row());
+    });
+    connect(this, &QAbstractItemModel::modelReset, this, [this] { m_displayRows.clear(); });
+    // fetchMore 追加在末尾，已算好的行原样保留；插在中间时后面的行跟着挪。
+    connect(this, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
+        if (first < m_displayRows.size()) {
+            m_displayRows.insert(first, last - first + 1, DisplayRow());
+        }
+    });
+    connect(this, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex&, int first, int last) {
+        if (first < m_displayRows.size()) {
+            m_displayRows.remove(first, qMin(last + 1, static_cast<int>(m_displayRows.size())) - first);
+        }
+    });
+
     select();
 
-    setHeaderData(columnIndex(QStringLiteral("ID")), Qt::Horizontal, QStringLiteral("ID"));
-    setHeaderData(columnIndex(QStringLiteral("ID_CARD")), Qt::Horizontal, QStringLiteral("身份证"));
-    setHeaderData(columnIndex(QStringLiteral("NAME")), Qt::Horizontal, QStringLiteral("姓名"));
-    setHeaderData(columnIndex(QStringLiteral("SEX")), Qt::Horizontal, QStringLiteral("性别"));
-    setHeaderData(columnIndex(QStringLiteral("DOB")), Qt::Horizontal, QStringLiteral("出生日期"));
-    setHeaderData(columnIndex(QStringLiteral("HEIGHT")), Qt::Horizontal, QStringLiteral("身高(cm)"));
-    setHeaderData(columnIndex(QStringLiteral("WEIGHT")), Qt::Horizontal, QStringLiteral("体重(kg)"));
-    setHeaderData(columnIndex(QStringLiteral("MOBILEPHONE")), Qt::Horizontal, QStringLiteral("手机号"));
-    setHeaderData(columnIndex(QStringLiteral("AGE")), Qt::Horizontal, QStringLiteral("年龄"));
-    setHeaderData(columnIndex(QStringLiteral("CREATEDTIMESTAMP")), Qt::Horizontal, QStringLiteral("创建时间"));
+    const auto rec = record();
+    for (int i = 0; i < rec.count(); ++i) {
+        setHeaderData(i, Qt::Horizontal, headerText(rec.fieldName(i)));
+    }
+}
+
+QString PatientModel::headerText(const QString& fieldName)
+{
+    static const QHash<QString, QString> labels = {
+        {QStringLiteral("ID"), QStringLiteral("ID")},
+        {QStringLiteral("ID_CARD"), QStringLiteral("身份证")},
+        {QStringLiteral("NAME"), QStringLiteral("姓名")},
+        {QStringLiteral("SEX"), QStringLiteral("性别")},
+        {QStringLiteral("DOB"), QStringLiteral("出生日期")},
+        {QStringLiteral("HEIGHT"), QStringLiteral("身高(cm)")},
+        {QStringLiteral("WEIGHT"), QStringLiteral("体重(kg)")},
+        {QStringLiteral("MOBILEPHONE"), QStringLiteral("手机号")},
+        {QStringLiteral("AGE"), QStringLiteral("年龄")},
+        {QStringLiteral("CREATEDTIMESTAMP"), QStringLiteral("创建时间")},
+    };
+    return labels.value(fieldName.toUpper(), fieldName);
+}
+
+QString PatientModel::displayText(const QString& fieldName, const QVariant& value)
+{
+    static const QString kMale = QStringLiteral("男");
+    static const QString kFemale = QStringLiteral("女");
+
+    const auto is = [&fieldName](QLatin1String name) { return fieldName.compare(name, Qt::CaseInsensitive) == 0; };
+    if (is(QLatin1String("SEX"))) {
+        return value.toInt() == 1 ? kMale : kFemale;
+    }
+    if (is(QLatin1String("DOB"))) {
+        const auto dob = QDate::fromString(value.toString(), Qt::ISODate);
+        return dob.isValid() ? dob.toString(QStringLiteral("yyyy/M/d")) : value.toString();
+    }
+    if (is(QLatin1String("HEIGHT")) || is(QLatin1String("WEIGHT"))) {
+        return value.isNull() ? QString() : QString::number(value.toDouble(), 'f', 1);
+    }
+    return value.toString();
 }
 
 QString PatientModel::escapeLike(const QString& text)
@@ -47,19 +110,119 @@ void PatientModel::setKeywordFilter(const QString& keyword)
     select();
 }
 
+bool PatientModel::select()
+{
+    const bool ok = CompactTableModel::select();
+    resolveColumns();
+    return ok;
+}
+
+void PatientModel::resolveColumns()
+{
+    m_columns.sex = columnIndex(QStringLiteral("SEX"));
+    m_columns.dob = columnIndex(QStringLiteral("DOB"));
+    m_columns.height = columnIndex(QStringLiteral("HEIGHT"));
+    m_columns.weight = columnIndex(QStringLiteral("WEIGHT"));
+    m_columns.age = columnIndex(QStringLiteral("AGE"));
+}
+
 int PatientModel::columnIndex(const QString& fieldName) const
 {
-    for (int i = 0; i < record().count(); ++i) {
-        if (record().fieldName(i).compare(fieldName, Qt::CaseInsensitive) == 0) {
+    const auto rec = record();
+    for (int i = 0; i < rec.count(); ++i) {
+        if (rec.fieldName(i).compare(fieldName, Qt::CaseInsensitive) == 0) {
             return i;
         }
     }
     return -1;
 }
 
-int PatientModel::sexColumn() const { return columnIndex(QStringLiteral("SEX")); }
-int PatientModel::dobColumn() const { return columnIndex(QStringLiteral("DOB")); }
-int PatientModel::heightColumn() const { return columnIndex(QStringLiteral("HEIGHT")); }
-int PatientModel::weightColumn() const { return columnIndex(QStringLiteral("WEIGHT")); }
-int PatientModel::ageColumn() const { return columnIndex(QStringLiteral("AGE")); }
+void PatientModel::invalidateDisplayRows(int first, int last)
+{
+    const int end = qMin(last, static_cast<int>(m_displayRows.size()) - 1);
+    for (int r = qMax(first, 0); r <= end; ++r) {
+        m_displayRows[r].valid = false;
+    }
+}
+
+const PatientModel::DisplayRow& PatientModel::displayRow(int row) const
+{
+    if (row >= m_displayRows.size()) {
+        m_displayRows.resize(qMax(row + 1, rowCount()));
+    }
+    auto& d = m_displayRows[row];
+    if (d.valid) {
+        return d;
+    }
+
+    const auto raw = [this, row](int col) { return col >= 0 ? store().value(row, col) : QVariant(); };
+
+    d.sex = displayText(QStringLiteral("SEX"), raw(m_columns.sex));
+    d.dob = displayText(QStringLiteral("DOB"), raw(m_columns.dob));
+    d.height = displayText(QStringLiteral("HEIGHT"), raw(m_columns.height));
+    d.weight = displayText(QStringLiteral("WEIGHT"), raw(m_columns.weight));
+
+    d.valid = true;
+    return d;
+}
+
+QVariant PatientModel::data(const QModelIndex& index, int role) const
+{
+    if (role != DisplayTextRole) {
+        return CompactTableModel::data(index, role);
+    }
+    if (!index.isValid()) {
+        return {};
+    }
+
+    const int col = index.column();
+    if (col != m_columns.sex && col != m_columns.dob && col != m_columns.height && col != m_columns.weight) {
+        return {};
+    }
 
+    const auto& d = displayRow(index.row());
+    if (col == m_columns.sex) {
+        return d.sex;
+    }
+    if (col == m_columns.dob) {
+        return d.dob;
+    }
+    if (col == m_columns.height) {
+        return d.height;
+    }
+    return d.weight;
+}
+
+bool PatientModel::updateRowInTable(int row, const QSqlRecord& values)
+{
+    // 读旧值、更新、写版本放在同一事务里，版本链与表内容不会脱节。
+    const auto id = record(row).value(QStringLiteral("ID")).toString();
+    auto db = database();
+    if (!db.transaction()) {
+        setLastError(db.lastError());
+        return false;
+    }
+
+    QString err;
+    Patient before;
+    Patient after;
+    if (!PatientRevisions::current(db, id, &before, &err) || !CompactTableModel::updateRowInTable(row, values)) {
+        if (!err.isEmpty()) {
+            setLastError(QSqlError(err, {}, QSqlError::StatementError));
+        }
+        db.rollback();
+        return false;
+    }
+    if (!PatientRevisions::current(db, id, &after, &err)
+        || !PatientRevisions::recordUpdated(db, before, after, m_userId, &err)) {
+        setLastError(QSqlError(err, {}, QSqlError::StatementError));
+        db.rollback();
+        return false;
+    }
+    if (!db.commit()) {
+        setLastError(db.lastError());
+        db.rollback();
+        return false;
+    }
+    return true;
+}
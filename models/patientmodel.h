@@ -1,24 +1,66 @@
 #pragma once
 
-#include <QSqlTableModel>
+#include "models/compacttablemodel.h"
 
-class PatientModel final : public QSqlTableModel
+// 行数据在 CompactRowStore 里：性别、年龄、身高体重定宽存放，日期和创建时间存整数。
+class PatientModel final : public CompactTableModel
 {
     Q_OBJECT
 
 public:
+    // 预格式化的显示文本（性别标签、出生日期、身高体重），委托绘制时直接取用。
+    enum Role { DisplayTextRole = Qt::UserRole + 1 };
+
+    struct Columns
+    {
+        int sex = -1;
+        int dob = -1;
+        int height = -1;
+        int weight = -1;
+        int age = -1;
+    };
+
     explicit PatientModel(QObject* parent = nullptr);
 
+    bool select() override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
     void setKeywordFilter(const QString& keyword);
+    // 表格内直接编辑时记入 PatientRevision 的操作人。
+    void setCurrentUserId(const QString& userId) { m_userId = userId; }
+
+    // 列标题和表格里显示的文本（性别标签、出生日期、身高体重按固定格式），启动缓存与本模型共用。
+    static QString headerText(const QString& fieldName);
+    static QString displayText(const QString& fieldName, const QVariant& value);
 
-    int sexColumn() const;
-    int dobColumn() const;
-    int heightColumn() const;
-    int weightColumn() const;
-    int ageColumn() const;
+    const Columns& columns() const { return m_columns; }
+    int sexColumn() const { return m_columns.sex; }
+    int dobColumn() const { return m_columns.dob; }
+    int heightColumn() const { return m_columns.height; }
+    int weightColumn() const { return m_columns.weight; }
+    int ageColumn() const { return m_columns.age; }
+
+protected:
+    bool updateRowInTable(int row, const QSqlRecord& values) override;
 
 private:
+    struct DisplayRow
+    {
+        bool valid = false;
+        QString sex;
+        QString dob;
+        QString height;
+        QString weight;
+    };
+
+    void resolveColumns();
+    void invalidateDisplayRows(int first, int last);
+    const DisplayRow& displayRow(int row) const;
     int columnIndex(const QString& fieldName) const;
     static QString escapeLike(const QString& text);
+
+    Columns m_columns;
+    QString m_userId;
+    mutable QVector<DisplayRow> m_displayRows;
 };
 
@@ -0,0 +1,58 @@
+#include "stringpool.h"
+
+StringPool::StringPool()
+{
+    m_strings.append(QString());
+}
+
+StringPool& StringPool::shared()
+{
+    static StringPool inst;
+    return inst;
+}
+
+quint32 StringPool::intern(const QString& text)
+{
+    // 空串也照常分配编号，NULL 由调用方直接用 kNullId 表示。
+    const QString key = text.isNull() ? QStringLiteral("") : text;
+    {
+        QReadLocker locker(&m_lock);
+        const auto it = m_ids.constFind(key);
+        if (it != m_ids.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    const auto it = m_ids.constFind(key);
+    if (it != m_ids.constEnd()) {
+        return it.value();
+    }
+    const auto id = static_cast<quint32>(m_strings.size());
+    m_strings.append(key);
+    m_ids.insert(key, id);
+    m_bytes += static_cast<qint64>(key.size()) * static_cast<qint64>(sizeof(QChar));
+    return id;
+}
+
+QString StringPool::at(quint32 id) const
+{
+    QReadLocker locker(&m_lock);
+    if (id == kNullId || id >= static_cast<quint32>(m_strings.size())) {
+        return {};
+    }
+    return m_strings.at(static_cast<int>(id));
+}
+
+int StringPool::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_strings.size() - 1;
+}
+
+qint64 StringPool::byteSize() const
+{
+    QReadLocker locker(&m_lock);
+    // 字符数据 + 每个条目在 QVector / QHash 中的大致开销。
+    return m_bytes + static_cast<qint64>(m_strings.size()) * static_cast<qint64>(sizeof(QString) * 2 + sizeof(quint32));
+}
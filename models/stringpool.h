@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+// 低基数字符串（科室等）的全局驻留池：同一取值只保存一份，行内仅存 32 位编号。
+// 条目只增不减，不要拿来存姓名、证件号这类高基数的列。
+class StringPool final
+{
+public:
+    // 0 号只表示 NULL；空串有自己的编号。
+    static constexpr quint32 kNullId = 0;
+
+    StringPool();
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    static StringPool& shared();
+
+    quint32 intern(const QString& text);
+    // kNullId 和越界的编号返回空 QString。
+    QString at(quint32 id) const;
+
+    int size() const;
+    qint64 byteSize() const;
+
+private:
+    mutable QReadWriteLock m_lock;
+    QHash<QString, quint32> m_ids;
+    QVector<QString> m_strings;
+    qint64 m_bytes = 0;
+};
@@ -18,7 +18,8 @@ CREATE TABLE IF NOT EXISTS Patient (
   WEIGHT REAL,
   MOBILEPHONE TEXT,
   AGE INTEGER,
-  CREATEDTIMESTAMP TEXT
+  CREATEDTIMESTAMP TEXT,
+  CREATED_MS INTEGER
 );
 
 CREATE TABLE IF NOT EXISTS Department (
@@ -40,10 +41,125 @@ CREATE TABLE IF NOT EXISTS History (
   USER_ID TEXT,
   EVENT TEXT,
   TIMESTAMP TEXT,
+  ACTION INTEGER,
+  ENTITY_TYPE INTEGER,
+  ENTITY_ID TEXT,
+  TEMPLATE_ID INTEGER,
+  DETAIL TEXT,
+  TS_MS INTEGER,
   FOREIGN KEY(USER_ID) REFERENCES User(ID)
     ON UPDATE CASCADE ON DELETE SET NULL
 );
 
+-- 日志消息模板字典：History 只存 TEMPLATE_ID + DETAIL/ENTITY_ID，显示时 %1=DETAIL、%2=ENTITY_ID
+CREATE TABLE IF NOT EXISTS HistoryTemplate (
+  ID INTEGER PRIMARY KEY AUTOINCREMENT,
+  TEXT TEXT NOT NULL UNIQUE
+);
+
+-- 日志文件后端已物化进 History 的最大日志序号（与 History.ID 无关），单行
+CREATE TABLE IF NOT EXISTS HistoryJournalState (MATERIALIZED_SEQ INTEGER NOT NULL);
+INSERT INTO HistoryJournalState(MATERIALIZED_SEQ)
+  SELECT IFNULL((SELECT seq FROM sqlite_sequence WHERE name='History'),0)
+  WHERE NOT EXISTS (SELECT 1 FROM HistoryJournalState);
+
+CREATE INDEX IF NOT EXISTS idx_history_entity ON History(ENTITY_ID, ENTITY_TYPE);
+CREATE INDEX IF NOT EXISTS idx_history_user_action ON History(USER_ID, ACTION);
+
+-- 时间以 UTC 毫秒整数另存一份（TIMESTAMP/CREATEDTIMESTAMP 文本保留用于显示和兼容）
+CREATE INDEX IF NOT EXISTS idx_history_ts ON History(TS_MS);
+CREATE INDEX IF NOT EXISTS idx_patient_created ON Patient(CREATED_MS);
+
+-- 检验结果（HL7 ORU 消息）：(发送应用, 发送机构, MESSAGE_ID, SET_ID) 去重，按身份证关联患者，未关联时 PATIENT_ID 为空
+CREATE TABLE IF NOT EXISTS LabResult (
+  ID INTEGER PRIMARY KEY,
+  SENDING_APP TEXT NOT NULL DEFAULT '',
+  SENDING_FACILITY TEXT NOT NULL DEFAULT '',
+  MESSAGE_ID TEXT NOT NULL,
+  SET_ID INTEGER NOT NULL,
+  PATIENT_ID TEXT,
+  ID_CARD TEXT,
+  ORDER_CODE TEXT,
+  CODE TEXT,
+  NAME TEXT,
+  VALUE TEXT,
+  UNITS TEXT,
+  REF_RANGE TEXT,
+  FLAGS TEXT,
+  STATUS TEXT,
+  OBSERVED_MS INTEGER,
+  RECEIVED_MS INTEGER NOT NULL,
+  FOREIGN KEY(PATIENT_ID) REFERENCES Patient(ID)
+    ON UPDATE CASCADE ON DELETE SET NULL
+);
+
+CREATE INDEX IF NOT EXISTS idx_patient_idcard ON Patient(ID_CARD);
+CREATE UNIQUE INDEX IF NOT EXISTS idx_labresult_source ON LabResult(SENDING_APP, SENDING_FACILITY, MESSAGE_ID, SET_ID);
+CREATE INDEX IF NOT EXISTS idx_labresult_patient ON LabResult(PATIENT_ID, OBSERVED_MS);
+-- 未关联的结果在患者建档或改身份证后补关联
+CREATE INDEX IF NOT EXISTS idx_labresult_unmatched ON LabResult(ID_CARD) WHERE PATIENT_ID IS NULL;
+CREATE TRIGGER IF NOT EXISTS trg_patient_labresult_ins AFTER INSERT ON Patient WHEN NEW.ID_CARD IS NOT NULL
+BEGIN UPDATE LabResult SET PATIENT_ID=NEW.ID WHERE PATIENT_ID IS NULL AND ID_CARD=NEW.ID_CARD; END;
+-- 改身份证时先解除按旧号关联上的结果（旧号属于别的患者时改挂过去）
+CREATE TRIGGER IF NOT EXISTS trg_patient_labresult_upd AFTER UPDATE OF ID_CARD ON Patient WHEN OLD.ID_CARD IS NOT NEW.ID_CARD
+BEGIN
+  UPDATE LabResult SET PATIENT_ID=(SELECT ID FROM Patient WHERE ID_CARD=OLD.ID_CARD LIMIT 1)
+    WHERE PATIENT_ID=NEW.ID AND ID_CARD=OLD.ID_CARD;
+  UPDATE LabResult SET PATIENT_ID=NEW.ID WHERE PATIENT_ID IS NULL AND ID_CARD=NEW.ID_CARD;
+END;
+
+-- 日志全文索引：rowid = History.ID，TOKENS 为程序切好的词（汉字二元组 + 末字，其他按词小写）
+-- 需要 SQLite 编译了 FTS5；程序在建表失败时不建此表，关键字查找退回 LIKE
+CREATE VIRTUAL TABLE IF NOT EXISTS HistoryFts USING fts5(TOKENS);
+-- 建索引前已有日志的补词进度：NEXT_ID 及以下的行尚未入索引
+CREATE TABLE IF NOT EXISTS HistoryFtsBackfill (NEXT_ID INTEGER NOT NULL);
+
+-- 日志保留：超期明细按月搬到 archive/history-yyyy-MM.db，主库保留按天的汇总与归档目录
+CREATE TABLE IF NOT EXISTS HistoryDaily (
+  DAY TEXT NOT NULL,
+  USER_ID TEXT NOT NULL,
+  ACTION INTEGER NOT NULL,
+  COUNT INTEGER NOT NULL,
+  PRIMARY KEY(DAY, USER_ID, ACTION)
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS HistoryArchive (
+  MONTH TEXT PRIMARY KEY,
+  FILE TEXT NOT NULL,
+  MIN_TS INTEGER NOT NULL,
+  MAX_TS INTEGER NOT NULL,
+  ROWS INTEGER NOT NULL DEFAULT 0
+);
+
+-- 表版本号（由触发器维护），用于进程内字典缓存判断是否过期
+CREATE TABLE IF NOT EXISTS TableVersion (
+  NAME TEXT PRIMARY KEY,
+  VERSION INTEGER NOT NULL DEFAULT 0
+);
+
+INSERT OR IGNORE INTO TableVersion(NAME,VERSION) VALUES('Department',0);
+INSERT OR IGNORE INTO TableVersion(NAME,VERSION) VALUES('User',0);
+INSERT OR IGNORE INTO TableVersion(NAME,VERSION) VALUES('HistoryTemplate',0);
+
+CREATE TRIGGER IF NOT EXISTS trg_department_version_ins AFTER INSERT ON Department
+BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='Department'; END;
+CREATE TRIGGER IF NOT EXISTS trg_department_version_upd AFTER UPDATE ON Department
+BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='Department'; END;
+CREATE TRIGGER IF NOT EXISTS trg_department_version_del AFTER DELETE ON Department
+BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='Department'; END;
+CREATE TRIGGER IF NOT EXISTS trg_user_version_ins AFTER INSERT ON User
+BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='User'; END;
+CREATE TRIGGER IF NOT EXISTS trg_user_version_upd AFTER UPDATE ON User
+BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='User'; END;
+CREATE TRIGGER IF NOT EXISTS trg_user_version_del AFTER DELETE ON User
+BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='User'; END;
+CREATE TRIGGER IF NOT EXISTS trg_historytemplate_version_ins AFTER INSERT ON HistoryTemplate
+BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='HistoryTemplate'; END;
+CREATE TRIGGER IF NOT EXISTS trg_historytemplate_version_upd AFTER UPDATE ON HistoryTemplate
+BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='HistoryTemplate'; END;
+CREATE TRIGGER IF NOT EXISTS trg_historytemplate_version_del AFTER DELETE ON HistoryTemplate
+BEGIN UPDATE TableVersion SET VERSION=VERSION+1 WHERE NAME='HistoryTemplate'; END;
+
 -- 默认账号：admin / 123456
 INSERT OR IGNORE INTO User(ID,FULLNAME,USERNAME,PASSWORD)
 VALUES('u-admin','管理员','admin','123456');
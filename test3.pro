@@ -1,50 +1,113 @@
-QT       += core gui widgets sql svg
+QT       += core gui widgets sql svg network
 
 CONFIG += c++17
 
+# 在线备份直接用 SQLite 备份 API 和 zlib，源库另开 C 接口连接，不借用 QSQLITE 驱动的句柄。
+LIBS += -lsqlite3 -lz
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    db/auditjournal.cpp \
+    db/backupmanager.cpp \
     db/dbmanager.cpp \
+    db/deltasync.cpp \
+    db/historyarchiver.cpp \
     db/historylogger.cpp \
+    db/historysearch.cpp \
+    db/lookupcache.cpp \
+    db/patientrevisions.cpp \
+    db/periodicjob.cpp \
+    db/snapshotexporter.cpp \
+    db/streamingloader.cpp \
+    delegates/doctordelegate.cpp \
     delegates/patientdelegate.cpp \
+    io/csv.cpp \
+    io/csvimporter.cpp \
+    io/snapshotwriter.cpp \
+    io/tableexporter.cpp \
+    io/xlsxwriter.cpp \
+    io/zipwriter.cpp \
+    lab/hl7.cpp \
+    lab/labingestor.cpp \
+    lab/labmessage.cpp \
     main.cpp \
     mainwindow.cpp \
+    models/compactrowstore.cpp \
+    models/compacttablemodel.cpp \
     models/departmentmodel.cpp \
     models/doctormodel.cpp \
+    models/historymodel.cpp \
+    models/patientgridcache.cpp \
+    models/patientgridcachewriter.cpp \
     models/patientmodel.cpp \
+    models/stringpool.cpp \
     ui/departmenteditdialog.cpp \
     ui/departmentpage.cpp \
     ui/doctoreditdialog.cpp \
     ui/doctorpage.cpp \
+    ui/exportdialog.cpp \
     ui/historypage.cpp \
     ui/homepage.cpp \
+    ui/importdialog.cpp \
     ui/loginpage.cpp \
     ui/patienteditdialog.cpp \
-    ui/patientpage.cpp
+    ui/patientpage.cpp \
+    ui/patientrevisiondialog.cpp
 
 HEADERS += \
     appinfo.h \
+    db/auditjournal.h \
+    db/backupmanager.h \
     db/dbmanager.h \
+    db/deltasync.h \
+    db/historyarchiver.h \
     db/historylogger.h \
+    db/historysearch.h \
+    db/lookupcache.h \
+    db/mpscqueue.h \
+    db/patientrevisions.h \
+    db/periodicjob.h \
+    db/snapshotexporter.h \
+    db/streamingloader.h \
     entities/patient.h \
     entities/userinfo.h \
+    io/csv.h \
+    io/csvimporter.h \
+    io/snapshotformat.h \
+    io/snapshotwriter.h \
+    io/tableexporter.h \
+    io/xlsxwriter.h \
+    io/zipwriter.h \
+    lab/hl7.h \
+    lab/labingestor.h \
+    lab/labmessage.h \
     mainwindow.h \
+    models/compactrowstore.h \
+    models/compacttablemodel.h \
     models/departmentmodel.h \
     models/doctormodel.h \
+    models/historymodel.h \
+    models/patientgridcache.h \
+    models/patientgridcachewriter.h \
     models/patientmodel.h \
+    models/stringpool.h \
+    delegates/doctordelegate.h \
     delegates/patientdelegate.h \
     ui/departmenteditdialog.h \
     ui/departmentpage.h \
     ui/doctoreditdialog.h \
     ui/doctorpage.h \
+    ui/exportdialog.h \
     ui/historypage.h \
     ui/homepage.h \
+    ui/importdialog.h \
     ui/loginpage.h \
     ui/patienteditdialog.h \
-    ui/patientpage.h
+    ui/patientpage.h \
+    ui/patientrevisiondialog.h
 
 RESOURCES += \
     resources/resources.qrc
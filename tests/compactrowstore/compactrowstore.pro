@@ -0,0 +1,19 @@
+# CompactRowStore：各种编码读回与写入一致，NULL 与空串分开，编码不了的值原样保留。
+QT       += core sql testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_compactrowstore
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../models/compactrowstore.cpp \
+    ../../models/stringpool.cpp \
+    tst_compactrowstore.cpp
+
+HEADERS += \
+    ../../models/compactrowstore.h \
+    ../../models/stringpool.h
@@ -0,0 +1,146 @@
+#include <QtTest>
+
+#include "models/compactrowstore.h"
+#include "models/stringpool.h"
+
+namespace {
+
+using T = CompactRowStore::ColumnType;
+
+const QVector<CompactRowStore::Column> kColumns = {
+    {QStringLiteral("NAME"), T::Text},
+    {QStringLiteral("SEX"), T::Int16},
+    {QStringLiteral("DOB"), T::Date},
+    {QStringLiteral("HEIGHT"), T::Decimal1},
+    {QStringLiteral("CREATEDTIMESTAMP"), T::DateTime},
+    {QStringLiteral("CREATED_MS"), T::Int64},
+    {QStringLiteral("DEPARTMENT_ID"), T::Interned},
+};
+
+// 类型和取值都要一致，NULL 与空串也要分开。
+bool same(const QVariant& a, const QVariant& b)
+{
+    if (a.isNull() || b.isNull()) {
+        return a.isNull() == b.isNull();
+    }
+    return a.typeId() == b.typeId() && a == b;
+}
+
+}
+
+class CompactRowStoreTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void nullAndEmptyDiffer();
+    void setValue();
+    void bytesPerRow();
+};
+
+void CompactRowStoreTest::roundTrip_data()
+{
+    QTest::addColumn<QVariantList>("row");
+
+    QTest::newRow("typical") << QVariantList{QStringLiteral("张三"), qlonglong(1), QStringLiteral("1990-05-17"), 175.2,
+                                             QStringLiteral("2024-03-01T08:15:30"), qlonglong(1709252130000),
+                                             QStringLiteral("D01")};
+    QTest::newRow("nulls") << QVariantList{QVariant(), QVariant(), QVariant(), QVariant(), QVariant(), QVariant(),
+                                           QVariant()};
+    // 超出范围、非规范格式、多于一位小数、类型不符的值不编码，按原值另存。
+    QTest::newRow("spilled") << QVariantList{qlonglong(42), qlonglong(70000), QStringLiteral("1990-5-17"), 175.25,
+                                             QStringLiteral("2024-03-01 08:15:30"), QStringLiteral("now"),
+                                             qlonglong(3)};
+}
+
+void CompactRowStoreTest::roundTrip()
+{
+    QFETCH(QVariantList, row);
+
+    StringPool pool;
+    CompactRowStore store(kColumns, &pool);
+    store.appendRow(QVariantList{QStringLiteral("前一行"), qlonglong(2), QStringLiteral("2000-01-01"), 60.0,
+                                 QStringLiteral("2020-01-01T00:00:00"), qlonglong(0), QStringLiteral("D02")});
+    store.appendRow(row);
+    store.appendRow(QVariantList{QStringLiteral("后一行"), qlonglong(1), QStringLiteral("2001-02-03"), 180.5,
+                                 QStringLiteral("2021-12-31T23:59:59"), qlonglong(-1), QStringLiteral("D01")});
+
+    QCOMPARE(store.rowCount(), 3);
+    for (int c = 0; c < kColumns.size(); ++c) {
+        QVERIFY2(same(store.value(1, c), row.at(c)), qPrintable(kColumns.at(c).name));
+    }
+    QCOMPARE(store.value(0, 0).toString(), QStringLiteral("前一行"));
+    QCOMPARE(store.value(2, 0).toString(), QStringLiteral("后一行"));
+    QCOMPARE(store.value(2, 3).toDouble(), 180.5);
+}
+
+void CompactRowStoreTest::nullAndEmptyDiffer()
+{
+    StringPool pool;
+    CompactRowStore store(kColumns, &pool);
+    const QString empty = QStringLiteral("");
+    store.appendRow(QVariantList{empty, {}, {}, {}, {}, {}, empty});
+    store.appendRow(QVariantList{QVariant(), {}, {}, {}, {}, {}, QVariant()});
+
+    QVERIFY(!store.value(0, 0).isNull());
+    QCOMPARE(store.value(0, 0).toString(), empty);
+    QVERIFY(store.value(1, 0).isNull());
+
+    QVERIFY(!store.value(0, 6).isNull());
+    QCOMPARE(store.value(0, 6).toString(), empty);
+    QVERIFY(store.value(1, 6).isNull());
+    QCOMPARE(pool.size(), 1);
+}
+
+void CompactRowStoreTest::setValue()
+{
+    StringPool pool;
+    CompactRowStore store(kColumns, &pool);
+    for (int i = 0; i < 20; ++i) {
+        store.appendRow(QVariantList{QStringLiteral("n%1").arg(i), qlonglong(i % 2), QStringLiteral("1990-01-01"), 170.0,
+                                     {}, qlonglong(i), QStringLiteral("D01")});
+    }
+
+    store.setValue(9, 0, QStringLiteral("改过的名字"));
+    store.setValue(9, 1, qlonglong(70000));
+    store.setValue(9, 3, 170.15);
+    store.setValue(10, 0, QVariant());
+    store.setValue(10, 6, QStringLiteral("D09"));
+
+    QCOMPARE(store.value(9, 0).toString(), QStringLiteral("改过的名字"));
+    QVERIFY(same(store.value(9, 1), qlonglong(70000)));
+    QVERIFY(same(store.value(9, 3), 170.15));
+    QVERIFY(store.value(10, 0).isNull());
+    QCOMPARE(store.value(10, 6).toString(), QStringLiteral("D09"));
+    // 相邻行不受影响。
+    QCOMPARE(store.value(8, 0).toString(), QStringLiteral("n8"));
+    QCOMPARE(store.value(11, 0).toString(), QStringLiteral("n11"));
+    QCOMPARE(store.value(11, 6).toString(), QStringLiteral("D01"));
+
+    // 改回可编码的值后不再另存。
+    store.setValue(9, 1, qlonglong(1));
+    QVERIFY(same(store.value(9, 1), qlonglong(1)));
+}
+
+void CompactRowStoreTest::bytesPerRow()
+{
+    StringPool pool;
+    CompactRowStore store(kColumns, &pool);
+    QCOMPARE(store.bytesPerRow(), 0.0);
+    const int rows = 10000;
+    store.reserve(rows);
+    for (int i = 0; i < rows; ++i) {
+        store.appendRow(QVariantList{QStringLiteral("患者%1").arg(i), qlonglong(i % 2), QStringLiteral("1990-01-01"),
+                                     170.0, QStringLiteral("2024-03-01T08:15:30"), qlonglong(i),
+                                     QStringLiteral("D%1").arg(i % 10)});
+    }
+    store.squeeze();
+    QVERIFY(store.bytesPerRow() > 0.0);
+    // 定宽部分 2+4+4+8+8+4 字节，文本约 10 字节加偏移和位图，远小于逐行 QVariant。
+    QVERIFY2(store.bytesPerRow() < 64.0, qPrintable(QString::number(store.bytesPerRow())));
+}
+
+QTEST_GUILESS_MAIN(CompactRowStoreTest)
+#include "tst_compactrowstore.moc"
@@ -0,0 +1,17 @@
+# Csv：分块读取在引号内换行处不截断，断点续传与从头读结果一致。
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_csv
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../io/csv.cpp \
+    tst_csv.cpp
+
+HEADERS += \
+    ../../io/csv.h
@@ -0,0 +1,193 @@
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "io/csv.h"
+
+namespace {
+
+// 每隔几行放一个带逗号、引号或换行的字段，保证块边界会落在引号内。
+QVector<QStringList> sampleRows(int count)
+{
+    QVector<QStringList> rows;
+    for (int i = 0; i < count; ++i) {
+        QString note = QStringLiteral("备注%1").arg(i);
+        if (i % 3 == 0) {
+            note += QStringLiteral("\n第二行,含逗号");
+        }
+        if (i % 5 == 0) {
+            note += QStringLiteral(" \"引号\"");
+        }
+        rows.append({QString::number(i), QStringLiteral("姓名%1").arg(i), note});
+    }
+    return rows;
+}
+
+}
+
+class CsvTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void chunksSplitOnlyOutsideQuotes();
+    void seekResumesAtChunkBoundary();
+    void recordLongerThanChunk();
+    void headerWithBom();
+
+private:
+    QString writeFile(const QByteArray& data);
+    // 读完整个文件，逐块解析后拼起来。
+    QVector<Csv::Record> readAll(Csv::ChunkReader* reader, QVector<Csv::ChunkReader::Chunk>* chunks = nullptr);
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+void CsvTest::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+}
+
+void CsvTest::cleanup()
+{
+    m_dir.reset();
+}
+
+QString CsvTest::writeFile(const QByteArray& data)
+{
+    const auto path = m_dir->filePath(QStringLiteral("data.csv"));
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(data) != data.size()) {
+        qWarning("%s", qPrintable(f.errorString()));
+    }
+    return path;
+}
+
+QVector<Csv::Record> CsvTest::readAll(Csv::ChunkReader* reader, QVector<Csv::ChunkReader::Chunk>* chunks)
+{
+    QVector<Csv::Record> records;
+    Csv::ChunkReader::Chunk chunk;
+    QString err;
+    while (reader->next(&chunk, &err)) {
+        records += Csv::parse(chunk.data, chunk.firstLine);
+        if (chunks) {
+            chunks->append(chunk);
+        }
+    }
+    if (!err.isEmpty()) {
+        qWarning("%s", qPrintable(err));
+    }
+    return records;
+}
+
+void CsvTest::chunksSplitOnlyOutsideQuotes()
+{
+    const auto rows = sampleRows(2000);
+    QByteArray data = Csv::formatRecord({QStringLiteral("ID"), QStringLiteral("NAME"), QStringLiteral("NOTE")});
+    QVector<qint64> lines;
+    qint64 line = 2;
+    for (const auto& row : rows) {
+        lines.append(line);
+        const auto record = Csv::formatRecord(row);
+        line += record.count('\n');
+        data += record;
+    }
+
+    Csv::ChunkReader reader(writeFile(data), 4096);
+    QStringList header;
+    QString err;
+    QVERIFY2(reader.open(&header, &err), qPrintable(err));
+    QCOMPARE(header, QStringList({QStringLiteral("ID"), QStringLiteral("NAME"), QStringLiteral("NOTE")}));
+
+    QVector<Csv::ChunkReader::Chunk> chunks;
+    const auto records = readAll(&reader, &chunks);
+    QVERIFY(chunks.size() > 1);
+    QCOMPARE(records.size(), rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        QCOMPARE(records.at(i).fields, rows.at(i));
+        QCOMPARE(records.at(i).line, lines.at(i));
+    }
+
+    // 各块首尾相接，覆盖表头之后的全部内容。
+    QCOMPARE(chunks.constFirst().offset, reader.dataOffset());
+    for (int i = 1; i < chunks.size(); ++i) {
+        QCOMPARE(chunks.at(i).offset, chunks.at(i - 1).endOffset);
+        QCOMPARE(chunks.at(i).firstLine, chunks.at(i - 1).firstLine + chunks.at(i - 1).lines);
+    }
+    QCOMPARE(chunks.constLast().endOffset, qint64(data.size()));
+}
+
+void CsvTest::seekResumesAtChunkBoundary()
+{
+    const auto rows = sampleRows(1000);
+    QByteArray data = Csv::formatRecord({QStringLiteral("ID"), QStringLiteral("NAME"), QStringLiteral("NOTE")});
+    for (const auto& row : rows) {
+        data += Csv::formatRecord(row);
+    }
+    const auto path = writeFile(data);
+
+    QStringList header;
+    QString err;
+    Csv::ChunkReader first(path, 4096);
+    QVERIFY2(first.open(&header, &err), qPrintable(err));
+    QVector<Csv::ChunkReader::Chunk> chunks;
+    const auto all = readAll(&first, &chunks);
+    QVERIFY(chunks.size() > 2);
+
+    // 从中间某块的结尾续读，结果与整读的后半段相同。
+    const auto& stop = chunks.at(chunks.size() / 2);
+    qint64 before = 0;
+    for (const auto& chunk : chunks) {
+        if (chunk.endOffset > stop.endOffset) {
+            break;
+        }
+        before += Csv::parse(chunk.data, chunk.firstLine).size();
+    }
+    Csv::ChunkReader resumed(path, 4096);
+    QVERIFY2(resumed.open(&header, &err), qPrintable(err));
+    QVERIFY2(resumed.seek(stop.endOffset, stop.firstLine + stop.lines, &err), qPrintable(err));
+    const auto rest = readAll(&resumed);
+    QCOMPARE(qint64(rest.size()), qint64(all.size()) - before);
+    for (int i = 0; i < rest.size(); ++i) {
+        QCOMPARE(rest.at(i).fields, all.at(int(before) + i).fields);
+        QCOMPARE(rest.at(i).line, all.at(int(before) + i).line);
+    }
+
+    QVERIFY(!resumed.seek(0, 1, &err));
+}
+
+void CsvTest::recordLongerThanChunk()
+{
+    const QString longField = QString(10000, QLatin1Char('x')) + QStringLiteral("\n,\"") + QString(10000, QLatin1Char('y'));
+    QByteArray data = Csv::formatRecord({QStringLiteral("A"), QStringLiteral("B")});
+    data += Csv::formatRecord({QStringLiteral("1"), longField});
+    data += Csv::formatRecord({QStringLiteral("2"), QStringLiteral("短")});
+
+    Csv::ChunkReader reader(writeFile(data), 4096);
+    QStringList header;
+    QString err;
+    QVERIFY2(reader.open(&header, &err), qPrintable(err));
+    const auto records = readAll(&reader);
+    QCOMPARE(records.size(), 2);
+    QCOMPARE(records.at(0).fields.value(1), longField);
+    QCOMPARE(records.at(1).fields, QStringList({QStringLiteral("2"), QStringLiteral("短")}));
+    QCOMPARE(records.at(1).line, qint64(4));
+}
+
+void CsvTest::headerWithBom()
+{
+    Csv::ChunkReader reader(writeFile(QByteArray("\xEF\xBB\xBFID,NAME\n\n1,张三\n")), 4096);
+    QStringList header;
+    QString err;
+    QVERIFY2(reader.open(&header, &err), qPrintable(err));
+    QCOMPARE(header, QStringList({QStringLiteral("ID"), QStringLiteral("NAME")}));
+    const auto records = readAll(&reader);
+    QCOMPARE(records.size(), 1);
+    QCOMPARE(records.at(0).line, qint64(3));
+}
+
+QTEST_GUILESS_MAIN(CsvTest)
+#include "tst_csv.moc"
@@ -0,0 +1,25 @@
+# Deidentifier：输出库里不再出现源库的用户名和密码，登录日志里的用户名与 User 表换成同一个假名。
+QT       += core sql testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_deidentify
+
+INCLUDEPATH += ../..
+
+LIBS += -lsqlite3
+
+SOURCES += \
+    ../../db/patientrevisions.cpp \
+    ../../tools/datagen/chinaid.cpp \
+    ../../tools/deidentify/deidentifier.cpp \
+    ../../tools/deidentify/pseudonymizer.cpp \
+    tst_deidentify.cpp
+
+HEADERS += \
+    ../../db/patientrevisions.h \
+    ../../tools/datagen/chinaid.h \
+    ../../tools/deidentify/deidentifier.h \
+    ../../tools/deidentify/pseudonymizer.h
@@ -0,0 +1,157 @@
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "db/historylogger.h"
+#include "tools/deidentify/deidentifier.h"
+
+#include <memory>
+
+namespace {
+
+struct Account
+{
+    QString id;
+    QString fullName;
+    QString username;
+    QString password;
+};
+
+const QVector<Account> kAccounts = {
+    {QStringLiteral("u-1"), QStringLiteral("王建国"), QStringLiteral("wangjianguo"), QStringLiteral("Tr0ub4dor&3")},
+    {QStringLiteral("u-2"), QStringLiteral("李秀英"), QStringLiteral("li.xiuying"), QStringLiteral("correct-horse")},
+    {QStringLiteral("u-3"), QStringLiteral("赵敏"), QStringLiteral("赵敏医生"), QStringLiteral("p@ssw0rd!2024")},
+};
+
+const QString kConnection = QStringLiteral("tst_deidentify");
+
+bool exec(QSqlDatabase& db, const QString& sql, const QVariantList& args = {})
+{
+    QSqlQuery q(db);
+    if (!q.prepare(sql)) {
+        qWarning("%s: %s", qPrintable(sql), qPrintable(q.lastError().text()));
+        return false;
+    }
+    for (const auto& v : args) {
+        q.addBindValue(v);
+    }
+    if (!q.exec()) {
+        qWarning("%s: %s", qPrintable(sql), qPrintable(q.lastError().text()));
+        return false;
+    }
+    return true;
+}
+
+}
+
+class DeidentifyTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void noUsernameOrPasswordSurvives();
+
+private:
+    bool makeSource();
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+    QString m_source;
+    QString m_output;
+};
+
+void DeidentifyTest::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    m_source = m_dir->filePath(QStringLiteral("source.db"));
+    m_output = m_dir->filePath(QStringLiteral("anon.db"));
+}
+
+void DeidentifyTest::cleanup()
+{
+    QSqlDatabase::removeDatabase(kConnection);
+    m_dir.reset();
+}
+
+bool DeidentifyTest::makeSource()
+{
+    bool ok = false;
+    {
+        auto db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), kConnection);
+        db.setDatabaseName(m_source);
+        if (!db.open()) {
+            return false;
+        }
+        ok = exec(db, QStringLiteral("CREATE TABLE User (ID TEXT PRIMARY KEY, FULLNAME TEXT, USERNAME TEXT UNIQUE, PASSWORD TEXT);"))
+            && exec(db, QStringLiteral("CREATE TABLE History (ID INTEGER PRIMARY KEY AUTOINCREMENT, USER_ID TEXT, EVENT TEXT,"
+                                       " TIMESTAMP TEXT, ACTION INTEGER, ENTITY_TYPE INTEGER, ENTITY_ID TEXT,"
+                                       " TEMPLATE_ID INTEGER, DETAIL TEXT, TS_MS INTEGER);"));
+        for (const auto& a : kAccounts) {
+            ok = ok
+                && exec(db, QStringLiteral("INSERT INTO User(ID,FULLNAME,USERNAME,PASSWORD) VALUES(?,?,?,?);"),
+                        {a.id, a.fullName, a.username, a.password})
+                // 与登录页一样，登录日志的 DETAIL 记用户名。
+                && exec(db, QStringLiteral("INSERT INTO History(USER_ID,ACTION,ENTITY_TYPE,ENTITY_ID,DETAIL,TS_MS) VALUES(?,?,?,?,?,?);"),
+                        {a.id, int(HistoryLogger::Action::Login), int(HistoryLogger::Entity::User), a.id, a.username,
+                         qint64(1700000000000)});
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(kConnection);
+    return ok;
+}
+
+void DeidentifyTest::noUsernameOrPasswordSurvives()
+{
+    QVERIFY(makeSource());
+
+    Deidentifier::Options opt;
+    opt.source = m_source;
+    opt.output = m_output;
+    opt.key = QByteArrayLiteral("0123456789abcdef-test-key");
+    opt.threads = 2;
+    // 每个分片一行，顺带走一遍多分片合并。
+    opt.shardRows = 1;
+    Deidentifier deidentifier(opt);
+    QString err;
+    QVERIFY2(deidentifier.run(&err), qPrintable(err));
+
+    // 直接查整个文件的字节，任何表、索引里都不应留下原值。
+    QFile file(m_output);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const auto bytes = file.readAll();
+    file.close();
+    for (const auto& a : kAccounts) {
+        QVERIFY2(!bytes.contains(a.username.toUtf8()), qPrintable(a.username));
+        QVERIFY2(!bytes.contains(a.password.toUtf8()), qPrintable(a.password));
+    }
+
+    auto db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), kConnection);
+    db.setDatabaseName(m_output);
+    QVERIFY(db.open());
+    {
+        QSqlQuery q(db);
+        QVERIFY(q.exec(QStringLiteral("SELECT u.USERNAME, u.PASSWORD, h.DETAIL FROM User u"
+                                      " JOIN History h ON h.USER_ID = u.ID AND h.ACTION = %1 ORDER BY u.ID;")
+                           .arg(int(HistoryLogger::Action::Login))));
+        int rows = 0;
+        while (q.next()) {
+            const auto& a = kAccounts.at(rows++);
+            QCOMPARE(q.value(0).toString().size(), a.username.size());
+            QVERIFY(q.value(0).toString() != a.username);
+            QCOMPARE(q.value(1).toString(), QStringLiteral("123456"));
+            // 登录日志里的用户名与 User 表换成同一个假名。
+            QCOMPARE(q.value(2).toString(), q.value(0).toString());
+        }
+        QCOMPARE(rows, int(kAccounts.size()));
+    }
+    db.close();
+}
+
+QTEST_GUILESS_MAIN(DeidentifyTest)
+#include "tst_deidentify.moc"
@@ -0,0 +1,17 @@
+# DeltaSync：两个本地库文件之间的冲突处理与失败重跑。
+QT       += core sql testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_deltasync
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../db/deltasync.cpp \
+    tst_deltasync.cpp
+
+HEADERS += \
+    ../../db/deltasync.h
@@ -0,0 +1,203 @@
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "db/deltasync.h"
+
+namespace {
+
+// 同步涉及的三张表，结构与 sql/schema.sql 一致。
+const char* const kSchema[] = {
+    "CREATE TABLE Department (ID TEXT PRIMARY KEY, NAME TEXT);",
+    "CREATE TABLE Doctor (ID TEXT PRIMARY KEY, EMPLOYEENO TEXT, NAME TEXT, DEPARTMENT_ID TEXT,"
+    " FOREIGN KEY(DEPARTMENT_ID) REFERENCES Department(ID) ON UPDATE CASCADE ON DELETE SET NULL);",
+    "CREATE TABLE Patient (ID TEXT PRIMARY KEY, ID_CARD TEXT, NAME TEXT, SEX INTEGER, DOB TEXT, HEIGHT REAL,"
+    " WEIGHT REAL, MOBILEPHONE TEXT, AGE INTEGER, CREATEDTIMESTAMP TEXT, CREATED_MS INTEGER);",
+};
+
+}
+
+class DeltaSyncTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void syncCopiesRows();
+    void conflictLastWriterWins();
+    void failedApplyCanBeRerun();
+    void lostDeltaIsResentFromPeerPosition();
+
+private:
+    QSqlDatabase open(const QString& name, const QString& path, const QString& options = QString());
+    bool exec(QSqlDatabase& db, const QString& sql);
+    QString patientName(const QSqlDatabase& db, const QString& id);
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+    QSqlDatabase m_a;
+    QSqlDatabase m_b;
+};
+
+QSqlDatabase DeltaSyncTest::open(const QString& name, const QString& path, const QString& options)
+{
+    auto db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), name);
+    db.setDatabaseName(path);
+    db.setConnectOptions(options);
+    if (!db.open()) {
+        qWarning("%s", qPrintable(db.lastError().text()));
+    }
+    return db;
+}
+
+bool DeltaSyncTest::exec(QSqlDatabase& db, const QString& sql)
+{
+    QSqlQuery q(db);
+    if (!q.exec(sql)) {
+        qWarning("%s: %s", qPrintable(sql), qPrintable(q.lastError().text()));
+        return false;
+    }
+    return true;
+}
+
+QString DeltaSyncTest::patientName(const QSqlDatabase& db, const QString& id)
+{
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("SELECT NAME FROM Patient WHERE ID=?;"));
+    q.addBindValue(id);
+    return q.exec() && q.next() ? q.value(0).toString() : QString();
+}
+
+void DeltaSyncTest::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    // B 不等锁，用来制造应用失败。
+    m_a = open(QStringLiteral("a"), m_dir->filePath(QStringLiteral("a.db")));
+    m_b = open(QStringLiteral("b"), m_dir->filePath(QStringLiteral("b.db")), QStringLiteral("QSQLITE_BUSY_TIMEOUT=0"));
+    QVERIFY(m_a.isOpen() && m_b.isOpen());
+    for (auto* db : {&m_a, &m_b}) {
+        for (const char* sql : kSchema) {
+            QVERIFY(exec(*db, QString::fromUtf8(sql)));
+        }
+        QString err;
+        QVERIFY2(DeltaSync::install(*db, &err), qPrintable(err));
+    }
+}
+
+void DeltaSyncTest::cleanup()
+{
+    m_a.close();
+    m_b.close();
+    m_a = QSqlDatabase();
+    m_b = QSqlDatabase();
+    QSqlDatabase::removeDatabase(QStringLiteral("a"));
+    QSqlDatabase::removeDatabase(QStringLiteral("b"));
+    m_dir.reset();
+}
+
+void DeltaSyncTest::syncCopiesRows()
+{
+    QVERIFY(exec(m_a, QStringLiteral("INSERT INTO Department(ID,NAME) VALUES('d1','内科');")));
+    QVERIFY(exec(m_a, QStringLiteral("INSERT INTO Doctor(ID,NAME,DEPARTMENT_ID) VALUES('doc1','张医生','d1');")));
+    QVERIFY(exec(m_b, QStringLiteral("INSERT INTO Patient(ID,NAME) VALUES('p1','李四');")));
+
+    QString err;
+    DeltaSync::Stats aToB;
+    DeltaSync::Stats bToA;
+    QVERIFY2(DeltaSync::syncLocal(m_a, m_b, m_dir->path(), &aToB, &bToA, &err), qPrintable(err));
+    QCOMPARE(aToB.upserts, qint64(2));
+    QCOMPARE(bToA.upserts, qint64(1));
+    QCOMPARE(patientName(m_a, QStringLiteral("p1")), QStringLiteral("李四"));
+
+    QSqlQuery q(m_b);
+    QVERIFY(q.exec(QStringLiteral("SELECT DEPARTMENT_ID FROM Doctor WHERE ID='doc1';")) && q.next());
+    QCOMPARE(q.value(0).toString(), QStringLiteral("d1"));
+
+    // 再同步一轮没有新改动，刚收到的也不会被发回去。
+    QVERIFY2(DeltaSync::syncLocal(m_a, m_b, m_dir->path(), &aToB, &bToA, &err), qPrintable(err));
+    QCOMPARE(aToB.upserts + aToB.deletes, qint64(0));
+    QCOMPARE(bToA.upserts + bToA.deletes, qint64(0));
+}
+
+void DeltaSyncTest::conflictLastWriterWins()
+{
+    QString err;
+    QVERIFY(exec(m_a, QStringLiteral("INSERT INTO Patient(ID,NAME) VALUES('p1','原名');")));
+    QVERIFY2(DeltaSync::syncLocal(m_a, m_b, m_dir->path(), nullptr, nullptr, &err), qPrintable(err));
+
+    // 两边同时改同一行；时间戳直接写死，不依赖两次改动之间的时钟。
+    QVERIFY(exec(m_a, QStringLiteral("UPDATE Patient SET NAME='A 改' WHERE ID='p1';")));
+    QVERIFY(exec(m_b, QStringLiteral("UPDATE Patient SET NAME='B 改' WHERE ID='p1';")));
+    QVERIFY(exec(m_a, QStringLiteral("UPDATE ChangeLog SET TS_MS=1000 WHERE TBL='Patient' AND ROW_ID='p1';")));
+    QVERIFY(exec(m_b, QStringLiteral("UPDATE ChangeLog SET TS_MS=2000 WHERE TBL='Patient' AND ROW_ID='p1';")));
+
+    DeltaSync::Stats aToB;
+    DeltaSync::Stats bToA;
+    QVERIFY2(DeltaSync::syncLocal(m_a, m_b, m_dir->path(), &aToB, &bToA, &err), qPrintable(err));
+    QCOMPARE(aToB.skipped, qint64(1));
+    QCOMPARE(bToA.upserts, qint64(1));
+    QCOMPARE(patientName(m_a, QStringLiteral("p1")), QStringLiteral("B 改"));
+    QCOMPARE(patientName(m_b, QStringLiteral("p1")), QStringLiteral("B 改"));
+
+    // 删除同样按时间戳：较新的删除胜过较旧的修改。
+    QVERIFY(exec(m_a, QStringLiteral("DELETE FROM Patient WHERE ID='p1';")));
+    QVERIFY2(DeltaSync::syncLocal(m_a, m_b, m_dir->path(), nullptr, nullptr, &err), qPrintable(err));
+    QVERIFY(patientName(m_b, QStringLiteral("p1")).isEmpty());
+}
+
+void DeltaSyncTest::failedApplyCanBeRerun()
+{
+    QString err;
+    const auto path = m_dir->filePath(QStringLiteral("a-to-b.delta"));
+    QVERIFY(exec(m_a, QStringLiteral("INSERT INTO Patient(ID,NAME) VALUES('p1','王五');")));
+    QVERIFY2(DeltaSync::exportChanges(m_a, DeltaSync::nodeId(m_b), path, nullptr, &err), qPrintable(err));
+
+    // 另一个连接占着 B 的写锁，应用失败；A 的发送位置这时已经推进，增量文件也随临时目录丢掉。
+    auto blocker = open(QStringLiteral("blocker"), m_b.databaseName());
+    QVERIFY(exec(blocker, QStringLiteral("BEGIN IMMEDIATE;")));
+    QVERIFY(!DeltaSync::applyChanges(m_b, path, nullptr, &err));
+    QVERIFY(exec(blocker, QStringLiteral("ROLLBACK;")));
+    blocker.close();
+    blocker = QSqlDatabase();
+    QSqlDatabase::removeDatabase(QStringLiteral("blocker"));
+    QVERIFY(QFile::remove(path));
+    QVERIFY(patientName(m_b, QStringLiteral("p1")).isEmpty());
+
+    // 直接重跑同步即可补上，不需要手工改 SENT_SEQ。
+    DeltaSync::Stats aToB;
+    QVERIFY2(DeltaSync::syncLocal(m_a, m_b, m_dir->path(), &aToB, nullptr, &err), qPrintable(err));
+    QCOMPARE(aToB.upserts, qint64(1));
+    QCOMPARE(patientName(m_b, QStringLiteral("p1")), QStringLiteral("王五"));
+}
+
+void DeltaSyncTest::lostDeltaIsResentFromPeerPosition()
+{
+    QString err;
+    const auto idA = DeltaSync::nodeId(m_a);
+    const auto idB = DeltaSync::nodeId(m_b);
+    const auto path = m_dir->filePath(QStringLiteral("lost.delta"));
+
+    QVERIFY(exec(m_a, QStringLiteral("INSERT INTO Patient(ID,NAME) VALUES('p1','赵六');")));
+    QVERIFY2(DeltaSync::exportChanges(m_a, idB, path, nullptr, &err), qPrintable(err));
+    QVERIFY(QFile::remove(path));
+
+    // 按本库发送位置导出的下一份缺了前一段，对方拒收。
+    QVERIFY(exec(m_a, QStringLiteral("INSERT INTO Patient(ID,NAME) VALUES('p2','钱七');")));
+    QVERIFY2(DeltaSync::exportChanges(m_a, idB, path, nullptr, &err), qPrintable(err));
+    QVERIFY(!DeltaSync::applyChanges(m_b, path, nullptr, &err));
+
+    // 从对方已确认的位置重发即可。
+    const qint64 ack = DeltaSync::receivedSeq(m_b, idA, &err);
+    QCOMPARE(ack, qint64(0));
+    QVERIFY2(DeltaSync::exportChangesSince(m_a, idB, ack, path, nullptr, &err), qPrintable(err));
+    QVERIFY2(DeltaSync::applyChanges(m_b, path, nullptr, &err), qPrintable(err));
+    QCOMPARE(patientName(m_b, QStringLiteral("p1")), QStringLiteral("赵六"));
+    QCOMPARE(patientName(m_b, QStringLiteral("p2")), QStringLiteral("钱七"));
+}
+
+QTEST_GUILESS_MAIN(DeltaSyncTest)
+#include "tst_deltasync.moc"
@@ -0,0 +1,19 @@
+# HL7 切分、取字段与检验结果消息解析。
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_hl7
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../lab/hl7.cpp \
+    ../../lab/labmessage.cpp \
+    tst_hl7.cpp
+
+HEADERS += \
+    ../../lab/hl7.h \
+    ../../lab/labmessage.h
@@ -0,0 +1,186 @@
+#include <QDateTime>
+#include <QtTest>
+
+#include "lab/hl7.h"
+#include "lab/labmessage.h"
+
+namespace {
+
+QByteArray oru(const QByteArray& controlId, const QByteArray& app = "LIS")
+{
+    return "MSH|^~\\&|" + app + "|LAB|HIS|HOSP|20240301083000||ORU^R01|" + controlId + "|P|2.5\r"
+           "PID|1||110101199001011234^^^HOSP||张三\r"
+           "OBR|1||S001|CBC^血常规|||20240301080000+0800\r"
+           "OBX|1|NM|WBC^白细胞||6.5|10*9/L|3.5-9.5|N|||F\r"
+           "OBX|2|NM|HGB^血红蛋白||98|g/L|115-150|L|||F|||20240301081500+0800\r";
+}
+
+QByteArray mllp(const QByteArray& message)
+{
+    return '\x0B' + message + "\x1C\r";
+}
+
+}
+
+class Hl7Test : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void splitMllpFrames();
+    void splitRawText();
+    void streamWaitsForCompleteFrame();
+    void fieldsAndComponents();
+    void textUnescapes();
+    void parseTimestamp();
+    void parseLabMessage();
+    void acknowledgementEchoesControlId();
+};
+
+void Hl7Test::splitMllpFrames()
+{
+    const QByteArray data = mllp(oru("1")) + mllp(oru("2"));
+    qsizetype pos = 0;
+    QByteArrayView message;
+    QVERIFY(Hl7Stream::split(data, &pos, &message, false));
+    QCOMPARE(Hl7Message(message).field(Hl7Message(message).segment("MSH"), 10).toByteArray(), QByteArray("1"));
+    QVERIFY(Hl7Stream::split(data, &pos, &message, false));
+    QVERIFY(message.startsWith("MSH"));
+    QVERIFY(!Hl7Stream::split(data, &pos, &message, false));
+    QCOMPARE(pos, data.size());
+}
+
+void Hl7Test::splitRawText()
+{
+    // 文件里的裸文本，行尾被改成了 LF；最后一条要到 atEnd 才算完整。
+    QByteArray first = oru("1");
+    QByteArray second = oru("2");
+    first.replace('\r', '\n');
+    second.replace('\r', '\n');
+    const QByteArray data = first + second;
+
+    qsizetype pos = 0;
+    QByteArrayView message;
+    QVERIFY(Hl7Stream::split(data, &pos, &message, false));
+    QCOMPARE(message.toByteArray(), first.chopped(1));
+    QVERIFY(!Hl7Stream::split(data, &pos, &message, false));
+    QVERIFY(Hl7Stream::split(data, &pos, &message, true));
+    QCOMPARE(message.toByteArray(), second.chopped(1));
+}
+
+void Hl7Test::streamWaitsForCompleteFrame()
+{
+    const QByteArray frame = mllp(oru("1"));
+    Hl7Stream stream;
+    QByteArrayView message;
+    stream.feed(QByteArrayView(frame).first(20));
+    QVERIFY(!stream.next(&message));
+    stream.feed(QByteArrayView(frame).sliced(20));
+    QVERIFY(stream.next(&message));
+    QCOMPARE(message.toByteArray(), oru("1").chopped(1));
+    QVERIFY(!stream.next(&message));
+    QCOMPARE(stream.discarded(), qsizetype(0));
+}
+
+void Hl7Test::fieldsAndComponents()
+{
+    const QByteArray raw = oru("42");
+    const Hl7Message m(raw);
+    QVERIFY(m.isValid());
+    QCOMPARE(m.fieldSeparator(), '|');
+    QCOMPARE(m.encodingCharacters(), QByteArray("^~\\&"));
+
+    // MSH-1 是分隔符本身，MSH-2 是编码字符。
+    const QByteArrayView msh = m.segment("MSH");
+    QCOMPARE(m.field(msh, 1).toByteArray(), QByteArray("|"));
+    QCOMPARE(m.field(msh, 2).toByteArray(), QByteArray("^~\\&"));
+    QCOMPARE(m.field(msh, 3).toByteArray(), QByteArray("LIS"));
+    QCOMPARE(m.component(m.field(msh, 9), 2).toByteArray(), QByteArray("R01"));
+    QCOMPARE(m.field(msh, 10).toByteArray(), QByteArray("42"));
+
+    const QByteArrayView obx = m.segment("OBX", 1);
+    QCOMPARE(Hl7Message::segmentId(obx).toByteArray(), QByteArray("OBX"));
+    QCOMPARE(m.text(m.component(m.field(obx, 3), 2)), QStringLiteral("血红蛋白"));
+    QVERIFY(m.segment("OBX", 2).isEmpty());
+    QVERIFY(m.field(obx, 40).isEmpty());
+
+    QVERIFY(!Hl7Message(QByteArrayView("PID|1")).isValid());
+}
+
+void Hl7Test::textUnescapes()
+{
+    const Hl7Message m(QByteArrayView("MSH|^~\\&|A"));
+    QCOMPARE(m.text("a\\F\\b\\S\\c\\T\\d\\R\\e\\E\\f"), QStringLiteral("a|b^c&d~e\\f"));
+    QCOMPARE(m.text("line1\\.br\\line2"), QStringLiteral("line1\nline2"));
+    QCOMPARE(m.text("plain"), QStringLiteral("plain"));
+}
+
+void Hl7Test::parseTimestamp()
+{
+    const qint64 utc = QDateTime::fromString(QStringLiteral("2024-03-01T00:00:00Z"), Qt::ISODate).toMSecsSinceEpoch();
+    QCOMPARE(LabMessage::parseTimestamp("20240301080000+0800"), utc);
+    QCOMPARE(LabMessage::parseTimestamp("20240301000000.25+0000"), utc + 250);
+    QCOMPARE(LabMessage::parseTimestamp("20240229-0130"), utc - 24 * 3600000 + 90 * 60000);
+    QCOMPARE(LabMessage::parseTimestamp("202403011200"),
+             QDateTime(QDate(2024, 3, 1), QTime(12, 0)).toMSecsSinceEpoch());
+    QCOMPARE(LabMessage::parseTimestamp("20241301"), qint64(0));
+    QCOMPARE(LabMessage::parseTimestamp("abc"), qint64(0));
+    QCOMPARE(LabMessage::parseTimestamp(""), qint64(0));
+}
+
+void Hl7Test::parseLabMessage()
+{
+    const QByteArray raw = oru("42", "ANALYZER^1");
+    LabMessage lab;
+    QString err;
+    QVERIFY2(LabMessage::parse(Hl7Message(raw), &lab, &err), qPrintable(err));
+    QCOMPARE(lab.sendingApplication, QStringLiteral("ANALYZER"));
+    QCOMPARE(lab.sendingFacility, QStringLiteral("LAB"));
+    QCOMPARE(lab.controlId, QStringLiteral("42"));
+    QCOMPARE(lab.idCard, QStringLiteral("110101199001011234"));
+    QCOMPARE(lab.observations.size(), 2);
+
+    const qint64 orderMs = LabMessage::parseTimestamp("20240301080000+0800");
+    const auto& wbc = lab.observations.at(0);
+    QCOMPARE(wbc.setId, 1);
+    QCOMPARE(wbc.orderCode, QStringLiteral("CBC"));
+    QCOMPARE(wbc.code, QStringLiteral("WBC"));
+    QCOMPARE(wbc.value, QStringLiteral("6.5"));
+    QCOMPARE(wbc.units, QStringLiteral("10*9/L"));
+    QCOMPARE(wbc.status, QStringLiteral("F"));
+    QCOMPARE(wbc.observedMs, orderMs);
+
+    const auto& hgb = lab.observations.at(1);
+    QCOMPARE(hgb.setId, 2);
+    QCOMPARE(hgb.flags, QStringLiteral("L"));
+    QCOMPARE(hgb.observedMs, orderMs + 15 * 60000);
+
+    QVERIFY(!LabMessage::parse(Hl7Message(QByteArrayView("MSH|^~\\&|A|B|C|D|1||ADT^A01|7|P|2.5\r")), &lab, &err));
+    QVERIFY(!LabMessage::parse(Hl7Message(QByteArrayView("MSH|^~\\&|A|B|C|D|1||ORU^R01|7|P|2.5\r")), &lab, &err));
+}
+
+void Hl7Test::acknowledgementEchoesControlId()
+{
+    const QByteArray raw = oru("42");
+    const QByteArray ack = LabMessage::acknowledgement(Hl7Message(raw), false, QStringLiteral("写库失败|重发"));
+    QVERIFY(ack.startsWith('\x0B'));
+    QVERIFY(ack.endsWith("\x1C\r"));
+
+    QByteArrayView message;
+    qsizetype pos = 0;
+    QVERIFY(Hl7Stream::split(ack, &pos, &message, false));
+    const Hl7Message m(message);
+    QVERIFY(m.isValid());
+    const QByteArrayView msh = m.segment("MSH");
+    QCOMPARE(m.field(msh, 3).toByteArray(), QByteArray("HIS"));
+    QCOMPARE(m.field(msh, 5).toByteArray(), QByteArray("LIS"));
+    QCOMPARE(m.field(msh, 9).toByteArray(), QByteArray("ACK^R01"));
+
+    const QByteArrayView msa = m.segment("MSA");
+    QCOMPARE(m.field(msa, 1).toByteArray(), QByteArray("AR"));
+    QCOMPARE(m.field(msa, 2).toByteArray(), QByteArray("42"));
+    QCOMPARE(m.text(m.field(msa, 3)), QStringLiteral("写库失败|重发"));
+}
+
+QTEST_GUILESS_MAIN(Hl7Test)
+#include "tst_hl7.moc"
@@ -0,0 +1,19 @@
+# Pseudonymizer：同一密钥下假名稳定，换密钥就变；身份证号、手机号保留的部分不变。
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_pseudonymizer
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../tools/datagen/chinaid.cpp \
+    ../../tools/deidentify/pseudonymizer.cpp \
+    tst_pseudonymizer.cpp
+
+HEADERS += \
+    ../../tools/datagen/chinaid.h \
+    ../../tools/deidentify/pseudonymizer.h
@@ -0,0 +1,109 @@
+#include <QtTest>
+
+#include "tools/datagen/chinaid.h"
+#include "tools/deidentify/pseudonymizer.h"
+
+class PseudonymizerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sameKeySameResult();
+    void differentKeyDifferentResult();
+    void idCardKeepsRegionDateAndSex();
+    void mobileKeepsPrefix();
+    void nameAndTextKeepShape();
+};
+
+void PseudonymizerTest::sameKeySameResult()
+{
+    // 两个实例各自从头算，与缓存无关；同一实例反复调用结果也不变。
+    Pseudonymizer a(QByteArrayLiteral("secret"));
+    Pseudonymizer b(QByteArrayLiteral("secret"));
+    const QStringList names = {QStringLiteral("张三"), QStringLiteral("李四"), QStringLiteral("欧阳娜娜")};
+    for (const auto& n : names) {
+        const auto first = a.name(n);
+        QCOMPARE(a.name(n), first);
+        QCOMPARE(b.name(n), first);
+    }
+    QCOMPARE(a.idCard(QStringLiteral("110105199001011234")), b.idCard(QStringLiteral("110105199001011234")));
+    QCOMPARE(a.mobile(QStringLiteral("13812345678")), b.mobile(QStringLiteral("13812345678")));
+    QCOMPARE(a.text(QStringLiteral("门诊 3 号楼")), b.text(QStringLiteral("门诊 3 号楼")));
+    QCOMPARE(a.name(QString()), QString());
+
+    // 不同种类的值即使原文相同，假名也互不相关。
+    QVERIFY(a.name(QStringLiteral("王小明")) != a.text(QStringLiteral("王小明")));
+}
+
+void PseudonymizerTest::differentKeyDifferentResult()
+{
+    Pseudonymizer a(QByteArrayLiteral("key-a"));
+    Pseudonymizer b(QByteArrayLiteral("key-b"));
+    // 后 8 位随机，两把密钥碰巧相同的概率可以忽略。
+    for (int i = 0; i < 20; ++i) {
+        const auto mobile = QStringLiteral("139%1").arg(i, 8, 10, QLatin1Char('0'));
+        QVERIFY(a.mobile(mobile) != b.mobile(mobile));
+    }
+}
+
+void PseudonymizerTest::idCardKeepsRegionDateAndSex()
+{
+    Pseudonymizer p(QByteArrayLiteral("secret"));
+    const QStringList ids = {ChinaId::make(QStringLiteral("110105"), QDate(1990, 1, 1), 123, 1),
+                             ChinaId::make(QStringLiteral("440304"), QDate(1985, 12, 31), 456, 0),
+                             ChinaId::make(QStringLiteral("310115"), QDate(2001, 6, 15), 7, 1)};
+    for (const auto& id : ids) {
+        QVERIFY(ChinaId::isValid(id));
+        const auto out = p.idCard(id);
+        QCOMPARE(out.size(), 18);
+        QVERIFY2(ChinaId::isValid(out), qPrintable(out));
+        QCOMPARE(out.left(2), id.left(2));
+        QCOMPARE(out.mid(6, 8), id.mid(6, 8));
+        QCOMPARE(out.at(16).digitValue() % 2, id.at(16).digitValue() % 2);
+    }
+
+    // 15 位旧号同样保留出生日期和性别位，不加校验码。
+    const auto old = QStringLiteral("110105900101123");
+    const auto out = p.idCard(old);
+    QCOMPARE(out.size(), 15);
+    QCOMPARE(out.left(2), old.left(2));
+    QCOMPARE(out.mid(6, 6), old.mid(6, 6));
+    QCOMPARE(out.at(14).digitValue() % 2, old.at(14).digitValue() % 2);
+
+    // 格式不对的按自由文本处理，长度和字符类别不变。
+    const auto bad = p.idCard(QStringLiteral("ABC-123"));
+    QCOMPARE(bad.size(), 7);
+    QCOMPARE(bad.at(3), QLatin1Char('-'));
+}
+
+void PseudonymizerTest::mobileKeepsPrefix()
+{
+    Pseudonymizer p(QByteArrayLiteral("secret"));
+    const auto out = p.mobile(QStringLiteral("18612345678"));
+    QCOMPARE(out.size(), 11);
+    QVERIFY(out.startsWith(QStringLiteral("186")));
+    for (const auto c : out) {
+        QVERIFY(c.isDigit());
+    }
+}
+
+void PseudonymizerTest::nameAndTextKeepShape()
+{
+    Pseudonymizer p(QByteArrayLiteral("secret"));
+    const auto name = p.name(QStringLiteral("欧阳娜娜"));
+    QCOMPARE(name.size(), 4);
+    for (const auto c : name) {
+        QVERIFY(c.unicode() >= 0x4E00 && c.unicode() <= 0x9FFF);
+    }
+
+    const auto text = p.text(QStringLiteral("Room 12，三楼"));
+    QCOMPARE(text.size(), 10);
+    QVERIFY(text.at(0).isUpper());
+    QVERIFY(text.at(1).isLower());
+    QCOMPARE(text.at(4), QLatin1Char(' '));
+    QVERIFY(text.at(5).isDigit() && text.at(6).isDigit());
+    QCOMPARE(text.at(7), QChar(0xFF0C));
+}
+
+QTEST_GUILESS_MAIN(PseudonymizerTest)
+#include "tst_pseudonymizer.moc"
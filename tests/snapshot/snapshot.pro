@@ -0,0 +1,22 @@
+# 列式快照：SnapshotWriter 写出的 .hcol 由 tools/snapshot 的 SnapshotReader 读回，逐行一致。
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_snapshot
+
+INCLUDEPATH += ../..
+
+LIBS += -lz
+
+SOURCES += \
+    ../../io/snapshotwriter.cpp \
+    ../../tools/snapshot/snapshotreader.cpp \
+    tst_snapshot.cpp
+
+HEADERS += \
+    ../../io/snapshotformat.h \
+    ../../io/snapshotwriter.h \
+    ../../tools/snapshot/snapshotreader.h
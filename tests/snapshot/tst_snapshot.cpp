@@ -0,0 +1,167 @@
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "io/snapshotwriter.h"
+#include "tools/snapshot/snapshotreader.h"
+
+#include <limits>
+#include <set>
+
+using SnapshotFormat::Type;
+
+namespace {
+
+// 行数跨两个行组。
+constexpr int kRows = SnapshotFormat::kRowsPerGroup + 1000;
+
+// 各列的取值让写入端分别选中 Delta、Rle、Plain、Dict 编码，并带空值和极值。
+QVariantList rowAt(int i)
+{
+    const quint64 mixed = quint64(i) * 6364136223846793005ull + 1442695040888963407ull;
+    QVariant random = qint64(mixed);
+    if (i == 1) {
+        random = std::numeric_limits<qint64>::min();
+    } else if (i == 2) {
+        random = std::numeric_limits<qint64>::max();
+    } else if (i % 7 == 0) {
+        random = QVariant();
+    }
+    QVariant amount = i % 5 == 0 ? QVariant() : QVariant(i * 0.25 - 100);
+    QVariant note = QStringLiteral("备注-%1").arg(i);
+    if (i % 11 == 0) {
+        note = QVariant();
+    } else if (i % 13 == 0) {
+        note = QString();
+    }
+    return {qint64(i) * 3, qint64(i / 1000), random, amount, i % 3 == 0 ? QStringLiteral("女") : QStringLiteral("男"), note};
+}
+
+}
+
+class SnapshotTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void roundTrip();
+    void unconvertibleValueIsAnError();
+
+private:
+    std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+void SnapshotTest::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+}
+
+void SnapshotTest::cleanup()
+{
+    m_dir.reset();
+}
+
+void SnapshotTest::roundTrip()
+{
+    const auto path = m_dir->filePath(QStringLiteral("t.hcol"));
+    const QVector<SnapshotWriter::Column> columns = {
+        {QStringLiteral("SEQ"), Type::Int64},
+        {QStringLiteral("BUCKET"), Type::Int64},
+        {QStringLiteral("RANDOM"), Type::Int64},
+        {QStringLiteral("AMOUNT"), Type::Double},
+        {QStringLiteral("SEX"), Type::String},
+        {QStringLiteral("NOTE"), Type::String},
+    };
+
+    QString err;
+    SnapshotWriter writer(path);
+    QVERIFY2(writer.open(1234567890123, &err), qPrintable(err));
+    QVERIFY2(writer.beginTable(QStringLiteral("Sample"), columns, &err), qPrintable(err));
+    for (int i = 0; i < kRows; ++i) {
+        QVERIFY2(writer.addRow(rowAt(i), &err), qPrintable(err));
+    }
+    // 空表也要能读回。
+    QVERIFY2(writer.beginTable(QStringLiteral("Empty"), {{QStringLiteral("ID"), Type::String}}, &err), qPrintable(err));
+    QVERIFY2(writer.close(&err), qPrintable(err));
+
+    SnapshotReader reader;
+    std::string error;
+    QVERIFY2(reader.open(QFile::encodeName(path).toStdString(), &error), error.c_str());
+    QCOMPARE(reader.createdMs(), std::int64_t(1234567890123));
+    QCOMPARE(reader.tables().size(), std::size_t(2));
+    const auto* empty = reader.table("Empty");
+    QVERIFY(empty);
+    QCOMPARE(empty->rows, std::uint64_t(0));
+
+    const auto* table = reader.table("Sample");
+    QVERIFY(table);
+    QCOMPARE(table->rows, std::uint64_t(kRows));
+    QCOMPARE(table->groups.size(), std::size_t(2));
+    QCOMPARE(table->columns.size(), std::size_t(columns.size()));
+    QCOMPARE(table->column("NOTE"), 5);
+    QCOMPARE(table->column("MISSING"), -1);
+
+    std::set<SnapshotFormat::Encoding> encodings;
+    int base = 0;
+    for (std::size_t g = 0; g < table->groups.size(); ++g) {
+        const auto& group = table->groups.at(g);
+        for (std::size_t c = 0; c < table->columns.size(); ++c) {
+            encodings.insert(group.chunks.at(c).encoding);
+            SnapshotReader::Vector v;
+            QVERIFY2(reader.read(*table, g, c, &v, &error), error.c_str());
+            QCOMPARE(v.size(), std::size_t(group.rows));
+            for (std::size_t r = 0; r < v.size(); ++r) {
+                const auto expected = rowAt(base + int(r)).at(int(c));
+                QCOMPARE(v.isNull(r), expected.isNull());
+                if (expected.isNull()) {
+                    continue;
+                }
+                switch (table->columns.at(c).type) {
+                case Type::Int64:
+                    QCOMPARE(qint64(v.ints.at(r)), expected.toLongLong());
+                    break;
+                case Type::Double:
+                    QCOMPARE(v.reals.at(r), expected.toDouble());
+                    break;
+                case Type::String:
+                    QCOMPARE(QString::fromStdString(v.texts.at(r)), expected.toString());
+                    break;
+                }
+            }
+        }
+        base += int(group.rows);
+    }
+    QVERIFY(encodings.count(SnapshotFormat::Encoding::Plain));
+    QVERIFY(encodings.count(SnapshotFormat::Encoding::Delta));
+    QVERIFY(encodings.count(SnapshotFormat::Encoding::Rle));
+    QVERIFY(encodings.count(SnapshotFormat::Encoding::Dict));
+
+    // 行组统计：SEQ 在第二组从 kRowsPerGroup*3 开始，第一组可以跳过。
+    const auto& seq = table->columns.at(0).stats;
+    QCOMPARE(seq.minInt, std::int64_t(0));
+    QCOMPARE(seq.maxInt, std::int64_t(kRows - 1) * 3);
+    const std::int64_t lo = std::int64_t(SnapshotFormat::kRowsPerGroup) * 3;
+    QVERIFY(!SnapshotReader::mayContain(table->groups.at(0).chunks.at(0).stats, lo, lo));
+    QVERIFY(SnapshotReader::mayContain(table->groups.at(1).chunks.at(0).stats, lo, lo));
+    QCOMPARE(table->columns.at(2).stats.minInt, std::numeric_limits<std::int64_t>::min());
+    QCOMPARE(table->columns.at(2).stats.maxInt, std::numeric_limits<std::int64_t>::max());
+}
+
+void SnapshotTest::unconvertibleValueIsAnError()
+{
+    SnapshotWriter writer(m_dir->filePath(QStringLiteral("bad.hcol")));
+    QString err;
+    QVERIFY2(writer.open(0, &err), qPrintable(err));
+    QVERIFY2(writer.beginTable(QStringLiteral("Patient"), {{QStringLiteral("AGE"), Type::Int64}}, &err), qPrintable(err));
+    QVERIFY2(writer.addRow({qint64(30)}, &err), qPrintable(err));
+    QVERIFY(!writer.addRow({QStringLiteral("三十")}, &err));
+    QVERIFY(err.contains(QStringLiteral("AGE")));
+    QVERIFY(err.contains(QStringLiteral("三十")));
+    QVERIFY(err.contains(QStringLiteral("第 2 行")));
+}
+
+QTEST_GUILESS_MAIN(SnapshotTest)
+#include "tst_snapshot.moc"
@@ -0,0 +1,12 @@
+# 不依赖界面的组件的单元测试（Qt Test）；qmake && make check 全部运行。
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    compactrowstore \
+    csv \
+    deidentify \
+    deltasync \
+    hl7 \
+    pseudonymizer \
+    snapshot \
+    zip
@@ -0,0 +1,206 @@
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+
+#include "io/xlsxwriter.h"
+#include "io/zipwriter.h"
+
+#include <zlib.h>
+
+namespace {
+
+struct ZipEntry
+{
+    QByteArray name;
+    quint16 method = 0;
+    quint32 crc = 0;
+    QByteArray data;
+};
+
+quint16 get16(const QByteArray& b, qsizetype at)
+{
+    return qFromLittleEndian<quint16>(b.constData() + at);
+}
+
+quint32 get32(const QByteArray& b, qsizetype at)
+{
+    return qFromLittleEndian<quint32>(b.constData() + at);
+}
+
+QByteArray inflateRaw(const QByteArray& in, qint64 size)
+{
+    // 多留一个字节，解压结果比声明的大小长时能发现。
+    QByteArray out(size + 1, Qt::Uninitialized);
+    z_stream z{};
+    if (inflateInit2(&z, -MAX_WBITS) != Z_OK) {
+        return {};
+    }
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.constData()));
+    z.avail_in = uInt(in.size());
+    z.next_out = reinterpret_cast<Bytef*>(out.data());
+    z.avail_out = uInt(out.size());
+    const int rc = inflate(&z, Z_FINISH);
+    inflateEnd(&z);
+    if (rc != Z_STREAM_END || qint64(z.total_out) != size) {
+        return {};
+    }
+    out.resize(size);
+    return out;
+}
+
+// 与解压程序一样只按中央目录定位条目；本地头里的大小是 0，不能用。
+bool readZip(const QString& path, QVector<ZipEntry>* entries)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray all = f.readAll();
+    const qsizetype eocd = all.lastIndexOf(QByteArray("PK\x05\x06", 4));
+    if (eocd < 0 || eocd + 22 > all.size()) {
+        return false;
+    }
+    const int count = get16(all, eocd + 10);
+    qsizetype p = get32(all, eocd + 16);
+    for (int i = 0; i < count; ++i) {
+        if (get32(all, p) != 0x02014b50) {
+            return false;
+        }
+        ZipEntry e;
+        e.method = get16(all, p + 10);
+        e.crc = get32(all, p + 16);
+        const quint32 compressed = get32(all, p + 20);
+        const quint32 size = get32(all, p + 24);
+        const int nameLen = get16(all, p + 28);
+        const int extraLen = get16(all, p + 30);
+        const int commentLen = get16(all, p + 32);
+        const quint32 offset = get32(all, p + 42);
+        e.name = all.mid(p + 46, nameLen);
+        p += 46 + nameLen + extraLen + commentLen;
+
+        if (get32(all, offset) != 0x04034b50) {
+            return false;
+        }
+        const qsizetype dataAt = offset + 30 + get16(all, offset + 26) + get16(all, offset + 28);
+        const QByteArray raw = all.mid(dataAt, compressed);
+        e.data = e.method == 8 ? inflateRaw(raw, size) : raw;
+        if (qint64(e.data.size()) != size) {
+            return false;
+        }
+        // 数据后紧跟数据描述符，内容与中央目录一致。
+        const qsizetype desc = dataAt + compressed;
+        if (get32(all, desc) != 0x08074b50 || get32(all, desc + 4) != e.crc || get32(all, desc + 8) != compressed
+            || get32(all, desc + 12) != size) {
+            return false;
+        }
+        entries->append(e);
+    }
+    return true;
+}
+
+quint32 crcOf(const QByteArray& data)
+{
+    return quint32(crc32(0, reinterpret_cast<const Bytef*>(data.constData()), uInt(data.size())));
+}
+
+}
+
+class ZipTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void entriesRoundTrip();
+    void xlsxPackage();
+
+private:
+    std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+void ZipTest::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+}
+
+void ZipTest::cleanup()
+{
+    m_dir.reset();
+}
+
+void ZipTest::entriesRoundTrip()
+{
+    // 大条目分多次写入，跨过压缩输出缓冲区的大小。
+    QByteArray big;
+    for (int i = 0; i < 50000; ++i) {
+        big += "第" + QByteArray::number(i) + "行,张三,13800000000\r\n";
+    }
+    const QByteArray small("hello");
+
+    const auto path = m_dir->filePath(QStringLiteral("out.zip"));
+    ZipWriter zip(path);
+    QString err;
+    QVERIFY2(zip.open(&err), qPrintable(err));
+    QVERIFY2(zip.beginEntry(QStringLiteral("数据/big.csv"), &err), qPrintable(err));
+    for (qsizetype at = 0; at < big.size(); at += 10000) {
+        QVERIFY2(zip.write(big.mid(at, 10000), &err), qPrintable(err));
+    }
+    QVERIFY2(zip.endEntry(&err), qPrintable(err));
+    QVERIFY2(zip.beginEntry(QStringLiteral("empty.txt"), &err), qPrintable(err));
+    // 不显式 endEntry，下一个 beginEntry 会补上。
+    QVERIFY2(zip.beginEntry(QStringLiteral("small.txt"), &err), qPrintable(err));
+    QVERIFY2(zip.write(small, &err), qPrintable(err));
+    QVERIFY2(zip.close(&err), qPrintable(err));
+
+    QVector<ZipEntry> entries;
+    QVERIFY(readZip(path, &entries));
+    QCOMPARE(entries.size(), 3);
+    QCOMPARE(QString::fromUtf8(entries.at(0).name), QStringLiteral("数据/big.csv"));
+    QCOMPARE(entries.at(0).method, quint16(8));
+    QCOMPARE(entries.at(0).data, big);
+    QCOMPARE(entries.at(0).crc, crcOf(big));
+    QCOMPARE(entries.at(1).data, QByteArray());
+    QCOMPARE(entries.at(2).data, small);
+    QCOMPARE(entries.at(2).crc, crcOf(small));
+
+    // 重复内容应当确实被压缩了。
+    QVERIFY(QFileInfo(path).size() < big.size() / 4);
+}
+
+void ZipTest::xlsxPackage()
+{
+    const auto path = m_dir->filePath(QStringLiteral("out.xlsx"));
+    XlsxWriter xlsx(path);
+    QString err;
+    QVERIFY2(xlsx.open({QStringLiteral("ID"), QStringLiteral("姓名")}, &err), qPrintable(err));
+    QVERIFY2(xlsx.addRow({42, QStringLiteral("A&B <C>")}, &err), qPrintable(err));
+    QVERIFY2(xlsx.addRow({QVariant(), QStringLiteral("李四")}, &err), qPrintable(err));
+    QVERIFY2(xlsx.close(&err), qPrintable(err));
+
+    QVector<ZipEntry> entries;
+    QVERIFY(readZip(path, &entries));
+    QStringList names;
+    QByteArray sheet;
+    for (const auto& e : std::as_const(entries)) {
+        names << QString::fromUtf8(e.name);
+        if (e.name == "xl/worksheets/sheet1.xml") {
+            sheet = e.data;
+        }
+    }
+    QCOMPARE(names,
+             QStringList({QStringLiteral("xl/worksheets/sheet1.xml"),
+                          QStringLiteral("[Content_Types].xml"),
+                          QStringLiteral("_rels/.rels"),
+                          QStringLiteral("xl/workbook.xml"),
+                          QStringLiteral("xl/_rels/workbook.xml.rels")}));
+    QVERIFY(sheet.startsWith("<?xml"));
+    QVERIFY(sheet.endsWith("</sheetData></worksheet>"));
+    QVERIFY(sheet.contains("<row><c><v>42</v></c><c t=\"inlineStr\"><is><t xml:space=\"preserve\">A&amp;B &lt;C&gt;</t></is></c></row>"));
+    QVERIFY(sheet.contains(QStringLiteral("<row><c/><c t=\"inlineStr\"><is><t xml:space=\"preserve\">李四</t></is></c></row>").toUtf8()));
+}
+
+QTEST_GUILESS_MAIN(ZipTest)
+#include "tst_zip.moc"
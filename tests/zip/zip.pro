@@ -0,0 +1,21 @@
+# ZipWriter / XlsxWriter：按中央目录读回各条目，解压后与写入内容一致。
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_zip
+
+INCLUDEPATH += ../..
+
+LIBS += -lz
+
+SOURCES += \
+    ../../io/xlsxwriter.cpp \
+    ../../io/zipwriter.cpp \
+    tst_zip.cpp
+
+HEADERS += \
+    ../../io/xlsxwriter.h \
+    ../../io/zipwriter.h
@@ -0,0 +1,43 @@
+#include "chinaid.h"
+
+namespace ChinaId {
+
+QChar checkDigit(const QString& first17)
+{
+    static const int weights[17] = {7, 9, 10, 5, 8, 4, 2, 1, 6, 3, 7, 9, 10, 5, 8, 4, 2};
+    static const char codes[] = "10X98765432";
+    int sum = 0;
+    for (int i = 0; i < 17; ++i) {
+        sum += first17.at(i).digitValue() * weights[i];
+    }
+    return QLatin1Char(codes[sum % 11]);
+}
+
+QString make(const QString& region, const QDate& dob, int sequence, int sex)
+{
+    // 顺序码末位奇数为男、偶数为女。
+    int seq = qBound(0, sequence, 999);
+    if ((seq % 2 == 1) != (sex == 1)) {
+        seq = seq == 999 ? 998 : seq + 1;
+    }
+    const auto first17 = region + dob.toString(QStringLiteral("yyyyMMdd")) + QStringLiteral("%1").arg(seq, 3, 10, QLatin1Char('0'));
+    return first17 + checkDigit(first17);
+}
+
+bool isValid(const QString& id)
+{
+    if (id.size() != 18) {
+        return false;
+    }
+    for (int i = 0; i < 17; ++i) {
+        if (!id.at(i).isDigit()) {
+            return false;
+        }
+    }
+    if (!QDate::fromString(id.mid(6, 8), QStringLiteral("yyyyMMdd")).isValid()) {
+        return false;
+    }
+    return checkDigit(id.left(17)) == id.at(17).toUpper();
+}
+
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QDate>
+#include <QString>
+
+// 居民身份证号（GB 11643）：6 位地区码 + 8 位出生日期 + 3 位顺序码（奇数男、偶数女）+ 1 位校验码。
+namespace ChinaId {
+
+// ISO 7064 MOD 11-2 校验码；first17 必须是 17 位数字。
+QChar checkDigit(const QString& first17);
+QString make(const QString& region, const QDate& dob, int sequence, int sex);
+bool isValid(const QString& id);
+
+}
@@ -0,0 +1,30 @@
+# 生成大规模测试库（hospital.db）的命令行工具，与主程序共用 db/ 下的建表和日志模板代码。
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = datagen
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../db/auditjournal.cpp \
+    ../../db/dbmanager.cpp \
+    ../../db/deltasync.cpp \
+    ../../db/historylogger.cpp \
+    ../../db/historysearch.cpp \
+    chinaid.cpp \
+    generator.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../db/auditjournal.h \
+    ../../db/dbmanager.h \
+    ../../db/deltasync.h \
+    ../../db/historylogger.h \
+    ../../db/historysearch.h \
+    ../../db/mpscqueue.h \
+    chinaid.h \
+    generator.h
@@ -0,0 +1,732 @@
+#include "generator.h"
+
+#include "chinaid.h"
+#include "db/dbmanager.h"
+#include "db/deltasync.h"
+#include "db/historylogger.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QUuid>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// 每张表一个独立的随机数流，互不影响。
+enum Stream : quint64 {
+    StreamDoctor = 1,
+    StreamUser,
+    StreamPatient,
+    StreamHistory,
+    StreamPersonName,
+};
+
+quint64 splitMix(quint64* state)
+{
+    quint64 z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// 以 (种子, 流, 行号) 为键的计数器式随机数，任意一行都可以单独算出来。
+class Rng final
+{
+public:
+    Rng(quint64 seed, quint64 stream, qint64 index)
+    {
+        quint64 s = seed;
+        s = splitMix(&s) ^ (stream * 0xD1B54A32D192ED03ull);
+        s = splitMix(&s) ^ (quint64(index) * 0xA0761D6478BD642Full);
+        m_state = splitMix(&s);
+    }
+
+    quint64 next() { return splitMix(&m_state); }
+    // [0, 1)
+    double uniform() { return double(next() >> 11) * (1.0 / 9007199254740992.0); }
+    // [lo, hi]
+    int range(int lo, int hi) { return lo + int(next() % quint64(hi - lo + 1)); }
+    bool chance(double p) { return uniform() < p; }
+
+    double normal(double mean, double sd)
+    {
+        const double u1 = qMax(uniform(), 1e-12);
+        const double u2 = uniform();
+        return mean + sd * std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+
+    // 按累计权重抽取下标。
+    int weighted(const std::vector<double>& cdf)
+    {
+        const double x = uniform() * cdf.back();
+        return int(std::upper_bound(cdf.begin(), cdf.end(), x) - cdf.begin());
+    }
+
+private:
+    quint64 m_state = 0;
+};
+
+template <typename T, std::size_t N>
+std::vector<double> cumulative(const T (&items)[N])
+{
+    std::vector<double> cdf;
+    cdf.reserve(N);
+    double sum = 0;
+    for (const auto& item : items) {
+        sum += item.weight;
+        cdf.push_back(sum);
+    }
+    return cdf;
+}
+
+// 齐普夫分布：第 k 个（从 0 开始）的权重为 1/(k+1)^s。
+std::vector<double> zipf(qint64 n, double s)
+{
+    std::vector<double> cdf;
+    cdf.reserve(size_t(n));
+    double sum = 0;
+    for (qint64 k = 0; k < n; ++k) {
+        sum += 1.0 / std::pow(double(k + 1), s);
+        cdf.push_back(sum);
+    }
+    return cdf;
+}
+
+struct Weighted
+{
+    const char* text;
+    double weight;
+};
+
+// 常见姓氏及大致占比（%），另有少量复姓。
+const Weighted kSurnames[] = {
+    {"王", 7.1}, {"李", 7.0}, {"张", 6.7}, {"刘", 5.4}, {"陈", 4.6}, {"杨", 3.1}, {"黄", 2.2}, {"赵", 2.0},
+    {"吴", 1.9}, {"周", 1.9}, {"徐", 1.5}, {"孙", 1.5}, {"马", 1.4}, {"朱", 1.3}, {"胡", 1.2}, {"郭", 1.2},
+    {"何", 1.1}, {"高", 1.1}, {"林", 1.1}, {"罗", 1.0}, {"郑", 1.0}, {"梁", 1.0}, {"谢", 0.8}, {"宋", 0.8},
+    {"唐", 0.8}, {"许", 0.7}, {"韩", 0.7}, {"冯", 0.7}, {"邓", 0.7}, {"曹", 0.6}, {"彭", 0.6}, {"曾", 0.6},
+    {"肖", 0.6}, {"田", 0.6}, {"董", 0.5}, {"袁", 0.5}, {"潘", 0.5}, {"于", 0.5}, {"蒋", 0.5}, {"蔡", 0.5},
+    {"余", 0.5}, {"杜", 0.5}, {"叶", 0.4}, {"程", 0.4}, {"苏", 0.4}, {"魏", 0.4}, {"吕", 0.4}, {"丁", 0.4},
+    {"任", 0.4}, {"沈", 0.4}, {"姚", 0.3}, {"卢", 0.3}, {"姜", 0.3}, {"崔", 0.3}, {"钟", 0.3}, {"谭", 0.3},
+    {"陆", 0.3}, {"汪", 0.3}, {"范", 0.3}, {"金", 0.3}, {"石", 0.3}, {"廖", 0.3}, {"贾", 0.3}, {"夏", 0.3},
+    {"欧阳", 0.02}, {"司马", 0.01}, {"上官", 0.005}, {"诸葛", 0.005},
+};
+
+const char* const kMaleChars[] = {
+    "伟", "强", "磊", "军", "勇", "杰", "涛", "明", "超", "刚", "平", "辉", "鹏", "华", "飞", "鑫",
+    "波", "斌", "宇", "浩", "凯", "健", "俊", "帆", "帅", "旭", "宁", "龙", "林", "阳", "建", "国",
+    "志", "文", "博", "晨", "轩", "睿", "泽", "子", "然", "皓", "铭", "嘉", "峰", "成", "东", "海",
+    "亮", "永", "春", "生", "红", "德", "民", "庆", "荣", "昊", "宏", "毅", "航", "瑞", "诚", "豪",
+};
+
+const char* const kFemaleChars[] = {
+    "芳", "娜", "敏", "静", "丽", "艳", "娟", "霞", "秀", "英", "玲", "桂", "兰", "婷", "雪", "琳",
+    "欣", "怡", "萍", "红", "燕", "梅", "莉", "倩", "颖", "洁", "佳", "琪", "涵", "萱", "悦", "思",
+    "雨", "梦", "晶", "慧", "瑶", "蕾", "妍", "璐", "月", "春", "华", "凤", "珍", "淑", "云", "彤",
+    "诗", "语", "馨", "可", "晓", "嘉", "楠", "露", "丹", "宁", "文", "小", "美", "玉", "亚", "青",
+};
+
+// 地区码：本地（北京朝阳）占四成，其余分散在各省会城区。
+const Weighted kRegions[] = {
+    {"110105", 40}, {"110101", 6}, {"110108", 6}, {"130102", 4}, {"120101", 4}, {"370102", 3},
+    {"410105", 3}, {"310101", 3}, {"310115", 3}, {"440106", 3}, {"440304", 3}, {"330106", 3},
+    {"320102", 3}, {"510104", 3}, {"420102", 3}, {"610113", 2}, {"430102", 2}, {"500103", 2},
+    {"210102", 2}, {"350102", 1}, {"340102", 1}, {"230102", 1},
+};
+
+// 年龄段（岁，含两端）及占比：儿童和中老年就诊多。
+const struct AgeBand
+{
+    int from;
+    int to;
+    double weight;
+} kAgeBands[] = {
+    {0, 4, 8}, {5, 14, 8}, {15, 24, 7}, {25, 34, 11}, {35, 44, 11},
+    {45, 54, 14}, {55, 64, 16}, {65, 74, 14}, {75, 84, 8}, {85, 99, 3},
+};
+
+const Weighted kMobilePrefixes[] = {
+    {"138", 6}, {"139", 6}, {"135", 4}, {"136", 4}, {"137", 4}, {"150", 4}, {"151", 3}, {"152", 3},
+    {"158", 3}, {"159", 3}, {"182", 3}, {"183", 2}, {"187", 3}, {"188", 3}, {"130", 3}, {"131", 3},
+    {"132", 2}, {"155", 2}, {"156", 2}, {"185", 2}, {"186", 3}, {"133", 2}, {"153", 2}, {"180", 2},
+    {"181", 2}, {"189", 3}, {"177", 1}, {"199", 1}, {"166", 1}, {"176", 1},
+};
+
+const char* const kDepartmentNames[] = {
+    "心血管内科", "呼吸内科", "消化内科", "神经内科", "肾内科", "内分泌科", "血液科", "普外科",
+    "骨科", "神经外科", "泌尿外科", "胸外科", "妇科", "产科", "眼科", "耳鼻喉科",
+    "口腔科", "皮肤科", "中医科", "康复科", "麻醉科", "放射科", "检验科", "病理科",
+    "肿瘤科", "感染科", "精神科", "老年病科", "风湿免疫科", "全科医学科", "营养科", "重症医学科",
+};
+
+// 日志操作类型占比；增删改的对象以患者为主。
+const struct ActionWeight
+{
+    HistoryLogger::Action action;
+    double weight;
+} kActions[] = {
+    {HistoryLogger::Action::Update, 42},
+    {HistoryLogger::Action::Login, 25},
+    {HistoryLogger::Action::Create, 25},
+    {HistoryLogger::Action::Delete, 5},
+    {HistoryLogger::Action::BulkDelete, 1},
+    {HistoryLogger::Action::BulkUpdate, 1.5},
+    {HistoryLogger::Action::Import, 0.5},
+};
+
+const struct EntityWeight
+{
+    HistoryLogger::Entity entity;
+    double weight;
+} kEntities[] = {
+    {HistoryLogger::Entity::Patient, 88},
+    {HistoryLogger::Entity::Doctor, 9},
+    {HistoryLogger::Entity::Department, 3},
+};
+
+QString personName(quint64 seed, quint64 stream, qint64 index, int sex)
+{
+    static const auto surnameCdf = cumulative(kSurnames);
+    Rng rng(seed, StreamPersonName ^ (stream << 8), index);
+    auto name = QString::fromUtf8(kSurnames[rng.weighted(surnameCdf)].text);
+    const int length = rng.chance(0.25) ? 1 : 2;
+    for (int i = 0; i < length; ++i) {
+        name += QString::fromUtf8(sex == 1 ? kMaleChars[rng.range(0, int(std::size(kMaleChars)) - 1)]
+                                           : kFemaleChars[rng.range(0, int(std::size(kFemaleChars)) - 1)]);
+    }
+    return name;
+}
+
+// 编号型 ID（hz12、ys3…）中已用到的最大序号；生成的行从它之后接着编。
+qint64 maxSimpleId(QSqlDatabase& db, const QString& table, const QString& prefix, QString* error)
+{
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("SELECT IFNULL(MAX(CAST(SUBSTR(ID, %1) AS INTEGER)), 0) FROM %2 WHERE ID GLOB ?;")
+                  .arg(prefix.size() + 1)
+                  .arg(table));
+    q.addBindValue(prefix + QStringLiteral("[0-9]*"));
+    if (!q.exec() || !q.next()) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return -1;
+    }
+    return q.value(0).toLongLong();
+}
+
+bool execAll(QSqlDatabase& db, const QStringList& statements, QString* error)
+{
+    for (const auto& sql : statements) {
+        QSqlQuery q(db);
+        if (!q.exec(sql)) {
+            if (error) {
+                *error = QStringLiteral("%1: %2").arg(sql, q.lastError().text());
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+struct DataGenerator::Context
+{
+    quint64 seed = 0;
+    qint64 startMs = 0;
+    qint64 spanMs = 0;
+    QDate asOf;
+
+    qint64 departmentBase = 0;
+    qint64 doctorBase = 0;
+    qint64 userBase = 0;
+    qint64 patientBase = 0;
+    qint64 historyBase = 0;
+    qint64 patients = 0;
+    qint64 history = 0;
+
+    // 全部科室 ID（含演示数据），医生按齐普夫分布分到各科室。
+    QStringList departmentIds;
+    QStringList departmentNames;
+    std::vector<double> departmentCdf;
+    QStringList doctorIds;
+    QStringList userIds;
+    QStringList userNames;
+    std::vector<double> userCdf;
+    QHash<int, qint64> templates;
+
+    static int templateKey(HistoryLogger::Action a, HistoryLogger::Entity e) { return int(a) * 16 + int(e); }
+
+    // 建档和日志都随时间逐年增多：累计比例 x 对应时刻 start + span * sqrt(x)，ID 越大时间越晚。
+    qint64 timeAt(double fraction) const { return startMs + qint64(double(spanMs) * std::sqrt(qBound(0.0, fraction, 1.0))); }
+
+    QString patientId(qint64 i) const { return QStringLiteral("hz%1").arg(patientBase + i + 1); }
+    int patientSex(qint64 i) const { return Rng(seed, StreamPatient, i).next() & 1 ? 1 : 0; }
+    QString patientName(qint64 i) const { return personName(seed, StreamPatient, i, patientSex(i)); }
+};
+
+DataGenerator::DataGenerator(const Options& options)
+    : m_options(options)
+{
+    m_pool.setMaxThreadCount(m_options.threads > 0 ? m_options.threads : QThread::idealThreadCount());
+}
+
+bool DataGenerator::run(QString* error)
+{
+    auto db = DbManager::instance().database();
+    QStringList indexSql;
+    if (!prepare(db, &indexSql, error)) {
+        return false;
+    }
+
+    Context ctx;
+    ctx.seed = m_options.seed;
+    ctx.asOf = m_options.asOf;
+    const QDateTime end(m_options.asOf.addDays(1), QTime(0, 0));
+    ctx.startMs = end.addYears(-qMax(1, m_options.years)).toMSecsSinceEpoch();
+    ctx.spanMs = end.toMSecsSinceEpoch() - ctx.startMs - 1;
+    ctx.patients = m_options.patients;
+    ctx.history = m_options.history;
+
+    if ((ctx.departmentBase = maxSimpleId(db, QStringLiteral("Department"), QStringLiteral("ks"), error)) < 0
+        || (ctx.doctorBase = maxSimpleId(db, QStringLiteral("Doctor"), QStringLiteral("ys"), error)) < 0
+        || (ctx.patientBase = maxSimpleId(db, QStringLiteral("Patient"), QStringLiteral("hz"), error)) < 0) {
+        return false;
+    }
+    {
+        QSqlQuery q(db);
+        if (!q.exec(QStringLiteral("SELECT IFNULL(MAX(ID), 0), (SELECT COUNT(1) FROM User) FROM History;")) || !q.next()) {
+            if (error) {
+                *error = q.lastError().text();
+            }
+            return false;
+        }
+        ctx.historyBase = q.value(0).toLongLong();
+        ctx.userBase = q.value(1).toLongLong();
+    }
+
+    // 科室
+    const auto departmentName = [](qint64 k) {
+        const auto n = qint64(std::size(kDepartmentNames));
+        auto name = QString::fromUtf8(kDepartmentNames[k % n]);
+        if (k >= n) {
+            name += QStringLiteral("%1病区").arg(k / n + 1);
+        }
+        return name;
+    };
+    if (!loadTable(db,
+                   QStringLiteral("Department"),
+                   QStringLiteral("INSERT INTO Department(ID,NAME) VALUES(?,?);"),
+                   m_options.departments,
+                   [&ctx, departmentName](qint64 k) -> QVariantList {
+                       return {QStringLiteral("ks%1").arg(ctx.departmentBase + k + 1), departmentName(k)};
+                   },
+                   error)) {
+        return false;
+    }
+    {
+        QSqlQuery q(db);
+        if (!q.exec(QStringLiteral("SELECT ID, NAME FROM Department ORDER BY ROWID;"))) {
+            if (error) {
+                *error = q.lastError().text();
+            }
+            return false;
+        }
+        while (q.next()) {
+            ctx.departmentIds << q.value(0).toString();
+            ctx.departmentNames << q.value(1).toString();
+        }
+        ctx.departmentCdf = zipf(ctx.departmentIds.size(), 0.8);
+    }
+
+    // 医生
+    if (!loadTable(db,
+                   QStringLiteral("Doctor"),
+                   QStringLiteral("INSERT INTO Doctor(ID,EMPLOYEENO,NAME,DEPARTMENT_ID) VALUES(?,?,?,?);"),
+                   m_options.doctors,
+                   [&ctx](qint64 k) -> QVariantList {
+                       Rng rng(ctx.seed, StreamDoctor, k);
+                       const qint64 n = ctx.doctorBase + k + 1;
+                       const int sex = rng.chance(0.55) ? 0 : 1;
+                       return {QStringLiteral("ys%1").arg(n),
+                               QStringLiteral("YS%1").arg(n, 6, 10, QLatin1Char('0')),
+                               personName(ctx.seed, StreamDoctor, k, sex),
+                               ctx.departmentIds.value(rng.weighted(ctx.departmentCdf))};
+                   },
+                   error)) {
+        return false;
+    }
+    for (qint64 k = 0; k < m_options.doctors; ++k) {
+        ctx.doctorIds << QStringLiteral("ys%1").arg(ctx.doctorBase + k + 1);
+    }
+
+    // 用户：ID 由种子和序号派生的 UUID（与登录页注册的用户同一形式），口令统一为 123456。
+    const QUuid userNamespace(QStringLiteral("6f1c7a52-3d0e-4c8e-9b5a-2f4e8d1a7c30"));
+    const auto userId = [&ctx, userNamespace](qint64 k) {
+        return QUuid::createUuidV5(userNamespace, QStringLiteral("%1/%2").arg(ctx.seed).arg(k))
+            .toString(QUuid::WithoutBraces);
+    };
+    if (!loadTable(db,
+                   QStringLiteral("User"),
+                   QStringLiteral("INSERT INTO User(ID,FULLNAME,USERNAME,PASSWORD) VALUES(?,?,?,?);"),
+                   m_options.users,
+                   [&ctx, userId](qint64 k) -> QVariantList {
+                       Rng rng(ctx.seed, StreamUser, k);
+                       return {userId(k),
+                               personName(ctx.seed, StreamUser, k, rng.range(0, 1)),
+                               QStringLiteral("user%1").arg(ctx.userBase + k + 1),
+                               QStringLiteral("123456")};
+                   },
+                   error)) {
+        return false;
+    }
+    {
+        QSqlQuery q(db);
+        if (!q.exec(QStringLiteral("SELECT ID, USERNAME FROM User ORDER BY ROWID;"))) {
+            if (error) {
+                *error = q.lastError().text();
+            }
+            return false;
+        }
+        while (q.next()) {
+            ctx.userIds << q.value(0).toString();
+            ctx.userNames << q.value(1).toString();
+        }
+        // 少数用户承担大部分操作。
+        ctx.userCdf = zipf(ctx.userIds.size(), 1.1);
+    }
+
+    // 患者
+    if (!loadTable(db,
+                   QStringLiteral("Patient"),
+                   QStringLiteral("INSERT INTO Patient(ID,ID_CARD,NAME,SEX,DOB,HEIGHT,WEIGHT,MOBILEPHONE,AGE,CREATEDTIMESTAMP,CREATED_MS)"
+                                  " VALUES(?,?,?,?,?,?,?,?,?,?,?);"),
+                   ctx.patients,
+                   [&ctx](qint64 i) -> QVariantList {
+                       static const auto ageCdf = cumulative(kAgeBands);
+                       static const auto regionCdf = cumulative(kRegions);
+                       static const auto mobileCdf = cumulative(kMobilePrefixes);
+
+                       Rng rng(ctx.seed, StreamPatient, i);
+                       const int sex = rng.next() & 1 ? 1 : 0;
+                       const auto& band = kAgeBands[rng.weighted(ageCdf)];
+                       const int ageYears = rng.range(band.from, band.to);
+                       const QDate dob = ctx.asOf.addYears(-ageYears).addDays(-rng.range(0, 364));
+                       int age = ctx.asOf.year() - dob.year();
+                       if (ctx.asOf.month() < dob.month() || (ctx.asOf.month() == dob.month() && ctx.asOf.day() < dob.day())) {
+                           --age;
+                       }
+
+                       // 身高按年龄、性别取均值，成人 60 岁后逐年略降；体重由 BMI 推出。
+                       double heightMean = 0;
+                       if (age < 1) {
+                           heightMean = 60;
+                       } else if (age < 18) {
+                           heightMean = qMin(75.0 + 6.3 * age, sex == 1 ? 171.0 : 159.0);
+                       } else {
+                           heightMean = (sex == 1 ? 171.0 : 159.0) - qMax(0, age - 60) * 0.1;
+                       }
+                       const double height = qBound(45.0, rng.normal(heightMean, age < 18 ? 4.0 : 6.0), 210.0);
+                       const double bmi = qBound(11.0, rng.normal(age < 18 ? 16.5 : 23.5, age < 18 ? 1.8 : 3.5), 45.0);
+                       const double weight = bmi * (height / 100.0) * (height / 100.0);
+
+                       QString mobile;
+                       // 老人和幼儿有一部分不留电话。
+                       if (!(age >= 80 || age < 6) || rng.chance(0.6)) {
+                           mobile = QString::fromUtf8(kMobilePrefixes[rng.weighted(mobileCdf)].text)
+                               + QStringLiteral("%1").arg(rng.next() % 100000000ull, 8, 10, QLatin1Char('0'));
+                       }
+
+                       const QString region = QString::fromUtf8(kRegions[rng.weighted(regionCdf)].text);
+                       const QString idCard = ChinaId::make(region, dob, rng.range(0, 999), sex);
+
+                       qint64 createdMs = ctx.timeAt((double(i) + rng.uniform()) / double(ctx.patients));
+                       const qint64 bornMs = QDateTime(dob, QTime(0, 0)).toMSecsSinceEpoch();
+                       if (createdMs < bornMs) {
+                           createdMs = bornMs + rng.range(1, 72) * 3600 * 1000ll;
+                       }
+
+                       return {ctx.patientId(i),
+                               idCard,
+                               personName(ctx.seed, StreamPatient, i, sex),
+                               sex,
+                               dob.toString(Qt::ISODate),
+                               std::round(height * 10) / 10,
+                               std::round(weight * 10) / 10,
+                               mobile,
+                               age,
+                               QDateTime::fromMSecsSinceEpoch(createdMs).toString(Qt::ISODate),
+                               createdMs};
+                   },
+                   error)) {
+        return false;
+    }
+
+    // 日志模板
+    {
+        QSqlQuery ins(db);
+        ins.prepare(QStringLiteral("INSERT OR IGNORE INTO HistoryTemplate(TEXT) VALUES(?);"));
+        QSqlQuery sel(db);
+        sel.prepare(QStringLiteral("SELECT ID FROM HistoryTemplate WHERE TEXT=?;"));
+        for (const auto& a : kActions) {
+            for (int e = int(HistoryLogger::Entity::User); e <= int(HistoryLogger::Entity::Department); ++e) {
+                const auto entity = static_cast<HistoryLogger::Entity>(e);
+                const auto text = HistoryLogger::templateText(a.action, entity);
+                ins.addBindValue(text);
+                sel.addBindValue(text);
+                if (!ins.exec() || !sel.exec() || !sel.next()) {
+                    if (error) {
+                        *error = ins.lastError().isValid() ? ins.lastError().text() : sel.lastError().text();
+                    }
+                    return false;
+                }
+                ctx.templates.insert(Context::templateKey(a.action, entity), sel.value(0).toLongLong());
+                sel.finish();
+            }
+        }
+    }
+
+    // 日志：时间随 ID 递增；操作对象多是当时已建档患者中较新的那部分。
+    if (ctx.patients > 0 && !ctx.userIds.isEmpty()) {
+        if (!loadTable(db,
+                       QStringLiteral("History"),
+                       QStringLiteral("INSERT INTO History(ID,USER_ID,EVENT,TIMESTAMP,ACTION,ENTITY_TYPE,ENTITY_ID,TEMPLATE_ID,DETAIL,TS_MS)"
+                                      " VALUES(?,?,NULL,?,?,?,?,?,?,?);"),
+                       ctx.history,
+                       [&ctx](qint64 i) -> QVariantList {
+                           static const auto actionCdf = cumulative(kActions);
+                           static const auto entityCdf = cumulative(kEntities);
+
+                           Rng rng(ctx.seed, StreamHistory, i);
+                           const double fraction = (double(i) + rng.uniform()) / double(ctx.history);
+                           const qint64 tsMs = ctx.timeAt(fraction);
+                           const int user = rng.weighted(ctx.userCdf);
+                           const auto action = kActions[rng.weighted(actionCdf)].action;
+                           auto entity = HistoryLogger::Entity::User;
+                           QString entityId;
+                           QString detail;
+
+                           const qint64 created = qBound<qint64>(1, qint64(fraction * double(ctx.patients)) + 1, ctx.patients);
+                           const auto pickPatient = [&] { return created - 1 - qint64(double(created) * std::pow(rng.uniform(), 3.0)); };
+
+                           if (action == HistoryLogger::Action::Login) {
+                               entityId = ctx.userIds.at(user);
+                               detail = ctx.userNames.at(user);
+                           } else {
+                               entity = kEntities[rng.weighted(entityCdf)].entity;
+                               if (entity == HistoryLogger::Entity::Doctor && ctx.doctorIds.isEmpty()) {
+                                   entity = HistoryLogger::Entity::Patient;
+                               }
+                               if (action == HistoryLogger::Action::BulkDelete || action == HistoryLogger::Action::BulkUpdate) {
+                                   QStringList ids;
+                                   const int n = rng.range(2, 30);
+                                   for (int k = 0; k < n; ++k) {
+                                       ids << ctx.patientId(pickPatient());
+                                   }
+                                   entity = HistoryLogger::Entity::Patient;
+                                   detail = QStringLiteral("%1条(%2)").arg(n).arg(HistoryLogger::summarizeIds(ids));
+                               } else if (action == HistoryLogger::Action::Import) {
+                                   const int n = rng.range(100, 50000);
+                                   detail = QStringLiteral("%1条(import_%2.csv)").arg(n).arg(i);
+                               } else if (entity == HistoryLogger::Entity::Patient) {
+                                   const qint64 p = action == HistoryLogger::Action::Create ? created - 1 : pickPatient();
+                                   entityId = ctx.patientId(p);
+                                   detail = ctx.patientName(p);
+                               } else if (entity == HistoryLogger::Entity::Doctor) {
+                                   const int d = rng.range(0, int(ctx.doctorIds.size()) - 1);
+                                   entityId = ctx.doctorIds.at(d);
+                                   detail = personName(ctx.seed, StreamDoctor, d, Rng(ctx.seed, StreamDoctor, d).chance(0.55) ? 0 : 1);
+                               } else {
+                                   const int d = rng.weighted(ctx.departmentCdf);
+                                   entityId = ctx.departmentIds.at(d);
+                                   detail = ctx.departmentNames.at(d);
+                               }
+                           }
+
+                           return {ctx.historyBase + i + 1,
+                                   ctx.userIds.at(user),
+                                   QDateTime::fromMSecsSinceEpoch(tsMs).toString(Qt::ISODate),
+                                   int(action),
+                                   int(entity),
+                                   entityId.isEmpty() ? QVariant() : QVariant(entityId),
+                                   ctx.templates.value(Context::templateKey(action, entity)),
+                                   detail,
+                                   tsMs};
+                       },
+                       error)) {
+            return false;
+        }
+    }
+
+    return finish(db, indexSql, error);
+}
+
+bool DataGenerator::prepare(QSqlDatabase& db, QStringList* indexSql, QString* error)
+{
+    // 批量写入期间不要回滚日志、不落盘同步；生成的库写坏了重跑即可。
+    if (!execAll(db,
+                 {QStringLiteral("PRAGMA journal_mode = OFF;"),
+                  QStringLiteral("PRAGMA synchronous = OFF;"),
+                  QStringLiteral("PRAGMA locking_mode = EXCLUSIVE;"),
+                  QStringLiteral("PRAGMA temp_store = MEMORY;"),
+                  QStringLiteral("PRAGMA cache_size = -262144;")},
+                 error)) {
+        return false;
+    }
+    // 生成的行不进同步用的 ChangeLog，否则首次同步会把整库当作改动发出去。
+    if (!DeltaSync::setCaptureEnabled(db, false, error)) {
+        return false;
+    }
+
+    // 二级索引先删掉，写完后按原定义重建，比逐行维护快得多。
+    QSqlQuery q(db);
+    if (!q.exec(QStringLiteral("SELECT name, sql FROM sqlite_master"
+                               " WHERE type='index' AND sql IS NOT NULL AND tbl_name IN ('Patient','Doctor','History');"))) {
+        if (error) {
+            *error = q.lastError().text();
+        }
+        return false;
+    }
+    QStringList drops;
+    while (q.next()) {
+        drops << QStringLiteral("DROP INDEX %1;").arg(q.value(0).toString());
+        *indexSql << q.value(1).toString() + QStringLiteral(";");
+    }
+    q.finish();
+    return execAll(db, drops, error);
+}
+
+bool DataGenerator::loadTable(QSqlDatabase& db,
+                              const QString& table,
+                              const QString& insertSql,
+                              qint64 count,
+                              const RowFactory& makeRow,
+                              QString* error)
+{
+    if (count <= 0) {
+        return true;
+    }
+
+    const qint64 blockRows = qMax(1, m_options.blockRows);
+    const qint64 blocks = (count + blockRows - 1) / blockRows;
+    // 在途的块数有上限，内存占用与总行数无关。
+    const qint64 window = qMax(2, m_pool.maxThreadCount() * 2);
+
+    QMutex mutex;
+    QWaitCondition ready;
+    QHash<qint64, QVector<QVariantList>> done;
+    std::atomic_bool stop{false};
+    qint64 submitted = 0;
+
+    const auto submit = [&] {
+        const qint64 b = submitted++;
+        m_pool.start([&, b] {
+            QVector<QVariantList> rows;
+            const qint64 first = b * blockRows;
+            const qint64 last = qMin(count, first + blockRows);
+            rows.reserve(int(last - first));
+            for (qint64 i = first; i < last && !stop.load(std::memory_order_relaxed); ++i) {
+                rows.append(makeRow(i));
+            }
+            QMutexLocker locker(&mutex);
+            done.insert(b, std::move(rows));
+            ready.wakeAll();
+        });
+    };
+    while (submitted < qMin(blocks, window)) {
+        submit();
+    }
+
+    const auto fail = [&](const QString& message) {
+        stop.store(true);
+        m_pool.waitForDone();
+        if (error) {
+            *error = QStringLiteral("%1: %2").arg(table, message);
+        }
+        return false;
+    };
+
+    QSqlQuery q(db);
+    if (!q.prepare(insertSql)) {
+        return fail(q.lastError().text());
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 lastReport = 0;
+    qint64 written = 0;
+    for (qint64 b = 0; b < blocks; ++b) {
+        QVector<QVariantList> rows;
+        {
+            QMutexLocker locker(&mutex);
+            while (!done.contains(b)) {
+                ready.wait(&mutex);
+            }
+            rows = done.take(b);
+        }
+        if (submitted < blocks) {
+            submit();
+        }
+
+        if (!db.transaction()) {
+            return fail(db.lastError().text());
+        }
+        for (const auto& row : std::as_const(rows)) {
+            for (const auto& v : row) {
+                q.addBindValue(v);
+            }
+            if (!q.exec()) {
+                const auto err = q.lastError().text();
+                db.rollback();
+                return fail(err);
+            }
+        }
+        if (!db.commit()) {
+            const auto err = db.lastError().text();
+            db.rollback();
+            return fail(err);
+        }
+        written += rows.size();
+
+        if (timer.elapsed() - lastReport >= 2000 || written == count) {
+            lastReport = timer.elapsed();
+            qInfo("%s: %lld / %lld rows, %lld rows/s",
+                  qPrintable(table),
+                  static_cast<long long>(written),
+                  static_cast<long long>(count),
+                  static_cast<long long>(written * 1000 / qMax<qint64>(1, timer.elapsed())));
+        }
+    }
+    return true;
+}
+
+bool DataGenerator::finish(QSqlDatabase& db, const QStringList& indexSql, QString* error)
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (!execAll(db, indexSql, error)) {
+        return false;
+    }
+    qInfo("Indexes rebuilt in %lld ms", static_cast<long long>(timer.elapsed()));
+
+    // 全文索引交给程序启动后的后台任务分批补（HistorySearch::backfillChunk），从最新的日志往前。
+    return execAll(db,
+                   {QStringLiteral("DELETE FROM HistoryFtsBackfill;"),
+                    QStringLiteral("INSERT INTO HistoryFtsBackfill(NEXT_ID) SELECT IFNULL(MAX(ID), 0) FROM History;"),
+                    QStringLiteral("ANALYZE;"),
+                    QStringLiteral("PRAGMA locking_mode = NORMAL;"),
+                    QStringLiteral("PRAGMA journal_mode = WAL;")},
+                   error)
+        && DeltaSync::setCaptureEnabled(db, true, error);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QDate>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVariantList>
+
+#include <functional>
+
+class QSqlDatabase;
+
+// 按给定规模生成测试库：科室、医生、用户、患者和操作日志。
+// 每一行只由 (种子, 表, 行号) 决定，与线程数和分块方式无关，同一种子生成的库内容相同。
+// 生成在线程池里分块并行，写入由单个连接按块顺序提交；写入期间关闭日志和同步、
+// 先删掉二级索引，写完再建，最后把全文索引交给程序启动后的后台补词任务。
+class DataGenerator final
+{
+public:
+    struct Options
+    {
+        quint64 seed = 20240601;
+        qint64 departments = 40;
+        qint64 doctors = 2000;
+        qint64 users = 200;
+        qint64 patients = 1000000;
+        qint64 history = 10000000;
+        int threads = 0;
+        int blockRows = 20000;
+        // 年龄、建档时间都相对这一天计算；固定下来生成结果才可复现。
+        QDate asOf = QDate(2025, 12, 31);
+        // 建档和日志时间分布在 asOf 之前的若干年内。
+        int years = 5;
+    };
+
+    explicit DataGenerator(const Options& options);
+
+    bool run(QString* error = nullptr);
+
+private:
+    struct Context;
+    using RowFactory = std::function<QVariantList(qint64 index)>;
+
+    // 切到批量写入设置并删掉二级索引，indexSql 返回重建用的语句。
+    bool prepare(QSqlDatabase& db, QStringList* indexSql, QString* error);
+    bool loadTable(QSqlDatabase& db,
+                   const QString& table,
+                   const QString& insertSql,
+                   qint64 count,
+                   const RowFactory& makeRow,
+                   QString* error);
+    bool finish(QSqlDatabase& db, const QStringList& indexSql, QString* error);
+
+    Options m_options;
+    QThreadPool m_pool;
+};
@@ -0,0 +1,614 @@
+#include "deidentifier.h"
+
+#include "db/historylogger.h"
+#include "db/patientrevisions.h"
+#include "pseudonymizer.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QThread>
+#include <QUrl>
+
+#include <sqlite3.h>
+
+namespace {
+
+// 含个人信息的列及其替换表达式；日志的 DETAIL 里患者、医生的增删改记的是姓名，登录记的是用户名。
+struct Rule
+{
+    QString table;
+    QString column;
+    QString expr;
+};
+
+const QVector<Rule>& rules()
+{
+    static const QVector<Rule> list = {
+        {QStringLiteral("Patient"), QStringLiteral("ID_CARD"), QStringLiteral("deid_idcard(\"ID_CARD\")")},
+        {QStringLiteral("Patient"), QStringLiteral("NAME"), QStringLiteral("deid_name(\"NAME\")")},
+        {QStringLiteral("Patient"), QStringLiteral("MOBILEPHONE"), QStringLiteral("deid_mobile(\"MOBILEPHONE\")")},
+        {QStringLiteral("Doctor"), QStringLiteral("NAME"), QStringLiteral("deid_name(\"NAME\")")},
+        {QStringLiteral("User"), QStringLiteral("FULLNAME"), QStringLiteral("deid_name(\"FULLNAME\")")},
+        // 用户名与登录日志的 DETAIL 用同一个函数，两边仍然对得上。
+        {QStringLiteral("User"), QStringLiteral("USERNAME"), QStringLiteral("deid_name(\"USERNAME\")")},
+        // 密码一律换成默认账号的 123456，复制出的库可以用任一账号登录。
+        {QStringLiteral("User"), QStringLiteral("PASSWORD"), QStringLiteral("CASE WHEN \"PASSWORD\" IS NULL THEN NULL ELSE '123456' END")},
+        // 旧格式日志只有整句 EVENT，逐字替换。
+        {QStringLiteral("History"), QStringLiteral("EVENT"), QStringLiteral("deid_text(\"EVENT\")")},
+        {QStringLiteral("History"),
+         QStringLiteral("DETAIL"),
+         QStringLiteral("CASE WHEN \"ACTION\" IN (%1,%2,%3) AND \"ENTITY_TYPE\" IN (%4,%5)"
+                        " THEN deid_name(\"DETAIL\")"
+                        " WHEN \"ACTION\" = %6 THEN deid_name(\"DETAIL\") ELSE \"DETAIL\" END")
+             .arg(int(HistoryLogger::Action::Create))
+             .arg(int(HistoryLogger::Action::Update))
+             .arg(int(HistoryLogger::Action::Delete))
+             .arg(int(HistoryLogger::Entity::Patient))
+             .arg(int(HistoryLogger::Entity::Doctor))
+             .arg(int(HistoryLogger::Action::Login))},
+        {QStringLiteral("PatientRevision"), QStringLiteral("DATA"), QStringLiteral("deid_revision(\"MASK\", \"DATA\")")},
+        {QStringLiteral("LabResult"), QStringLiteral("ID_CARD"), QStringLiteral("deid_idcard(\"ID_CARD\")")},
+    };
+    return list;
+}
+
+// 建表但不复制行：归档目录指向不随库复制的文件，同步状态属于源库，
+// 全文索引的补词位置在最后重设，由程序启动后从头补。
+const QSet<QString>& tablesWithoutRows()
+{
+    static const QSet<QString> names = {
+        QStringLiteral("HistoryArchive"),
+        QStringLiteral("HistoryFtsBackfill"),
+        QStringLiteral("ChangeLog"),
+        QStringLiteral("SyncPeer"),
+        QStringLiteral("SyncState"),
+    };
+    return names;
+}
+
+QString sqliteError(sqlite3* h, const QString& what)
+{
+    return QStringLiteral("%1: %2").arg(what, QString::fromUtf8(h ? sqlite3_errmsg(h) : "out of memory"));
+}
+
+bool exec(sqlite3* h, const QString& sql, QString* error)
+{
+    if (sqlite3_exec(h, sql.toUtf8().constData(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+        *error = sqliteError(h, sql.left(120));
+        return false;
+    }
+    return true;
+}
+
+QString quoted(const QString& name)
+{
+    return QLatin1Char('"') + QString(name).replace(QLatin1Char('"'), QStringLiteral("\"\"")) + QLatin1Char('"');
+}
+
+QString columnText(sqlite3_stmt* stmt, int column)
+{
+    return QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_column_text(stmt, column)), sqlite3_column_bytes(stmt, column));
+}
+
+sqlite3* openDatabase(const QString& path, int flags, QString* error)
+{
+    sqlite3* h = nullptr;
+    if (sqlite3_open_v2(path.toUtf8().constData(), &h, flags, nullptr) != SQLITE_OK) {
+        *error = sqliteError(h, path);
+        sqlite3_close(h);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(h, 5000);
+    return h;
+}
+
+bool attach(sqlite3* h, const QString& path, const QString& alias, bool readOnly, QString* error)
+{
+    auto uri = QUrl::fromLocalFile(QFileInfo(path).absoluteFilePath()).toString(QUrl::FullyEncoded);
+    if (readOnly) {
+        uri += QStringLiteral("?mode=ro");
+    }
+    const auto sql = QStringLiteral("ATTACH DATABASE ? AS %1;").arg(alias).toUtf8();
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(h, sql.constData(), -1, &stmt, nullptr) != SQLITE_OK) {
+        *error = sqliteError(h, QStringLiteral("attach"));
+        return false;
+    }
+    const auto bytes = uri.toUtf8();
+    sqlite3_bind_text(stmt, 1, bytes.constData(), bytes.size(), SQLITE_TRANSIENT);
+    const bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok) {
+        *error = sqliteError(h, QStringLiteral("attach %1").arg(path));
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+// 单个整数结果；没有结果行或为 NULL 时 *isNull 为 true。
+bool scalar(sqlite3* h, const QString& sql, qint64* value, bool* isNull, QString* error)
+{
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(h, sql.toUtf8().constData(), -1, &stmt, nullptr) != SQLITE_OK) {
+        *error = sqliteError(h, sql);
+        return false;
+    }
+    const int rc = sqlite3_step(stmt);
+    *isNull = rc != SQLITE_ROW || sqlite3_column_type(stmt, 0) == SQLITE_NULL;
+    *value = *isNull ? 0 : sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        *error = sqliteError(h, sql);
+        return false;
+    }
+    return true;
+}
+
+QString textArg(sqlite3_value* v)
+{
+    return QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_value_text(v)), sqlite3_value_bytes(v));
+}
+
+// deid_name(x) 等：NULL 原样返回，其余按文本替换。
+template <QString (Pseudonymizer::*Fn)(const QString&)>
+void pseudonymFunction(sqlite3_context* ctx, int, sqlite3_value** argv)
+{
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+    auto* p = static_cast<Pseudonymizer*>(sqlite3_user_data(ctx));
+    const auto out = (p->*Fn)(textArg(argv[0])).toUtf8();
+    sqlite3_result_text(ctx, out.constData(), out.size(), SQLITE_TRANSIENT);
+}
+
+// deid_revision(MASK, DATA)：解出版本里的字段，换掉身份证号、姓名、手机号后按同一掩码重新编码。
+void revisionFunction(sqlite3_context* ctx, int, sqlite3_value** argv)
+{
+    auto* p = static_cast<Pseudonymizer*>(sqlite3_user_data(ctx));
+    const auto mask = quint32(sqlite3_value_int64(argv[0]));
+    const QByteArray data(static_cast<const char*>(sqlite3_value_blob(argv[1])), sqlite3_value_bytes(argv[1]));
+    Patient patient;
+    if (!PatientRevisions::decode(data, mask, &patient)) {
+        // 解不开就不能保证里面没有个人信息，宁可整体失败。
+        sqlite3_result_error(ctx, "cannot decode PatientRevision.DATA", -1);
+        return;
+    }
+    if (mask & PatientRevisions::IdCard) {
+        patient.idCard = p->idCard(patient.idCard);
+    }
+    if (mask & PatientRevisions::Name) {
+        patient.name = p->name(patient.name);
+    }
+    if (mask & PatientRevisions::MobilePhone) {
+        patient.mobilePhone = p->mobile(patient.mobilePhone);
+    }
+    const auto out = PatientRevisions::encode(patient, mask);
+    sqlite3_result_blob(ctx, out.constData(), out.size(), SQLITE_TRANSIENT);
+}
+
+bool registerFunctions(sqlite3* h, Pseudonymizer* p, QString* error)
+{
+    const int flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC;
+    const bool ok = sqlite3_create_function_v2(h, "deid_name", 1, flags, p, &pseudonymFunction<&Pseudonymizer::name>, nullptr, nullptr, nullptr) == SQLITE_OK
+        && sqlite3_create_function_v2(h, "deid_idcard", 1, flags, p, &pseudonymFunction<&Pseudonymizer::idCard>, nullptr, nullptr, nullptr) == SQLITE_OK
+        && sqlite3_create_function_v2(h, "deid_mobile", 1, flags, p, &pseudonymFunction<&Pseudonymizer::mobile>, nullptr, nullptr, nullptr) == SQLITE_OK
+        && sqlite3_create_function_v2(h, "deid_text", 1, flags, p, &pseudonymFunction<&Pseudonymizer::text>, nullptr, nullptr, nullptr) == SQLITE_OK
+        && sqlite3_create_function_v2(h, "deid_revision", 2, flags, p, &revisionFunction, nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok) {
+        *error = sqliteError(h, QStringLiteral("create function"));
+    }
+    return ok;
+}
+
+// 批量写入：不要回滚日志、不落盘同步；中途失败整个文件作废。
+bool bulkPragmas(sqlite3* h, QString* error)
+{
+    return exec(h, QStringLiteral("PRAGMA journal_mode = OFF;"), error)
+        && exec(h, QStringLiteral("PRAGMA synchronous = OFF;"), error)
+        && exec(h, QStringLiteral("PRAGMA temp_store = MEMORY;"), error)
+        && exec(h, QStringLiteral("PRAGMA cache_size = -65536;"), error);
+}
+
+}
+
+struct Deidentifier::Table
+{
+    QString name;
+    QString createSql;
+    QStringList columns;
+    // 与 columns 一一对应：原列或替换表达式。
+    QStringList exprs;
+    bool hasRowid = false;
+    // 主键不是 INTEGER PRIMARY KEY 的普通表要显式带上 ROWID，新库里行的物理顺序才与源库一致。
+    bool explicitRowid = false;
+    bool sensitive = false;
+    bool copyRows = true;
+    bool virtualTable = false;
+
+    QString columnList() const
+    {
+        QStringList list;
+        if (explicitRowid) {
+            list << QStringLiteral("rowid");
+        }
+        for (const auto& c : columns) {
+            list << quoted(c);
+        }
+        return list.join(QLatin1Char(','));
+    }
+
+    QString selectList() const
+    {
+        return (explicitRowid ? QStringLiteral("rowid,") : QString()) + exprs.join(QLatin1Char(','));
+    }
+};
+
+struct Deidentifier::Shard
+{
+    int table = 0;
+    bool ranged = false;
+    qint64 from = 0;
+    qint64 to = 0;
+    QString file;
+    bool done = false;
+    qint64 rows = 0;
+    QString error;
+};
+
+Deidentifier::Deidentifier(const Options& options)
+    : m_options(options)
+{
+    m_pool.setMaxThreadCount(options.threads > 0 ? options.threads : QThread::idealThreadCount());
+    // 多留一倍，合并当前分片时后面的已经在算了。
+    m_window = m_pool.maxThreadCount() * 2;
+}
+
+Deidentifier::~Deidentifier()
+{
+    m_failed = true;
+    m_pool.waitForDone();
+}
+
+bool Deidentifier::run(QString* error)
+{
+    QString err;
+    QElapsedTimer timer;
+    timer.start();
+    m_partPath = m_options.output + QStringLiteral(".part");
+    QFile::remove(m_partPath);
+
+    sqlite3* source = openDatabase(m_options.source, SQLITE_OPEN_READONLY, &err);
+    bool ok = source && loadSchema(source, &err) && planShards(source, &err);
+    sqlite3_close(source);
+
+    sqlite3* out = nullptr;
+    if (ok) {
+        for (int i = 0; i < int(m_shards.size()) && i < m_window; ++i) {
+            submit(i);
+        }
+        out = openDatabase(m_partPath, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, &err);
+        ok = out && createSchema(out, &err) && attach(out, m_options.source, QStringLiteral("src"), true, &err)
+            && copyPlainTables(out, &err) && mergeShards(out, &err) && finish(out, &err);
+    }
+    if (out && sqlite3_close(out) != SQLITE_OK && ok) {
+        err = sqliteError(out, QStringLiteral("close"));
+        ok = false;
+    }
+
+    if (ok) {
+        QFile::remove(m_options.output);
+        ok = QFile::rename(m_partPath, m_options.output);
+        if (!ok) {
+            err = QStringLiteral("无法重命名 %1").arg(m_partPath);
+        }
+    }
+    if (!ok) {
+        cleanup();
+        if (error) {
+            *error = err;
+        }
+        return false;
+    }
+    qInfo("Done in %.1f s", timer.elapsed() / 1000.0);
+    return true;
+}
+
+bool Deidentifier::loadSchema(sqlite3* source, QString* error)
+{
+    qint64 pageSize = 0;
+    bool isNull = false;
+    if (!scalar(source, QStringLiteral("PRAGMA page_size;"), &pageSize, &isNull, error)) {
+        return false;
+    }
+    m_pageSize = int(pageSize);
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(source,
+                           "SELECT type, name, tbl_name, sql FROM sqlite_master WHERE sql IS NOT NULL ORDER BY rowid;",
+                           -1,
+                           &stmt,
+                           nullptr)
+        != SQLITE_OK) {
+        *error = sqliteError(source, QStringLiteral("sqlite_master"));
+        return false;
+    }
+    QStringList virtualTables;
+    const auto isShadow = [&virtualTables](const QString& name) {
+        for (const auto& v : std::as_const(virtualTables)) {
+            if (name.startsWith(v + QLatin1Char('_'))) {
+                return true;
+            }
+        }
+        return false;
+    };
+    int rc = SQLITE_ROW;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const auto type = columnText(stmt, 0);
+        const auto name = columnText(stmt, 1);
+        const auto tableName = columnText(stmt, 2);
+        const auto sql = columnText(stmt, 3);
+        if (type != QStringLiteral("table")) {
+            // 虚表影子表上的索引由虚表自己建。
+            if (!isShadow(tableName)) {
+                m_postSql << sql;
+            }
+            continue;
+        }
+        if (name.startsWith(QStringLiteral("sqlite_"))) {
+            m_hasSequence = m_hasSequence || name == QStringLiteral("sqlite_sequence");
+            m_hasStats = m_hasStats || name == QStringLiteral("sqlite_stat1");
+            continue;
+        }
+        if (isShadow(name)) {
+            continue;
+        }
+        Table t;
+        t.name = name;
+        t.createSql = sql;
+        if (sql.startsWith(QStringLiteral("CREATE VIRTUAL TABLE"), Qt::CaseInsensitive)) {
+            virtualTables << name;
+            t.virtualTable = true;
+            t.copyRows = false;
+        }
+        m_tables.push_back(t);
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        *error = sqliteError(source, QStringLiteral("sqlite_master"));
+        return false;
+    }
+
+    for (auto& t : m_tables) {
+        if (t.virtualTable) {
+            continue;
+        }
+        t.copyRows = !tablesWithoutRows().contains(t.name);
+        const auto pragma = QStringLiteral("PRAGMA table_info(%1);").arg(quoted(t.name)).toUtf8();
+        if (sqlite3_prepare_v2(source, pragma.constData(), -1, &stmt, nullptr) != SQLITE_OK) {
+            *error = sqliteError(source, QString::fromUtf8(pragma));
+            return false;
+        }
+        int pkCount = 0;
+        bool integerPk = false;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const auto column = columnText(stmt, 1);
+            t.columns << column;
+            QString expr = quoted(column);
+            for (const auto& r : rules()) {
+                if (r.table == t.name && r.column == column) {
+                    expr = r.expr;
+                    t.sensitive = t.copyRows;
+                }
+            }
+            t.exprs << expr;
+            if (sqlite3_column_int(stmt, 5) > 0) {
+                ++pkCount;
+                integerPk = columnText(stmt, 2).compare(QStringLiteral("INTEGER"), Qt::CaseInsensitive) == 0;
+            }
+        }
+        sqlite3_finalize(stmt);
+
+        // WITHOUT ROWID 表取不到 rowid。
+        const auto probe = QStringLiteral("SELECT rowid FROM %1 LIMIT 0;").arg(quoted(t.name)).toUtf8();
+        t.hasRowid = sqlite3_prepare_v2(source, probe.constData(), -1, &stmt, nullptr) == SQLITE_OK;
+        sqlite3_finalize(stmt);
+        t.explicitRowid = t.hasRowid && !(pkCount == 1 && integerPk);
+    }
+    return true;
+}
+
+bool Deidentifier::planShards(sqlite3* source, QString* error)
+{
+    for (int i = 0; i < int(m_tables.size()); ++i) {
+        const auto& t = m_tables[i];
+        if (!t.sensitive) {
+            continue;
+        }
+        const auto add = [&](bool ranged, qint64 from, qint64 to) {
+            auto shard = std::make_unique<Shard>();
+            shard->table = i;
+            shard->ranged = ranged;
+            shard->from = from;
+            shard->to = to;
+            shard->file = QStringLiteral("%1.shard%2").arg(m_partPath).arg(m_shards.size());
+            m_shards.push_back(std::move(shard));
+        };
+        if (!t.hasRowid) {
+            add(false, 0, 0);
+            continue;
+        }
+        qint64 lo = 0;
+        qint64 hi = 0;
+        bool empty = false;
+        if (!scalar(source, QStringLiteral("SELECT MIN(rowid) FROM %1;").arg(quoted(t.name)), &lo, &empty, error)
+            || !scalar(source, QStringLiteral("SELECT MAX(rowid) FROM %1;").arg(quoted(t.name)), &hi, &empty, error)) {
+            return false;
+        }
+        if (empty) {
+            continue;
+        }
+        const qint64 step = qMax<qint64>(1, m_options.shardRows);
+        for (qint64 from = lo; from <= hi; from += step) {
+            add(true, from, qMin(hi, from + step - 1));
+        }
+    }
+    qInfo("%d shards for tables with personal data", int(m_shards.size()));
+    return true;
+}
+
+void Deidentifier::submit(int index)
+{
+    if (index >= int(m_shards.size())) {
+        return;
+    }
+    auto* shard = m_shards[index].get();
+    m_pool.start([this, shard] { runShard(shard); });
+}
+
+void Deidentifier::runShard(Shard* shard)
+{
+    QString err;
+    qint64 rows = 0;
+    if (!m_failed) {
+        const auto& t = m_tables[shard->table];
+        Pseudonymizer pseudonymizer(m_options.key);
+        QFile::remove(shard->file);
+        sqlite3* h = openDatabase(shard->file, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, &err);
+        bool ok = h && bulkPragmas(h, &err) && exec(h, t.createSql, &err)
+            && attach(h, m_options.source, QStringLiteral("src"), true, &err) && registerFunctions(h, &pseudonymizer, &err);
+        if (ok) {
+            auto sql = QStringLiteral("INSERT INTO main.%1(%2) SELECT %3 FROM src.%1")
+                           .arg(quoted(t.name), t.columnList(), t.selectList());
+            if (shard->ranged) {
+                sql += QStringLiteral(" WHERE rowid BETWEEN %1 AND %2").arg(shard->from).arg(shard->to);
+            }
+            ok = exec(h, sql + QLatin1Char(';'), &err);
+            rows = ok ? sqlite3_changes(h) : 0;
+        }
+        if (h && sqlite3_close(h) != SQLITE_OK && ok) {
+            err = sqliteError(h, QStringLiteral("close"));
+        }
+    } else {
+        err = QStringLiteral("cancelled");
+    }
+
+    QMutexLocker lock(&m_mutex);
+    shard->done = true;
+    shard->rows = rows;
+    shard->error = err;
+    m_shardDone.wakeAll();
+}
+
+bool Deidentifier::createSchema(sqlite3* out, QString* error)
+{
+    if (m_pageSize > 0 && !exec(out, QStringLiteral("PRAGMA page_size = %1;").arg(m_pageSize), error)) {
+        return false;
+    }
+    if (!bulkPragmas(out, error)) {
+        return false;
+    }
+    for (const auto& t : m_tables) {
+        if (!exec(out, t.createSql, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Deidentifier::copyPlainTables(sqlite3* out, QString* error)
+{
+    for (const auto& t : m_tables) {
+        if (!t.copyRows || t.sensitive) {
+            continue;
+        }
+        QElapsedTimer timer;
+        timer.start();
+        const auto sql = QStringLiteral("INSERT INTO main.%1(%2) SELECT %2 FROM src.%1;").arg(quoted(t.name), t.columnList());
+        if (!exec(out, sql, error)) {
+            return false;
+        }
+        qInfo("%s: %lld rows copied in %lld ms",
+              qPrintable(t.name),
+              static_cast<long long>(sqlite3_changes(out)),
+              static_cast<long long>(timer.elapsed()));
+    }
+    return true;
+}
+
+bool Deidentifier::mergeShards(sqlite3* out, QString* error)
+{
+    for (int i = 0; i < int(m_shards.size()); ++i) {
+        auto* shard = m_shards[i].get();
+        {
+            QMutexLocker lock(&m_mutex);
+            while (!shard->done) {
+                m_shardDone.wait(&m_mutex);
+            }
+        }
+        if (!shard->error.isEmpty()) {
+            *error = QStringLiteral("%1: %2").arg(m_tables[shard->table].name, shard->error);
+            return false;
+        }
+
+        const auto& t = m_tables[shard->table];
+        const auto sql = QStringLiteral("INSERT INTO main.%1(%2) SELECT %2 FROM shard.%1;").arg(quoted(t.name), t.columnList());
+        if (!attach(out, shard->file, QStringLiteral("shard"), true, error) || !exec(out, sql, error)
+            || !exec(out, QStringLiteral("DETACH DATABASE shard;"), error)) {
+            return false;
+        }
+        QFile::remove(shard->file);
+        submit(i + m_window);
+        qInfo("%s: shard %d/%d, %lld rows",
+              qPrintable(t.name),
+              i + 1,
+              int(m_shards.size()),
+              static_cast<long long>(shard->rows));
+    }
+    return true;
+}
+
+bool Deidentifier::finish(sqlite3* out, QString* error)
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (m_hasSequence
+        && (!exec(out, QStringLiteral("DELETE FROM main.sqlite_sequence;"), error)
+            || !exec(out, QStringLiteral("INSERT INTO main.sqlite_sequence(name, seq) SELECT name, seq FROM src.sqlite_sequence;"), error))) {
+        return false;
+    }
+    if (!exec(out, QStringLiteral("DETACH DATABASE src;"), error)) {
+        return false;
+    }
+    for (const auto& sql : std::as_const(m_postSql)) {
+        if (!exec(out, sql, error)) {
+            return false;
+        }
+    }
+    qInfo("Indexes and triggers created in %lld ms", static_cast<long long>(timer.elapsed()));
+
+    // 全文索引是按原文分词的，不复制；让程序启动后从最新的日志往前重新补。
+    for (const auto& t : m_tables) {
+        if (t.name == QStringLiteral("HistoryFtsBackfill")
+            && !exec(out, QStringLiteral("INSERT INTO HistoryFtsBackfill(NEXT_ID) SELECT IFNULL(MAX(ID), 0) FROM History;"), error)) {
+            return false;
+        }
+    }
+    if (m_hasStats && !exec(out, QStringLiteral("ANALYZE;"), error)) {
+        return false;
+    }
+    return exec(out, QStringLiteral("PRAGMA journal_mode = WAL;"), error);
+}
+
+void Deidentifier::cleanup()
+{
+    m_failed = true;
+    m_pool.waitForDone();
+    for (const auto& shard : m_shards) {
+        QFile::remove(shard->file);
+    }
+    for (const auto& suffix : {QString(), QStringLiteral("-wal"), QStringLiteral("-shm")}) {
+        QFile::remove(m_partPath + suffix);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct sqlite3;
+
+// 把 hospital.db 复制成去标识化的新库：Patient 的 NAME、ID_CARD、MOBILEPHONE，Doctor.NAME、
+// User 的 FULLNAME 和 USERNAME，日志里记的患者/医生姓名和登录用户名，PatientRevision 里的这三个字段，
+// 以及 LabResult.ID_CARD 都换成假名（见 Pseudonymizer）；User.PASSWORD 统一换成同一个值。
+// 含这些列的表按 ROWID 切成若干段，线程池里每段各写一个临时分片库（INSERT … SELECT 调用
+// 注册的假名函数，整段由 SQLite 流式处理，不进内存）；主线程同时复制其余的表，再按顺序把分片并入新库。
+// 同时在途的分片数有上限，临时文件占用的磁盘有界。
+// 不复制：全文索引（由程序启动后重建）、归档库目录、同步状态；源库在运行期间不应再被写入。
+class Deidentifier final
+{
+public:
+    struct Options
+    {
+        QString source;
+        QString output;
+        QByteArray key;
+        int threads = 0;
+        // 每个分片的行数（按 ROWID 范围）。
+        qint64 shardRows = 2000000;
+    };
+
+    explicit Deidentifier(const Options& options);
+    ~Deidentifier();
+
+    bool run(QString* error = nullptr);
+
+private:
+    struct Table;
+    struct Shard;
+
+    bool loadSchema(sqlite3* source, QString* error);
+    bool planShards(sqlite3* source, QString* error);
+    bool createSchema(sqlite3* out, QString* error);
+    bool copyPlainTables(sqlite3* out, QString* error);
+    bool mergeShards(sqlite3* out, QString* error);
+    bool finish(sqlite3* out, QString* error);
+    void submit(int index);
+    void runShard(Shard* shard);
+    void cleanup();
+
+    Options m_options;
+    QString m_partPath;
+    std::vector<Table> m_tables;
+    // 数据写完后再建的索引、触发器和视图。
+    QStringList m_postSql;
+    bool m_hasSequence = false;
+    bool m_hasStats = false;
+    int m_pageSize = 0;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    int m_window = 0;
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    QWaitCondition m_shardDone;
+    std::atomic_bool m_failed{false};
+};
@@ -0,0 +1,26 @@
+# 把 hospital.db 复制成去标识化的新库，用于在生产规模的数据上复现性能问题。
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = deidentify
+
+INCLUDEPATH += ../..
+
+# 直接用 SQLite C 接口注册假名函数，不经过 QSQLITE 驱动。
+LIBS += -lsqlite3
+
+SOURCES += \
+    ../../db/patientrevisions.cpp \
+    ../datagen/chinaid.cpp \
+    deidentifier.cpp \
+    main.cpp \
+    pseudonymizer.cpp
+
+HEADERS += \
+    ../../db/patientrevisions.h \
+    ../datagen/chinaid.h \
+    deidentifier.h \
+    pseudonymizer.h
@@ -0,0 +1,82 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+
+#include "deidentifier.h"
+
+// 用法：deidentify --out anon.db [--key-file secret.key] [--threads 8] hospital.db
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("deidentify"));
+
+    Deidentifier::Options defaults;
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("把 hospital.db 复制成去标识化的新库：姓名、身份证号、手机号换成等长的假名，"
+                                                    "同一密钥下同一原值的假名相同。"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("source"), QStringLiteral("源数据库文件"));
+    const QCommandLineOption out(QStringLiteral("out"), QStringLiteral("输出的数据库文件"), QStringLiteral("path"));
+    const QCommandLineOption force(QStringLiteral("force"), QStringLiteral("输出文件已存在时覆盖"));
+    const QCommandLineOption keyFile(QStringLiteral("key-file"),
+                                     QStringLiteral("密钥文件；不指定时每次随机生成，各次输出的假名互不相同"),
+                                     QStringLiteral("path"));
+    const QCommandLineOption threads(QStringLiteral("threads"), QStringLiteral("线程数（默认为 CPU 核数）"), QStringLiteral("n"), QStringLiteral("0"));
+    const QCommandLineOption shardRows(QStringLiteral("shard-rows"),
+                                       QStringLiteral("每个分片的行数"),
+                                       QStringLiteral("n"),
+                                       QString::number(defaults.shardRows));
+    parser.addOptions({out, force, keyFile, threads, shardRows});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1 || !parser.isSet(out)) {
+        parser.showHelp(2);
+    }
+
+    Deidentifier::Options opt;
+    opt.source = QFileInfo(parser.positionalArguments().constFirst()).absoluteFilePath();
+    opt.output = QFileInfo(parser.value(out)).absoluteFilePath();
+    opt.threads = parser.value(threads).toInt();
+    opt.shardRows = parser.value(shardRows).toLongLong();
+    if (!QFileInfo::exists(opt.source)) {
+        qCritical("%s does not exist", qPrintable(opt.source));
+        return 2;
+    }
+    if (opt.source == opt.output) {
+        qCritical("--out must differ from the source");
+        return 2;
+    }
+    if (QFileInfo::exists(opt.output) && !parser.isSet(force)) {
+        qCritical("%s already exists (use --force to overwrite)", qPrintable(opt.output));
+        return 2;
+    }
+
+    if (parser.isSet(keyFile)) {
+        QFile file(parser.value(keyFile));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qCritical("cannot read key file: %s", qPrintable(file.errorString()));
+            return 2;
+        }
+        opt.key = file.readAll().trimmed();
+        if (opt.key.size() < 16) {
+            qCritical("key file must contain at least 16 bytes");
+            return 2;
+        }
+    } else {
+        // 随机密钥只在内存里，运行结束即丢弃，假名无法再与原值对应。
+        opt.key.resize(32);
+        QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(opt.key.data()), opt.key.size() / 4);
+        qInfo("No --key-file given; using a one-off random key");
+    }
+
+    Deidentifier deidentifier(opt);
+    QString err;
+    if (!deidentifier.run(&err)) {
+        qCritical("de-identification failed: %s", qPrintable(err));
+        return 1;
+    }
+    qInfo("Written %s", qPrintable(opt.output));
+    return 0;
+}
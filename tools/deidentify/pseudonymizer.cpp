@@ -0,0 +1,250 @@
+#include "pseudonymizer.h"
+
+#include "tools/datagen/chinaid.h"
+
+#include <QtEndian>
+
+namespace {
+
+// 缓存只为省掉重复值的 HMAC；超过上限整个清掉，内存占用有界。
+constexpr int kCacheLimit = 1 << 20;
+
+// HMAC 输入的前缀，不同种类的值即使原文相同也得到互不相关的假名。
+enum Domain : char {
+    DomainName = 'N',
+    DomainIdCard = 'I',
+    DomainMobile = 'M',
+    DomainText = 'T',
+};
+
+// 常见单字姓氏及大致占比（‰），假名的姓氏分布与实际接近。
+const struct
+{
+    const char* text;
+    int weight;
+} kSurnames[] = {
+    {"王", 71}, {"李", 70}, {"张", 67}, {"刘", 54}, {"陈", 46}, {"杨", 31}, {"黄", 22}, {"赵", 20},
+    {"吴", 19}, {"周", 19}, {"徐", 15}, {"孙", 15}, {"马", 14}, {"朱", 13}, {"胡", 12}, {"郭", 12},
+    {"何", 11}, {"高", 11}, {"林", 11}, {"罗", 10}, {"郑", 10}, {"梁", 10}, {"谢", 8},  {"宋", 8},
+    {"唐", 8},  {"许", 7},  {"韩", 7},  {"冯", 7},  {"邓", 7},  {"曹", 6},  {"彭", 6},  {"曾", 6},
+    {"肖", 6},  {"田", 6},  {"董", 5},  {"袁", 5},  {"潘", 5},  {"于", 5},  {"蒋", 5},  {"蔡", 5},
+    {"余", 5},  {"杜", 5},  {"叶", 4},  {"程", 4},  {"苏", 4},  {"魏", 4},  {"吕", 4},  {"丁", 4},
+    {"任", 4},  {"沈", 4},  {"姚", 3},  {"卢", 3},  {"姜", 3},  {"崔", 3},  {"钟", 3},  {"谭", 3},
+    {"陆", 3},  {"汪", 3},  {"范", 3},  {"金", 3},  {"石", 3},  {"廖", 3},  {"贾", 3},  {"夏", 3},
+};
+
+// 名字用字，不分男女；自由文本里的汉字也从这里取。
+const char kGivenChars[] = "伟强磊军勇杰涛明超刚平辉鹏华飞鑫波斌宇浩凯健俊帆帅旭宁龙林阳建国"
+                           "志文博晨轩睿泽子然皓铭嘉峰成东海亮永春生红德民庆荣昊宏毅航瑞诚豪"
+                           "芳娜敏静丽艳娟霞秀英玲桂兰婷雪琳欣怡萍燕梅莉倩颖洁佳琪涵萱悦思"
+                           "雨梦晶慧瑶蕾妍璐月凤珍淑云彤诗语馨可晓楠露丹小美玉亚青";
+
+const QString& givenChars()
+{
+    static const QString chars = QString::fromUtf8(kGivenChars);
+    return chars;
+}
+
+int surnameTotal()
+{
+    int total = 0;
+    for (const auto& s : kSurnames) {
+        total += s.weight;
+    }
+    return total;
+}
+
+bool isHan(QChar c)
+{
+    return c.unicode() >= 0x4E00 && c.unicode() <= 0x9FFF;
+}
+
+bool allDigits(const QString& s, int from, int count)
+{
+    for (int i = from; i < from + count; ++i) {
+        if (s.at(i).unicode() < '0' || s.at(i).unicode() > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+// HMAC(密钥, 种类 + 原值) 展开成的随机数流，用完一块再以计数器续算下一块。
+class Pseudonymizer::Bits final
+{
+public:
+    Bits(QMessageAuthenticationCode& mac, char domain, const QString& value)
+        : m_mac(mac)
+    {
+        m_mac.reset();
+        m_mac.addData(&domain, 1);
+        m_mac.addData(value.toUtf8());
+        m_seed = m_mac.result();
+        m_block = m_seed;
+    }
+
+    // [0, n)
+    int below(int n)
+    {
+        if (m_pos + 4 > m_block.size()) {
+            char counter[4];
+            qToLittleEndian(++m_counter, counter);
+            m_mac.reset();
+            m_mac.addData(m_seed);
+            m_mac.addData(counter, sizeof(counter));
+            m_block = m_mac.result();
+            m_pos = 0;
+        }
+        const auto v = qFromLittleEndian<quint32>(m_block.constData() + m_pos);
+        m_pos += 4;
+        return int(v % quint32(n));
+    }
+
+    QChar digit() { return QLatin1Char(char('0' + below(10))); }
+
+private:
+    QMessageAuthenticationCode& m_mac;
+    QByteArray m_seed;
+    QByteArray m_block;
+    int m_pos = 0;
+    quint32 m_counter = 0;
+};
+
+Pseudonymizer::Pseudonymizer(const QByteArray& key)
+    : m_mac(QCryptographicHash::Sha256, key)
+{
+}
+
+QString Pseudonymizer::name(const QString& value)
+{
+    return cached(m_names, value, &Pseudonymizer::makeName);
+}
+
+QString Pseudonymizer::idCard(const QString& value)
+{
+    return cached(m_idCards, value, &Pseudonymizer::makeIdCard);
+}
+
+QString Pseudonymizer::mobile(const QString& value)
+{
+    return cached(m_mobiles, value, &Pseudonymizer::makeMobile);
+}
+
+QString Pseudonymizer::text(const QString& value)
+{
+    return cached(m_texts, value, &Pseudonymizer::makeText);
+}
+
+QString Pseudonymizer::cached(QHash<QString, QString>& cache,
+                              const QString& value,
+                              QString (Pseudonymizer::*make)(const QString&))
+{
+    if (value.isEmpty()) {
+        return value;
+    }
+    const auto it = cache.constFind(value);
+    if (it != cache.constEnd()) {
+        return it.value();
+    }
+    if (cache.size() >= kCacheLimit) {
+        cache.clear();
+    }
+    const auto result = (this->*make)(value);
+    cache.insert(value, result);
+    return result;
+}
+
+QChar Pseudonymizer::substitute(QChar c, Bits& bits)
+{
+    const auto u = c.unicode();
+    if (u >= '0' && u <= '9') {
+        return bits.digit();
+    }
+    if (u >= 'a' && u <= 'z') {
+        return QLatin1Char(char('a' + bits.below(26)));
+    }
+    if (u >= 'A' && u <= 'Z') {
+        return QLatin1Char(char('A' + bits.below(26)));
+    }
+    if (isHan(c)) {
+        return givenChars().at(bits.below(int(givenChars().size())));
+    }
+    return c;
+}
+
+QString Pseudonymizer::makeName(const QString& value)
+{
+    static const int total = surnameTotal();
+    Bits bits(m_mac, DomainName, value);
+    QString out = value;
+    bool surname = true;
+    for (auto& c : out) {
+        if (surname && isHan(c)) {
+            // 第一个汉字当作姓氏，按占比抽。
+            int x = bits.below(total);
+            for (const auto& s : kSurnames) {
+                if (x < s.weight) {
+                    c = QString::fromUtf8(s.text).at(0);
+                    break;
+                }
+                x -= s.weight;
+            }
+            surname = false;
+        } else {
+            c = substitute(c, bits);
+        }
+    }
+    return out;
+}
+
+QString Pseudonymizer::makeIdCard(const QString& value)
+{
+    // 18 位：地区 6 + 出生日期 8 + 顺序 3 + 校验 1；15 位旧号：地区 6 + 出生日期 6 + 顺序 3。
+    // 省份（前两位）、出生日期和顺序码末位的奇偶（性别）保留，其余数字替换。
+    const bool longForm = value.size() == 18 && allDigits(value, 0, 17);
+    const bool shortForm = value.size() == 15 && allDigits(value, 0, 15);
+    if (!longForm && !shortForm) {
+        return makeText(value);
+    }
+    Bits bits(m_mac, DomainIdCard, value);
+    const int dateLength = longForm ? 8 : 6;
+    QString out = value.left(2);
+    for (int i = 0; i < 4; ++i) {
+        out += bits.digit();
+    }
+    out += value.mid(6, dateLength);
+    out += bits.digit();
+    out += bits.digit();
+    const int sexDigit = value.at(6 + dateLength + 2).digitValue();
+    out += QLatin1Char(char('0' + (bits.below(5) * 2 + sexDigit % 2)));
+    if (longForm) {
+        out += ChinaId::checkDigit(out);
+    }
+    return out;
+}
+
+QString Pseudonymizer::makeMobile(const QString& value)
+{
+    // 11 位手机号保留前三位号段。
+    if (value.size() != 11 || !value.startsWith(QLatin1Char('1')) || !allDigits(value, 0, 11)) {
+        return makeText(value);
+    }
+    Bits bits(m_mac, DomainMobile, value);
+    QString out = value.left(3);
+    for (int i = 3; i < 11; ++i) {
+        out += bits.digit();
+    }
+    return out;
+}
+
+QString Pseudonymizer::makeText(const QString& value)
+{
+    Bits bits(m_mac, DomainText, value);
+    QString out = value;
+    for (auto& c : out) {
+        c = substitute(c, bits);
+    }
+    return out;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QMessageAuthenticationCode>
+#include <QString>
+
+// 由密钥决定的假名：同一密钥下同一个原值总是得到同一个假名（跨表、跨运行都一致），
+// 所以按姓名、身份证号关联的查询结果不变，各值出现的频次分布也不变。
+// 假名与原值等长、字符类别相同（汉字换汉字、数字换数字），身份证号保留省份、出生日期和
+// 性别位并重算校验码，手机号保留号段。没有密钥无法由假名反推原值。
+// 不是线程安全的，每个线程用自己的实例（内部缓存最近的结果）。
+class Pseudonymizer final
+{
+public:
+    explicit Pseudonymizer(const QByteArray& key);
+
+    QString name(const QString& value);
+    QString idCard(const QString& value);
+    QString mobile(const QString& value);
+    // 其他自由文本：逐字符按类别替换，空白和标点保留。
+    QString text(const QString& value);
+
+private:
+    class Bits;
+
+    QString cached(QHash<QString, QString>& cache, const QString& value, QString (Pseudonymizer::*make)(const QString&));
+    QString makeName(const QString& value);
+    QString makeIdCard(const QString& value);
+    QString makeMobile(const QString& value);
+    QString makeText(const QString& value);
+    // 按字符类别换成同类的另一个字符，其他字符原样返回。
+    static QChar substitute(QChar c, Bits& bits);
+
+    QMessageAuthenticationCode m_mac;
+    QHash<QString, QString> m_names;
+    QHash<QString, QString> m_idCards;
+    QHash<QString, QString> m_mobiles;
+    QHash<QString, QString> m_texts;
+};
@@ -0,0 +1,498 @@
+#include "admincommands.h"
+
+#include "db/backupmanager.h"
+#include "db/dbmanager.h"
+#include "db/deltasync.h"
+#include "db/historylogger.h"
+#include "db/historysearch.h"
+#include "io/csvimporter.h"
+#include "io/tableexporter.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QSet>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <algorithm>
+
+namespace {
+
+// 后台任务的进度最多每秒往标准错误打一行，标准输出只留给最后的 JSON。
+constexpr int kProgressIntervalMs = 1000;
+constexpr int kMaxProblems = 100;
+
+bool fail(QString* error, const QString& message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+bool parseTarget(const QString& name, CsvImporter::Target* target, QString* error)
+{
+    if (name == QStringLiteral("patients")) {
+        *target = CsvImporter::Target::Patients;
+    } else if (name == QStringLiteral("doctors")) {
+        *target = CsvImporter::Target::Doctors;
+    } else if (name == QStringLiteral("departments")) {
+        *target = CsvImporter::Target::Departments;
+    } else {
+        return fail(error, QStringLiteral("未知的表 %1（patients、doctors 或 departments）").arg(name));
+    }
+    return true;
+}
+
+// 数据库文件和 -wal 文件的大小。
+QJsonObject fileSizes()
+{
+    const auto path = DbManager::instance().databasePath();
+    return {
+        {QStringLiteral("dbBytes"), QFileInfo(path).size()},
+        {QStringLiteral("walBytes"), QFileInfo(path + QStringLiteral("-wal")).size()},
+    };
+}
+
+bool pragmaValue(const QString& pragma, QVariant* value, QString* error)
+{
+    QSqlQuery q(DbManager::instance().database());
+    if (!q.exec(QStringLiteral("PRAGMA %1;").arg(pragma))) {
+        return fail(error, q.lastError().text());
+    }
+    *value = q.next() ? q.value(0) : QVariant();
+    return true;
+}
+
+double median(QVector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values.isEmpty() ? 0 : values.at(values.size() / 2);
+}
+
+}
+
+bool AdminCommands::importCsv(const Options& opt, QJsonObject* out, QString* error)
+{
+    CsvImporter::Target target;
+    if (!parseTarget(opt.args.value(0), &target, error)) {
+        return false;
+    }
+    const auto path = QFileInfo(opt.args.value(1)).absoluteFilePath();
+    if (!QFileInfo::exists(path)) {
+        return fail(error, QStringLiteral("%1 不存在").arg(path));
+    }
+    if (opt.restart && !CsvImporter::clearCheckpoint(path, error)) {
+        return false;
+    }
+
+    const qint64 resumeFrom = CsvImporter::checkpointOffset(target, path);
+    (*out)[QStringLiteral("table")] = opt.args.value(0);
+    (*out)[QStringLiteral("file")] = path;
+    (*out)[QStringLiteral("resumedFromBytes")] = resumeFrom;
+    if (resumeFrom > 0) {
+        qInfo("import: resuming %s at byte %lld", qPrintable(path), resumeFrom);
+    }
+
+    CsvImporter importer;
+    if (opt.threads > 0) {
+        importer.setParserThreads(opt.threads);
+    }
+
+    QEventLoop loop;
+    QElapsedTimer lastReport;
+    lastReport.start();
+    bool done = false;
+    qint64 imported = 0;
+    qint64 failed = 0;
+    QString err;
+    QObject::connect(&importer, &CsvImporter::progress, &loop, [&](qint64 bytesDone, qint64 bytesTotal, qint64 rows, qint64 bad) {
+        if (lastReport.elapsed() >= kProgressIntervalMs) {
+            qInfo("import: %lld/%lld bytes, %lld imported, %lld failed", bytesDone, bytesTotal, rows, bad);
+            lastReport.restart();
+        }
+    });
+    QObject::connect(&importer, &CsvImporter::finished, &loop, [&](qint64 rows, qint64 bad, bool cancelled, const QString& message) {
+        imported = rows;
+        failed = bad;
+        err = cancelled && message.isEmpty() ? QStringLiteral("已取消") : message;
+        done = true;
+        loop.quit();
+    });
+    if (!importer.start(target, path, error)) {
+        return false;
+    }
+    const qint64 resumed = importer.resumedImported();
+    if (!done) {
+        loop.exec();
+    }
+
+    // finished 里的行数含续传之前已提交的部分，那部分上次已经记过日志。
+    imported -= resumed;
+    (*out)[QStringLiteral("imported")] = imported;
+    (*out)[QStringLiteral("resumedImported")] = resumed;
+    (*out)[QStringLiteral("failed")] = failed;
+    if (failed > 0) {
+        (*out)[QStringLiteral("errorReport")] = CsvImporter::errorReportPath(path);
+    }
+    // 与界面上导入一样记一条操作日志。
+    if (imported > 0) {
+        const auto entity = target == CsvImporter::Target::Patients  ? HistoryLogger::Entity::Patient
+                          : target == CsvImporter::Target::Doctors   ? HistoryLogger::Entity::Doctor
+                                                                     : HistoryLogger::Entity::Department;
+        HistoryLogger::log(opt.userId,
+                           HistoryLogger::Action::Import,
+                           entity,
+                           {},
+                           QStringLiteral("%1条(%2)").arg(imported).arg(QFileInfo(path).fileName()));
+    }
+    return err.isEmpty() || fail(error, err);
+}
+
+bool AdminCommands::exportTable(const Options& opt, QJsonObject* out, QString* error)
+{
+    const auto table = opt.args.value(0);
+    TableExporter::Source source;
+    if (table == QStringLiteral("patients")) {
+        source = TableExporter::patients(opt.where);
+    } else if (table == QStringLiteral("doctors")) {
+        source = TableExporter::doctors(opt.where);
+    } else if (table == QStringLiteral("departments")) {
+        source = TableExporter::departments(opt.where);
+    } else {
+        return fail(error, QStringLiteral("未知的表 %1（patients、doctors 或 departments）").arg(table));
+    }
+
+    const auto path = QFileInfo(opt.args.value(1)).absoluteFilePath();
+    const auto format = TableExporter::formatFor(path);
+    (*out)[QStringLiteral("table")] = table;
+    (*out)[QStringLiteral("file")] = path;
+    (*out)[QStringLiteral("format")] = format == TableExporter::Format::Xlsx ? QStringLiteral("xlsx") : QStringLiteral("csv");
+
+    TableExporter exporter;
+    QEventLoop loop;
+    QElapsedTimer lastReport;
+    lastReport.start();
+    bool done = false;
+    qint64 rows = 0;
+    QString err;
+    QObject::connect(&exporter, &TableExporter::progress, &loop, [&](qint64 written, qint64 total) {
+        if (lastReport.elapsed() >= kProgressIntervalMs) {
+            qInfo("export: %lld/%lld rows", written, total);
+            lastReport.restart();
+        }
+    });
+    QObject::connect(&exporter, &TableExporter::finished, &loop, [&](qint64 written, bool cancelled, const QString& message) {
+        rows = written;
+        err = cancelled && message.isEmpty() ? QStringLiteral("已取消") : message;
+        done = true;
+        loop.quit();
+    });
+    if (!exporter.start(source, path, format, error)) {
+        return false;
+    }
+    if (!done) {
+        loop.exec();
+    }
+
+    (*out)[QStringLiteral("rows")] = rows;
+    if (!err.isEmpty()) {
+        return fail(error, err);
+    }
+    (*out)[QStringLiteral("bytes")] = QFileInfo(path).size();
+    return true;
+}
+
+bool AdminCommands::backup(const Options&, QJsonObject* out, QString* error)
+{
+    BackupManager manager;
+    QEventLoop loop;
+    QElapsedTimer lastReport;
+    lastReport.start();
+    QString path;
+    QString err;
+    QObject::connect(&manager, &BackupManager::progress, &loop, [&](int pagesDone, int pagesTotal) {
+        if (lastReport.elapsed() >= kProgressIntervalMs) {
+            qInfo("backup: %d/%d pages", pagesDone, pagesTotal);
+            lastReport.restart();
+        }
+    });
+    QObject::connect(&manager, &BackupManager::finished, &loop, [&](const QString& finalPath, const QString& message) {
+        path = finalPath;
+        err = message;
+        loop.quit();
+    });
+    manager.start();
+    loop.exec();
+
+    if (!err.isEmpty() || path.isEmpty()) {
+        return fail(error, err.isEmpty() ? QStringLiteral("备份未完成") : err);
+    }
+    (*out)[QStringLiteral("file")] = path;
+    (*out)[QStringLiteral("bytes")] = QFileInfo(path).size();
+    (*out)[QStringLiteral("compressed")] = path.endsWith(QStringLiteral(".gz"));
+    (*out)[QStringLiteral("kept")] = BackupManager::backups().size();
+    return true;
+}
+
+bool AdminCommands::check(const Options& opt, QJsonObject* out, QString* error)
+{
+    if (!opt.args.isEmpty()) {
+        const auto path = QFileInfo(opt.args.at(0)).absoluteFilePath();
+        (*out)[QStringLiteral("file")] = path;
+        return BackupManager::verify(path, error);
+    }
+
+    const auto db = DbManager::instance().database();
+    const auto mode = opt.quick ? QStringLiteral("quick_check") : QStringLiteral("integrity_check");
+    (*out)[QStringLiteral("mode")] = mode;
+
+    QSqlQuery q(db);
+    if (!q.exec(QStringLiteral("PRAGMA %1(%2);").arg(mode).arg(kMaxProblems))) {
+        return fail(error, q.lastError().text());
+    }
+    QJsonArray problems;
+    while (q.next()) {
+        const auto line = q.value(0).toString();
+        if (line != QStringLiteral("ok")) {
+            problems.append(line);
+        }
+    }
+    (*out)[QStringLiteral("problems")] = problems;
+
+    // foreign_key_check 每行：表、rowid、父表、外键序号。
+    if (!q.exec(QStringLiteral("PRAGMA foreign_key_check;"))) {
+        return fail(error, q.lastError().text());
+    }
+    qint64 violations = 0;
+    QJsonArray samples;
+    while (q.next()) {
+        if (++violations <= kMaxProblems) {
+            samples.append(QJsonObject{
+                {QStringLiteral("table"), q.value(0).toString()},
+                {QStringLiteral("rowid"), q.value(1).toLongLong()},
+                {QStringLiteral("parent"), q.value(2).toString()},
+            });
+        }
+    }
+    (*out)[QStringLiteral("foreignKeyViolations")] = violations;
+    (*out)[QStringLiteral("foreignKeySamples")] = samples;
+
+    if (!problems.isEmpty() || violations > 0) {
+        return fail(error, QStringLiteral("数据库校验未通过"));
+    }
+    return true;
+}
+
+bool AdminCommands::reindex(const Options&, QJsonObject* out, QString* error)
+{
+    auto& dbm = DbManager::instance();
+    QElapsedTimer timer;
+    timer.start();
+    if (!dbm.exec(QStringLiteral("REINDEX;"), {}, error)) {
+        return false;
+    }
+    (*out)[QStringLiteral("reindexMs")] = timer.restart();
+    // 索引重建后顺带刷新查询规划用的统计信息。
+    if (!dbm.exec(QStringLiteral("ANALYZE;"), {}, error)) {
+        return false;
+    }
+    (*out)[QStringLiteral("analyzeMs")] = timer.elapsed();
+
+    QVariant count;
+    QSqlQuery q(dbm.database());
+    if (q.exec(QStringLiteral("SELECT COUNT(1) FROM sqlite_master WHERE type='index';")) && q.next()) {
+        count = q.value(0);
+    }
+    (*out)[QStringLiteral("indexes")] = count.toLongLong();
+    return true;
+}
+
+bool AdminCommands::vacuum(const Options& opt, QJsonObject* out, QString* error)
+{
+    auto& dbm = DbManager::instance();
+    (*out)[QStringLiteral("before")] = fileSizes();
+
+    if (!opt.into.isEmpty()) {
+        // VACUUM INTO 只读源库，写出整理过的副本，不影响正在使用的程序。
+        const auto path = QFileInfo(opt.into).absoluteFilePath();
+        if (QFileInfo::exists(path)) {
+            return fail(error, QStringLiteral("%1 已存在").arg(path));
+        }
+        if (!dbm.exec(QStringLiteral("VACUUM INTO ?;"), {path}, error)) {
+            return false;
+        }
+        (*out)[QStringLiteral("into")] = path;
+        (*out)[QStringLiteral("intoBytes")] = QFileInfo(path).size();
+        return true;
+    }
+
+    // 就地整理需要独占：先把 WAL 并回主文件，整理后再截断一次 WAL。
+    QVariant freePages;
+    if (!pragmaValue(QStringLiteral("freelist_count"), &freePages, error)
+        || !dbm.exec(QStringLiteral("PRAGMA wal_checkpoint(TRUNCATE);"), {}, error)
+        || !dbm.exec(QStringLiteral("VACUUM;"), {}, error)
+        || !dbm.exec(QStringLiteral("PRAGMA wal_checkpoint(TRUNCATE);"), {}, error)) {
+        return false;
+    }
+    (*out)[QStringLiteral("freedPages")] = freePages.toLongLong();
+    (*out)[QStringLiteral("after")] = fileSizes();
+    return true;
+}
+
+bool AdminCommands::stats(const Options&, QJsonObject* out, QString* error)
+{
+    auto& dbm = DbManager::instance();
+    const auto db = dbm.database();
+    (*out)[QStringLiteral("file")] = dbm.databasePath();
+    (*out)[QStringLiteral("files")] = fileSizes();
+
+    QJsonObject pragmas;
+    for (const auto& name : {QStringLiteral("page_size"), QStringLiteral("page_count"), QStringLiteral("freelist_count"), QStringLiteral("journal_mode")}) {
+        QVariant value;
+        if (!pragmaValue(name, &value, error)) {
+            return false;
+        }
+        pragmas[name] = QJsonValue::fromVariant(value);
+    }
+    (*out)[QStringLiteral("pragmas")] = pragmas;
+
+    // 虚拟表（HistoryFts）和它的影子表不计行数，COUNT 会扫整个索引。
+    QSqlQuery q(db);
+    if (!q.exec(QStringLiteral("SELECT name, sql FROM sqlite_master WHERE type='table' AND name NOT LIKE 'sqlite_%' ORDER BY name;"))) {
+        return fail(error, q.lastError().text());
+    }
+    QStringList tables;
+    QSet<QString> virtualTables;
+    while (q.next()) {
+        const auto name = q.value(0).toString();
+        if (q.value(1).toString().startsWith(QStringLiteral("CREATE VIRTUAL"), Qt::CaseInsensitive)) {
+            virtualTables.insert(name);
+        } else {
+            tables << name;
+        }
+    }
+    QJsonObject rows;
+    for (const auto& table : tables) {
+        const auto shadow = std::any_of(virtualTables.cbegin(), virtualTables.cend(), [&table](const QString& v) {
+            return table.startsWith(v + QLatin1Char('_'));
+        });
+        if (shadow) {
+            continue;
+        }
+        if (!q.exec(QStringLiteral("SELECT COUNT(1) FROM \"%1\";").arg(table)) || !q.next()) {
+            return fail(error, q.lastError().text());
+        }
+        rows[table] = q.value(0).toLongLong();
+    }
+    (*out)[QStringLiteral("rows")] = rows;
+
+    QJsonObject versions;
+    if (q.exec(QStringLiteral("SELECT NAME, VERSION FROM TableVersion ORDER BY NAME;"))) {
+        while (q.next()) {
+            versions[q.value(0).toString()] = q.value(1).toLongLong();
+        }
+    }
+    (*out)[QStringLiteral("tableVersions")] = versions;
+    (*out)[QStringLiteral("nodeId")] = DeltaSync::nodeId(db);
+    return true;
+}
+
+bool AdminCommands::benchmark(const Options& opt, QJsonObject* out, QString* error)
+{
+    struct Probe
+    {
+        QString name;
+        QString sql;
+        QVariantList args;
+    };
+
+    const auto nowMs = QDateTime::currentMSecsSinceEpoch();
+    const qint64 dayMs = 24LL * 60 * 60 * 1000;
+    const auto like = QLatin1Char('%') + opt.keyword + QLatin1Char('%');
+    // 与各页面实际发出的查询保持同样的形状，只取首屏的行数。
+    QVector<Probe> probes = {
+        {QStringLiteral("patientFirstPage"), QStringLiteral("SELECT * FROM Patient LIMIT 256;"), {}},
+        {QStringLiteral("patientCount"), QStringLiteral("SELECT COUNT(1) FROM Patient;"), {}},
+        {QStringLiteral("patientKeyword"),
+         QStringLiteral("SELECT * FROM Patient WHERE ID_CARD LIKE ? OR NAME LIKE ? OR MOBILEPHONE LIKE ? LIMIT 256;"),
+         {like, like, like}},
+        {QStringLiteral("patientRecent"),
+         QStringLiteral("SELECT * FROM Patient WHERE CREATED_MS >= ? ORDER BY CREATED_MS DESC LIMIT 256;"),
+         {nowMs - 30 * dayMs}},
+        {QStringLiteral("doctorWithDepartment"),
+         QStringLiteral("SELECT D.ID, D.EMPLOYEENO, D.NAME, P.NAME FROM Doctor D LEFT JOIN Department P ON P.ID = D.DEPARTMENT_ID;"),
+         {}},
+        {QStringLiteral("historyLatest"),
+         QStringLiteral("SELECT ID, USER_ID, ACTION, ENTITY_TYPE, ENTITY_ID, TEMPLATE_ID, DETAIL, TS_MS FROM History ORDER BY ID DESC LIMIT 200;"),
+         {}},
+        {QStringLiteral("historyLastWeek"),
+         QStringLiteral("SELECT ID, USER_ID, ACTION, ENTITY_TYPE, ENTITY_ID, TEMPLATE_ID, DETAIL, TS_MS FROM History"
+                        " WHERE TS_MS >= ? AND TS_MS < ? ORDER BY TS_MS DESC, ID DESC LIMIT 200;"),
+         {nowMs - 7 * dayMs, nowMs}},
+    };
+    const auto match = HistorySearch::isAvailable() ? HistorySearch::matchExpression(opt.keyword) : QString();
+    if (!match.isEmpty()) {
+        probes.append({QStringLiteral("historyFullText"),
+                       QStringLiteral("SELECT rowid FROM HistoryFts WHERE HistoryFts MATCH ? ORDER BY rowid DESC LIMIT 200;"),
+                       {match}});
+    } else if (!HistorySearch::isAvailable()) {
+        QVariantList args;
+        const auto condition = HistorySearch::likeCondition(opt.keyword, &args);
+        if (!condition.isEmpty()) {
+            probes.append({QStringLiteral("historyLike"),
+                           QStringLiteral("SELECT H.ID FROM History H WHERE %1 ORDER BY H.ID DESC LIMIT 200;").arg(condition),
+                           args});
+        }
+    }
+
+    const int repeat = qMax(1, opt.repeat);
+    (*out)[QStringLiteral("repeat")] = repeat;
+    (*out)[QStringLiteral("keyword")] = opt.keyword;
+
+    QJsonArray results;
+    QSqlQuery q(DbManager::instance().database());
+    q.setForwardOnly(true);
+    for (const auto& probe : probes) {
+        QJsonObject result{{QStringLiteral("name"), probe.name}};
+        if (!q.prepare(probe.sql)) {
+            result[QStringLiteral("error")] = q.lastError().text();
+            results.append(result);
+            continue;
+        }
+        QVector<double> times;
+        qint64 rows = 0;
+        QString err;
+        for (int i = 0; i < repeat && err.isEmpty(); ++i) {
+            for (int a = 0; a < probe.args.size(); ++a) {
+                q.bindValue(a, probe.args.at(a));
+            }
+            QElapsedTimer timer;
+            timer.start();
+            rows = 0;
+            if (!q.exec()) {
+                err = q.lastError().text();
+                break;
+            }
+            while (q.next()) {
+                ++rows;
+            }
+            times.append(timer.nsecsElapsed() / 1e6);
+            q.finish();
+        }
+        if (!err.isEmpty()) {
+            result[QStringLiteral("error")] = err;
+        } else {
+            result[QStringLiteral("rows")] = rows;
+            result[QStringLiteral("minMs")] = *std::min_element(times.cbegin(), times.cend());
+            result[QStringLiteral("medianMs")] = median(times);
+            result[QStringLiteral("maxMs")] = *std::max_element(times.cbegin(), times.cend());
+        }
+        results.append(result);
+    }
+    (*out)[QStringLiteral("queries")] = results;
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+// hospitalctl 的各个子命令。都在 DbManager::open 打开的默认连接上运行（后台任务另开工作连接）；
+// export、check、stats、benchmark 以只读方式打开，其余命令会建表升级但不补演示数据。
+// 结果字段写进 out，由 main 统一加上命令名、耗时后输出成一行 JSON；
+// 失败时返回 false 并给出 error，已得到的结果（如校验发现的问题）仍留在 out 里。
+class AdminCommands final
+{
+public:
+    struct Options
+    {
+        // 子命令之后的位置参数。
+        QStringList args;
+        // export：原样拼进 WHERE 的条件。
+        QString where;
+        // import：记入操作日志的用户 ID。
+        QString userId;
+        // benchmark：关键字查询用的词。
+        QString keyword;
+        // vacuum：VACUUM INTO 的目标文件，为空时就地整理。
+        QString into;
+        int threads = 0;
+        int repeat = 5;
+        bool restart = false;
+        bool quick = false;
+    };
+
+    // import <patients|doctors|departments> <file.csv>
+    static bool importCsv(const Options& opt, QJsonObject* out, QString* error);
+    // export <patients|doctors|departments> <file.csv|file.xlsx>
+    static bool exportTable(const Options& opt, QJsonObject* out, QString* error);
+    // backup：按 hospital.ini 的 Backup 节写一份在线备份。
+    static bool backup(const Options& opt, QJsonObject* out, QString* error);
+    // check [backup-file]：不带参数时校验当前库，带参数时校验备份文件。
+    static bool check(const Options& opt, QJsonObject* out, QString* error);
+    static bool reindex(const Options& opt, QJsonObject* out, QString* error);
+    static bool vacuum(const Options& opt, QJsonObject* out, QString* error);
+    static bool stats(const Options& opt, QJsonObject* out, QString* error);
+    // 把界面上常用的几类查询各跑 repeat 遍，报最小、中位、最大耗时。
+    static bool benchmark(const Options& opt, QJsonObject* out, QString* error);
+};
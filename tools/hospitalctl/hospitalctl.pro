@@ -0,0 +1,46 @@
+# 无界面的运维命令行（导入、导出、备份、校验、重建索引、VACUUM、统计、基准），结果以 JSON 输出到标准输出，
+# 供 cron 等在没有显示环境的服务器上调用；与主程序共用 db/、io/ 下的代码。
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = hospitalctl
+
+INCLUDEPATH += ../..
+
+# BackupManager 直接用 SQLite 备份 API 和 zlib，源库另开 C 接口连接，不借用 QSQLITE 驱动的句柄。
+LIBS += -lsqlite3 -lz
+
+SOURCES += \
+    ../../db/auditjournal.cpp \
+    ../../db/backupmanager.cpp \
+    ../../db/dbmanager.cpp \
+    ../../db/deltasync.cpp \
+    ../../db/historylogger.cpp \
+    ../../db/historysearch.cpp \
+    ../../db/periodicjob.cpp \
+    ../../io/csv.cpp \
+    ../../io/csvimporter.cpp \
+    ../../io/tableexporter.cpp \
+    ../../io/xlsxwriter.cpp \
+    ../../io/zipwriter.cpp \
+    admincommands.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../db/auditjournal.h \
+    ../../db/backupmanager.h \
+    ../../db/dbmanager.h \
+    ../../db/deltasync.h \
+    ../../db/historylogger.h \
+    ../../db/historysearch.h \
+    ../../db/mpscqueue.h \
+    ../../db/periodicjob.h \
+    ../../io/csv.h \
+    ../../io/csvimporter.h \
+    ../../io/tableexporter.h \
+    ../../io/xlsxwriter.h \
+    ../../io/zipwriter.h \
+    admincommands.h
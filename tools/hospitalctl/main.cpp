@@ -0,0 +1,146 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QSqlDatabase>
+
+#include <cstdio>
+
+#include "admincommands.h"
+#include "db/dbmanager.h"
+#include "db/historylogger.h"
+
+namespace {
+
+struct Command
+{
+    bool (*run)(const AdminCommands::Options&, QJsonObject*, QString*);
+    int minArgs;
+    int maxArgs;
+};
+
+// 标准输出只有这一行 JSON，日志和进度都走标准错误。
+void print(const QJsonObject& result, bool pretty)
+{
+    const auto json = QJsonDocument(result).toJson(pretty ? QJsonDocument::Indented : QJsonDocument::Compact);
+    std::fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    if (!pretty) {
+        std::fputc('\n', stdout);
+    }
+    std::fflush(stdout);
+}
+
+}
+
+// 用法：hospitalctl --db <hospital.db> <命令> [参数]
+//   import <patients|doctors|departments> <file.csv> [--threads n] [--restart] [--user id]
+//   export <patients|doctors|departments> <file.csv|file.xlsx> [--where 条件]
+//   backup                         按 hospital.ini 的 Backup 节做一次在线备份
+//   check [backup-file] [--quick]  完整性和外键校验；带文件时校验备份
+//   reindex                        REINDEX 后 ANALYZE
+//   vacuum [--into file]           就地 VACUUM，或 VACUUM INTO 写出整理后的副本
+//   stats                          文件大小、页统计、各表行数、表版本号、节点 ID
+//   benchmark [--repeat n] [--keyword 词]
+// 退出码：0 成功，1 失败（JSON 里 ok 为 false 并带 error），2 参数错误。
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("hospitalctl"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QStringLiteral("hospital.db 运维命令行：import | export | backup | check | reindex | vacuum | stats | benchmark"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("command"), QStringLiteral("子命令及其参数"));
+    const QCommandLineOption dbPath(QStringLiteral("db"), QStringLiteral("数据库文件"), QStringLiteral("path"));
+    const QCommandLineOption threads(QStringLiteral("threads"), QStringLiteral("import：解析线程数（默认为 CPU 核数）"), QStringLiteral("n"), QStringLiteral("0"));
+    const QCommandLineOption restart(QStringLiteral("restart"), QStringLiteral("import：丢弃上次未完成的进度，从头导入"));
+    const QCommandLineOption user(QStringLiteral("user"), QStringLiteral("import：记入操作日志的用户 ID"), QStringLiteral("id"));
+    const QCommandLineOption where(QStringLiteral("where"), QStringLiteral("export：SQL 条件"), QStringLiteral("sql"));
+    const QCommandLineOption quick(QStringLiteral("quick"), QStringLiteral("check：用 quick_check 代替 integrity_check"));
+    const QCommandLineOption into(QStringLiteral("into"), QStringLiteral("vacuum：写出整理后的副本而不改动原库"), QStringLiteral("path"));
+    const QCommandLineOption repeat(QStringLiteral("repeat"), QStringLiteral("benchmark：每个查询的次数"), QStringLiteral("n"), QStringLiteral("5"));
+    const QCommandLineOption keyword(QStringLiteral("keyword"), QStringLiteral("benchmark：关键字查询用的词"), QStringLiteral("text"), QStringLiteral("张"));
+    const QCommandLineOption pretty(QStringLiteral("pretty"), QStringLiteral("输出缩进的 JSON"));
+    parser.addOptions({dbPath, threads, restart, user, where, quick, into, repeat, keyword, pretty});
+    parser.process(app);
+
+    const QHash<QString, Command> commands = {
+        {QStringLiteral("import"), {&AdminCommands::importCsv, 2, 2}},
+        {QStringLiteral("export"), {&AdminCommands::exportTable, 2, 2}},
+        {QStringLiteral("backup"), {&AdminCommands::backup, 0, 0}},
+        {QStringLiteral("check"), {&AdminCommands::check, 0, 1}},
+        {QStringLiteral("reindex"), {&AdminCommands::reindex, 0, 0}},
+        {QStringLiteral("vacuum"), {&AdminCommands::vacuum, 0, 0}},
+        {QStringLiteral("stats"), {&AdminCommands::stats, 0, 0}},
+        {QStringLiteral("benchmark"), {&AdminCommands::benchmark, 0, 0}},
+    };
+    auto args = parser.positionalArguments();
+    const auto name = args.value(0);
+    if (!args.isEmpty()) {
+        args.removeFirst();
+    }
+    const auto it = commands.constFind(name);
+    if (it == commands.cend() || args.size() < it->minArgs || args.size() > it->maxArgs || !parser.isSet(dbPath)) {
+        parser.showHelp(2);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QJsonObject result{{QStringLiteral("command"), name}};
+    QJsonObject out;
+    QString err;
+
+    // 不替运维新建空库：路径写错时直接报错。DbManager::open 沿用这里建的默认连接。
+    // 不补默认用户和演示数据；只读的命令连建表升级也不做，以只读方式打开。
+    const auto path = QFileInfo(parser.value(dbPath)).absoluteFilePath();
+    const QSet<QString> readOnly = {QStringLiteral("export"), QStringLiteral("check"), QStringLiteral("stats"), QStringLiteral("benchmark")};
+    bool ok = QFileInfo::exists(path);
+    if (!ok) {
+        err = QStringLiteral("%1 不存在").arg(path);
+    } else {
+        auto db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"));
+        db.setDatabaseName(path);
+        db.setConnectOptions(QStringLiteral("QSQLITE_BUSY_TIMEOUT=5000"));
+        ok = DbManager::instance().open(&err, readOnly.contains(name) ? DbManager::OpenMode::ReadOnly : DbManager::OpenMode::Maintenance);
+    }
+
+    if (ok) {
+        AdminCommands::Options opt;
+        opt.args = args;
+        opt.threads = parser.value(threads).toInt();
+        opt.restart = parser.isSet(restart);
+        opt.userId = parser.value(user);
+        opt.where = parser.value(where);
+        opt.quick = parser.isSet(quick);
+        opt.into = parser.value(into);
+        opt.repeat = parser.value(repeat).toInt();
+        opt.keyword = parser.value(keyword);
+
+        // 只有导入会写操作日志。
+        const bool logs = name == QStringLiteral("import");
+        if (logs) {
+            HistoryLogger::start();
+        }
+        ok = it->run(opt, &out, &err);
+        if (logs) {
+            HistoryLogger::shutdown();
+        }
+    }
+
+    for (auto i = out.constBegin(); i != out.constEnd(); ++i) {
+        result.insert(i.key(), i.value());
+    }
+    result[QStringLiteral("ok")] = ok;
+    result[QStringLiteral("elapsedMs")] = timer.elapsed();
+    if (!ok) {
+        result[QStringLiteral("error")] = err;
+        qCritical("%s failed: %s", qPrintable(name), qPrintable(err));
+    }
+    print(result, parser.isSet(pretty));
+    return ok ? 0 : 1;
+}
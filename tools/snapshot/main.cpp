@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "snapshotreader.h"
+
+// 快照读取库的示例程序，不依赖 Qt。
+//   snapquery info  <file.hcol>
+//   snapquery count <file.hcol> <table> <column> [<int-column> <lo> <hi>]
+// count 按某列分组计数，可选按整数列范围过滤（如 History 的 TS_MS），用行组 min/max 跳过无关的行组。
+namespace {
+
+const char* typeName(SnapshotFormat::Type type)
+{
+    switch (type) {
+    case SnapshotFormat::Type::Int64:
+        return "int64";
+    case SnapshotFormat::Type::Double:
+        return "double";
+    case SnapshotFormat::Type::String:
+        return "string";
+    }
+    return "?";
+}
+
+std::string range(const SnapshotReader::Column& c)
+{
+    const auto& s = c.stats;
+    if (!s.hasMinMax) {
+        return "-";
+    }
+    switch (c.type) {
+    case SnapshotFormat::Type::Int64:
+        return std::to_string(s.minInt) + " .. " + std::to_string(s.maxInt);
+    case SnapshotFormat::Type::Double:
+        return std::to_string(s.minReal) + " .. " + std::to_string(s.maxReal);
+    case SnapshotFormat::Type::String:
+        return s.minText + " .. " + s.maxText;
+    }
+    return "-";
+}
+
+int info(SnapshotReader& reader)
+{
+    const std::time_t created = std::time_t(reader.createdMs() / 1000);
+    std::cout << "created " << std::asctime(std::localtime(&created));
+    for (const auto& t : reader.tables()) {
+        std::cout << t.name << ": " << t.rows << " rows, " << t.groups.size() << " row groups\n";
+        for (std::size_t i = 0; i < t.columns.size(); ++i) {
+            const auto& c = t.columns[i];
+            std::uint64_t stored = 0;
+            std::uint64_t raw = 0;
+            for (const auto& g : t.groups) {
+                stored += g.chunks[i].stored;
+                raw += g.chunks[i].raw;
+            }
+            std::cout << "  " << c.name << " " << typeName(c.type) << "  nulls " << c.stats.nulls << "  " << range(c)
+                      << "  " << stored << " bytes (" << raw << " before compression)\n";
+        }
+    }
+    return 0;
+}
+
+int count(SnapshotReader& reader, int argc, char* argv[])
+{
+    const auto* t = reader.table(argv[3]);
+    const int column = t ? t->column(argv[4]) : -1;
+    if (column < 0) {
+        std::cerr << "no such table or column\n";
+        return 2;
+    }
+    int filter = -1;
+    std::int64_t lo = 0;
+    std::int64_t hi = 0;
+    if (argc == 8) {
+        filter = t->column(argv[5]);
+        if (filter < 0 || t->columns[std::size_t(filter)].type != SnapshotFormat::Type::Int64) {
+            std::cerr << "filter column must be an int64 column\n";
+            return 2;
+        }
+        lo = std::strtoll(argv[6], nullptr, 10);
+        hi = std::strtoll(argv[7], nullptr, 10);
+    }
+
+    std::map<std::string, std::uint64_t> counts;
+    std::size_t skipped = 0;
+    SnapshotReader::Vector values;
+    SnapshotReader::Vector keys;
+    std::string error;
+    for (std::size_t g = 0; g < t->groups.size(); ++g) {
+        if (filter >= 0) {
+            if (!SnapshotReader::mayContain(t->groups[g].chunks[std::size_t(filter)].stats, lo, hi)) {
+                ++skipped;
+                continue;
+            }
+            if (!reader.read(*t, g, std::size_t(filter), &keys, &error)) {
+                std::cerr << error << "\n";
+                return 1;
+            }
+        }
+        if (!reader.read(*t, g, std::size_t(column), &values, &error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        for (std::size_t r = 0; r < values.size(); ++r) {
+            if (filter >= 0 && (keys.isNull(r) || keys.ints[r] < lo || keys.ints[r] > hi)) {
+                continue;
+            }
+            std::string key;
+            if (values.isNull(r)) {
+                key = "(null)";
+            } else if (values.type == SnapshotFormat::Type::Int64) {
+                key = std::to_string(values.ints[r]);
+            } else if (values.type == SnapshotFormat::Type::Double) {
+                key = std::to_string(values.reals[r]);
+            } else {
+                key = values.texts[r];
+            }
+            ++counts[key];
+        }
+    }
+
+    std::vector<std::pair<std::string, std::uint64_t>> sorted(counts.begin(), counts.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    for (const auto& [key, n] : sorted) {
+        std::cout << key << "\t" << n << "\n";
+    }
+    if (filter >= 0) {
+        std::cerr << skipped << " of " << t->groups.size() << " row groups skipped by min/max\n";
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string command = argc > 1 ? argv[1] : "";
+    if (!((command == "info" && argc == 3) || (command == "count" && (argc == 5 || argc == 8)))) {
+        std::cerr << "usage: snapquery info <file.hcol>\n"
+                     "       snapquery count <file.hcol> <table> <column> [<int-column> <lo> <hi>]\n";
+        return 2;
+    }
+    SnapshotReader reader;
+    std::string error;
+    if (!reader.open(argv[2], &error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    return command == "info" ? info(reader) : count(reader, argc, argv);
+}
@@ -0,0 +1,18 @@
+# 列式快照（.hcol）读取库及示例查询程序 snapquery；只依赖标准库和 zlib，不需要 Qt。
+TEMPLATE = app
+CONFIG += c++17 console
+CONFIG -= app_bundle qt
+
+TARGET = snapquery
+
+INCLUDEPATH += ../..
+
+LIBS += -lz
+
+SOURCES += \
+    main.cpp \
+    snapshotreader.cpp
+
+HEADERS += \
+    ../../io/snapshotformat.h \
+    snapshotreader.h
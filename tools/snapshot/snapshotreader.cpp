@@ -0,0 +1,403 @@
+#include "snapshotreader.h"
+
+#include <zlib.h>
+
+#include <cstring>
+
+using namespace SnapshotFormat;
+
+namespace {
+
+// 顺序解析一段内存，越界时置 ok=false，之后的读取都返回零值。
+class Cursor final
+{
+public:
+    Cursor(const char* data, std::size_t size)
+        : m_data(data)
+        , m_size(size)
+    {
+    }
+
+    bool ok() const { return m_ok; }
+    bool atEnd() const { return m_pos == m_size; }
+
+    std::uint64_t varint()
+    {
+        std::uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (m_pos >= m_size) {
+                break;
+            }
+            const auto b = static_cast<std::uint8_t>(m_data[m_pos++]);
+            v |= std::uint64_t(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                return v;
+            }
+        }
+        m_ok = false;
+        return 0;
+    }
+
+    std::int64_t zigzag()
+    {
+        const auto v = varint();
+        return std::int64_t(v >> 1) ^ -std::int64_t(v & 1);
+    }
+
+    std::uint8_t byte()
+    {
+        if (m_pos >= m_size) {
+            m_ok = false;
+            return 0;
+        }
+        return static_cast<std::uint8_t>(m_data[m_pos++]);
+    }
+
+    double real()
+    {
+        std::uint64_t bits = 0;
+        if (!take(8)) {
+            return 0;
+        }
+        for (int i = 0; i < 8; ++i) {
+            bits |= std::uint64_t(static_cast<std::uint8_t>(m_data[m_pos - 8 + i])) << (8 * i);
+        }
+        double d = 0;
+        std::memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    std::string bytes()
+    {
+        const auto n = varint();
+        if (!m_ok || n > m_size - m_pos) {
+            m_ok = false;
+            return {};
+        }
+        std::string s(m_data + m_pos, std::size_t(n));
+        m_pos += std::size_t(n);
+        return s;
+    }
+
+    const char* raw(std::size_t n)
+    {
+        return take(n) ? m_data + m_pos - n : nullptr;
+    }
+
+private:
+    bool take(std::size_t n)
+    {
+        if (n > m_size - m_pos) {
+            m_ok = false;
+            return false;
+        }
+        m_pos += n;
+        return true;
+    }
+
+    const char* m_data;
+    std::size_t m_size;
+    std::size_t m_pos = 0;
+    bool m_ok = true;
+};
+
+std::uint64_t fixed(const char* p, int bytes)
+{
+    std::uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) {
+        v |= std::uint64_t(static_cast<std::uint8_t>(p[i])) << (8 * i);
+    }
+    return v;
+}
+
+SnapshotReader::Stats readStats(Cursor& c, Type type)
+{
+    SnapshotReader::Stats s;
+    s.nulls = c.varint();
+    s.hasMinMax = c.byte() != 0;
+    if (!s.hasMinMax) {
+        return s;
+    }
+    switch (type) {
+    case Type::Int64:
+        s.minInt = c.zigzag();
+        s.maxInt = c.zigzag();
+        break;
+    case Type::Double:
+        s.minReal = c.real();
+        s.maxReal = c.real();
+        break;
+    case Type::String:
+        s.minText = c.bytes();
+        s.maxText = c.bytes();
+        break;
+    }
+    return s;
+}
+
+}
+
+int SnapshotReader::Table::column(const std::string& name) const
+{
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].name == name) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+bool SnapshotReader::fail(std::string* error, const std::string& message) const
+{
+    if (error) {
+        *error = m_path + ": " + message;
+    }
+    return false;
+}
+
+bool SnapshotReader::open(const std::string& path, std::string* error)
+{
+    close();
+    m_path = path;
+    m_file.open(path, std::ios::binary);
+    if (!m_file) {
+        return fail(error, "cannot open");
+    }
+    m_file.seekg(0, std::ios::end);
+    const auto size = std::uint64_t(m_file.tellg());
+    if (size < std::uint64_t(kHeaderSize + kTrailerSize)) {
+        return fail(error, "not a snapshot file");
+    }
+
+    char header[kHeaderSize];
+    char trailer[kTrailerSize];
+    m_file.seekg(0);
+    m_file.read(header, kHeaderSize);
+    m_file.seekg(std::streamoff(size - kTrailerSize));
+    m_file.read(trailer, kTrailerSize);
+    if (!m_file || std::memcmp(header, kMagic, sizeof(kMagic)) != 0
+        || std::memcmp(trailer + kTrailerSize - sizeof(kMagic), kMagic, sizeof(kMagic)) != 0) {
+        return fail(error, "not a snapshot file");
+    }
+    if (fixed(header + 8, 4) != kVersion) {
+        return fail(error, "unsupported version");
+    }
+    m_createdMs = std::int64_t(fixed(header + 12, 8));
+
+    const auto footerOffset = fixed(trailer, 8);
+    const auto footerSize = fixed(trailer + 8, 4);
+    const auto footerCrc = fixed(trailer + 12, 4);
+    if (footerOffset < std::uint64_t(kHeaderSize) || footerOffset + footerSize + kTrailerSize != size) {
+        return fail(error, "corrupt trailer");
+    }
+    std::string footer(std::size_t(footerSize), '\0');
+    m_file.seekg(std::streamoff(footerOffset));
+    m_file.read(&footer[0], std::streamsize(footerSize));
+    if (!m_file
+        || crc32(0, reinterpret_cast<const Bytef*>(footer.data()), uInt(footer.size())) != footerCrc) {
+        return fail(error, "corrupt footer");
+    }
+
+    Cursor c(footer.data(), footer.size());
+    const auto tableCount = c.varint();
+    for (std::uint64_t ti = 0; ti < tableCount && c.ok(); ++ti) {
+        Table t;
+        t.name = c.bytes();
+        t.rows = c.varint();
+        const auto columnCount = c.varint();
+        for (std::uint64_t i = 0; i < columnCount && c.ok(); ++i) {
+            Column col;
+            col.name = c.bytes();
+            col.type = static_cast<Type>(c.byte());
+            if (col.type != Type::Int64 && col.type != Type::Double && col.type != Type::String) {
+                return fail(error, "unknown column type");
+            }
+            col.stats = readStats(c, col.type);
+            t.columns.push_back(std::move(col));
+        }
+        const auto groupCount = c.varint();
+        for (std::uint64_t g = 0; g < groupCount && c.ok(); ++g) {
+            RowGroup group;
+            group.rows = c.varint();
+            for (const auto& col : t.columns) {
+                Chunk chunk;
+                chunk.offset = c.varint();
+                chunk.stored = c.varint();
+                chunk.raw = c.varint();
+                chunk.encoding = static_cast<Encoding>(c.byte());
+                chunk.compression = static_cast<Compression>(c.byte());
+                chunk.stats = readStats(c, col.type);
+                if (chunk.offset + chunk.stored > footerOffset) {
+                    return fail(error, "chunk outside data area");
+                }
+                group.chunks.push_back(std::move(chunk));
+            }
+            t.groups.push_back(std::move(group));
+        }
+        m_tables.push_back(std::move(t));
+    }
+    if (!c.ok() || !c.atEnd()) {
+        m_tables.clear();
+        return fail(error, "corrupt footer");
+    }
+    return true;
+}
+
+void SnapshotReader::close()
+{
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+    m_file.clear();
+    m_tables.clear();
+    m_createdMs = 0;
+}
+
+const SnapshotReader::Table* SnapshotReader::table(const std::string& name) const
+{
+    for (const auto& t : m_tables) {
+        if (t.name == name) {
+            return &t;
+        }
+    }
+    return nullptr;
+}
+
+bool SnapshotReader::read(const Table& table, std::size_t group, std::size_t column, Vector* out, std::string* error)
+{
+    if (group >= table.groups.size() || column >= table.columns.size()) {
+        return fail(error, "row group or column out of range");
+    }
+    const auto& g = table.groups[group];
+    const auto& chunk = g.chunks[column];
+    const auto type = table.columns[column].type;
+
+    std::string stored(std::size_t(chunk.stored), '\0');
+    m_file.clear();
+    m_file.seekg(std::streamoff(chunk.offset));
+    m_file.read(&stored[0], std::streamsize(stored.size()));
+    if (!m_file) {
+        return fail(error, "read failed");
+    }
+    std::string raw;
+    if (chunk.compression == Compression::Zlib) {
+        raw.resize(std::size_t(chunk.raw));
+        uLongf size = uLongf(raw.size());
+        if (uncompress(reinterpret_cast<Bytef*>(&raw[0]), &size, reinterpret_cast<const Bytef*>(stored.data()), uLong(stored.size())) != Z_OK
+            || size != raw.size()) {
+            return fail(error, "corrupt chunk in " + table.name + "." + table.columns[column].name);
+        }
+    } else if (chunk.compression == Compression::None) {
+        raw.swap(stored);
+    } else {
+        return fail(error, "unknown compression");
+    }
+
+    const auto rows = std::size_t(g.rows);
+    out->type = type;
+    out->valid.assign(rows, 1);
+    out->ints.clear();
+    out->reals.clear();
+    out->texts.clear();
+
+    Cursor c(raw.data(), raw.size());
+    if (chunk.stats.nulls > 0) {
+        const char* bitmap = c.raw((rows + 7) / 8);
+        if (!bitmap) {
+            return fail(error, "corrupt null bitmap");
+        }
+        for (std::size_t r = 0; r < rows; ++r) {
+            out->valid[r] = (static_cast<std::uint8_t>(bitmap[r / 8]) >> (r % 8)) & 1;
+        }
+    }
+
+    // 先解出非空值，再按存在位图摊回各行。
+    const std::size_t values = rows - std::size_t(chunk.stats.nulls);
+    switch (type) {
+    case Type::Int64: {
+        std::vector<std::int64_t> v;
+        v.reserve(values);
+        if (chunk.encoding == Encoding::Rle) {
+            while (v.size() < values && c.ok()) {
+                const auto value = c.zigzag();
+                const auto run = c.varint();
+                if (run == 0 || run > values - v.size()) {
+                    return fail(error, "corrupt run");
+                }
+                v.insert(v.end(), std::size_t(run), value);
+            }
+        } else {
+            std::uint64_t prev = 0;
+            for (std::size_t k = 0; k < values && c.ok(); ++k) {
+                const auto n = c.zigzag();
+                if (chunk.encoding == Encoding::Delta) {
+                    prev = k == 0 ? std::uint64_t(n) : prev + std::uint64_t(n);
+                    v.push_back(std::int64_t(prev));
+                } else {
+                    v.push_back(n);
+                }
+            }
+        }
+        out->ints.assign(rows, 0);
+        for (std::size_t r = 0, k = 0; r < rows && k < v.size(); ++r) {
+            if (out->valid[r]) {
+                out->ints[r] = v[k++];
+            }
+        }
+        break;
+    }
+    case Type::Double: {
+        out->reals.assign(rows, 0);
+        for (std::size_t r = 0; r < rows && c.ok(); ++r) {
+            if (out->valid[r]) {
+                out->reals[r] = c.real();
+            }
+        }
+        break;
+    }
+    case Type::String: {
+        out->texts.assign(rows, std::string());
+        if (chunk.encoding == Encoding::Dict) {
+            std::vector<std::string> dict(std::size_t(c.varint()));
+            for (auto& d : dict) {
+                d = c.bytes();
+            }
+            std::size_t r = 0;
+            std::size_t filled = 0;
+            while (filled < values && c.ok()) {
+                const auto id = c.varint();
+                auto run = c.varint();
+                if (id >= dict.size() || run == 0 || run > values - filled) {
+                    return fail(error, "corrupt dictionary run");
+                }
+                filled += std::size_t(run);
+                for (; run > 0 && r < rows; ++r) {
+                    if (out->valid[r]) {
+                        out->texts[r] = dict[std::size_t(id)];
+                        --run;
+                    }
+                }
+                if (run > 0) {
+                    return fail(error, "corrupt dictionary run");
+                }
+            }
+        } else {
+            for (std::size_t r = 0; r < rows && c.ok(); ++r) {
+                if (out->valid[r]) {
+                    out->texts[r] = c.bytes();
+                }
+            }
+        }
+        break;
+    }
+    }
+    if (!c.ok() || !c.atEnd()) {
+        return fail(error, "corrupt chunk in " + table.name + "." + table.columns[column].name);
+    }
+    return true;
+}
+
+bool SnapshotReader::mayContain(const Stats& stats, std::int64_t lo, std::int64_t hi)
+{
+    return !stats.hasMinMax || (stats.maxInt >= lo && stats.minInt <= hi);
+}
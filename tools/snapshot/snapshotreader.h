@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "io/snapshotformat.h"
+
+// 读列式快照（.hcol）的小库，只依赖标准库和 zlib，分析程序可以不带 Qt 直接链接。
+// open 只读文件尾部的目录；列数据按 (表, 行组, 列) 读取并解码，一次只占一个列块的内存。
+// 查询前先看行组的 min/max（mayContain），整组不相关就不必读。
+// 一个实例只能在一个线程里用；多线程扫描时每个线程各开一个。
+class SnapshotReader final
+{
+public:
+    struct Stats
+    {
+        std::uint64_t nulls = 0;
+        bool hasMinMax = false;
+        std::int64_t minInt = 0;
+        std::int64_t maxInt = 0;
+        double minReal = 0;
+        double maxReal = 0;
+        std::string minText;
+        std::string maxText;
+    };
+
+    struct Chunk
+    {
+        std::uint64_t offset = 0;
+        std::uint64_t stored = 0;
+        std::uint64_t raw = 0;
+        SnapshotFormat::Encoding encoding = SnapshotFormat::Encoding::Plain;
+        SnapshotFormat::Compression compression = SnapshotFormat::Compression::None;
+        Stats stats;
+    };
+
+    struct RowGroup
+    {
+        std::uint64_t rows = 0;
+        std::vector<Chunk> chunks;
+    };
+
+    struct Column
+    {
+        std::string name;
+        SnapshotFormat::Type type = SnapshotFormat::Type::String;
+        Stats stats;
+    };
+
+    struct Table
+    {
+        std::string name;
+        std::uint64_t rows = 0;
+        std::vector<Column> columns;
+        std::vector<RowGroup> groups;
+
+        // 没有该列返回 -1。
+        int column(const std::string& name) const;
+    };
+
+    // 一个列块解码后的值，按行对齐：空值所在行 valid 为 0，对应位置是默认值。
+    struct Vector
+    {
+        SnapshotFormat::Type type = SnapshotFormat::Type::String;
+        std::vector<std::uint8_t> valid;
+        std::vector<std::int64_t> ints;
+        std::vector<double> reals;
+        std::vector<std::string> texts;
+
+        std::size_t size() const { return valid.size(); }
+        bool isNull(std::size_t row) const { return !valid[row]; }
+    };
+
+    bool open(const std::string& path, std::string* error = nullptr);
+    void close();
+
+    std::int64_t createdMs() const { return m_createdMs; }
+    const std::vector<Table>& tables() const { return m_tables; }
+    const Table* table(const std::string& name) const;
+
+    bool read(const Table& table, std::size_t group, std::size_t column, Vector* out, std::string* error = nullptr);
+
+    // 整数列的行组是否可能有落在 [lo, hi] 内的值。
+    static bool mayContain(const Stats& stats, std::int64_t lo, std::int64_t hi);
+
+private:
+    bool fail(std::string* error, const std::string& message) const;
+
+    std::ifstream m_file;
+    std::string m_path;
+    std::int64_t m_createdMs = 0;
+    std::vector<Table> m_tables;
+};
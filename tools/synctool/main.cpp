@@ -0,0 +1,143 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+
+#include "db/deltasync.h"
+
+namespace {
+
+// 库须已由主程序或 datagen 建好表；这里只补同步用的表和触发器。
+QSqlDatabase openDatabase(const QString& path, QString* error)
+{
+    if (!QFileInfo::exists(path)) {
+        *error = QStringLiteral("%1 不存在").arg(path);
+        return {};
+    }
+    auto db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), path);
+    db.setDatabaseName(path);
+    db.setConnectOptions(QStringLiteral("QSQLITE_BUSY_TIMEOUT=5000"));
+    if (!db.open()) {
+        *error = db.lastError().text();
+        return {};
+    }
+    QSqlQuery pragma(db);
+    pragma.exec(QStringLiteral("PRAGMA foreign_keys = ON;"));
+    if (!DeltaSync::install(db, error)) {
+        return {};
+    }
+    return db;
+}
+
+void printStats(const char* what, const DeltaSync::Stats& s)
+{
+    if (s.alreadyApplied) {
+        qInfo("%s: already applied (%s, seq %lld..%lld)", what, qPrintable(s.source), s.fromSeq, s.toSeq);
+        return;
+    }
+    qInfo("%s: %s seq %lld..%lld, %lld upserts, %lld deletes, %lld skipped",
+          what,
+          qPrintable(s.source),
+          s.fromSeq,
+          s.toSeq,
+          s.upserts,
+          s.deletes,
+          s.skipped);
+}
+
+}
+
+// 用法：
+//   synctool node   <db>                         打印节点 ID
+//   synctool reinit <db>                         复制出来的库换新节点 ID
+//   synctool export <db> <peer-id> <delta-file> [from-seq]
+//                                                导出发给 peer 的增量；from-seq 取对方 RECV_SEQ 时可重发丢失的增量
+//   synctool apply  <db> <delta-file>            应用增量
+//   synctool sync   <db-a> <db-b>                两个本地库互相同步一轮
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("synctool"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("hospital.db 增量同步：node | reinit | export | apply | sync"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("command"), QStringLiteral("node、reinit、export、apply 或 sync"));
+    parser.process(app);
+
+    const auto args = parser.positionalArguments();
+    const auto command = args.value(0);
+    const QHash<QString, int> arity = {
+        {QStringLiteral("node"), 2},
+        {QStringLiteral("reinit"), 2},
+        {QStringLiteral("export"), 4},
+        {QStringLiteral("apply"), 3},
+        {QStringLiteral("sync"), 3},
+    };
+    const bool withFrom = command == QStringLiteral("export") && args.size() == 5;
+    if (!arity.contains(command) || (args.size() != arity.value(command) && !withFrom)) {
+        parser.showHelp(2);
+    }
+
+    QString err;
+    auto db = openDatabase(QFileInfo(args.at(1)).absoluteFilePath(), &err);
+    if (!db.isOpen()) {
+        qCritical("open failed: %s", qPrintable(err));
+        return 1;
+    }
+
+    DeltaSync::Stats stats;
+    if (command == QStringLiteral("node")) {
+        const auto id = DeltaSync::nodeId(db, &err);
+        if (id.isEmpty()) {
+            qCritical("%s", qPrintable(err));
+            return 1;
+        }
+        qInfo("%s", qPrintable(id));
+    } else if (command == QStringLiteral("reinit")) {
+        if (!DeltaSync::resetNode(db, &err)) {
+            qCritical("reinit failed: %s", qPrintable(err));
+            return 1;
+        }
+        qInfo("%s", qPrintable(DeltaSync::nodeId(db)));
+    } else if (command == QStringLiteral("export")) {
+        bool fromOk = true;
+        const qint64 from = withFrom ? args.at(4).toLongLong(&fromOk) : 0;
+        if (!fromOk || from < 0) {
+            parser.showHelp(2);
+        }
+        const bool ok = withFrom ? DeltaSync::exportChangesSince(db, args.at(2), from, args.at(3), &stats, &err)
+                                 : DeltaSync::exportChanges(db, args.at(2), args.at(3), &stats, &err);
+        if (!ok) {
+            qCritical("export failed: %s", qPrintable(err));
+            return 1;
+        }
+        printStats("export", stats);
+    } else if (command == QStringLiteral("apply")) {
+        if (!DeltaSync::applyChanges(db, args.at(2), &stats, &err)) {
+            qCritical("apply failed: %s", qPrintable(err));
+            return 1;
+        }
+        printStats("apply", stats);
+    } else {
+        auto other = openDatabase(QFileInfo(args.at(2)).absoluteFilePath(), &err);
+        if (!other.isOpen()) {
+            qCritical("open failed: %s", qPrintable(err));
+            return 1;
+        }
+        QTemporaryDir dir;
+        DeltaSync::Stats back;
+        const bool ok = DeltaSync::syncLocal(db, other, dir.path(), &stats, &back, &err);
+        printStats("a->b", stats);
+        printStats("b->a", back);
+        if (!ok) {
+            qCritical("sync failed: %s", qPrintable(err));
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,17 @@
+# 两个 hospital.db 之间交换增量的命令行工具，也用于在本机用两个库文件验证同步。
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = synctool
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../db/deltasync.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../db/deltasync.h
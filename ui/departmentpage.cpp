@@ -4,8 +4,13 @@
 #include "db/historylogger.h"
 #include "models/departmentmodel.h"
 #include "ui/departmenteditdialog.h"
+#include "ui/exportdialog.h"
+#include "ui/importdialog.h"
 
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QHeaderView>
+#include <QItemSelectionModel>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QPushButton>
@@ -68,12 +73,16 @@ DepartmentPage::DepartmentPage(QWidget* parent)
     m_keyword->setPlaceholderText(QStringLiteral("输入科室名称关键字"));
     m_searchBtn = new QPushButton(QStringLiteral("查找"), this);
     m_addBtn = new QPushButton(QStringLiteral("添加"), this);
+    m_importBtn = new QPushButton(QStringLiteral("导入"), this);
+    m_exportBtn = new QPushButton(QStringLiteral("导出"), this);
     m_deleteBtn = new QPushButton(QStringLiteral("删除"), this);
     m_editBtn = new QPushButton(QStringLiteral("修改"), this);
 
     top->addWidget(m_keyword, 1);
     top->addWidget(m_searchBtn);
     top->addWidget(m_addBtn);
+    top->addWidget(m_importBtn);
+    top->addWidget(m_exportBtn);
     top->addWidget(m_deleteBtn);
     top->addWidget(m_editBtn);
     root->addLayout(top);
@@ -83,7 +92,7 @@ DepartmentPage::DepartmentPage(QWidget* parent)
     m_table = new QTableView(this);
     m_table->setModel(m_model);
     m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
-    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_table->setSelectionMode(QAbstractItemView::ExtendedSelection);
     m_table->horizontalHeader()->setStretchLastSection(true);
     m_table->setAlternatingRowColors(true);
     root->addWidget(m_table, 1);
@@ -91,6 +100,8 @@ DepartmentPage::DepartmentPage(QWidget* parent)
     connect(m_searchBtn, &QPushButton::clicked, this, &DepartmentPage::onSearch);
     connect(m_keyword, &QLineEdit::returnPressed, this, &DepartmentPage::onSearch);
     connect(m_addBtn, &QPushButton::clicked, this, &DepartmentPage::onAdd);
+    connect(m_importBtn, &QPushButton::clicked, this, &DepartmentPage::onImport);
+    connect(m_exportBtn, &QPushButton::clicked, this, &DepartmentPage::onExport);
     connect(m_editBtn, &QPushButton::clicked, this, &DepartmentPage::onEdit);
     connect(m_deleteBtn, &QPushButton::clicked, this, &DepartmentPage::onDelete);
 }
@@ -107,8 +118,19 @@ void DepartmentPage::onSearch()
 
 int DepartmentPage::selectedRow() const
 {
-    const auto idx = m_table->currentIndex();
-    return idx.isValid() ? idx.row() : -1;
+    const auto rows = m_table->selectionModel()->selectedRows();
+    return rows.size() == 1 ? rows.constFirst().row() : -1;
+}
+
+QStringList DepartmentPage::selectedIds() const
+{
+    QStringList ids;
+    const auto rows = m_table->selectionModel()->selectedRows();
+    ids.reserve(rows.size());
+    for (const auto& idx : rows) {
+        ids << m_model->record(idx.row()).value(QStringLiteral("ID")).toString();
+    }
+    return ids;
 }
 
 void DepartmentPage::onAdd()
@@ -131,14 +153,39 @@ void DepartmentPage::onAdd()
         return;
     }
     m_model->select();
-    HistoryLogger::logEvent(m_userId, QStringLiteral("添加科室：%1(%2)").arg(name, id));
+    HistoryLogger::log(m_userId, HistoryLogger::Action::Create, HistoryLogger::Entity::Department, id, name);
+}
+
+void DepartmentPage::onImport()
+{
+    const auto path = QFileDialog::getOpenFileName(this, QStringLiteral("选择 CSV 文件"), {}, QStringLiteral("CSV 文件 (*.csv);;所有文件 (*)"));
+    if (path.isEmpty()) {
+        return;
+    }
+
+    ImportDialog dlg(CsvImporter::Target::Departments, path, this);
+    dlg.exec();
+    if (dlg.imported() > 0) {
+        m_model->select();
+        HistoryLogger::log(m_userId,
+                           HistoryLogger::Action::Import,
+                           HistoryLogger::Entity::Department,
+                           {},
+                           QStringLiteral("%1条(%2)").arg(dlg.imported()).arg(QFileInfo(path).fileName()));
+    }
+}
+
+void DepartmentPage::onExport()
+{
+    // 按当前查找条件导出，直接读表，不依赖表格已加载的行。
+    ExportDialog::start(TableExporter::departments(m_model->filter()), QStringLiteral("科室"), this);
 }
 
 void DepartmentPage::onEdit()
 {
     const int row = selectedRow();
     if (row < 0) {
-        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请先选择一行。"));
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请选择一行（只能选一行）。"));
         return;
     }
     const auto rec = m_model->record(row);
@@ -162,14 +209,20 @@ void DepartmentPage::onEdit()
         return;
     }
     m_model->select();
-    HistoryLogger::logEvent(m_userId, QStringLiteral("修改科室：%1(%2)").arg(newName, id));
+    HistoryLogger::log(m_userId, HistoryLogger::Action::Update, HistoryLogger::Entity::Department, id, newName);
 }
 
 void DepartmentPage::onDelete()
 {
+    const auto ids = selectedIds();
+    if (ids.size() > 1) {
+        onBulkDelete(ids);
+        return;
+    }
+
     const int row = selectedRow();
     if (row < 0) {
-        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请先选择一行。"));
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请选择一行（只能选一行）。"));
         return;
     }
     const auto rec = m_model->record(row);
@@ -188,5 +241,27 @@ void DepartmentPage::onDelete()
         return;
     }
     m_model->select();
-    HistoryLogger::logEvent(m_userId, QStringLiteral("删除科室：%1(%2)").arg(name, id));
+    HistoryLogger::log(m_userId, HistoryLogger::Action::Delete, HistoryLogger::Entity::Department, id, name);
+}
+
+void DepartmentPage::onBulkDelete(const QStringList& ids)
+{
+    if (QMessageBox::question(this,
+                             QStringLiteral("确认删除"),
+                             QStringLiteral("确定删除选中的 %1 条科室记录？").arg(ids.size()))
+        != QMessageBox::Yes) {
+        return;
+    }
+
+    QString err;
+    if (!DbManager::instance().execBulk(QStringLiteral("DELETE FROM Department WHERE ID IN (%1);"), {}, ids, &err)) {
+        QMessageBox::critical(this, QStringLiteral("删除失败"), err);
+        return;
+    }
+    m_model->select();
+    HistoryLogger::log(m_userId,
+                       HistoryLogger::Action::BulkDelete,
+                       HistoryLogger::Entity::Department,
+                       {},
+                       QStringLiteral("%1条(%2)").arg(ids.size()).arg(HistoryLogger::summarizeIds(ids)));
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QStringList>
 #include <QWidget>
 
 class DepartmentModel;
@@ -18,15 +19,22 @@ public:
 private:
     void onSearch();
     void onAdd();
+    void onImport();
+    void onExport();
     void onEdit();
     void onDelete();
+    void onBulkDelete(const QStringList& ids);
+    // 恰好选中一行时返回该行，否则返回 -1（当前行可能不在选区内，不能用）。
     int selectedRow() const;
+    QStringList selectedIds() const;
 
     QString m_userId;
     DepartmentModel* m_model = nullptr;
     QLineEdit* m_keyword = nullptr;
     QPushButton* m_searchBtn = nullptr;
     QPushButton* m_addBtn = nullptr;
+    QPushButton* m_importBtn = nullptr;
+    QPushButton* m_exportBtn = nullptr;
     QPushButton* m_deleteBtn = nullptr;
     QPushButton* m_editBtn = nullptr;
     QTableView* m_table = nullptr;
@@ -1,14 +1,12 @@
 #include "doctoreditdialog.h"
 
-#include "db/dbmanager.h"
+#include "db/lookupcache.h"
 
 #include <QComboBox>
 #include <QDialogButtonBox>
 #include <QFormLayout>
 #include <QLineEdit>
 #include <QPushButton>
-#include <QSqlError>
-#include <QSqlQuery>
 #include <QVBoxLayout>
 
 DoctorEditDialog::DoctorEditDialog(QWidget* parent)
@@ -49,12 +47,12 @@ void DoctorEditDialog::reloadDepartments()
     m_department->clear();
     m_department->addItem(QStringLiteral("（无）"), {});
 
-    QSqlQuery q(DbManager::instance().database());
-    if (!q.exec(QStringLiteral("SELECT ID,NAME FROM Department ORDER BY NAME;"))) {
+    auto& cache = LookupCache::departments();
+    if (!cache.refresh()) {
         return;
     }
-    while (q.next()) {
-        m_department->addItem(q.value(1).toString(), q.value(0).toString());
+    for (const auto& e : cache.entries()) {
+        m_department->addItem(e.value, e.key);
     }
 }
 
@@ -2,17 +2,27 @@
 
 #include "db/dbmanager.h"
 #include "db/historylogger.h"
+#include "db/lookupcache.h"
+#include "delegates/doctordelegate.h"
 #include "models/doctormodel.h"
 #include "ui/doctoreditdialog.h"
+#include "ui/exportdialog.h"
+#include "ui/importdialog.h"
 
+#include <QComboBox>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFormLayout>
 #include <QHeaderView>
+#include <QItemSelectionModel>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QPushButton>
 #include <QRegularExpression>
 #include <QSqlQuery>
 #include <QSqlRecord>
-#include <QSqlRelationalDelegate>
 #include <QTableView>
 #include <QVBoxLayout>
 
@@ -84,23 +94,29 @@ DoctorPage::DoctorPage(QWidget* parent)
     m_keyword->setPlaceholderText(QStringLiteral("输入工号/姓名关键字"));
     m_searchBtn = new QPushButton(QStringLiteral("查找"), this);
     m_addBtn = new QPushButton(QStringLiteral("添加"), this);
+    m_importBtn = new QPushButton(QStringLiteral("导入"), this);
+    m_exportBtn = new QPushButton(QStringLiteral("导出"), this);
     m_deleteBtn = new QPushButton(QStringLiteral("删除"), this);
     m_editBtn = new QPushButton(QStringLiteral("修改"), this);
+    m_moveBtn = new QPushButton(QStringLiteral("调整科室"), this);
 
     top->addWidget(m_keyword, 1);
     top->addWidget(m_searchBtn);
     top->addWidget(m_addBtn);
+    top->addWidget(m_importBtn);
+    top->addWidget(m_exportBtn);
     top->addWidget(m_deleteBtn);
     top->addWidget(m_editBtn);
+    top->addWidget(m_moveBtn);
     root->addLayout(top);
 
     m_model = new DoctorModel(this);
 
     m_table = new QTableView(this);
     m_table->setModel(m_model);
-    m_table->setItemDelegate(new QSqlRelationalDelegate(m_table));
+    m_table->setItemDelegate(new DoctorDelegate(m_model, m_table));
     m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
-    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_table->setSelectionMode(QAbstractItemView::ExtendedSelection);
     m_table->horizontalHeader()->setStretchLastSection(true);
     m_table->setAlternatingRowColors(true);
     root->addWidget(m_table, 1);
@@ -108,8 +124,11 @@ DoctorPage::DoctorPage(QWidget* parent)
     connect(m_searchBtn, &QPushButton::clicked, this, &DoctorPage::onSearch);
     connect(m_keyword, &QLineEdit::returnPressed, this, &DoctorPage::onSearch);
     connect(m_addBtn, &QPushButton::clicked, this, &DoctorPage::onAdd);
+    connect(m_importBtn, &QPushButton::clicked, this, &DoctorPage::onImport);
+    connect(m_exportBtn, &QPushButton::clicked, this, &DoctorPage::onExport);
     connect(m_editBtn, &QPushButton::clicked, this, &DoctorPage::onEdit);
     connect(m_deleteBtn, &QPushButton::clicked, this, &DoctorPage::onDelete);
+    connect(m_moveBtn, &QPushButton::clicked, this, &DoctorPage::onReassignDepartment);
 }
 
 void DoctorPage::setCurrentUserId(const QString& userId)
@@ -124,8 +143,19 @@ void DoctorPage::onSearch()
 
 int DoctorPage::selectedRow() const
 {
-    const auto idx = m_table->currentIndex();
-    return idx.isValid() ? idx.row() : -1;
+    const auto rows = m_table->selectionModel()->selectedRows();
+    return rows.size() == 1 ? rows.constFirst().row() : -1;
+}
+
+QStringList DoctorPage::selectedIds() const
+{
+    QStringList ids;
+    const auto rows = m_table->selectionModel()->selectedRows();
+    ids.reserve(rows.size());
+    for (const auto& idx : rows) {
+        ids << m_model->record(idx.row()).value(QStringLiteral("ID")).toString();
+    }
+    return ids;
 }
 
 void DoctorPage::onAdd()
@@ -147,14 +177,39 @@ void DoctorPage::onAdd()
         return;
     }
     m_model->select();
-    HistoryLogger::logEvent(m_userId, QStringLiteral("添加医生：%1(%2)").arg(dlg.name(), id));
+    HistoryLogger::log(m_userId, HistoryLogger::Action::Create, HistoryLogger::Entity::Doctor, id, dlg.name());
+}
+
+void DoctorPage::onImport()
+{
+    const auto path = QFileDialog::getOpenFileName(this, QStringLiteral("选择 CSV 文件"), {}, QStringLiteral("CSV 文件 (*.csv);;所有文件 (*)"));
+    if (path.isEmpty()) {
+        return;
+    }
+
+    ImportDialog dlg(CsvImporter::Target::Doctors, path, this);
+    dlg.exec();
+    if (dlg.imported() > 0) {
+        m_model->select();
+        HistoryLogger::log(m_userId,
+                           HistoryLogger::Action::Import,
+                           HistoryLogger::Entity::Doctor,
+                           {},
+                           QStringLiteral("%1条(%2)").arg(dlg.imported()).arg(QFileInfo(path).fileName()));
+    }
+}
+
+void DoctorPage::onExport()
+{
+    // 按当前查找条件导出，直接读表，不依赖表格已加载的行。
+    ExportDialog::start(TableExporter::doctors(m_model->filter()), QStringLiteral("医生"), this);
 }
 
 void DoctorPage::onEdit()
 {
     const int row = selectedRow();
     if (row < 0) {
-        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请先选择一行。"));
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请选择一行（只能选一行）。"));
         return;
     }
     const auto rec = m_model->record(row);
@@ -179,14 +234,20 @@ void DoctorPage::onEdit()
         return;
     }
     m_model->select();
-    HistoryLogger::logEvent(m_userId, QStringLiteral("修改医生：%1(%2)").arg(dlg.name(), id));
+    HistoryLogger::log(m_userId, HistoryLogger::Action::Update, HistoryLogger::Entity::Doctor, id, dlg.name());
 }
 
 void DoctorPage::onDelete()
 {
+    const auto ids = selectedIds();
+    if (ids.size() > 1) {
+        onBulkDelete(ids);
+        return;
+    }
+
     const int row = selectedRow();
     if (row < 0) {
-        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请先选择一行。"));
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请选择一行（只能选一行）。"));
         return;
     }
     const auto rec = m_model->record(row);
@@ -204,5 +265,79 @@ void DoctorPage::onDelete()
         return;
     }
     m_model->select();
-    HistoryLogger::logEvent(m_userId, QStringLiteral("删除医生：%1(%2)").arg(name, id));
+    HistoryLogger::log(m_userId, HistoryLogger::Action::Delete, HistoryLogger::Entity::Doctor, id, name);
+}
+
+void DoctorPage::onBulkDelete(const QStringList& ids)
+{
+    if (QMessageBox::question(this,
+                             QStringLiteral("确认删除"),
+                             QStringLiteral("确定删除选中的 %1 条医生记录？").arg(ids.size()))
+        != QMessageBox::Yes) {
+        return;
+    }
+
+    QString err;
+    if (!DbManager::instance().execBulk(QStringLiteral("DELETE FROM Doctor WHERE ID IN (%1);"), {}, ids, &err)) {
+        QMessageBox::critical(this, QStringLiteral("删除失败"), err);
+        return;
+    }
+    m_model->select();
+    HistoryLogger::log(m_userId,
+                       HistoryLogger::Action::BulkDelete,
+                       HistoryLogger::Entity::Doctor,
+                       {},
+                       QStringLiteral("%1条(%2)").arg(ids.size()).arg(HistoryLogger::summarizeIds(ids)));
+}
+
+void DoctorPage::onReassignDepartment()
+{
+    const auto ids = selectedIds();
+    if (ids.isEmpty()) {
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请先选择一行或多行。"));
+        return;
+    }
+
+    // 科室名可能重名，按下拉框的下标取条目里带的 ID，不按名字反查。
+    QDialog dlg(this);
+    dlg.setWindowTitle(QStringLiteral("调整科室"));
+    auto* root = new QVBoxLayout(&dlg);
+    auto* form = new QFormLayout();
+    auto* department = new QComboBox(&dlg);
+    department->addItem(QStringLiteral("（无）"), {});
+    auto& cache = LookupCache::departments();
+    cache.refresh();
+    for (const auto& e : cache.entries()) {
+        department->addItem(e.value, e.key);
+    }
+    form->addRow(QStringLiteral("将选中的 %1 位医生调整到：").arg(ids.size()), department);
+    root->addLayout(form);
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
+    buttons->button(QDialogButtonBox::Ok)->setText(QStringLiteral("确定"));
+    buttons->button(QDialogButtonBox::Cancel)->setText(QStringLiteral("取消"));
+    root->addWidget(buttons);
+    connect(buttons, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    if (dlg.exec() != QDialog::Accepted) {
+        return;
+    }
+    const auto departmentId = department->currentData().toString();
+    const auto picked = department->currentText();
+
+    QString err;
+    if (!DbManager::instance().execBulk(QStringLiteral("UPDATE Doctor SET DEPARTMENT_ID=? WHERE ID IN (%1);"),
+                                        {departmentId.isEmpty() ? QVariant() : QVariant(departmentId)},
+                                        ids,
+                                        &err)) {
+        QMessageBox::critical(this, QStringLiteral("修改失败"), err);
+        return;
+    }
+    m_model->select();
+    HistoryLogger::log(m_userId,
+                       HistoryLogger::Action::BulkUpdate,
+                       HistoryLogger::Entity::Doctor,
+                       {},
+                       QStringLiteral("%1条，科室→%2(%3)")
+                           .arg(ids.size())
+                           .arg(picked, HistoryLogger::summarizeIds(ids)));
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QStringList>
 #include <QWidget>
 
 class DoctorModel;
@@ -18,17 +19,26 @@ public:
 private:
     void onSearch();
     void onAdd();
+    void onImport();
+    void onExport();
     void onEdit();
     void onDelete();
+    void onBulkDelete(const QStringList& ids);
+    void onReassignDepartment();
+    // 恰好选中一行时返回该行，否则返回 -1（当前行可能不在选区内，不能用）。
     int selectedRow() const;
+    QStringList selectedIds() const;
 
     QString m_userId;
     DoctorModel* m_model = nullptr;
     QLineEdit* m_keyword = nullptr;
     QPushButton* m_searchBtn = nullptr;
     QPushButton* m_addBtn = nullptr;
+    QPushButton* m_importBtn = nullptr;
+    QPushButton* m_exportBtn = nullptr;
     QPushButton* m_deleteBtn = nullptr;
     QPushButton* m_editBtn = nullptr;
+    QPushButton* m_moveBtn = nullptr;
     QTableView* m_table = nullptr;
 };
 
@@ -0,0 +1,121 @@
+#include "exportdialog.h"
+
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QLabel>
+#include <QMessageBox>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+ExportDialog* ExportDialog::start(const TableExporter::Source& source, const QString& defaultName, QWidget* parent)
+{
+    QString selected;
+    const auto path = QFileDialog::getSaveFileName(parent,
+                                                   QStringLiteral("导出"),
+                                                   QDir::home().filePath(defaultName + QStringLiteral(".csv")),
+                                                   QStringLiteral("CSV (*.csv);;Excel 工作簿 (*.xlsx)"),
+                                                   &selected);
+    if (path.isEmpty()) {
+        return nullptr;
+    }
+
+    // 没写扩展名时按所选的文件类型补上。
+    auto target = path;
+    if (QFileInfo(target).suffix().isEmpty()) {
+        target += selected.contains(QStringLiteral("xlsx")) ? QStringLiteral(".xlsx") : QStringLiteral(".csv");
+    }
+
+    auto* dlg = new ExportDialog(target, parent);
+    QString err;
+    if (!dlg->m_exporter->start(source, target, TableExporter::formatFor(target), &err)) {
+        delete dlg;
+        QMessageBox::critical(parent, QStringLiteral("导出失败"), err);
+        return nullptr;
+    }
+    dlg->m_timer.start();
+    dlg->show();
+    return dlg;
+}
+
+ExportDialog::ExportDialog(const QString& path, QWidget* parent)
+    : QDialog(parent), m_path(path), m_exporter(new TableExporter(this))
+{
+    setWindowTitle(QStringLiteral("导出"));
+    setAttribute(Qt::WA_DeleteOnClose);
+    setModal(false);
+    resize(480, 160);
+
+    auto* root = new QVBoxLayout(this);
+    auto* file = new QLabel(QStringLiteral("文件：%1").arg(QDir::toNativeSeparators(path)), this);
+    file->setWordWrap(true);
+    m_progress = new QProgressBar(this);
+    // 总数统计出来之前显示为忙碌状态。
+    m_progress->setRange(0, 0);
+    m_status = new QLabel(QStringLiteral("正在导出…"), this);
+    m_status->setWordWrap(true);
+    m_button = new QPushButton(QStringLiteral("取消"), this);
+
+    root->addWidget(file);
+    root->addWidget(m_progress);
+    root->addWidget(m_status, 1);
+    root->addWidget(m_button, 0, Qt::AlignRight);
+
+    connect(m_exporter, &TableExporter::progress, this, &ExportDialog::onProgress);
+    connect(m_exporter, &TableExporter::finished, this, &ExportDialog::onFinished);
+    connect(m_button, &QPushButton::clicked, this, [this] {
+        if (m_exporter->isRunning()) {
+            reject();
+        } else {
+            accept();
+        }
+    });
+}
+
+void ExportDialog::reject()
+{
+    if (!m_exporter->isRunning()) {
+        QDialog::reject();
+        return;
+    }
+    m_button->setEnabled(false);
+    m_status->setText(QStringLiteral("正在取消…"));
+    m_exporter->cancel();
+}
+
+void ExportDialog::onProgress(qint64 rows, qint64 total)
+{
+    if (total >= 0) {
+        m_total = total;
+        m_progress->setRange(0, 1000);
+    }
+    if (m_total > 0) {
+        m_progress->setValue(int(qMin(rows, m_total) * 1000 / m_total));
+    }
+    const double seconds = qMax<qint64>(1, m_timer.elapsed()) / 1000.0;
+    m_status->setText(m_total >= 0 ? QStringLiteral("已导出 %1 / %2 条（约 %3 条/秒）")
+                                         .arg(rows)
+                                         .arg(m_total)
+                                         .arg(qRound64(rows / seconds))
+                                   : QStringLiteral("已导出 %1 条（约 %2 条/秒）").arg(rows).arg(qRound64(rows / seconds)));
+}
+
+void ExportDialog::onFinished(qint64 rows, bool cancelled, const QString& error)
+{
+    m_button->setEnabled(true);
+    m_button->setText(QStringLiteral("关闭"));
+    m_progress->setRange(0, 1000);
+
+    if (!error.isEmpty()) {
+        m_status->setText(QStringLiteral("导出失败：%1").arg(error));
+    } else if (cancelled) {
+        // 取消时不留半个文件，直接关掉。
+        close();
+    } else {
+        m_progress->setValue(m_progress->maximum());
+        m_status->setText(QStringLiteral("导出完成：%1 条，用时 %2 秒。")
+                              .arg(rows)
+                              .arg(m_timer.elapsed() / 1000.0, 0, 'f', 1));
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QDialog>
+#include <QElapsedTimer>
+
+#include "io/tableexporter.h"
+
+class QLabel;
+class QProgressBar;
+class QPushButton;
+
+// 导出进度：非模态，导出在后台进行，期间主窗口照常可用；关闭窗口即取消。
+class ExportDialog final : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // 选择保存路径后开始导出；用户取消选择时返回 nullptr。对话框关闭时自行释放。
+    static ExportDialog* start(const TableExporter::Source& source, const QString& defaultName, QWidget* parent);
+
+    void reject() override;
+
+private:
+    ExportDialog(const QString& path, QWidget* parent);
+
+    void onProgress(qint64 rows, qint64 total);
+    void onFinished(qint64 rows, bool cancelled, const QString& error);
+
+    QString m_path;
+    TableExporter* m_exporter = nullptr;
+    QElapsedTimer m_timer;
+    qint64 m_total = -1;
+
+    QProgressBar* m_progress = nullptr;
+    QLabel* m_status = nullptr;
+    QPushButton* m_button = nullptr;
+};
@@ -1,23 +1,24 @@
 #include "historypage.h"
 
-#include "db/dbmanager.h"
+#include "db/historylogger.h"
+#include "db/historysearch.h"
+#include "models/historymodel.h"
+#include "ui/exportdialog.h"
 
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDate>
+#include <QDateTimeEdit>
 #include <QHeaderView>
+#include <QLabel>
 #include <QLineEdit>
+#include <QProgressBar>
 #include <QPushButton>
-#include <QSqlQueryModel>
+#include <QScrollBar>
 #include <QTableView>
+#include <QTimer>
 #include <QVBoxLayout>
 
-static QString escapeLike(const QString& text)
-{
-    QString s = text;
-    s.replace(QStringLiteral("\\"), QStringLiteral("\\\\"));
-    s.replace(QStringLiteral("%"), QStringLiteral("\\%"));
-    s.replace(QStringLiteral("_"), QStringLiteral("\\_"));
-    return s;
-}
-
 HistoryPage::HistoryPage(QWidget* parent)
     : QWidget(parent)
 {
@@ -27,78 +28,206 @@ HistoryPage::HistoryPage(QWidget* parent)
 
     auto* top = new QHBoxLayout();
     m_keyword = new QLineEdit(this);
-    m_keyword->setPlaceholderText(QStringLiteral("输入关键字（事件）"));
+    m_keyword->setPlaceholderText(QStringLiteral("输入关键字，空格分隔多个词；选择对象类型时按 ID 精确查找"));
+    m_entity = new QComboBox(this);
+    m_entity->addItem(QStringLiteral("全部对象"), static_cast<int>(HistoryLogger::Entity::None));
+    m_entity->addItem(QStringLiteral("用户"), static_cast<int>(HistoryLogger::Entity::User));
+    m_entity->addItem(QStringLiteral("患者"), static_cast<int>(HistoryLogger::Entity::Patient));
+    m_entity->addItem(QStringLiteral("医生"), static_cast<int>(HistoryLogger::Entity::Doctor));
+    m_entity->addItem(QStringLiteral("科室"), static_cast<int>(HistoryLogger::Entity::Department));
+    m_action = new QComboBox(this);
+    m_action->addItem(QStringLiteral("全部操作"), static_cast<int>(HistoryLogger::Action::Other));
+    m_action->addItem(QStringLiteral("登录"), static_cast<int>(HistoryLogger::Action::Login));
+    m_action->addItem(QStringLiteral("添加"), static_cast<int>(HistoryLogger::Action::Create));
+    m_action->addItem(QStringLiteral("修改"), static_cast<int>(HistoryLogger::Action::Update));
+    m_action->addItem(QStringLiteral("删除"), static_cast<int>(HistoryLogger::Action::Delete));
+    m_action->addItem(QStringLiteral("批量删除"), static_cast<int>(HistoryLogger::Action::BulkDelete));
+    m_action->addItem(QStringLiteral("批量修改"), static_cast<int>(HistoryLogger::Action::BulkUpdate));
+    m_action->addItem(QStringLiteral("导入"), static_cast<int>(HistoryLogger::Action::Import));
     m_searchBtn = new QPushButton(QStringLiteral("查找"), this);
     m_refreshBtn = new QPushButton(QStringLiteral("刷新"), this);
+    m_cancelBtn = new QPushButton(QStringLiteral("停止"), this);
+    m_cancelBtn->setEnabled(false);
+    m_exportBtn = new QPushButton(QStringLiteral("导出"), this);
+    m_live = new QCheckBox(QStringLiteral("实时"), this);
+    m_live->setChecked(true);
 
+    top->addWidget(m_entity);
+    top->addWidget(m_action);
     top->addWidget(m_keyword, 1);
     top->addWidget(m_searchBtn);
     top->addWidget(m_refreshBtn);
+    top->addWidget(m_cancelBtn);
+    top->addWidget(m_exportBtn);
+    top->addWidget(m_live);
     root->addLayout(top);
 
+    // 时间范围：起始含、结束不含，映射到 TS_MS 索引上的范围查找。
+    auto* range = new QHBoxLayout();
+    m_useRange = new QCheckBox(QStringLiteral("时间范围"), this);
+    const QDateTime today(QDate::currentDate(), QTime(0, 0));
+    m_from = new QDateTimeEdit(today, this);
+    m_to = new QDateTimeEdit(today.addDays(1), this);
+    for (auto* edit : {m_from, m_to}) {
+        edit->setCalendarPopup(true);
+        edit->setDisplayFormat(QStringLiteral("yyyy-MM-dd HH:mm"));
+        edit->setEnabled(false);
+    }
+    range->addWidget(m_useRange);
+    range->addWidget(m_from);
+    range->addWidget(new QLabel(QStringLiteral("至"), this));
+    range->addWidget(m_to);
+    range->addStretch(1);
+    m_byRelevance = new QCheckBox(QStringLiteral("按相关度排序"), this);
+    if (!HistorySearch::isAvailable()) {
+        m_byRelevance->setEnabled(false);
+        m_byRelevance->setToolTip(QStringLiteral("当前 SQLite 不支持全文索引，关键字按子串查找"));
+    }
+    range->addWidget(m_byRelevance);
+    root->addLayout(range);
+
+    m_model = new HistoryModel(this);
+
     m_table = new QTableView(this);
+    m_table->setModel(m_model);
     m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_table->setAlternatingRowColors(true);
     m_table->horizontalHeader()->setStretchLastSection(true);
     root->addWidget(m_table, 1);
 
+    auto* bottom = new QHBoxLayout();
+    m_status = new QLabel(this);
+    m_progress = new QProgressBar(this);
+    m_progress->setMaximumWidth(240);
+    m_progress->setTextVisible(false);
+    m_progress->setVisible(false);
+    bottom->addWidget(m_status, 1);
+    bottom->addWidget(m_progress);
+    root->addLayout(bottom);
+
     connect(m_searchBtn, &QPushButton::clicked, this, &HistoryPage::onSearch);
     connect(m_refreshBtn, &QPushButton::clicked, this, &HistoryPage::refresh);
+    connect(m_cancelBtn, &QPushButton::clicked, m_model, &HistoryModel::cancel);
+    connect(m_exportBtn, &QPushButton::clicked, this, &HistoryPage::onExport);
     connect(m_keyword, &QLineEdit::returnPressed, this, &HistoryPage::onSearch);
+    connect(m_useRange, &QCheckBox::toggled, this, [this](bool on) {
+        m_from->setEnabled(on);
+        m_to->setEnabled(on);
+    });
+    connect(m_model, &HistoryModel::loadingChanged, this, &HistoryPage::onLoadingChanged);
+    connect(m_model, &HistoryModel::notice, this, [this](const QString& text) { m_notice = text; });
+    connect(m_model, &HistoryModel::tailInserted, this, &HistoryPage::onTailInserted);
 
-    refresh();
+    // 写线程每 200ms 左右提交一批，这里再合并一次，避免频繁操作时反复查询。
+    m_liveTimer = new QTimer(this);
+    m_liveTimer->setSingleShot(true);
+    m_liveTimer->setInterval(300);
+    connect(m_liveTimer, &QTimer::timeout, m_model, &HistoryModel::refreshTail);
+    connect(HistoryLogger::notifier(), &HistoryNotifier::eventsCommitted, this, [this] {
+        if (!isVisible() || (!m_live->isChecked() && !m_catchUpPending)) {
+            return;
+        }
+        m_catchUpPending = HistoryLogger::queueDepth() > 0;
+        if (!m_liveTimer->isActive()) {
+            m_liveTimer->start();
+        }
+    });
+    connect(m_live, &QCheckBox::toggled, this, [this](bool on) {
+        if (on && isVisible()) {
+            m_model->refreshTail();
+        }
+    });
+    connect(m_model, &HistoryModel::loadFailed, this, [this](const QString& error) {
+        m_status->setText(QStringLiteral("加载失败：%1").arg(error));
+    });
 }
 
-HistoryPage::~HistoryPage()
+void HistoryPage::catchUp()
 {
-    delete m_model;
+    // 日志是异步批量写入的：不在界面线程等写线程，只叫醒它；队列里还有事件时，提交后再补取一次。
+    HistoryLogger::requestFlush();
+    m_catchUpPending = HistoryLogger::queueDepth() > 0;
+    // 构造时不查询，第一次进入页面才按界面上的条件加载首页。
+    if (!m_model->hasLoaded()) {
+        refresh();
+        return;
+    }
+    m_model->refreshTail();
 }
 
 void HistoryPage::refresh()
 {
-    delete m_model;
-    m_model = nullptr;
-
-    QString err;
-    m_model = DbManager::instance().createQueryModel(
-        QStringLiteral(
-            "SELECT H.ID AS 'ID',"
-            "       COALESCE(U.USERNAME,'') AS '用户名',"
-            "       H.EVENT AS '事件',"
-            "       H.TIMESTAMP AS '时间'"
-            "  FROM History H"
-            "  LEFT JOIN User U ON U.ID = H.USER_ID"
-            " ORDER BY H.ID DESC;"),
-        {},
-        nullptr,
-        &err);
-    m_table->setModel(m_model);
+    HistoryModel::Filter f;
+    f.action = m_action->currentData().toInt();
+    f.entityType = m_entity->currentData().toInt();
+
+    const auto k = m_keyword->text().trimmed();
+    if (f.entityType != 0) {
+        f.entityId = k;
+    } else {
+        f.keyword = k;
+        f.byRelevance = m_byRelevance->isChecked();
+    }
+    if (m_useRange->isChecked()) {
+        f.fromMs = m_from->dateTime().toMSecsSinceEpoch();
+        f.toMs = m_to->dateTime().toMSecsSinceEpoch();
+        if (f.toMs <= f.fromMs) {
+            m_status->setText(QStringLiteral("结束时间应晚于开始时间"));
+            return;
+        }
+    }
+    m_notice.clear();
+    m_model->setFilter(f);
 }
 
-void HistoryPage::onSearch()
+void HistoryPage::onExport()
 {
-    const auto k = m_keyword->text().trimmed();
-    if (k.isEmpty()) {
+    // 导出全部符合当前条件的记录（含已归档月份），而不只是已加载到表格里的页。
+    if (!m_model->hasLoaded()) {
         refresh();
-        return;
     }
-    delete m_model;
-    m_model = nullptr;
-
-    const auto like = QStringLiteral("%%%1%%").arg(escapeLike(k));
-    QString err;
-    m_model = DbManager::instance().createQueryModel(
-        QStringLiteral(
-            "SELECT H.ID AS 'ID',"
-            "       COALESCE(U.USERNAME,'') AS '用户名',"
-            "       H.EVENT AS '事件',"
-            "       H.TIMESTAMP AS '时间'"
-            "  FROM History H"
-            "  LEFT JOIN User U ON U.ID = H.USER_ID"
-            " WHERE H.EVENT LIKE ? ESCAPE '\\'"
-            " ORDER BY H.ID DESC;"),
-        {like},
-        nullptr,
-        &err);
-    m_table->setModel(m_model);
+    TableExporter::Source source;
+    m_model->exportQuery(&source.sql, &source.args, &source.attachments);
+    for (int c = 0; c < m_model->columnCount(); ++c) {
+        source.headers << m_model->headerData(c, Qt::Horizontal).toString();
+    }
+    ExportDialog::start(source, QStringLiteral("操作日志"), this);
+}
+
+void HistoryPage::onLoadingChanged(bool loading)
+{
+    m_cancelBtn->setEnabled(loading);
+    m_progress->setVisible(loading);
+    m_progress->setRange(0, 0);
+
+    const auto loaded = m_model->rowCount();
+    if (loading) {
+        m_status->setText(QStringLiteral("已加载 %1 条，正在读取下一页…").arg(loaded));
+    } else if (m_model->atEnd()) {
+        m_status->setText(QStringLiteral("共 %1 条").arg(loaded));
+    } else {
+        m_status->setText(QStringLiteral("已加载 %1 条，向下滚动加载更多").arg(loaded));
+    }
+    if (!m_notice.isEmpty()) {
+        m_status->setText(m_status->text() + QStringLiteral("（%1）").arg(m_notice));
+    }
+}
+
+void HistoryPage::onSearch()
+{
+    refresh();
+}
+
+void HistoryPage::onTailInserted(int rows)
+{
+    // 用户已向下翻看时保持当前可见行不动；停在顶部则直接显示最新记录。
+    auto* bar = m_table->verticalScrollBar();
+    if (bar->value() > 0) {
+        bar->setValue(bar->value() + rows * (m_table->verticalScrollMode() == QAbstractItemView::ScrollPerItem
+                                                 ? 1
+                                                 : m_table->verticalHeader()->defaultSectionSize()));
+    }
+    if (!m_model->isLoading()) {
+        onLoadingChanged(false);
+    }
 }
@@ -2,10 +2,16 @@
 
 #include <QWidget>
 
+class QCheckBox;
+class QComboBox;
+class QDateTimeEdit;
+class QLabel;
 class QLineEdit;
+class QProgressBar;
 class QPushButton;
-class QSqlQueryModel;
 class QTableView;
+class QTimer;
+class HistoryModel;
 
 class HistoryPage final : public QWidget
 {
@@ -13,17 +19,35 @@ class HistoryPage final : public QWidget
 
 public:
     explicit HistoryPage(QWidget* parent = nullptr);
-    ~HistoryPage() override;
 
     void refresh();
+    // 只补取新增的记录；首次进入页面时等同 refresh()。
+    void catchUp();
 
 private:
     void onSearch();
+    void onExport();
+    void onLoadingChanged(bool loading);
+    void onTailInserted(int rows);
 
+    QComboBox* m_entity = nullptr;
+    QComboBox* m_action = nullptr;
     QLineEdit* m_keyword = nullptr;
     QPushButton* m_searchBtn = nullptr;
     QPushButton* m_refreshBtn = nullptr;
+    QPushButton* m_cancelBtn = nullptr;
+    QPushButton* m_exportBtn = nullptr;
+    QCheckBox* m_live = nullptr;
+    QCheckBox* m_useRange = nullptr;
+    QCheckBox* m_byRelevance = nullptr;
+    QDateTimeEdit* m_from = nullptr;
+    QDateTimeEdit* m_to = nullptr;
+    QTimer* m_liveTimer = nullptr;
     QTableView* m_table = nullptr;
-    QSqlQueryModel* m_model = nullptr;
+    QLabel* m_status = nullptr;
+    QProgressBar* m_progress = nullptr;
+    HistoryModel* m_model = nullptr;
+    QString m_notice;
+    // 进入页面时队列里还有未提交的日志，提交后要补取一次（没勾选实时刷新也一样）。
+    bool m_catchUpPending = false;
 };
-
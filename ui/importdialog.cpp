@@ -0,0 +1,120 @@
+#include "importdialog.h"
+
+#include <QFileInfo>
+#include <QLabel>
+#include <QMessageBox>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+ImportDialog::ImportDialog(CsvImporter::Target target, const QString& path, QWidget* parent)
+    : QDialog(parent), m_target(target), m_path(path), m_importer(new CsvImporter(this))
+{
+    setWindowTitle(QStringLiteral("导入"));
+    setModal(true);
+    resize(520, 200);
+
+    auto* root = new QVBoxLayout(this);
+    m_file = new QLabel(QStringLiteral("文件：%1").arg(QFileInfo(path).fileName()), this);
+    auto* hint = new QLabel(QStringLiteral("可用列：%1（* 为必填）").arg(CsvImporter::columnHints(target).join(QStringLiteral("，"))), this);
+    hint->setWordWrap(true);
+    m_progress = new QProgressBar(this);
+    m_progress->setRange(0, 1000);
+    m_status = new QLabel(this);
+    m_status->setWordWrap(true);
+    m_button = new QPushButton(QStringLiteral("取消"), this);
+
+    root->addWidget(m_file);
+    root->addWidget(hint);
+    root->addWidget(m_progress);
+    root->addWidget(m_status, 1);
+    root->addWidget(m_button, 0, Qt::AlignRight);
+
+    connect(m_importer, &CsvImporter::progress, this, &ImportDialog::onProgress);
+    connect(m_importer, &CsvImporter::finished, this, &ImportDialog::onFinished);
+    connect(m_button, &QPushButton::clicked, this, [this] {
+        if (m_importer->isRunning()) {
+            reject();
+        } else {
+            accept();
+        }
+    });
+}
+
+void ImportDialog::reject()
+{
+    if (!m_importer->isRunning()) {
+        QDialog::reject();
+        return;
+    }
+    m_button->setEnabled(false);
+    m_status->setText(QStringLiteral("正在取消，等待当前批次提交…"));
+    m_importer->cancel();
+}
+
+int ImportDialog::exec()
+{
+    const qint64 resumeAt = CsvImporter::checkpointOffset(m_target, m_path);
+    if (resumeAt > 0) {
+        const auto answer = QMessageBox::question(
+            parentWidget(),
+            QStringLiteral("继续导入"),
+            QStringLiteral("该文件上次导入到 %1%，是否从断点继续？选择“否”将从头导入。")
+                .arg(resumeAt * 100 / qMax<qint64>(1, QFileInfo(m_path).size())),
+            QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+        if (answer == QMessageBox::Cancel) {
+            return Rejected;
+        }
+        QString err;
+        if (answer == QMessageBox::No && !CsvImporter::clearCheckpoint(m_path, &err)) {
+            QMessageBox::critical(parentWidget(), QStringLiteral("导入失败"), err);
+            return Rejected;
+        }
+    }
+
+    QString err;
+    if (!m_importer->start(m_target, m_path, &err)) {
+        QMessageBox::critical(parentWidget(), QStringLiteral("导入失败"), err);
+        return Rejected;
+    }
+    m_resumed = m_importer->resumedImported();
+    m_imported = m_resumed;
+    m_timer.start();
+    m_status->setText(QStringLiteral("正在导入…"));
+    return QDialog::exec();
+}
+
+void ImportDialog::onProgress(qint64 bytesDone, qint64 bytesTotal, qint64 imported, qint64 failed)
+{
+    m_imported = imported;
+    m_progress->setValue(bytesTotal > 0 ? int(bytesDone * 1000 / bytesTotal) : 0);
+    const double seconds = qMax<qint64>(1, m_timer.elapsed()) / 1000.0;
+    m_status->setText(QStringLiteral("已导入 %1 条，失败 %2 条（约 %3 条/秒）")
+                          .arg(imported)
+                          .arg(failed)
+                          .arg(qRound64((imported - m_resumed) / seconds)));
+}
+
+void ImportDialog::onFinished(qint64 imported, qint64 failed, bool cancelled, const QString& error)
+{
+    m_imported = imported;
+    m_button->setEnabled(true);
+    m_button->setText(QStringLiteral("关闭"));
+
+    QString text;
+    if (!error.isEmpty()) {
+        text = QStringLiteral("导入中断：%1。已提交的部分保留，再次导入该文件会从断点继续。").arg(error);
+    } else if (cancelled) {
+        text = QStringLiteral("已取消：已导入 %1 条。再次导入该文件会从断点继续。").arg(imported);
+    } else {
+        m_progress->setValue(m_progress->maximum());
+        text = QStringLiteral("导入完成：成功 %1 条，失败 %2 条，用时 %3 秒。")
+                   .arg(imported)
+                   .arg(failed)
+                   .arg(m_timer.elapsed() / 1000.0, 0, 'f', 1);
+    }
+    if (failed > 0) {
+        text += QStringLiteral("\n失败明细：%1").arg(CsvImporter::errorReportPath(m_path));
+    }
+    m_status->setText(text);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QDialog>
+#include <QElapsedTimer>
+
+#include "io/csvimporter.h"
+
+class QLabel;
+class QProgressBar;
+class QPushButton;
+
+// CSV 导入进度：打开即开始导入，可取消；取消后再导入同一文件会从断点继续。
+class ImportDialog final : public QDialog
+{
+    Q_OBJECT
+
+public:
+    ImportDialog(CsvImporter::Target target, const QString& path, QWidget* parent = nullptr);
+
+    // 本次运行成功导入的行数，不含续传之前已提交的部分（那部分上次已经记过日志）。
+    qint64 imported() const { return m_imported - m_resumed; }
+
+    int exec() override;
+    // 导入进行中时关闭窗口等同于取消。
+    void reject() override;
+
+private:
+    void onProgress(qint64 bytesDone, qint64 bytesTotal, qint64 imported, qint64 failed);
+    void onFinished(qint64 imported, qint64 failed, bool cancelled, const QString& error);
+
+    CsvImporter::Target m_target;
+    QString m_path;
+    CsvImporter* m_importer = nullptr;
+    QElapsedTimer m_timer;
+    qint64 m_imported = 0; // 含续传之前的部分，界面上显示的是累计数
+    qint64 m_resumed = 0;
+
+    QLabel* m_file = nullptr;
+    QProgressBar* m_progress = nullptr;
+    QLabel* m_status = nullptr;
+    QPushButton* m_button = nullptr;
+};
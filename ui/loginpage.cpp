@@ -101,7 +101,7 @@ void LoginPage::onLoginClicked()
     u.username = username;
     u.fullName = q.value(1).toString();
 
-    HistoryLogger::logEvent(u.id, QStringLiteral("登录：%1").arg(username));
+    HistoryLogger::log(u.id, HistoryLogger::Action::Login, HistoryLogger::Entity::User, u.id, username);
     emit loginSucceeded(u);
 }
 
@@ -2,13 +2,23 @@
 
 #include "db/dbmanager.h"
 #include "db/historylogger.h"
+#include "db/patientrevisions.h"
 #include "delegates/patientdelegate.h"
 #include "entities/patient.h"
+#include "models/patientgridcache.h"
+#include "models/patientgridcachewriter.h"
 #include "models/patientmodel.h"
+#include "ui/exportdialog.h"
+#include "ui/importdialog.h"
 #include "ui/patienteditdialog.h"
+#include "ui/patientrevisiondialog.h"
 
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QHeaderView>
+#include <QItemSelectionModel>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QPushButton>
@@ -17,8 +27,14 @@
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QTableView>
+#include <QTimer>
 #include <QVBoxLayout>
 
+#include <functional>
+
+// 追赶启动缓存时每次事件循环最多取数的时间，保证滚动缓存表格不卡。
+static constexpr int kCatchUpSliceMs = 8;
+
 static Patient recordToPatient(const QSqlRecord& r)
 {
     Patient p;
@@ -34,41 +50,75 @@ static Patient recordToPatient(const QSqlRecord& r)
     return p;
 }
 
-static bool insertPatient(const Patient& p, QString* error)
-{
-    const auto created = QDateTime::currentDateTime().toString(Qt::ISODate);
-    return DbManager::instance().exec(
-        QStringLiteral(
-            "INSERT INTO Patient(ID,ID_CARD,NAME,SEX,DOB,HEIGHT,WEIGHT,MOBILEPHONE,AGE,CREATEDTIMESTAMP)"
-            " VALUES(?,?,?,?,?,?,?,?,?,?);"),
-        {p.id,
-         p.idCard,
-         p.name,
-         p.sex,
-         p.dob.toString(Qt::ISODate),
-         p.height,
-         p.weight,
-         p.mobilePhone,
-         p.age,
-         created},
-        error);
-}
-
-static bool updatePatient(const Patient& p, QString* error)
-{
-    return DbManager::instance().exec(
-        QStringLiteral(
-            "UPDATE Patient SET ID_CARD=?,NAME=?,SEX=?,DOB=?,HEIGHT=?,WEIGHT=?,MOBILEPHONE=?,AGE=? WHERE ID=?;"),
-        {p.idCard,
-         p.name,
-         p.sex,
-         p.dob.toString(Qt::ISODate),
-         p.height,
-         p.weight,
-         p.mobilePhone,
-         p.age,
-         p.id},
-        error);
+// 患者表的改动和对应的 PatientRevision 版本在同一事务里提交。
+static bool inTransaction(QString* error, const std::function<bool(QString*)>& body)
+{
+    auto db = DbManager::instance().database();
+    if (!db.transaction()) {
+        if (error) {
+            *error = db.lastError().text();
+        }
+        return false;
+    }
+    if (!body(error)) {
+        db.rollback();
+        return false;
+    }
+    if (!db.commit()) {
+        if (error) {
+            *error = db.lastError().text();
+        }
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+static bool insertPatient(const Patient& p, const QString& userId, QString* error)
+{
+    const auto now = QDateTime::currentDateTime();
+    return inTransaction(error, [&](QString* err) {
+        return DbManager::instance().exec(
+                   QStringLiteral(
+                       "INSERT INTO Patient(ID,ID_CARD,NAME,SEX,DOB,HEIGHT,WEIGHT,MOBILEPHONE,AGE,CREATEDTIMESTAMP,CREATED_MS)"
+                       " VALUES(?,?,?,?,?,?,?,?,?,?,?);"),
+                   {p.id,
+                    p.idCard,
+                    p.name,
+                    p.sex,
+                    p.dob.toString(Qt::ISODate),
+                    p.height,
+                    p.weight,
+                    p.mobilePhone,
+                    p.age,
+                    now.toString(Qt::ISODate),
+                    now.toMSecsSinceEpoch()},
+                   err)
+            && PatientRevisions::recordCreated(DbManager::instance().database(), p, userId, err);
+    });
+}
+
+static bool updatePatient(const Patient& p, const QString& userId, QString* error)
+{
+    return inTransaction(error, [&](QString* err) {
+        const auto db = DbManager::instance().database();
+        Patient before;
+        return PatientRevisions::current(db, p.id, &before, err)
+            && DbManager::instance().exec(
+                QStringLiteral(
+                    "UPDATE Patient SET ID_CARD=?,NAME=?,SEX=?,DOB=?,HEIGHT=?,WEIGHT=?,MOBILEPHONE=?,AGE=? WHERE ID=?;"),
+                {p.idCard,
+                 p.name,
+                 p.sex,
+                 p.dob.toString(Qt::ISODate),
+                 p.height,
+                 p.weight,
+                 p.mobilePhone,
+                 p.age,
+                 p.id},
+                err)
+            && PatientRevisions::recordUpdated(db, before, p, userId, err);
+    });
 }
 
 static bool deletePatientById(const QString& id, QString* error)
@@ -114,56 +164,190 @@ PatientPage::PatientPage(QWidget* parent)
     m_keyword->setPlaceholderText(QStringLiteral("输入身份证/姓名/手机号关键字"));
     m_searchBtn = new QPushButton(QStringLiteral("查找"), this);
     m_addBtn = new QPushButton(QStringLiteral("添加"), this);
+    m_importBtn = new QPushButton(QStringLiteral("导入"), this);
+    m_exportBtn = new QPushButton(QStringLiteral("导出"), this);
     m_deleteBtn = new QPushButton(QStringLiteral("删除"), this);
     m_editBtn = new QPushButton(QStringLiteral("修改"), this);
+    m_revisionsBtn = new QPushButton(QStringLiteral("历史版本"), this);
 
     top->addWidget(m_keyword, 1);
     top->addWidget(m_searchBtn);
     top->addWidget(m_addBtn);
+    top->addWidget(m_importBtn);
+    top->addWidget(m_exportBtn);
     top->addWidget(m_deleteBtn);
     top->addWidget(m_editBtn);
+    top->addWidget(m_revisionsBtn);
     root->addLayout(top);
 
-    m_model = new PatientModel(this);
-
     m_table = new QTableView(this);
-    m_table->setModel(m_model);
     m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
-    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_table->setSelectionMode(QAbstractItemView::ExtendedSelection);
     m_table->setAlternatingRowColors(true);
     m_table->horizontalHeader()->setStretchLastSection(true);
     m_table->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::SelectedClicked);
-    m_table->setItemDelegate(new PatientDelegate(m_model, m_table));
+
+    if (PatientGridCache::enabled()) {
+        m_cacheWriter = new PatientGridCacheWriter(this);
+        QString err;
+        m_cache = PatientGridCache::open(this, &err);
+        if (!m_cache) {
+            qInfo("PatientPage: grid cache not used: %s", qPrintable(err));
+        }
+    }
+    if (m_cache) {
+        m_table->setModel(m_cache);
+        m_table->setColumnHidden(m_cache->fieldIndex(QStringLiteral("CREATED_MS")), true);
+        // 缓存是只读的，双击时先换成真实模型再进入编辑。
+        connect(m_table, &QAbstractItemView::doubleClicked, this, [this](const QModelIndex& index) {
+            if (!m_cache) {
+                return;
+            }
+            adoptModel();
+            m_table->edit(m_model->index(index.row(), index.column()));
+        });
+        QTimer::singleShot(0, this, &PatientPage::catchUp);
+    } else {
+        adoptModel();
+    }
     root->addWidget(m_table, 1);
 
     connect(m_searchBtn, &QPushButton::clicked, this, &PatientPage::onSearch);
     connect(m_keyword, &QLineEdit::returnPressed, this, &PatientPage::onSearch);
     connect(m_addBtn, &QPushButton::clicked, this, &PatientPage::onAdd);
+    connect(m_importBtn, &QPushButton::clicked, this, &PatientPage::onImport);
+    connect(m_exportBtn, &QPushButton::clicked, this, &PatientPage::onExport);
     connect(m_editBtn, &QPushButton::clicked, this, &PatientPage::onEdit);
     connect(m_deleteBtn, &QPushButton::clicked, this, &PatientPage::onDelete);
+    connect(m_revisionsBtn, &QPushButton::clicked, this, &PatientPage::onRevisions);
 }
 
 void PatientPage::setCurrentUserId(const QString& userId)
 {
     m_userId = userId;
+    if (m_model) {
+        m_model->setCurrentUserId(userId);
+    }
+}
+
+void PatientPage::catchUp()
+{
+    if (!m_cache) {
+        return;
+    }
+    if (!m_model) {
+        // 建模型本身（select 和首批取数）算一片。
+        createModel();
+        QTimer::singleShot(0, this, &PatientPage::catchUp);
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    while (m_model->rowCount() < m_cache->rowCount() && m_model->canFetchMore()) {
+        m_model->fetchMore();
+        if (timer.elapsed() >= kCatchUpSliceMs) {
+            QTimer::singleShot(0, this, &PatientPage::catchUp);
+            return;
+        }
+    }
+    qInfo("PatientPage: model caught up with grid cache (%d rows)", m_model->rowCount());
+    adoptModel();
+}
+
+void PatientPage::createModel()
+{
+    m_model = new PatientModel(this);
+    m_model->setCurrentUserId(m_userId);
+    if (m_cacheWriter) {
+        // 表内容变了（重新查询、表格内编辑）就在后台重写缓存；只换了过滤条件时写入端发现版本没变会直接跳过。
+        connect(m_model, &QAbstractItemModel::modelReset, m_cacheWriter, [this] { m_cacheWriter->schedule(); });
+        connect(m_model, &QAbstractItemModel::dataChanged, m_cacheWriter, [this] { m_cacheWriter->schedule(); });
+    }
+}
+
+void PatientPage::adoptModel()
+{
+    if (!m_model) {
+        createModel();
+    }
+    if (m_table->model() == m_model) {
+        return;
+    }
+
+    // 从缓存换过来时保留滚动位置、当前格和选择，需要的行先取到。
+    int top = -1;
+    QModelIndex current;
+    QItemSelection selection;
+    if (m_cache) {
+        top = m_table->rowAt(0);
+        current = m_table->currentIndex();
+        selection = m_table->selectionModel()->selection();
+        int needed = qMax(m_table->rowAt(m_table->viewport()->height() - 1), current.row());
+        for (const auto& range : selection) {
+            needed = qMax(needed, range.bottom());
+        }
+        while (m_model->rowCount() <= needed && m_model->canFetchMore()) {
+            m_model->fetchMore();
+        }
+    }
+
+    auto* oldSelection = m_table->selectionModel();
+    m_table->setModel(m_model);
+    delete oldSelection;
+    m_table->setItemDelegate(new PatientDelegate(m_model, m_table));
+    m_table->setColumnHidden(m_model->fieldIndex(QStringLiteral("CREATED_MS")), true);
+
+    if (m_cache) {
+        const int rows = m_model->rowCount();
+        if (top >= 0 && top < rows) {
+            m_table->scrollTo(m_model->index(top, 0), QAbstractItemView::PositionAtTop);
+        }
+        if (current.isValid() && current.row() < rows) {
+            m_table->selectionModel()->setCurrentIndex(m_model->index(current.row(), current.column()), QItemSelectionModel::NoUpdate);
+        }
+        QItemSelection restored;
+        for (const auto& range : selection) {
+            if (range.top() < rows) {
+                restored.select(m_model->index(range.top(), range.left()),
+                                m_model->index(qMin(range.bottom(), rows - 1), range.right()));
+            }
+        }
+        m_table->selectionModel()->select(restored, QItemSelectionModel::Select);
+        m_cache->deleteLater();
+        m_cache = nullptr;
+    }
+    if (m_cacheWriter) {
+        m_cacheWriter->schedule();
+    }
 }
 
 void PatientPage::onSearch()
 {
+    adoptModel();
     m_model->setKeywordFilter(m_keyword->text());
 }
 
 int PatientPage::selectedRow() const
 {
-    const auto idx = m_table->currentIndex();
-    if (!idx.isValid()) {
-        return -1;
+    const auto rows = m_table->selectionModel()->selectedRows();
+    return rows.size() == 1 ? rows.constFirst().row() : -1;
+}
+
+QStringList PatientPage::selectedIds() const
+{
+    QStringList ids;
+    const auto rows = m_table->selectionModel()->selectedRows();
+    ids.reserve(rows.size());
+    for (const auto& idx : rows) {
+        ids << m_model->record(idx.row()).value(QStringLiteral("ID")).toString();
     }
-    return idx.row();
+    return ids;
 }
 
 void PatientPage::onAdd()
 {
+    adoptModel();
     Patient p;
     p.id = nextSimpleId(QStringLiteral("hz"), QStringLiteral("Patient"));
     p.dob = QDate::currentDate();
@@ -182,20 +366,48 @@ void PatientPage::onAdd()
     }
 
     QString err;
-    if (!insertPatient(p, &err)) {
+    if (!insertPatient(p, m_userId, &err)) {
         QMessageBox::critical(this, QStringLiteral("添加失败"), err);
         return;
     }
 
     m_model->select();
-    HistoryLogger::logEvent(m_userId, QStringLiteral("添加患者：%1(%2)").arg(p.name, p.id));
+    HistoryLogger::log(m_userId, HistoryLogger::Action::Create, HistoryLogger::Entity::Patient, p.id, p.name);
+}
+
+void PatientPage::onImport()
+{
+    adoptModel();
+    const auto path = QFileDialog::getOpenFileName(this, QStringLiteral("选择 CSV 文件"), {}, QStringLiteral("CSV 文件 (*.csv);;所有文件 (*)"));
+    if (path.isEmpty()) {
+        return;
+    }
+
+    ImportDialog dlg(CsvImporter::Target::Patients, path, this);
+    dlg.exec();
+    if (dlg.imported() > 0) {
+        m_model->select();
+        HistoryLogger::log(m_userId,
+                           HistoryLogger::Action::Import,
+                           HistoryLogger::Entity::Patient,
+                           {},
+                           QStringLiteral("%1条(%2)").arg(dlg.imported()).arg(QFileInfo(path).fileName()));
+    }
+}
+
+void PatientPage::onExport()
+{
+    adoptModel();
+    // 按当前查找条件导出，直接读表，不依赖表格已加载的行。
+    ExportDialog::start(TableExporter::patients(m_model->filter()), QStringLiteral("患者"), this);
 }
 
 void PatientPage::onEdit()
 {
+    adoptModel();
     const int row = selectedRow();
     if (row < 0) {
-        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请先选择一行。"));
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请选择一行（只能选一行）。"));
         return;
     }
 
@@ -216,19 +428,40 @@ void PatientPage::onEdit()
     }
 
     QString err;
-    if (!updatePatient(p, &err)) {
+    if (!updatePatient(p, m_userId, &err)) {
         QMessageBox::critical(this, QStringLiteral("修改失败"), err);
         return;
     }
     m_model->select();
-    HistoryLogger::logEvent(m_userId, QStringLiteral("修改患者：%1(%2)").arg(p.name, p.id));
+    HistoryLogger::log(m_userId, HistoryLogger::Action::Update, HistoryLogger::Entity::Patient, p.id, p.name);
+}
+
+void PatientPage::onRevisions()
+{
+    adoptModel();
+    const int row = selectedRow();
+    if (row < 0) {
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请选择一行（只能选一行）。"));
+        return;
+    }
+
+    const auto rec = m_model->record(row);
+    PatientRevisionDialog dlg(rec.value(QStringLiteral("ID")).toString(), rec.value(QStringLiteral("NAME")).toString(), this);
+    dlg.exec();
 }
 
 void PatientPage::onDelete()
 {
+    adoptModel();
+    const auto ids = selectedIds();
+    if (ids.size() > 1) {
+        onBulkDelete(ids);
+        return;
+    }
+
     const int row = selectedRow();
     if (row < 0) {
-        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请先选择一行。"));
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请选择一行（只能选一行）。"));
         return;
     }
 
@@ -248,5 +481,27 @@ void PatientPage::onDelete()
         return;
     }
     m_model->select();
-    HistoryLogger::logEvent(m_userId, QStringLiteral("删除患者：%1(%2)").arg(name, id));
+    HistoryLogger::log(m_userId, HistoryLogger::Action::Delete, HistoryLogger::Entity::Patient, id, name);
+}
+
+void PatientPage::onBulkDelete(const QStringList& ids)
+{
+    if (QMessageBox::question(this,
+                             QStringLiteral("确认删除"),
+                             QStringLiteral("确定删除选中的 %1 条患者记录？").arg(ids.size()))
+        != QMessageBox::Yes) {
+        return;
+    }
+
+    QString err;
+    if (!DbManager::instance().execBulk(QStringLiteral("DELETE FROM Patient WHERE ID IN (%1);"), {}, ids, &err)) {
+        QMessageBox::critical(this, QStringLiteral("删除失败"), err);
+        return;
+    }
+    m_model->select();
+    HistoryLogger::log(m_userId,
+                       HistoryLogger::Action::BulkDelete,
+                       HistoryLogger::Entity::Patient,
+                       {},
+                       QStringLiteral("%1条(%2)").arg(ids.size()).arg(HistoryLogger::summarizeIds(ids)));
 }
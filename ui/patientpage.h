@@ -1,7 +1,10 @@
 #pragma once
 
+#include <QStringList>
 #include <QWidget>
 
+class PatientGridCache;
+class PatientGridCacheWriter;
 class PatientModel;
 class QLineEdit;
 class QPushButton;
@@ -19,19 +22,36 @@ public:
 private:
     void onSearch();
     void onAdd();
+    void onImport();
+    void onExport();
     void onEdit();
     void onDelete();
+    void onRevisions();
+    void onBulkDelete(const QStringList& ids);
 
+    // 有有效的启动缓存时先显示缓存，PatientModel 分片取数追上后再换上去；
+    // 任何需要真实数据的操作都会先调用 adoptModel() 立即换过去。
+    void catchUp();
+    void createModel();
+    void adoptModel();
+
+    // 恰好选中一行时返回该行，否则返回 -1（当前行可能不在选区内，不能用）。
     int selectedRow() const;
+    QStringList selectedIds() const;
 
     QString m_userId;
     PatientModel* m_model = nullptr;
+    PatientGridCache* m_cache = nullptr;
+    PatientGridCacheWriter* m_cacheWriter = nullptr;
 
     QLineEdit* m_keyword = nullptr;
     QPushButton* m_searchBtn = nullptr;
     QPushButton* m_addBtn = nullptr;
+    QPushButton* m_importBtn = nullptr;
+    QPushButton* m_exportBtn = nullptr;
     QPushButton* m_deleteBtn = nullptr;
     QPushButton* m_editBtn = nullptr;
+    QPushButton* m_revisionsBtn = nullptr;
     QTableView* m_table = nullptr;
 };
 
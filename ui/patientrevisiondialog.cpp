@@ -0,0 +1,178 @@
+#include "patientrevisiondialog.h"
+
+#include "db/dbmanager.h"
+#include "db/lookupcache.h"
+
+#include <QDateTime>
+#include <QDialogButtonBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+#include <iterator>
+
+static QString formatBytes(qint64 bytes)
+{
+    if (bytes < 1024) {
+        return QStringLiteral("%1 B").arg(bytes);
+    }
+    if (bytes < 1024 * 1024) {
+        return QStringLiteral("%1 KB").arg(bytes / 1024.0, 0, 'f', 1);
+    }
+    return QStringLiteral("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+PatientRevisionDialog::PatientRevisionDialog(const QString& patientId, const QString& name, QWidget* parent)
+    : QDialog(parent), m_patientId(patientId)
+{
+    setWindowTitle(QStringLiteral("历史版本 - %1(%2)").arg(name, patientId));
+    setModal(true);
+    resize(820, 460);
+
+    auto* root = new QVBoxLayout(this);
+    auto* body = new QHBoxLayout();
+
+    m_list = new QTableWidget(0, 4, this);
+    m_list->setHorizontalHeaderLabels(
+        {QStringLiteral("版本"), QStringLiteral("时间"), QStringLiteral("操作人"), QStringLiteral("改动字段")});
+    m_list->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_list->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_list->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_list->verticalHeader()->setVisible(false);
+    m_list->horizontalHeader()->setStretchLastSection(true);
+    body->addWidget(m_list, 3);
+
+    m_detail = new QTableWidget(0, 2, this);
+    m_detail->setHorizontalHeaderLabels({QStringLiteral("字段"), QStringLiteral("值")});
+    m_detail->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_detail->verticalHeader()->setVisible(false);
+    m_detail->horizontalHeader()->setStretchLastSection(true);
+    body->addWidget(m_detail, 2);
+    root->addLayout(body, 1);
+
+    m_report = new QLabel(this);
+    m_report->setWordWrap(true);
+    root->addWidget(m_report);
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    buttons->button(QDialogButtonBox::Close)->setText(QStringLiteral("关闭"));
+    root->addWidget(buttons);
+
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(m_list, &QTableWidget::currentCellChanged, this, [this](int row) { showRevision(row); });
+
+    loadRevisions();
+    showReport();
+}
+
+void PatientRevisionDialog::loadRevisions()
+{
+    QString err;
+    m_revisions = PatientRevisions::list(DbManager::instance().database(), m_patientId, &err);
+    if (!err.isEmpty()) {
+        m_report->setText(err);
+        return;
+    }
+
+    LookupCache::users().refresh();
+    m_list->setRowCount(m_revisions.size());
+    for (int i = 0; i < m_revisions.size(); ++i) {
+        const auto& r = m_revisions.at(i);
+        const bool baseline = r.tsMs == 0;
+        m_list->setItem(i, 0, new QTableWidgetItem(QString::number(r.rev)));
+        m_list->setItem(i, 1,
+                        new QTableWidgetItem(baseline ? QStringLiteral("开始记录前")
+                                                      : QDateTime::fromMSecsSinceEpoch(r.tsMs).toString(
+                                                          QStringLiteral("yyyy-MM-dd HH:mm:ss"))));
+        m_list->setItem(i, 2, new QTableWidgetItem(LookupCache::users().valueOf(r.userId)));
+        const auto changes = r.mask == PatientRevisions::AllFields ? QStringLiteral("（完整记录）")
+                                                                    : PatientRevisions::fieldNames(r.mask);
+        m_list->setItem(i, 3, new QTableWidgetItem(changes));
+    }
+    m_list->resizeColumnsToContents();
+    if (!m_revisions.isEmpty()) {
+        m_list->setCurrentCell(0, 0);
+    }
+}
+
+void PatientRevisionDialog::showRevision(int row)
+{
+    m_detail->setRowCount(0);
+    if (row < 0 || row >= m_revisions.size()) {
+        return;
+    }
+
+    const auto& r = m_revisions.at(row);
+    Patient p;
+    QString err;
+    if (!PatientRevisions::load(DbManager::instance().database(), m_patientId, r.rev, &p, &err)) {
+        m_report->setText(err);
+        return;
+    }
+
+    // 与上一版比较，快照版本也能标出真正改动的字段。
+    quint32 changed = r.mask;
+    if (row + 1 < m_revisions.size()) {
+        Patient prev;
+        if (PatientRevisions::load(DbManager::instance().database(), m_patientId, m_revisions.at(row + 1).rev, &prev)) {
+            changed = PatientRevisions::diff(prev, p);
+        }
+    }
+
+    const struct {
+        PatientRevisions::Field field;
+        QString label;
+        QString value;
+    } fields[] = {
+        {PatientRevisions::IdCard, QStringLiteral("身份证"), p.idCard},
+        {PatientRevisions::Name, QStringLiteral("姓名"), p.name},
+        {PatientRevisions::Sex, QStringLiteral("性别"), p.sex == 1 ? QStringLiteral("男") : QStringLiteral("女")},
+        {PatientRevisions::Dob, QStringLiteral("出生日期"), p.dob.toString(QStringLiteral("yyyy/M/d"))},
+        {PatientRevisions::Height, QStringLiteral("身高(cm)"), QString::number(p.height, 'f', 1)},
+        {PatientRevisions::Weight, QStringLiteral("体重(kg)"), QString::number(p.weight, 'f', 1)},
+        {PatientRevisions::MobilePhone, QStringLiteral("手机号"), p.mobilePhone},
+        {PatientRevisions::Age, QStringLiteral("年龄"), QString::number(p.age)},
+    };
+    m_detail->setRowCount(int(std::size(fields)));
+    int i = 0;
+    for (const auto& f : fields) {
+        auto* label = new QTableWidgetItem(f.label);
+        auto* value = new QTableWidgetItem(f.value);
+        if (changed & f.field) {
+            auto font = value->font();
+            font.setBold(true);
+            label->setFont(font);
+            value->setFont(font);
+        }
+        m_detail->setItem(i, 0, label);
+        m_detail->setItem(i, 1, value);
+        ++i;
+    }
+    m_detail->resizeColumnToContents(0);
+}
+
+void PatientRevisionDialog::showReport()
+{
+    PatientRevisions::Report r;
+    QString err;
+    if (!PatientRevisions::report(DbManager::instance().database(), &r, &err)) {
+        m_report->setText(err);
+        return;
+    }
+
+    const qint64 stored = r.deltaBytes + r.snapshotBytes;
+    auto text = QStringLiteral("全部患者共 %1 个版本（%2 个完整快照），涉及 %3 名患者；版本数据 %4，其中增量 %5")
+                    .arg(r.revisions)
+                    .arg(r.snapshots)
+                    .arg(r.patients)
+                    .arg(formatBytes(stored), formatBytes(r.deltaBytes));
+    if (r.fullCopyBytes > 0) {
+        text += QStringLiteral("；每版存整条记录约需 %1，节省 %2%")
+                    .arg(formatBytes(r.fullCopyBytes))
+                    .arg(qMax<qint64>(0, 100 - stored * 100 / r.fullCopyBytes));
+    }
+    m_report->setText(text + QStringLiteral("。"));
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QDialog>
+
+#include "db/patientrevisions.h"
+
+class QLabel;
+class QTableWidget;
+
+// 某个患者的历史版本：左侧版本列表，右侧为选中版本还原出的完整记录（本版改动的字段加粗）。
+class PatientRevisionDialog final : public QDialog
+{
+    Q_OBJECT
+
+public:
+    PatientRevisionDialog(const QString& patientId, const QString& name, QWidget* parent = nullptr);
+
+private:
+    void loadRevisions();
+    void showRevision(int row);
+    void showReport();
+
+    QString m_patientId;
+    QVector<PatientRevisions::Revision> m_revisions;
+
+    QTableWidget* m_list = nullptr;
+    QTableWidget* m_detail = nullptr;
+    QLabel* m_report = nullptr;
+};